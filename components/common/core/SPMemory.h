@@ -70,6 +70,12 @@ using Map = stappler::memory::map<K, V, Compare>;
 template <typename T, typename Compare = std::less<void>>
 using Set = stappler::memory::set<T, Compare>;
 
+template <typename K, typename V, typename Hash = stappler::memory::default_hash<K>, typename Equal = std::equal_to<void>>
+using UnorderedMap = stappler::memory::unordered_map<K, V, Hash, Equal>;
+
+template <typename T, typename Hash = stappler::memory::default_hash<T>, typename Equal = std::equal_to<void>>
+using UnorderedSet = stappler::memory::unordered_set<T, Hash, Equal>;
+
 template <typename T>
 using Function = stappler::memory::function<T>;
 
@@ -137,6 +143,12 @@ using Map = std::map<K, V, Compare>;
 template <typename T, typename Compare = std::less<void>>
 using Set = std::set<T, Compare>;
 
+template <typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+using UnorderedMap = std::unordered_map<K, V, Hash, Equal>;
+
+template <typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>>
+using UnorderedSet = std::unordered_set<T, Hash, Equal>;
+
 template <typename T>
 using Function = std::function<T>;
 
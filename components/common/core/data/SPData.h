@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "SPDataEncode.h"
 #include "SPDataDecode.h"
+#include "SPDataCompact.h"
 
 NS_SP_EXT_BEGIN(data)
 
@@ -0,0 +1,1128 @@
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#ifndef COMMON_DATA_SPDATACOMPACT_H_
+#define COMMON_DATA_SPDATACOMPACT_H_
+
+#include "SPDataEncode.h"
+#include "SPDataDecode.h"
+
+NS_SP_EXT_BEGIN(data)
+
+// Read-only flat representation for large data trees
+//
+// All nodes live in one contiguous array, children of every container are stored
+// as a contiguous range, container refers to it with (offset, size) pair. Nodes are
+// written in post-order, so root is the last node, and tree can be built in one pass
+// without knowing container sizes in advance.
+//
+// Dictionary keys are interned: every distinct key is stored once, node holds only
+// key index. Strings and byte strings up to 8 bytes are stored within the node itself,
+// larger ones - in shared arena. Dictionary children are sorted by key, so lookup is
+// a binary search.
+//
+// Offsets are 32-bit, so single value is limited with 4G nodes and 4GiB of string data.
+
+template <typename Interface>
+class CompactValueTemplate : public Interface::AllocBaseType {
+public:
+	using Self = CompactValueTemplate<Interface>;
+	using ValueType = ValueTemplate<Interface>;
+	using Type = typename ValueType::Type;
+	using BytesType = typename Interface::BytesType;
+
+	static constexpr uint32_t KeyNone = maxOf<uint32_t>();
+	static constexpr size_t InlineSize = 8;
+
+	struct Span {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	struct Node {
+		Type type = Type::EMPTY;
+		uint8_t inlined = 0; // size + 1 for inlined strings and bytes
+		uint16_t reserved = 0;
+		uint32_t key = KeyNone;
+
+		union {
+			int64_t intVal;
+			double doubleVal;
+			bool boolVal;
+			Span span; // arena range for strings and bytes, children range for containers
+			char inlineData[InlineSize];
+		};
+
+		Node() : intVal(0) { }
+	};
+
+	class View;
+	class Builder;
+
+	class Iterator {
+	public:
+		Iterator(const Self *v, const Node *n) : _value(v), _node(n) { }
+
+		View operator*() const { return View(_value, _node); }
+		Iterator & operator++() { ++ _node; return *this; }
+		bool operator==(const Iterator &it) const { return _node == it._node; }
+		bool operator!=(const Iterator &it) const { return _node != it._node; }
+
+	protected:
+		const Self *_value;
+		const Node *_node;
+	};
+
+	class View {
+	public:
+		View() : _value(nullptr), _node(nullptr) { }
+		View(const Self *v, const Node *n) : _value(v), _node(n) { }
+
+		operator bool() const { return _node && _node->type != Type::EMPTY && _node->type != Type::NONE; }
+
+		Type getType() const { return _node ? _node->type : Type::NONE; }
+
+		bool isNull() const { return !_node || _node->type == Type::EMPTY || _node->type == Type::NONE; }
+		bool isBasicType() const { return _node && _node->type != Type::ARRAY && _node->type != Type::DICTIONARY; }
+		bool isArray() const { return getType() == Type::ARRAY; }
+		bool isDictionary() const { return getType() == Type::DICTIONARY; }
+		bool isBool() const { return getType() == Type::BOOLEAN; }
+		bool isInteger() const { return getType() == Type::INTEGER; }
+		bool isDouble() const { return getType() == Type::DOUBLE; }
+		bool isString() const { return getType() == Type::CHARSTRING; }
+		bool isBytes() const { return getType() == Type::BYTESTRING; }
+
+		bool getBool() const;
+		int64_t getInteger(int64_t def = 0) const;
+		double getDouble(double def = 0) const;
+		StringView getString() const;
+		BytesView getBytes() const;
+
+		// key of this node within parent dictionary
+		StringView getKey() const { return _node ? _value->getKey(_node->key) : StringView(); }
+
+		size_t size() const { return (isArray() || isDictionary()) ? _node->span.size : 0; }
+		bool empty() const { return size() == 0; }
+
+		View getValue(size_t) const;
+		View getValue(const StringView &) const;
+
+		template <typename Key> bool hasValue(Key &&key) const { return getValue(std::forward<Key>(key)).getType() != Type::NONE; }
+
+		Iterator begin() const;
+		Iterator end() const;
+
+		template <class Stream, class Traits = StreamTraits<Stream>>
+		void encode(Stream &stream) const;
+
+		template <typename NewInterface = Interface>
+		auto toValue() const -> ValueTemplate<NewInterface>;
+
+	protected:
+		const Self *_value;
+		const Node *_node;
+	};
+
+	class Builder : public Interface::AllocBaseType {
+	public:
+		Builder() { }
+
+		void reserve(size_t nodes, size_t strings);
+
+		void beginArray();
+		void beginDict();
+		void end();
+
+		void key(const StringView &);
+
+		void value(nullptr_t);
+		void value(bool);
+		void value(int64_t);
+		void value(double);
+		void value(const StringView &);
+		void bytes(const BytesView &);
+
+		template <typename OtherInterface>
+		void value(const ValueTemplate<OtherInterface> &);
+
+		Self finalize();
+
+	protected:
+		struct Frame {
+			Type type;
+			uint32_t key;
+			size_t start;
+		};
+
+		Node &emplace(Type);
+		Span pushData(const uint8_t *, size_t);
+		void pushInline(Node &, const uint8_t *, size_t);
+		uint32_t intern(const StringView &);
+		void rehash(size_t);
+		StringView getKey(uint32_t) const;
+
+		uint32_t _nextKey = KeyNone;
+		typename Interface::template ArrayType<Node> _nodes;
+		typename Interface::template ArrayType<Node> _pending; // children of unfinished containers
+		typename Interface::template ArrayType<Frame> _frames;
+		typename Interface::template ArrayType<Span> _keys;
+		typename Interface::template ArrayType<uint32_t> _keysTable; // open addressing, key index + 1
+		BytesType _strings;
+	};
+
+	CompactValueTemplate() { }
+
+	template <typename OtherInterface>
+	explicit CompactValueTemplate(const ValueTemplate<OtherInterface> &);
+
+	View root() const { return _nodes.empty() ? View() : View(this, &_nodes.back()); }
+	operator View() const { return root(); }
+
+	Type getType() const { return root().getType(); }
+	size_t size() const { return root().size(); }
+	bool empty() const { return _nodes.empty(); }
+
+	template <typename Key> View getValue(Key &&key) const { return root().getValue(std::forward<Key>(key)); }
+	template <typename Key> bool hasValue(Key &&key) const { return root().hasValue(std::forward<Key>(key)); }
+
+	template <typename NewInterface = Interface>
+	auto toValue() const -> ValueTemplate<NewInterface> { return root().template toValue<NewInterface>(); }
+
+	template <class Stream, class Traits = StreamTraits<Stream>>
+	void encode(Stream &stream) const { if (!_nodes.empty()) { root().encode(stream); } }
+
+	size_t getNodesCount() const { return _nodes.size(); }
+	size_t getKeysCount() const { return _keys.size(); }
+
+	// bytes, allocated by value storage
+	size_t getMemoryUsage() const {
+		return sizeof(Self) + _nodes.capacity() * sizeof(Node) + _keys.capacity() * sizeof(Span) + _strings.capacity();
+	}
+
+	StringView getKey(uint32_t idx) const {
+		if (idx < _keys.size()) {
+			return StringView((const char *)_strings.data() + _keys[idx].offset, _keys[idx].size);
+		}
+		return StringView();
+	}
+
+protected:
+	friend class Builder;
+	friend class View;
+
+	const uint8_t *getData(const Node &node) const {
+		return node.inlined ? (const uint8_t *)node.inlineData : _strings.data() + node.span.offset;
+	}
+
+	size_t getDataSize(const Node &node) const {
+		return node.inlined ? size_t(node.inlined - 1) : size_t(node.span.size);
+	}
+
+	typename Interface::template ArrayType<Node> _nodes;
+	typename Interface::template ArrayType<Span> _keys;
+	BytesType _strings;
+};
+
+static_assert(sizeof(CompactValueTemplate<memory::DefaultInterface>::Node) == 16, "Compact node should fit into 16 bytes");
+
+template <typename Interface>
+bool CompactValueTemplate<Interface>::View::getBool() const {
+	switch (getType()) {
+	case Type::BOOLEAN: return _node->boolVal; break;
+	case Type::INTEGER: return _node->intVal != 0; break;
+	case Type::DOUBLE: return _node->doubleVal != 0.0; break;
+	default: break;
+	}
+	return false;
+}
+
+template <typename Interface>
+int64_t CompactValueTemplate<Interface>::View::getInteger(int64_t def) const {
+	switch (getType()) {
+	case Type::BOOLEAN: return _node->boolVal ? 1 : 0; break;
+	case Type::INTEGER: return _node->intVal; break;
+	case Type::DOUBLE: return int64_t(_node->doubleVal); break;
+	default: break;
+	}
+	return def;
+}
+
+template <typename Interface>
+double CompactValueTemplate<Interface>::View::getDouble(double def) const {
+	switch (getType()) {
+	case Type::BOOLEAN: return _node->boolVal ? 1.0 : 0.0; break;
+	case Type::INTEGER: return double(_node->intVal); break;
+	case Type::DOUBLE: return _node->doubleVal; break;
+	default: break;
+	}
+	return def;
+}
+
+template <typename Interface>
+StringView CompactValueTemplate<Interface>::View::getString() const {
+	if (isString()) {
+		return StringView((const char *)_value->getData(*_node), _value->getDataSize(*_node));
+	}
+	return StringView();
+}
+
+template <typename Interface>
+BytesView CompactValueTemplate<Interface>::View::getBytes() const {
+	if (isBytes()) {
+		return BytesView(_value->getData(*_node), _value->getDataSize(*_node));
+	}
+	return BytesView();
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::View::getValue(size_t idx) const -> View {
+	if (isArray() || isDictionary()) {
+		if (idx < _node->span.size) {
+			return View(_value, _value->_nodes.data() + _node->span.offset + idx);
+		}
+	}
+	return View();
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::View::getValue(const StringView &key) const -> View {
+	if (isDictionary()) {
+		auto first = _value->_nodes.data() + _node->span.offset;
+		auto last = first + _node->span.size;
+		auto keys = _value->_keys.data();
+		auto strings = (const char *)_value->_strings.data();
+
+		// typical dictionary (record) is small, for it linear scan, that compares key sizes first,
+		// is faster then binary search with full string comparison on every step
+		if (_node->span.size <= 8) {
+			for (auto it = first; it != last; ++ it) {
+				auto &k = keys[it->key];
+				if (k.size == key.size() && memcmp(strings + k.offset, key.data(), k.size) == 0) {
+					return View(_value, it);
+				}
+			}
+			return View();
+		}
+
+		auto it = std::lower_bound(first, last, key, [&] (const Node &l, const StringView &r) {
+			auto &k = keys[l.key];
+			return StringView(strings + k.offset, k.size) < r;
+		});
+		if (it != last) {
+			auto &k = keys[it->key];
+			if (StringView(strings + k.offset, k.size) == key) {
+				return View(_value, it);
+			}
+		}
+	}
+	return View();
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::View::begin() const -> Iterator {
+	if (isArray() || isDictionary()) {
+		return Iterator(_value, _value->_nodes.data() + _node->span.offset);
+	}
+	return Iterator(_value, nullptr);
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::View::end() const -> Iterator {
+	if (isArray() || isDictionary()) {
+		return Iterator(_value, _value->_nodes.data() + _node->span.offset + _node->span.size);
+	}
+	return Iterator(_value, nullptr);
+}
+
+template <typename Interface>
+template <class Stream, class Traits>
+void CompactValueTemplate<Interface>::View::encode(Stream &stream) const {
+	bool begin = false;
+	if constexpr (Traits::onValue) { stream.onValue(*this); }
+	switch (getType()) {
+	case Type::EMPTY: stream.write(nullptr); break;
+	case Type::BOOLEAN: stream.write(_node->boolVal); break;
+	case Type::INTEGER: stream.write(_node->intVal); break;
+	case Type::DOUBLE: stream.write(_node->doubleVal); break;
+	case Type::CHARSTRING: stream.write(getString()); break;
+	case Type::BYTESTRING: stream.write(getBytes()); break;
+	case Type::ARRAY:
+		if constexpr (Traits::onBeginArray) { stream.onBeginArray(*this); }
+		for (auto it : *this) {
+			if (!begin) {
+				begin = true;
+			} else {
+				if constexpr (Traits::onNextValue) { stream.onNextValue(); }
+			}
+			if constexpr (Traits::onArrayValue) {
+				stream.onArrayValue(it);
+			} else {
+				it.encode(stream);
+			}
+		}
+		if constexpr (Traits::onEndArray) { stream.onEndArray(*this); }
+		break;
+	case Type::DICTIONARY:
+		if constexpr (Traits::onBeginDict) { stream.onBeginDict(*this); }
+		for (auto it : *this) {
+			if (!begin) {
+				begin = true;
+			} else {
+				if constexpr (Traits::onNextValue) { stream.onNextValue(); }
+			}
+			if constexpr (Traits::onKeyValuePair) {
+				stream.onKeyValuePair(it.getKey(), it);
+			} else if constexpr (Traits::onKey) {
+				stream.onKey(it.getKey());
+				it.encode(stream);
+			} else {
+				stream.write(it.getKey());
+				it.encode(stream);
+			}
+		}
+		if constexpr (Traits::onEndDict) { stream.onEndDict(*this); }
+		break;
+	default:
+		break;
+	}
+}
+
+template <typename Interface>
+template <typename NewInterface>
+auto CompactValueTemplate<Interface>::View::toValue() const -> ValueTemplate<NewInterface> {
+	using RetType = ValueTemplate<NewInterface>;
+	switch (getType()) {
+	case Type::BOOLEAN: return RetType(_node->boolVal); break;
+	case Type::INTEGER: return RetType(_node->intVal); break;
+	case Type::DOUBLE: return RetType(_node->doubleVal); break;
+	case Type::CHARSTRING: return RetType(getString()); break;
+	case Type::BYTESTRING: return RetType(getBytes()); break;
+	case Type::ARRAY: {
+		typename RetType::ArrayType arr;
+		arr.reserve(size());
+		for (auto it : *this) {
+			arr.emplace_back(it.template toValue<NewInterface>());
+		}
+		return RetType(std::move(arr));
+		break;
+	}
+	case Type::DICTIONARY: {
+		typename RetType::DictionaryType dict;
+		for (auto it : *this) {
+			auto key = it.getKey();
+			dict.emplace_hint(dict.end(), typename NewInterface::StringType(key.data(), key.size()),
+					it.template toValue<NewInterface>());
+		}
+		return RetType(std::move(dict));
+		break;
+	}
+	default: break;
+	}
+	return RetType();
+}
+
+template <typename Interface>
+template <typename OtherInterface>
+CompactValueTemplate<Interface>::CompactValueTemplate(const ValueTemplate<OtherInterface> &val) {
+	Builder builder;
+	builder.value(val);
+	*this = builder.finalize();
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::reserve(size_t nodes, size_t strings) {
+	_nodes.reserve(nodes);
+	_strings.reserve(strings);
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::beginArray() {
+	_frames.emplace_back(Frame{Type::ARRAY, _nextKey, _pending.size()});
+	_nextKey = KeyNone;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::beginDict() {
+	_frames.emplace_back(Frame{Type::DICTIONARY, _nextKey, _pending.size()});
+	_nextKey = KeyNone;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::end() {
+	if (_frames.empty()) {
+		return;
+	}
+
+	auto frame = _frames.back();
+	_frames.pop_back();
+
+	auto first = _pending.begin() + frame.start;
+	if (frame.type == Type::DICTIONARY) {
+		// keys are interned, so, equal keys has equal indexes and strings are compared only for distinct keys
+		auto cmp = [&] (const Node &l, const Node &r) {
+			return l.key != r.key && getKey(l.key) < getKey(r.key);
+		};
+		if (!std::is_sorted(first, _pending.end(), cmp)) {
+			std::stable_sort(first, _pending.end(), cmp);
+		}
+	}
+
+	Node node;
+	node.type = frame.type;
+	node.key = frame.key;
+	node.span.offset = uint32_t(_nodes.size());
+	node.span.size = uint32_t(_pending.size() - frame.start);
+
+	_nodes.insert(_nodes.end(), first, _pending.end());
+	_pending.erase(first, _pending.end());
+
+	if (_frames.empty()) {
+		_nodes.emplace_back(node);
+	} else {
+		_pending.emplace_back(node);
+	}
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::key(const StringView &str) {
+	_nextKey = intern(str);
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::value(nullptr_t) {
+	emplace(Type::EMPTY);
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::value(bool val) {
+	emplace(Type::BOOLEAN).boolVal = val;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::value(int64_t val) {
+	emplace(Type::INTEGER).intVal = val;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::value(double val) {
+	emplace(Type::DOUBLE).doubleVal = val;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::value(const StringView &val) {
+	pushInline(emplace(Type::CHARSTRING), (const uint8_t *)val.data(), val.size());
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::bytes(const BytesView &val) {
+	pushInline(emplace(Type::BYTESTRING), val.data(), val.size());
+}
+
+template <typename Interface>
+template <typename OtherInterface>
+void CompactValueTemplate<Interface>::Builder::value(const ValueTemplate<OtherInterface> &val) {
+	using OtherType = typename ValueTemplate<OtherInterface>::Type;
+
+	switch (val.getType()) {
+	case OtherType::EMPTY: value(nullptr); break;
+	case OtherType::BOOLEAN: value(val.getBool()); break;
+	case OtherType::INTEGER: value(val.getInteger()); break;
+	case OtherType::DOUBLE: value(val.getDouble()); break;
+	case OtherType::CHARSTRING: value(StringView(val.getString())); break;
+	case OtherType::BYTESTRING: bytes(BytesView(val.getBytes())); break;
+	case OtherType::ARRAY:
+		beginArray();
+		for (auto &it : val.getArray()) {
+			value(it);
+		}
+		end();
+		break;
+	case OtherType::DICTIONARY:
+		beginDict();
+		for (auto &it : val.getDict()) {
+			key(it.first);
+			value(it.second);
+		}
+		end();
+		break;
+	default:
+		break;
+	}
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::Builder::finalize() -> Self {
+	while (!_frames.empty()) {
+		end();
+	}
+
+	Self ret;
+	if (!_pending.empty()) {
+		// top-level scalar
+		_nodes.emplace_back(_pending.back());
+	}
+
+	_nodes.shrink_to_fit();
+	_keys.shrink_to_fit();
+	_strings.shrink_to_fit();
+
+	ret._nodes = std::move(_nodes);
+	ret._keys = std::move(_keys);
+	ret._strings = std::move(_strings);
+
+	_nodes.clear();
+	_pending.clear();
+	_keys.clear();
+	_keysTable.clear();
+	_strings.clear();
+	_nextKey = KeyNone;
+	return ret;
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::Builder::emplace(Type type) -> Node & {
+	auto &ret = _pending.emplace_back();
+	ret.type = type;
+	ret.key = _nextKey;
+	_nextKey = KeyNone;
+	return ret;
+}
+
+template <typename Interface>
+auto CompactValueTemplate<Interface>::Builder::pushData(const uint8_t *data, size_t size) -> Span {
+	Span ret{uint32_t(_strings.size()), uint32_t(size)};
+	_strings.insert(_strings.end(), data, data + size);
+	return ret;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::pushInline(Node &node, const uint8_t *data, size_t size) {
+	if (size <= InlineSize) {
+		node.inlined = uint8_t(size + 1);
+		memcpy(node.inlineData, data, size);
+	} else {
+		node.span = pushData(data, size);
+	}
+}
+
+template <typename Interface>
+uint32_t CompactValueTemplate<Interface>::Builder::intern(const StringView &str) {
+	if (_keys.size() * 2 >= _keysTable.size()) {
+		rehash(std::max(size_t(64), _keysTable.size() * 2));
+	}
+
+	auto mask = _keysTable.size() - 1;
+	auto slot = hash::hash32(str.data(), str.size()) & mask;
+	while (auto idx = _keysTable[slot]) {
+		if (getKey(idx - 1) == str) {
+			return idx - 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	auto idx = uint32_t(_keys.size());
+	_keys.emplace_back(pushData((const uint8_t *)str.data(), str.size()));
+	_keysTable[slot] = idx + 1;
+	return idx;
+}
+
+template <typename Interface>
+void CompactValueTemplate<Interface>::Builder::rehash(size_t size) {
+	_keysTable.clear();
+	_keysTable.resize(size, 0);
+
+	auto mask = size - 1;
+	for (uint32_t i = 0; i < _keys.size(); ++ i) {
+		auto key = getKey(i);
+		auto slot = hash::hash32(key.data(), key.size()) & mask;
+		while (_keysTable[slot]) {
+			slot = (slot + 1) & mask;
+		}
+		_keysTable[slot] = i + 1;
+	}
+}
+
+template <typename Interface>
+StringView CompactValueTemplate<Interface>::Builder::getKey(uint32_t idx) const {
+	if (idx < _keys.size()) {
+		return StringView((const char *)_strings.data() + _keys[idx].offset, _keys[idx].size);
+	}
+	return StringView();
+}
+
+using CompactValue = CompactValueTemplate<DefaultInterface>;
+
+namespace json {
+
+template <typename Interface>
+struct CompactEncoder : public Interface::AllocBaseType {
+	using ViewType = typename CompactValueTemplate<Interface>::View;
+
+	inline CompactEncoder(OutputStream *stream) : stream(stream) { }
+
+	inline void write(nullptr_t) { (*stream) << "null"; }
+	inline void write(bool value) { (*stream) << ((value)?"true":"false"); }
+	inline void write(int64_t value) { (*stream) << value; }
+	inline void write(double value) { (*stream) << std::setprecision(std::numeric_limits<double>::max_digits10) << value; }
+	inline void write(const StringView &str) { encodeString(*stream, str); }
+	inline void write(const BytesView &data) { (*stream) << '"' << "BASE64:"; base64url::encode(*stream, data); (*stream) << '"'; }
+	inline void onBeginArray(const ViewType &) { (*stream) << '['; }
+	inline void onEndArray(const ViewType &) { (*stream) << ']'; }
+	inline void onBeginDict(const ViewType &) { (*stream) << '{'; }
+	inline void onEndDict(const ViewType &) { (*stream) << '}'; }
+	inline void onKey(const StringView &str) { write(str); (*stream) << ':'; }
+	inline void onNextValue() { (*stream) << ','; }
+
+	OutputStream *stream;
+};
+
+// pretty-printed output is for debug purposes only, so it goes through data::Value
+template <typename Interface>
+inline void write(std::ostream &stream, const CompactValueTemplate<Interface> &val, bool pretty, bool timeMarkers = false) {
+	if (pretty) {
+		write(stream, val.toValue(), pretty, timeMarkers);
+	} else {
+		CompactEncoder<Interface> encoder(&stream);
+		val.encode(encoder);
+	}
+}
+
+template <typename Interface>
+inline auto write(const CompactValueTemplate<Interface> &val, bool pretty = false, bool timeMarkers = false) -> typename Interface::StringType {
+	typename Interface::StringStreamType stream;
+	write<Interface>(stream, val, pretty, timeMarkers);
+	return stream.str();
+}
+
+}
+
+namespace cbor {
+
+template <typename Interface>
+struct CompactEncoder : public Interface::AllocBaseType {
+	using ViewType = typename CompactValueTemplate<Interface>::View;
+
+	CompactEncoder(Encoder<Interface> &enc) : enc(enc) { }
+
+	inline void write(nullptr_t n) { _writeNull(enc, n); }
+	inline void write(bool value) { _writeBool(enc, value); }
+	inline void write(int64_t value) { _writeInt(enc, value); }
+	inline void write(double value) { _writeFloat(enc, value); }
+	inline void write(const StringView &str) { _writeString(enc, str); }
+	inline void write(const BytesView &data) { _writeBytes(enc, BytesViewTemplate<ByteOrder::Network>(data.data(), data.size())); }
+	inline void onBeginArray(const ViewType &arr) { _writeArrayStart(enc, arr.size()); }
+	inline void onBeginDict(const ViewType &dict) { _writeMapStart(enc, dict.size()); }
+
+	Encoder<Interface> &enc;
+};
+
+template <typename Interface>
+inline auto write(const CompactValueTemplate<Interface> &data) -> typename Interface::BytesType {
+	Encoder<Interface> enc(true);
+	if (enc.isOpen()) {
+		CompactEncoder<Interface> compact(enc);
+		data.encode(compact);
+		return enc.data();
+	}
+	return typename Interface::BytesType();
+}
+
+template <typename Interface>
+inline bool write(std::ostream &stream, const CompactValueTemplate<Interface> &data) {
+	Encoder<Interface> enc(&stream);
+	if (enc.isOpen()) {
+		CompactEncoder<Interface> compact(enc);
+		data.encode(compact);
+		return true;
+	}
+	return false;
+}
+
+template <typename Interface>
+struct CompactDecoder : public Interface::AllocBaseType {
+	using BuilderType = typename CompactValueTemplate<Interface>::Builder;
+	using Reader = BytesViewTemplate<ByteOrder::Endian::Network>;
+
+	CompactDecoder(Reader &r, BuilderType &builder) : r(r), builder(builder) { }
+
+	// returns false on end of data or on break marker
+	bool decodeNext() {
+		if (r.empty()) {
+			return false;
+		}
+
+		uint8_t type = r.readUnsigned();
+		auto majorType = (MajorTypeEncoded)(type & toInt(Flags::MajorTypeMaskEncoded));
+		type = type & toInt(Flags::AdditionalInfoMask);
+		if (majorType == MajorTypeEncoded::Simple && type == toInt(Flags::UndefinedLength)) {
+			return false;
+		}
+
+		decode(majorType, type);
+		return true;
+	}
+
+	void decode(MajorTypeEncoded majorType, uint8_t type) {
+		switch (majorType) {
+		case MajorTypeEncoded::Unsigned: builder.value(int64_t(_readIntValue(r, type))); break;
+		case MajorTypeEncoded::Negative: builder.value(int64_t(-1 - _readIntValue(r, type))); break;
+		case MajorTypeEncoded::ByteString: {
+			auto data = readString(type, MajorTypeEncoded::ByteString);
+			builder.bytes(BytesView((const uint8_t *)data.data(), data.size()));
+			break;
+		}
+		case MajorTypeEncoded::CharString: builder.value(readString(type, MajorTypeEncoded::CharString)); break;
+		case MajorTypeEncoded::Array:
+			builder.beginArray();
+			if (type == toInt(Flags::UndefinedLength)) {
+				while (decodeNext()) { }
+			} else {
+				auto size = _readIntValue(r, type);
+				for (uint64_t i = 0; i < size && decodeNext(); ++ i) { }
+			}
+			builder.end();
+			break;
+		case MajorTypeEncoded::Map:
+			builder.beginDict();
+			if (type == toInt(Flags::UndefinedLength)) {
+				while (decodePair()) { }
+			} else {
+				auto size = _readIntValue(r, type);
+				for (uint64_t i = 0; i < size && decodePair(); ++ i) { }
+			}
+			builder.end();
+			break;
+		case MajorTypeEncoded::Tag:
+			_readIntValue(r, type);
+			if (!decodeNext()) {
+				builder.value(nullptr);
+			}
+			break;
+		case MajorTypeEncoded::Simple:
+			decodeSimpleValue(type);
+			break;
+		}
+	}
+
+	bool decodePair() {
+		if (r.empty()) {
+			return false;
+		}
+
+		uint8_t type = r.readUnsigned();
+		auto majorType = (MajorTypeEncoded)(type & toInt(Flags::MajorTypeMaskEncoded));
+		type = type & toInt(Flags::AdditionalInfoMask);
+
+		StringView key;
+		switch (majorType) {
+		case MajorTypeEncoded::Unsigned:
+			buf = string::ToStringTraits<Interface>::toString(_readIntValue(r, type));
+			key = StringView(buf);
+			break;
+		case MajorTypeEncoded::Negative:
+			buf = string::ToStringTraits<Interface>::toString((int64_t)(-1 - _readIntValue(r, type)));
+			key = StringView(buf);
+			break;
+		case MajorTypeEncoded::ByteString:
+		case MajorTypeEncoded::CharString:
+			key = readString(type, majorType);
+			break;
+		case MajorTypeEncoded::Simple:
+			if (type == toInt(Flags::UndefinedLength)) {
+				return false;
+			}
+			skip(majorType, type);
+			break;
+		default:
+			skip(majorType, type);
+			break;
+		}
+
+		if (key.empty()) {
+			// key can not be converted to string, skip pair
+			return skipNext();
+		}
+
+		builder.key(key);
+		if (!decodeNext()) {
+			builder.value(nullptr);
+			return false;
+		}
+		return true;
+	}
+
+	void decodeSimpleValue(uint8_t type) {
+		if (type == toInt(Flags::Simple8Bit)) {
+			builder.value(int64_t(r.readUnsigned()));
+		} else if (type == toInt(Flags::AdditionalFloat16Bit)) {
+			builder.value(double(r.readFloat16()));
+		} else if (type == toInt(Flags::AdditionalFloat32Bit)) {
+			builder.value(double(r.readFloat32()));
+		} else if (type == toInt(Flags::AdditionalFloat64Bit)) {
+			builder.value(double(r.readFloat64()));
+		} else if (type == toInt(SimpleValue::Null) || type == toInt(SimpleValue::Undefined)) {
+			builder.value(nullptr);
+		} else if (type == toInt(SimpleValue::True)) {
+			builder.value(true);
+		} else if (type == toInt(SimpleValue::False)) {
+			builder.value(false);
+		} else {
+			builder.value(int64_t(type));
+		}
+	}
+
+	// returns view into source data for definite-length strings, chunks are joined in buffer otherwise
+	StringView readString(uint8_t type, MajorTypeEncoded rootType) {
+		if (type != toInt(Flags::UndefinedLength)) {
+			auto size = std::min(r.size(), size_t(_readIntValue(r, type)));
+			StringView ret((const char *)r.data(), size);
+			r.offset(size);
+			return ret;
+		}
+
+		buf.clear();
+		while (!r.empty()) {
+			type = r.readUnsigned();
+			auto majorType = (MajorTypeEncoded)(type & toInt(Flags::MajorTypeMaskEncoded));
+			type = type & toInt(Flags::AdditionalInfoMask);
+			if (majorType != rootType) {
+				break;
+			}
+
+			auto size = std::min(r.size(), size_t(_readIntValue(r, type)));
+			buf.append((const char *)r.data(), size);
+			r.offset(size);
+		}
+		return StringView(buf);
+	}
+
+	void skip(MajorTypeEncoded majorType, uint8_t type) {
+		BuilderType tmp;
+		CompactDecoder<Interface> dec(r, tmp);
+		dec.decode(majorType, type);
+	}
+
+	bool skipNext() {
+		BuilderType tmp;
+		CompactDecoder<Interface> dec(r, tmp);
+		return dec.decodeNext();
+	}
+
+	Reader &r;
+	BuilderType &builder;
+	typename Interface::StringType buf;
+};
+
+template <typename Interface>
+auto readCompact(const BytesViewTemplate<ByteOrder::Endian::Network> &data) -> CompactValueTemplate<Interface> {
+	// read CBOR id ( 0xd9d9f7 )
+	if (data.size() <= 3 || data[0] != 0xd9 || data[1] != 0xd9 || data[2] != 0xf7) {
+		return CompactValueTemplate<Interface>();
+	}
+
+	BytesViewTemplate<ByteOrder::Endian::Network> reader(data);
+	reader.offset(3);
+
+	typename CompactValueTemplate<Interface>::Builder builder;
+	CompactDecoder<Interface> dec(reader, builder);
+	dec.decodeNext();
+	return builder.finalize();
+}
+
+}
+
+namespace serenity {
+
+template <typename Interface>
+struct CompactEncoder : public Interface::AllocBaseType {
+	using ViewType = typename CompactValueTemplate<Interface>::View;
+	using Type = typename RawEncoder<Interface>::Type;
+
+	inline CompactEncoder(OutputStream *stream) : stream(stream) { }
+
+	inline void write(nullptr_t) { (*stream) << "null"; }
+	inline void write(bool value) { (*stream) << ((value)?"true":"false"); }
+	inline void write(int64_t value) { (*stream) << value; }
+	inline void write(double value) { (*stream) << value; }
+	inline void write(const StringView &str) { encodeString(*stream, str); }
+	inline void write(const BytesView &data) { (*stream) << '~'; encodeString(*stream, StringView((const char *)data.data(), data.size())); }
+
+	inline void onBeginArray(const ViewType &) {
+		if (type == Type::Dict) {
+			type = Type::Plain;
+		} else {
+			type = Type::Array;
+			(*stream) << "~(";
+		}
+		preventKey = false;
+	}
+
+	inline void onEndArray(const ViewType &) {
+		if (type != Type::Plain) {
+			(*stream) << ')';
+			preventKey = true;
+		} else {
+			preventKey = false;
+		}
+	}
+
+	inline void onBeginDict(const ViewType &) {
+		(*stream) << '(';
+		type = Type::Dict;
+		preventKey = false;
+	}
+
+	inline void onEndDict(const ViewType &) {
+		(*stream) << ')';
+		preventKey = true;
+	}
+
+	inline void onKey(const StringView &str) { write(str); }
+	inline void onNextValue() {
+		if (!preventKey) {
+			(*stream) << ((type == Type::Dict)?';':',');
+		} else {
+			preventKey = false;
+		}
+	}
+
+	inline void onArrayValue(const ViewType &val) {
+		auto tmpType = type;
+		val.encode(*this);
+		type = tmpType;
+	}
+
+	inline void onKeyValuePair(const StringView &key, const ViewType &val) {
+		auto tmpType = type;
+		onKey(key);
+		if (!val.isBool() || !val.getBool()) {
+			if (!val.isDictionary()) {
+				(*stream) << ':';
+			}
+			if (val.isArray() && val.size() < 2) {
+				type = Type::Plain; // prevent plain array
+			}
+			val.encode(*this);
+		} else {
+			(*stream) << ":true";
+		}
+		type = tmpType;
+	}
+
+	bool preventKey = false;
+	OutputStream *stream;
+	Type type = Type::Dict;
+};
+
+template <typename Interface>
+inline void write(std::ostream &stream, const CompactValueTemplate<Interface> &val, bool pretty) {
+	if (pretty) {
+		write(stream, val.toValue(), pretty);
+	} else {
+		CompactEncoder<Interface> encoder(&stream);
+		val.encode(encoder);
+	}
+}
+
+template <typename Interface>
+inline auto write(const CompactValueTemplate<Interface> &val, bool pretty = false) -> typename Interface::StringType {
+	typename Interface::StringStreamType stream;
+	write<Interface>(stream, val, pretty);
+	return stream.str();
+}
+
+}
+
+template <typename Interface> inline auto
+write(const CompactValueTemplate<Interface> &data, EncodeFormat fmt = EncodeFormat()) -> typename Interface::BytesType {
+	typename Interface::BytesType ret;
+	switch (fmt.format) {
+	case EncodeFormat::Json:
+	case EncodeFormat::Pretty:
+	case EncodeFormat::PrettyTime: {
+		auto s = json::write(data, (fmt.format == EncodeFormat::Pretty), (fmt.format == EncodeFormat::PrettyTime));
+		ret.assign(s.begin(), s.end());
+		break;
+	}
+	case EncodeFormat::Cbor:
+	case EncodeFormat::DefaultFormat:
+		ret = cbor::write(data);
+		break;
+	case EncodeFormat::Serenity:
+	case EncodeFormat::SerenityPretty: {
+		auto s = serenity::write(data, (fmt.format == EncodeFormat::SerenityPretty));
+		ret.assign(s.begin(), s.end());
+		break;
+	}
+	}
+
+	if (fmt.compression != EncodeFormat::NoCompression) {
+		auto tmp = compress<Interface>(ret.data(), ret.size(), fmt.compression, true);
+		if (!tmp.empty()) {
+			return tmp;
+		}
+	}
+	return ret;
+}
+
+// CBOR is decoded directly into compact storage. Other decoders produce intermediate
+// tree within temporary memory pool, so its nodes are not allocated one by one, and
+// whole tree is dropped with the pool after flattening
+template <typename Interface = DefaultInterface, typename StringType>
+auto readCompact(const StringType &data) -> CompactValueTemplate<Interface> {
+	using TmpValue = ValueTemplate<memory::PoolInterface>;
+
+	if (data.size() == 0) {
+		return CompactValueTemplate<Interface>();
+	}
+
+	switch (detectDataFormat((const uint8_t *)data.data(), data.size())) {
+	case DataFormat::Cbor:
+		return cbor::readCompact<Interface>(BytesViewTemplate<ByteOrder::Endian::Network>((const uint8_t *)data.data(), data.size()));
+		break;
+	case DataFormat::CborBase64:
+		return readCompact<Interface>(base64::decode<Interface>(CoderSource(data)));
+		break;
+	default:
+		break;
+	}
+
+	auto pool = memory::pool::create(memory::pool::acquire());
+	memory::pool::push(pool);
+	auto val = new (pool) TmpValue(read<StringType, memory::PoolInterface>(data));
+	memory::pool::pop();
+
+	typename CompactValueTemplate<Interface>::Builder builder;
+	builder.value(*val);
+
+	memory::pool::destroy(pool);
+	return builder.finalize();
+}
+
+template <typename Interface = DefaultInterface>
+auto readCompactFile(const StringView &filename) -> CompactValueTemplate<Interface> {
+	return readCompact<Interface>(filesystem::readIntoMemory<Interface>(filename));
+}
+
+NS_SP_EXT_END(data)
+
+#endif /* COMMON_DATA_SPDATACOMPACT_H_ */
@@ -66,6 +66,11 @@ struct mem_sso_test<data::ValueTemplate<Interface>> {
 	static constexpr bool value = true;
 };
 
+// pool dictionaries are often modified in place (decoders, patches), so nodes of
+// erased or replaced keys are reused through pool's slab cache
+template <>
+struct rbtree::TreeSlabAllocation<Pair<const PoolInterface::StringType, data::ValueTemplate<PoolInterface>>> : std::true_type { };
+
 NS_SP_EXT_END(memory)
 
 
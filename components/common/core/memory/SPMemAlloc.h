@@ -128,6 +128,25 @@ public:
 		pool::free(pool_ptr(pool), t, bytes);
 	}
 
+	// single object from pool's size-class cache, see pool::slab_alloc
+	T * __slab_allocate(size_t &bytes) {
+		bytes = sizeof(T);
+		return (T *)pool::slab_alloc(pool_ptr(pool), bytes);
+	}
+
+	void __slab_deallocate(T *t, size_t bytes) {
+		pool::slab_free(pool_ptr(pool), t, bytes);
+	}
+
+	// for single object from __slab_allocate, when actual block size was not stored
+	void __slab_deallocate(T *t) {
+		if constexpr (sizeof(T) < mempool::custom::BlockThreshold) {
+			pool::slab_free(pool_ptr(pool), t, mempool::custom::SlabCache::class_size(sizeof(T)));
+		} else {
+			pool::slab_free(pool_ptr(pool), t, sizeof(T));
+		}
+	}
+
 	template<class B> inline bool operator == (const Allocator<B> &p) const noexcept { return pool_ptr(p.pool) == pool_ptr(pool); }
 	template<class B> inline bool operator != (const Allocator<B> &p) const noexcept { return pool_ptr(p.pool) != pool_ptr(pool); }
 
@@ -0,0 +1,707 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#ifndef COMMON_MEMORY_SPMEMHASHTABLE_H_
+#define COMMON_MEMORY_SPMEMHASHTABLE_H_
+
+#include "SPMemAlloc.h"
+#include "SPMemString.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+NS_SP_EXT_BEGIN(memory)
+
+enum class HashTableFlags : uint32_t {
+	None = 0,
+	Ordered = 1 << 0, // erase keeps insertion order of other values (O(n) erase)
+	Stable = 1 << 1, // references to values are not invalidated by insert, erase or rehash
+};
+
+SP_DEFINE_ENUM_AS_MASK(HashTableFlags)
+
+// Transparent hash for string keys: memory::string, std::string, StringView and
+// other types with data()/size() produce the same hash for the same content
+struct string_hash {
+	using is_transparent = void;
+
+	template <typename T>
+	size_t operator() (const T &s) const noexcept {
+		return hash(s.data(), s.size() * sizeof(typename std::remove_pointer<decltype(s.data())>::type));
+	}
+
+	size_t operator() (const char *s) const noexcept {
+		return hash(s, s ? ::strlen(s) : 0);
+	}
+
+	static size_t hash(const void *ptr, size_t len) noexcept {
+		if constexpr (sizeof(size_t) == 8) {
+			return CityHash64((const char *)ptr, len);
+		} else {
+			return CityHash32((const char *)ptr, len);
+		}
+	}
+};
+
+template <typename T>
+struct default_hash_select { using type = std::hash<T>; };
+
+template <typename CharType>
+struct default_hash_select<basic_string<CharType>> { using type = string_hash; };
+
+template <typename CharType, typename Traits, typename Alloc>
+struct default_hash_select<std::basic_string<CharType, Traits, Alloc>> { using type = string_hash; };
+
+template <typename T>
+using default_hash = typename default_hash_select<T>::type;
+
+namespace hashtable {
+
+// Index of the table is a SwissTable-like open addressing scheme: one control byte per bucket
+// (Empty, Deleted or 7 bits of hash for full bucket) and a 32-bit index into dense value array.
+// Buckets are probed by groups of 16 control bytes, that are matched in one SSE2 compare.
+// Values itself are stored densely in insertion order, so iteration does not depend on hashing
+// and is not changed by rehash
+
+enum Ctrl : int8_t {
+	Empty = -128,
+	Deleted = -2,
+};
+
+struct Group {
+	static constexpr size_t Width = 16;
+
+#if __SSE2__
+	explicit Group(const int8_t *p) noexcept : ctrl(_mm_loadu_si128((const __m128i *)p)) { }
+
+	uint32_t match(int8_t h2) const noexcept {
+		return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+	}
+
+	uint32_t matchEmpty() const noexcept {
+		return match(Ctrl::Empty);
+	}
+
+	// Empty and Deleted are the only control values with the sign bit set
+	uint32_t matchEmptyOrDeleted() const noexcept {
+		return uint32_t(_mm_movemask_epi8(ctrl));
+	}
+
+	__m128i ctrl;
+#else
+	explicit Group(const int8_t *p) noexcept : ctrl(p) { }
+
+	uint32_t match(int8_t h2) const noexcept {
+		uint32_t ret = 0;
+		for (size_t i = 0; i < Width; ++ i) {
+			if (ctrl[i] == h2) {
+				ret |= (1 << i);
+			}
+		}
+		return ret;
+	}
+
+	uint32_t matchEmpty() const noexcept {
+		return match(Ctrl::Empty);
+	}
+
+	uint32_t matchEmptyOrDeleted() const noexcept {
+		uint32_t ret = 0;
+		for (size_t i = 0; i < Width; ++ i) {
+			if (ctrl[i] < 0) {
+				ret |= (1 << i);
+			}
+		}
+		return ret;
+	}
+
+	const int8_t *ctrl;
+#endif
+};
+
+// hashers like std::hash<int> are identity functions, so bits should be mixed before
+// splitting hash into group position and control byte
+inline size_t mix(size_t h) noexcept {
+	if constexpr (sizeof(size_t) == 8) {
+		h ^= h >> 33;
+		h *= size_t(0xff51afd7ed558ccdULL);
+		h ^= h >> 33;
+	} else {
+		h ^= h >> 16;
+		h *= size_t(0x85ebca6bU);
+		h ^= h >> 13;
+	}
+	return h;
+}
+
+template <typename Key, typename Value>
+struct TableKeyExtractor;
+
+template <typename Key>
+struct TableKeyExtractor<Key, Key> {
+	static inline const Key & extract(const Key &k) noexcept { return k; }
+};
+
+template <typename Key, typename Value>
+struct TableKeyExtractor<Key, Pair<const Key, Value>> {
+	static inline const Key & extract(const Pair<const Key, Value> &v) noexcept { return v.first; }
+};
+
+template <typename Value>
+struct TableRelocate {
+	static inline void relocate(Allocator<Value> &alloc, Value *target, Value *source) {
+		alloc.construct(target, std::move(*source));
+		alloc.destroy(source);
+	}
+};
+
+template <typename Key, typename Value>
+struct TableRelocate<Pair<const Key, Value>> {
+	static inline void relocate(Allocator<Pair<const Key, Value>> &alloc, Pair<const Key, Value> *target, Pair<const Key, Value> *source) {
+		alloc.construct(target, std::move(const_cast<Key &>(source->first)), std::move(source->second));
+		alloc.destroy(source);
+	}
+};
+
+// Flat storage: values are stored in dense array itself
+template <typename Value, bool Stable>
+struct TableStorage {
+	using slot_type = Value;
+
+	static inline Value & get(slot_type &s) noexcept { return s; }
+	static inline const Value & get(const slot_type &s) noexcept { return s; }
+
+	template <typename Fn>
+	static inline void construct(Allocator<Value> &alloc, slot_type *s, const Fn &fn) {
+		fn(alloc, s);
+	}
+
+	static inline void destroy(Allocator<Value> &alloc, slot_type *s) {
+		alloc.destroy(s);
+	}
+
+	static inline void relocate(Allocator<Value> &alloc, slot_type *target, slot_type *source) {
+		TableRelocate<Value>::relocate(alloc, target, source);
+	}
+};
+
+// Stable storage: dense array holds pointers to values, allocated from pool's slab cache,
+// so references to values are not invalidated by insert, erase or rehash
+template <typename Value>
+struct TableStorage<Value, true> {
+	using slot_type = Value *;
+
+	static inline Value & get(slot_type &s) noexcept { return *s; }
+	static inline const Value & get(const slot_type &s) noexcept { return *s; }
+
+	template <typename Fn>
+	static inline void construct(Allocator<Value> &alloc, slot_type *s, const Fn &fn) {
+		size_t bytes = 0;
+		auto ptr = alloc.__slab_allocate(bytes);
+		fn(alloc, ptr);
+		*s = ptr;
+	}
+
+	static inline void destroy(Allocator<Value> &alloc, slot_type *s) {
+		alloc.destroy(*s);
+		alloc.__slab_deallocate(*s);
+	}
+
+	static inline void relocate(Allocator<Value> &alloc, slot_type *target, slot_type *source) {
+		*target = *source;
+	}
+};
+
+template <typename Storage, typename Value, bool IsConst>
+class TableIterator {
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = Value;
+	using difference_type = std::ptrdiff_t;
+	using pointer = typename std::conditional<IsConst, const Value *, Value *>::type;
+	using reference = typename std::conditional<IsConst, const Value &, Value &>::type;
+	using slot_type = typename Storage::slot_type;
+	using slot_pointer = typename std::conditional<IsConst, const slot_type *, slot_type *>::type;
+
+	TableIterator() noexcept : current(nullptr) { }
+	explicit TableIterator(slot_pointer p) noexcept : current(p) { }
+
+	// const_iterator cast
+	operator TableIterator<Storage, Value, true> () const { return TableIterator<Storage, Value, true>(current); }
+
+	bool operator==(const TableIterator &other) const { return current == other.current; }
+	bool operator!=(const TableIterator &other) const { return current != other.current; }
+
+	TableIterator& operator++() { ++current; return *this; }
+	TableIterator operator++(int) { auto tmp = *this; ++ current; return tmp; }
+	TableIterator& operator--() { --current; return *this; }
+	TableIterator operator--(int) { auto tmp = *this; --current; return tmp; }
+	difference_type operator-(const TableIterator &other) const { return current - other.current; }
+
+	reference operator*() const { return Storage::get(*current); }
+	pointer operator->() const { return &Storage::get(*current); }
+
+	slot_pointer slot() const { return current; }
+
+protected:
+	slot_pointer current;
+};
+
+// Ordered = false: erase moves last value into the hole, O(1)
+// Ordered = true: erase shifts values after the hole, so insertion order is always preserved
+// Stable = true: values are allocated one by one, see TableStorage
+template <typename Key, typename Value, typename Hash, typename Equal, bool Ordered, bool Stable>
+class Table : public AllocPool {
+public:
+	using value_type = Value;
+	using allocator_type = Allocator<value_type>;
+	using key_extractor = TableKeyExtractor<Key, Value>;
+	using storage_type = TableStorage<Value, Stable>;
+	using slot_type = typename storage_type::slot_type;
+	using slot_allocator_type = Allocator<slot_type>;
+	using index_allocator_type = Allocator<uint8_t>;
+
+	using iterator = TableIterator<storage_type, value_type, false>;
+	using const_iterator = TableIterator<storage_type, value_type, true>;
+
+	static constexpr size_t npos = maxOf<size_t>();
+
+	Table(const Hash &hash = Hash(), const Equal &equal = Equal(), const allocator_type &alloc = allocator_type()) noexcept
+	: _hash(hash), _equal(equal), _allocator(alloc) { }
+
+	Table(const Table &other, const allocator_type &alloc = allocator_type()) noexcept
+	: _hash(other._hash), _equal(other._equal), _allocator(alloc) {
+		clone(other);
+	}
+
+	Table(Table &&other, const allocator_type &alloc = allocator_type()) noexcept
+	: _hash(other._hash), _equal(other._equal), _allocator(alloc) {
+		if (other._allocator == _allocator) {
+			steal(other);
+		} else {
+			clone(other);
+		}
+	}
+
+	Table & operator = (const Table &other) noexcept {
+		if (this != &other) {
+			clear();
+			_hash = other._hash;
+			_equal = other._equal;
+			clone(other);
+		}
+		return *this;
+	}
+
+	Table & operator = (Table &&other) noexcept {
+		if (this != &other) {
+			_hash = other._hash;
+			_equal = other._equal;
+			if (other._allocator == _allocator) {
+				release();
+				steal(other);
+			} else {
+				clear();
+				clone(other);
+			}
+		}
+		return *this;
+	}
+
+	~Table() noexcept {
+		release();
+	}
+
+	const allocator_type & get_allocator() const noexcept { return _allocator; }
+	const Hash & hash_function() const noexcept { return _hash; }
+	const Equal & key_eq() const noexcept { return _equal; }
+
+	iterator begin() noexcept { return iterator(_values); }
+	iterator end() noexcept { return iterator(_values + _size); }
+
+	const_iterator begin() const noexcept { return const_iterator(_values); }
+	const_iterator end() const noexcept { return const_iterator(_values + _size); }
+
+	size_t size() const noexcept { return _size; }
+	bool empty() const noexcept { return _size == 0; }
+	size_t capacity() const noexcept { return _capacity; }
+	size_t bucket_count() const noexcept { return _buckets; }
+	float load_factor() const noexcept { return _buckets ? float(_size) / float(_buckets) : 0.0f; }
+
+	void clear() {
+		for (size_t i = 0; i < _size; ++ i) {
+			storage_type::destroy(_allocator, _values + i);
+		}
+		_size = 0;
+		if (_buckets) {
+			memset(_ctrl, Ctrl::Empty, _buckets);
+			_growthLeft = maxLoad(_buckets);
+		}
+	}
+
+	void reserve(size_t c) {
+		if (c > _capacity) {
+			growValues(c);
+		}
+		if (c > maxLoad(_buckets)) {
+			rebuildIndex(bucketsFor(c));
+		}
+	}
+
+	void swap(Table &other) noexcept {
+		std::swap(_hash, other._hash);
+		std::swap(_equal, other._equal);
+		std::swap(_allocator, other._allocator);
+		std::swap(_values, other._values);
+		std::swap(_size, other._size);
+		std::swap(_capacity, other._capacity);
+		std::swap(_ctrl, other._ctrl);
+		std::swap(_slots, other._slots);
+		std::swap(_buckets, other._buckets);
+		std::swap(_indexBytes, other._indexBytes);
+		std::swap(_growthLeft, other._growthLeft);
+	}
+
+	template <typename K>
+	size_t find_index(const K &key) const {
+		return (_size == 0) ? npos : findIndex(key, mix(_hash(key)));
+	}
+
+	template <typename K>
+	iterator find(const K &key) {
+		auto idx = find_index(key);
+		return (idx != npos) ? iterator(_values + idx) : end();
+	}
+
+	template <typename K>
+	const_iterator find(const K &key) const {
+		auto idx = find_index(key);
+		return (idx != npos) ? const_iterator(_values + idx) : end();
+	}
+
+	// constructs new value with Fn(allocator_type &, value_type *) only if there is no value for key
+	template <typename K, typename Fn>
+	Pair<iterator, bool> emplace_unique(const K &key, const Fn &construct) {
+		auto h = mix(_hash(key));
+		auto idx = findIndex(key, h);
+		if (idx != npos) {
+			return pair(iterator(_values + idx), false);
+		}
+
+		if (_size == _capacity) {
+			growValues(_capacity ? _capacity * 2 : Group::Width / 2);
+		}
+
+		auto slot = prepareInsert(h);
+		storage_type::construct(_allocator, _values + _size, construct);
+		if (_ctrl[slot] == Ctrl::Empty) {
+			-- _growthLeft;
+		}
+		_ctrl[slot] = int8_t(h & 0x7F);
+		_slots[slot] = uint32_t(_size);
+		return pair(iterator(_values + _size ++), true);
+	}
+
+	iterator erase(const_iterator pos) {
+		auto idx = size_t(pos.slot() - _values);
+		if (idx >= _size) {
+			return end();
+		}
+
+		auto h = mix(_hash(key_extractor::extract(valueAt(idx))));
+		eraseSlot(findSlot(h, idx));
+
+		storage_type::destroy(_allocator, _values + idx);
+		if constexpr (Ordered) {
+			for (size_t i = idx + 1; i < _size; ++ i) {
+				storage_type::relocate(_allocator, _values + i - 1, _values + i);
+			}
+			for (size_t i = 0; i < _buckets; ++ i) {
+				if (_ctrl[i] >= 0 && _slots[i] > idx) {
+					-- _slots[i];
+				}
+			}
+		} else {
+			auto last = _size - 1;
+			if (idx != last) {
+				auto lh = mix(_hash(key_extractor::extract(valueAt(last))));
+				_slots[findSlot(lh, last)] = uint32_t(idx);
+				storage_type::relocate(_allocator, _values + idx, _values + last);
+			}
+		}
+		-- _size;
+		return iterator(_values + idx);
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		auto count = size_t(last.slot() - first.slot());
+		auto idx = size_t(first.slot() - _values);
+		for (size_t i = 0; i < count; ++ i) {
+			if constexpr (Ordered) {
+				erase(const_iterator(_values + idx));
+			} else {
+				// erase from the end of range, so values, moved into holes, are not from range itself
+				erase(const_iterator(_values + idx + count - i - 1));
+			}
+		}
+		return iterator(_values + idx);
+	}
+
+	template <typename K>
+	size_t erase_unique(const K &key) {
+		auto idx = find_index(key);
+		if (idx != npos) {
+			erase(const_iterator(_values + idx));
+			return 1;
+		}
+		return 0;
+	}
+
+protected:
+	static constexpr size_t maxLoad(size_t buckets) { return buckets - buckets / 8; }
+
+	static size_t bucketsFor(size_t count) {
+		size_t ret = Group::Width;
+		while (maxLoad(ret) < count) {
+			ret *= 2;
+		}
+		return ret;
+	}
+
+	value_type & valueAt(size_t idx) { return storage_type::get(_values[idx]); }
+	const value_type & valueAt(size_t idx) const { return storage_type::get(_values[idx]); }
+
+	template <typename K>
+	size_t findIndex(const K &key, size_t h) const {
+		if (_size == 0) {
+			return npos;
+		}
+
+		auto h2 = int8_t(h & 0x7F);
+		auto mask = _buckets - 1;
+		auto pos = (h >> 7) & mask & ~(Group::Width - 1);
+		size_t step = 0;
+		while (true) {
+			Group g(_ctrl + pos);
+			auto bits = g.match(h2);
+			while (bits) {
+				auto idx = _slots[pos + __builtin_ctz(bits)];
+				if (_equal(key_extractor::extract(valueAt(idx)), key)) {
+					return idx;
+				}
+				bits &= bits - 1;
+			}
+			if (g.matchEmpty()) {
+				return npos;
+			}
+			step += Group::Width;
+			pos = (pos + step) & mask;
+		}
+		return npos;
+	}
+
+	// bucket, that refers to value with index idx
+	size_t findSlot(size_t h, size_t idx) const {
+		auto h2 = int8_t(h & 0x7F);
+		auto mask = _buckets - 1;
+		auto pos = (h >> 7) & mask & ~(Group::Width - 1);
+		size_t step = 0;
+		while (true) {
+			auto bits = Group(_ctrl + pos).match(h2);
+			while (bits) {
+				auto slot = pos + __builtin_ctz(bits);
+				if (_slots[slot] == idx) {
+					return slot;
+				}
+				bits &= bits - 1;
+			}
+			step += Group::Width;
+			pos = (pos + step) & mask;
+		}
+		return npos;
+	}
+
+	static size_t findInsertSlot(const int8_t *ctrl, size_t buckets, size_t h) {
+		auto mask = buckets - 1;
+		auto pos = (h >> 7) & mask & ~(Group::Width - 1);
+		size_t step = 0;
+		while (true) {
+			if (auto bits = Group(ctrl + pos).matchEmptyOrDeleted()) {
+				return pos + __builtin_ctz(bits);
+			}
+			step += Group::Width;
+			pos = (pos + step) & mask;
+		}
+		return npos;
+	}
+
+	size_t prepareInsert(size_t h) {
+		if (_buckets == 0) {
+			rebuildIndex(Group::Width);
+		}
+
+		auto slot = findInsertSlot(_ctrl, _buckets, h);
+		if (_growthLeft == 0 && _ctrl[slot] != Ctrl::Deleted) {
+			// no space left: drop tombstones if they take more then a half of load, or grow
+			rebuildIndex((_size + 1 <= maxLoad(_buckets) / 2) ? _buckets : _buckets * 2);
+			slot = findInsertSlot(_ctrl, _buckets, h);
+		}
+		return slot;
+	}
+
+	void eraseSlot(size_t slot) {
+		// if group still has empty bucket, no probe sequence ever passed through it,
+		// so bucket can be freed without tombstone
+		if (Group(_ctrl + (slot & ~(Group::Width - 1))).matchEmpty()) {
+			_ctrl[slot] = Ctrl::Empty;
+			++ _growthLeft;
+		} else {
+			_ctrl[slot] = Ctrl::Deleted;
+		}
+	}
+
+	void allocateIndex(size_t buckets) {
+		size_t bytes = 0;
+		auto mem = index_allocator_type(_allocator).__allocate(buckets * (1 + sizeof(uint32_t)), bytes);
+		_ctrl = (int8_t *)mem;
+		_slots = (uint32_t *)(mem + buckets);
+		_buckets = buckets;
+		_indexBytes = bytes;
+	}
+
+	void rebuildIndex(size_t buckets) {
+		releaseIndex();
+		allocateIndex(buckets);
+
+		memset(_ctrl, Ctrl::Empty, _buckets);
+		for (size_t i = 0; i < _size; ++ i) {
+			auto h = mix(_hash(key_extractor::extract(valueAt(i))));
+			auto slot = findInsertSlot(_ctrl, _buckets, h);
+			_ctrl[slot] = int8_t(h & 0x7F);
+			_slots[slot] = uint32_t(i);
+		}
+		_growthLeft = maxLoad(_buckets) - _size;
+	}
+
+	void growValues(size_t c) {
+		size_t count = c;
+		auto values = slot_allocator_type(_allocator).__allocate(count);
+		for (size_t i = 0; i < _size; ++ i) {
+			storage_type::relocate(_allocator, values + i, _values + i);
+		}
+		releaseValues();
+		_values = values;
+		_capacity = count;
+	}
+
+	void releaseIndex() {
+		if (_ctrl) {
+			index_allocator_type(_allocator).__deallocate((uint8_t *)_ctrl, _indexBytes, _indexBytes);
+			_ctrl = nullptr;
+			_slots = nullptr;
+			_buckets = 0;
+			_indexBytes = 0;
+			_growthLeft = 0;
+		}
+	}
+
+	void releaseValues() {
+		if (_values) {
+			slot_allocator_type(_allocator).deallocate(_values, _capacity);
+			_values = nullptr;
+			_capacity = 0;
+		}
+	}
+
+	void release() {
+		clear();
+		releaseValues();
+		releaseIndex();
+	}
+
+	void clone(const Table &other) {
+		if (other._size == 0) {
+			return;
+		}
+
+		if (_capacity < other._size) {
+			growValues(other._size);
+		}
+		for (size_t i = 0; i < other._size; ++ i) {
+			auto &source = other.valueAt(i);
+			storage_type::construct(_allocator, _values + i, [&] (allocator_type &alloc, value_type *ptr) {
+				alloc.construct(ptr, source);
+			});
+		}
+		_size = other._size;
+
+		// values are in the same order, so index can be copied as is
+		if (_buckets != other._buckets) {
+			releaseIndex();
+			allocateIndex(other._buckets);
+		}
+		memcpy(_ctrl, other._ctrl, _buckets);
+		memcpy(_slots, other._slots, _buckets * sizeof(uint32_t));
+		_growthLeft = other._growthLeft;
+	}
+
+	void steal(Table &other) {
+		_values = other._values;
+		_size = other._size;
+		_capacity = other._capacity;
+		_ctrl = other._ctrl;
+		_slots = other._slots;
+		_buckets = other._buckets;
+		_indexBytes = other._indexBytes;
+		_growthLeft = other._growthLeft;
+
+		other._values = nullptr;
+		other._size = 0;
+		other._capacity = 0;
+		other._ctrl = nullptr;
+		other._slots = nullptr;
+		other._buckets = 0;
+		other._indexBytes = 0;
+		other._growthLeft = 0;
+	}
+
+	Hash _hash;
+	Equal _equal;
+	allocator_type _allocator;
+
+	slot_type *_values = nullptr;
+	size_t _size = 0;
+	size_t _capacity = 0;
+
+	int8_t *_ctrl = nullptr;
+	uint32_t *_slots = nullptr;
+	size_t _buckets = 0;
+	size_t _indexBytes = 0;
+	size_t _growthLeft = 0;
+};
+
+}
+
+NS_SP_EXT_END(memory)
+
+#endif /* COMMON_MEMORY_SPMEMHASHTABLE_H_ */
@@ -32,6 +32,8 @@ THE SOFTWARE.
 #include "SPMemSet.h"
 #include "SPMemMap.h"
 #include "SPMemDict.h"
+#include "SPMemUnorderedMap.h"
+#include "SPMemUnorderedSet.h"
 
 NS_SP_EXT_BEGIN(memory)
 
@@ -268,6 +268,12 @@ struct TreeComparator<Key, Comp, typename Comp::is_transparent> {
 	}
 };
 
+// Trees for values with this trait take nodes from pool's size-class cache (pool::slab_alloc),
+// so erased nodes are reused instead of leaking until pool is cleared;
+// other trees can opt in with Tree::set_slab_allocation
+template <typename Value>
+struct TreeSlabAllocation : std::false_type { };
+
 template <typename Key, typename Value, typename Comp = std::less<>>
 class Tree : public AllocPool {
 public:
@@ -298,6 +304,8 @@ public:
 
 	Tree(Tree &&other, const value_allocator_type &alloc = value_allocator_type()) noexcept
 	: _header(NodeColor::Black), _comp(other._comp), _allocator(alloc), _size(0) {
+		// nodes of moved tree are released the same way, as they were allocated
+		set_slab_allocation(other._allocator.test(value_allocator_type::ThirdFlag));
 		if (other.get_allocator() == _allocator) {
 			_header = other._header;
 			_size = other._size;
@@ -320,6 +328,7 @@ public:
 	Tree & operator = (Tree &&other) noexcept {
 		if (other.get_allocator() == _allocator) {
 			clear();
+			set_slab_allocation(other._allocator.test(value_allocator_type::ThirdFlag));
 			_header = other._header;
 			_size = other._size;
 			_comp = std::move(other._comp);
@@ -428,6 +437,9 @@ public:
 		if (_allocator.test(value_allocator_type::SecondFlag)) {
 			node_allocator_type(_allocator).__deallocate(_tmp, _size, _tmp->getSize());
 			_tmp = nullptr;
+		} else if (_tmp && !_tmp->isPrealloc() && is_slab_allocation()) {
+			deallocateNode(_tmp, _tmp->getSize());
+			_tmp = nullptr;
 		}
 		_size = 0;
 		_allocator.reset(value_allocator_type::SecondFlag);
@@ -508,6 +520,20 @@ public:
 		}
 	}
 
+	// ThirdFlag of allocator marks tree, that uses slab cache for single nodes;
+	// it's safe to switch mode on non-empty tree: slab cache accepts any node by its size
+	void set_slab_allocation(bool value) {
+		if (value) {
+			_allocator.set(value_allocator_type::ThirdFlag);
+		} else {
+			_allocator.reset(value_allocator_type::ThirdFlag);
+		}
+	}
+
+	bool is_slab_allocation() const {
+		return TreeSlabAllocation<Value>::value || _allocator.test(value_allocator_type::ThirdFlag);
+	}
+
 protected:
 	friend class TreeDebug;
 
@@ -893,7 +919,7 @@ protected:
 
 		_allocator.destroy(target->value.ptr());
 		if (target->getSize()) {
-			node_allocator_type(_allocator).__deallocate(target, 1, target->getSize());
+			deallocateNode(target, target->getSize());
 		}
 	}
 
@@ -1031,7 +1057,7 @@ protected:
 					_tmp->setSize(n->getSize() + _tmp->getSize());
 				}
 			} else if (n->getSize()) {
-				node_allocator_type(_allocator).__deallocate(n, 1, n->isPrealloc() ? sizeof(Node<Value>) : n->getSize());
+				deallocateNode(n, n->isPrealloc() ? sizeof(Node<Value>) : n->getSize());
 			}
 		} else {
 			_tmp = n;
@@ -1076,13 +1102,24 @@ protected:
 			if (_allocator.test(value_allocator_type::SecondFlag)) {
 				_allocator.reset(value_allocator_type::SecondFlag);
 			}
-			auto ret = node_allocator_type(_allocator).__allocate(1, s);
+			auto ret = is_slab_allocation()
+					? node_allocator_type(_allocator).__slab_allocate(s)
+					: node_allocator_type(_allocator).__allocate(1, s);
 			ret->setSize(s);
 			ret->setCount(0);
 			ret->setPrealloc(false);
 			return ret;
 		}
 	}
+
+	void deallocateNode(Node<Value> *n, size_t bytes) {
+		// preallocated nodes are parts of reserved block, they can not be returned into slab cache
+		if (!n->isPrealloc() && is_slab_allocation()) {
+			node_allocator_type(_allocator).__slab_deallocate(n, n->getSize());
+		} else {
+			node_allocator_type(_allocator).__deallocate(n, 1, bytes);
+		}
+	}
 };
 
 }
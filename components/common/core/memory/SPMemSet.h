@@ -193,6 +193,10 @@ public:
 
 	void reserve(size_t c) { _tree.reserve(c); }
 
+	// reuse erased nodes within pool lifetime, see rbtree::TreeSlabAllocation
+	void set_slab_allocation(bool value) { _tree.set_slab_allocation(value); }
+	bool is_slab_allocation() const { return _tree.is_slab_allocation(); }
+
 protected:
 	rbtree::Tree<Value, Value, Comp> _tree;
 };
@@ -0,0 +1,258 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+
+#ifndef COMMON_MEMORY_SPMEMUNORDEREDMAP_H_
+#define COMMON_MEMORY_SPMEMUNORDEREDMAP_H_
+
+#include "SPMemHashTable.h"
+
+NS_SP_EXT_BEGIN(memory)
+
+// Pool-based hash map with open addressing, see hashtable::Table
+//
+// Unlike std::unordered_map, values are stored in a dense array in insertion order:
+// - iteration order is insertion order (with HashTableFlags::Ordered it's preserved across erase too)
+// - insert and erase can move values, so references are not stable (unless HashTableFlags::Stable)
+// - iterators are invalidated by insert and erase
+// - lookup is heterogeneous, when Hash and Equal are transparent (default for string keys)
+template <typename Key, typename Value, typename Hash = default_hash<Key>, typename Equal = std::equal_to<>, HashTableFlags Flags = HashTableFlags::None>
+class unordered_map : public AllocPool {
+public:
+	using key_type = Key;
+	using mapped_type = Value;
+	using value_type = Pair<const Key, Value>;
+	using hasher = Hash;
+	using key_equal = Equal;
+	using allocator_type = Allocator<value_type>;
+
+	using pointer = value_type *;
+	using const_pointer = const value_type *;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+
+	using table_type = hashtable::Table<Key, value_type, Hash, Equal,
+			(Flags & HashTableFlags::Ordered) != 0, (Flags & HashTableFlags::Stable) != 0>;
+
+	using iterator = typename table_type::iterator;
+	using const_iterator = typename table_type::const_iterator;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+
+public:
+	unordered_map() noexcept : _table() { }
+
+	explicit unordered_map(size_t count, const Hash &hash = Hash(), const Equal &equal = Equal(),
+			const allocator_type &alloc = allocator_type()) noexcept : _table(hash, equal, alloc) {
+		_table.reserve(count);
+	}
+	explicit unordered_map(const allocator_type &alloc) noexcept : _table(Hash(), Equal(), alloc) { }
+
+	template<class InputIterator>
+	unordered_map(InputIterator first, InputIterator last, const allocator_type &alloc = allocator_type())
+	: _table(Hash(), Equal(), alloc) {
+		for (auto it = first; it != last; it ++) {
+			do_insert(*it);
+		}
+	}
+
+	unordered_map(const unordered_map &x) noexcept : _table(x._table) { }
+	unordered_map(const unordered_map &x, const allocator_type &alloc) noexcept : _table(x._table, alloc) { }
+
+	unordered_map(unordered_map &&x) noexcept : _table(std::move(x._table)) { }
+	unordered_map(unordered_map &&x, const allocator_type &alloc) noexcept : _table(std::move(x._table), alloc) { }
+
+	unordered_map(InitializerList<value_type> il, const allocator_type &alloc = allocator_type()) noexcept
+	: _table(Hash(), Equal(), alloc) {
+		_table.reserve(il.size());
+		for (auto &it : il) {
+			do_insert(std::move(const_cast<reference>(it)));
+		}
+	}
+
+	unordered_map& operator= (const unordered_map &other) noexcept {
+		_table = other._table;
+		return *this;
+	}
+	unordered_map& operator= (unordered_map &&other) noexcept {
+		_table = std::move(other._table);
+		return *this;
+	}
+	unordered_map& operator= (InitializerList<value_type> ilist) noexcept {
+		_table.clear();
+		for (auto &it : ilist) {
+			do_insert(std::move(const_cast<reference>(it)));
+		}
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept { return _table.get_allocator(); }
+	hasher hash_function() const { return _table.hash_function(); }
+	key_equal key_eq() const { return _table.key_eq(); }
+
+	bool empty() const noexcept { return _table.empty(); }
+	size_t size() const noexcept { return _table.size(); }
+	void clear() { _table.clear(); }
+
+	size_t bucket_count() const noexcept { return _table.bucket_count(); }
+	float load_factor() const noexcept { return _table.load_factor(); }
+	void reserve(size_t c) { _table.reserve(c); }
+
+	Value& at(const Key& key) {
+		return find(key)->second;
+	}
+	const Value& at(const Key& key) const {
+		return find(key)->second;
+	}
+
+	Value& operator[] ( const Key& key ) {
+		return this->try_emplace(key).first->second;
+	}
+	Value& operator[] ( Key&& key ) {
+		return this->try_emplace(std::move(key)).first->second;
+	}
+
+	iterator begin() noexcept { return _table.begin(); }
+	iterator end() noexcept { return _table.end(); }
+
+	const_iterator begin() const noexcept { return _table.begin(); }
+	const_iterator end() const noexcept { return _table.end(); }
+
+	const_iterator cbegin() const noexcept { return _table.begin(); }
+	const_iterator cend() const noexcept { return _table.end(); }
+
+	void swap(unordered_map &other) noexcept { _table.swap(other._table); }
+
+	template <class P>
+	Pair<iterator,bool> insert( P&& value ) {
+		return do_insert(std::forward<P>(value));
+	}
+
+	template< class InputIt >
+	void insert( InputIt first, InputIt last ) {
+		for (auto it = first; it != last; it ++) {
+			do_insert(*it);
+		}
+	}
+
+	void insert( InitializerList<value_type> ilist ) {
+		for (auto &it : ilist) {
+			do_insert(std::move(const_cast<reference>(it)));
+		}
+	}
+
+	template <class M>
+	Pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj) {
+		auto ret = try_emplace(k, std::forward<M>(obj));
+		if (!ret.second) {
+			ret.first->second = std::forward<M>(obj);
+		}
+		return ret;
+	}
+
+	template <class M>
+	Pair<iterator, bool> insert_or_assign(key_type&& k, M&& obj) {
+		auto ret = try_emplace(std::move(k), std::forward<M>(obj));
+		if (!ret.second) {
+			ret.first->second = std::forward<M>(obj);
+		}
+		return ret;
+	}
+
+	// same as memory::map: value for existing key is replaced
+	template< class... Args >
+	Pair<iterator,bool> emplace( Args&&... args ) {
+		auto ret = try_emplace(std::forward<Args>(args)...);
+		if (!ret.second) {
+			do_assign(ret.first, std::forward<Args>(args)...);
+		}
+		return ret;
+	}
+
+	template <class... Args>
+	Pair<iterator, bool> try_emplace(const key_type& k, Args&&... args) {
+		return _table.emplace_unique(k, [&] (allocator_type &alloc, value_type *ptr) {
+			alloc.construct(ptr, std::piecewise_construct,
+					std::forward_as_tuple(k), std::forward_as_tuple(std::forward<Args>(args)...));
+		});
+	}
+
+	template <class... Args>
+	Pair<iterator, bool> try_emplace(key_type&& k, Args&&... args) {
+		return _table.emplace_unique(k, [&] (allocator_type &alloc, value_type *ptr) {
+			alloc.construct(ptr, std::piecewise_construct,
+					std::forward_as_tuple(std::move(k)), std::forward_as_tuple(std::forward<Args>(args)...));
+		});
+	}
+
+	iterator erase( const_iterator pos ) { return _table.erase(pos); }
+	iterator erase( const_iterator first, const_iterator last ) { return _table.erase(first, last); }
+
+	template< class K > size_type erase( const K& key ) { return _table.erase_unique(key); }
+
+	template< class K > iterator find( const K& x ) { return _table.find(x); }
+	template< class K > const_iterator find( const K& x ) const { return _table.find(x); }
+
+	template< class K > size_t count( const K& x ) const { return (_table.find_index(x) != table_type::npos) ? 1 : 0; }
+	template< class K > bool contains( const K& x ) const { return _table.find_index(x) != table_type::npos; }
+
+protected:
+	template <class A, class B>
+	Pair<iterator,bool> do_insert( const Pair<A, B> & value ) {
+		return emplace(value.first, value.second);
+	}
+
+	template <class A, class B>
+	Pair<iterator,bool> do_insert( Pair<A, B> && value ) {
+		return emplace(std::move(value.first), std::move(value.second));
+	}
+
+	template <class T, class ... Args>
+	void do_assign( iterator it, T &&, Args && ... args) {
+		it->second = Value(std::forward<Args>(args)...);
+	}
+
+	table_type _table;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal, HashTableFlags Flags> inline bool
+operator==(const unordered_map<Key, Value, Hash, Equal, Flags>& __x, const unordered_map<Key, Value, Hash, Equal, Flags>& __y) {
+	if (__x.size() != __y.size()) {
+		return false;
+	}
+	for (auto &it : __x) {
+		auto v = __y.find(it.first);
+		if (v == __y.end() || !(v->second == it.second)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal, HashTableFlags Flags> inline bool
+operator!=(const unordered_map<Key, Value, Hash, Equal, Flags>& __x, const unordered_map<Key, Value, Hash, Equal, Flags>& __y) {
+	return !(__x == __y);
+}
+
+NS_SP_EXT_END(memory)
+
+#endif /* COMMON_MEMORY_SPMEMUNORDEREDMAP_H_ */
@@ -0,0 +1,194 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+
+#ifndef COMMON_MEMORY_SPMEMUNORDEREDSET_H_
+#define COMMON_MEMORY_SPMEMUNORDEREDSET_H_
+
+#include "SPMemHashTable.h"
+
+NS_SP_EXT_BEGIN(memory)
+
+// Pool-based hash set with open addressing, same iteration and stability rules as unordered_map
+template <typename Value, typename Hash = default_hash<Value>, typename Equal = std::equal_to<>, HashTableFlags Flags = HashTableFlags::None>
+class unordered_set : public AllocPool {
+public:
+	using key_type = Value;
+	using value_type = Value;
+	using hasher = Hash;
+	using key_equal = Equal;
+	using allocator_type = Allocator<Value>;
+
+	using pointer = Value *;
+	using const_pointer = const Value *;
+	using reference = Value &;
+	using const_reference = const Value &;
+
+	using table_type = hashtable::Table<Value, Value, Hash, Equal,
+			(Flags & HashTableFlags::Ordered) != 0, (Flags & HashTableFlags::Stable) != 0>;
+
+	using iterator = typename table_type::const_iterator;
+	using const_iterator = typename table_type::const_iterator;
+	using size_type = size_t;
+	using difference_type = std::ptrdiff_t;
+
+public:
+	unordered_set() noexcept : _table() { }
+
+	explicit unordered_set(size_t count, const Hash &hash = Hash(), const Equal &equal = Equal(),
+			const allocator_type &alloc = allocator_type()) noexcept : _table(hash, equal, alloc) {
+		_table.reserve(count);
+	}
+	explicit unordered_set(const allocator_type &alloc) noexcept : _table(Hash(), Equal(), alloc) { }
+
+	template <class InputIterator>
+	unordered_set(InputIterator first, InputIterator last, const allocator_type &alloc = allocator_type())
+	: _table(Hash(), Equal(), alloc) {
+		for (auto it = first; it != last; it ++) {
+			emplace(*it);
+		}
+	}
+
+	unordered_set(const unordered_set &x) noexcept : _table(x._table) { }
+	unordered_set(const unordered_set &x, const allocator_type &alloc) noexcept : _table(x._table, alloc) { }
+
+	unordered_set(unordered_set &&x) noexcept : _table(std::move(x._table)) { }
+	unordered_set(unordered_set &&x, const allocator_type &alloc) noexcept : _table(std::move(x._table), alloc) { }
+
+	unordered_set(InitializerList<value_type> il, const allocator_type &alloc = allocator_type()) noexcept
+	: _table(Hash(), Equal(), alloc) {
+		_table.reserve(il.size());
+		for (auto &it : il) {
+			emplace(it);
+		}
+	}
+
+	unordered_set& operator= (const unordered_set &other) noexcept {
+		_table = other._table;
+		return *this;
+	}
+	unordered_set& operator= (unordered_set &&other) noexcept {
+		_table = std::move(other._table);
+		return *this;
+	}
+	unordered_set& operator= (InitializerList<value_type> ilist) noexcept {
+		_table.clear();
+		for (auto &it : ilist) {
+			emplace(it);
+		}
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept { return _table.get_allocator(); }
+	hasher hash_function() const { return _table.hash_function(); }
+	key_equal key_eq() const { return _table.key_eq(); }
+
+	bool empty() const noexcept { return _table.empty(); }
+	size_t size() const noexcept { return _table.size(); }
+	void clear() { _table.clear(); }
+
+	size_t bucket_count() const noexcept { return _table.bucket_count(); }
+	float load_factor() const noexcept { return _table.load_factor(); }
+	void reserve(size_t c) { _table.reserve(c); }
+
+	Pair<iterator,bool> insert( const value_type& value ) {
+		return emplace(value);
+	}
+
+	Pair<iterator,bool> insert( value_type&& value ) {
+		return emplace(std::move(value));
+	}
+
+	template< class InputIt > void insert( InputIt first, InputIt last ) {
+		for (auto it = first; it != last; it ++) {
+			emplace(*it);
+		}
+	}
+
+	void insert( InitializerList<value_type> ilist ) {
+		for (auto &it : ilist) {
+			emplace(it);
+		}
+	}
+
+	Pair<iterator,bool> emplace( const value_type &value ) {
+		return _table.emplace_unique(value, [&] (allocator_type &alloc, value_type *ptr) {
+			alloc.construct(ptr, value);
+		});
+	}
+
+	Pair<iterator,bool> emplace( value_type &&value ) {
+		return _table.emplace_unique(value, [&] (allocator_type &alloc, value_type *ptr) {
+			alloc.construct(ptr, std::move(value));
+		});
+	}
+
+	template< class... Args >
+	Pair<iterator,bool> emplace( Args && ... args ) {
+		return emplace(value_type(std::forward<Args>(args)...));
+	}
+
+	iterator erase( const_iterator pos ) { return _table.erase(pos); }
+	iterator erase( const_iterator first, const_iterator last ) { return _table.erase(first, last); }
+
+	template< class K > size_type erase( const K& key ) { return _table.erase_unique(key); }
+
+	iterator begin() const noexcept { return _table.begin(); }
+	iterator end() const noexcept { return _table.end(); }
+
+	const_iterator cbegin() const noexcept { return _table.begin(); }
+	const_iterator cend() const noexcept { return _table.end(); }
+
+	void swap(unordered_set &other) noexcept {
+		_table.swap(other._table);
+	}
+
+	template< class K > const_iterator find( const K& x ) const { return _table.find(x); }
+
+	template< class K > size_t count( const K& x ) const { return (_table.find_index(x) != table_type::npos) ? 1 : 0; }
+	template< class K > bool contains( const K& x ) const { return _table.find_index(x) != table_type::npos; }
+
+protected:
+	table_type _table;
+};
+
+template<typename Value, typename Hash, typename Equal, HashTableFlags Flags> inline bool
+operator==(const unordered_set<Value, Hash, Equal, Flags>& __x, const unordered_set<Value, Hash, Equal, Flags>& __y) {
+	if (__x.size() != __y.size()) {
+		return false;
+	}
+	for (auto &it : __x) {
+		if (!__y.contains(it)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename Value, typename Hash, typename Equal, HashTableFlags Flags> inline bool
+operator!=(const unordered_set<Value, Hash, Equal, Flags>& __x, const unordered_set<Value, Hash, Equal, Flags>& __y) {
+	return !(__x == __y);
+}
+
+NS_SP_EXT_END(memory)
+
+#endif /* COMMON_MEMORY_SPMEMUNORDEREDSET_H_ */
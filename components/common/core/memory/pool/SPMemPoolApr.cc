@@ -64,6 +64,42 @@ static custom::AllocManager *allocmngr_get(pool_t *pool) {
 	return (custom::AllocManager *)serenity_allocmngr_get(pool);
 }
 
+// APR pool can not hold SlabCache inline, so it lives in pool's userdata;
+// thread-local magazine caches last used cache to skip userdata hash lookup.
+// Magazine is invalidated with global epoch, bumped when any slab cache is destroyed
+static constexpr auto SP_SLAB_CACHE_KEY = "SP.SlabCache";
+
+struct SlabMagazine {
+	pool_t *pool = nullptr;
+	custom::SlabCache *cache = nullptr;
+	uint32_t epoch = 0;
+};
+
+static std::atomic<uint32_t> s_slabEpoch = 1;
+static thread_local SlabMagazine tl_slabMagazine;
+
+static status_t slab_cleanup(void *) {
+	++ s_slabEpoch;
+	return APR_SUCCESS;
+}
+
+static custom::SlabCache *slab_get(pool_t *p) {
+	auto epoch = s_slabEpoch.load();
+	if (tl_slabMagazine.pool == p && tl_slabMagazine.epoch == epoch) {
+		return tl_slabMagazine.cache;
+	}
+
+	void *data = nullptr;
+	apr_pool_userdata_get(&data, SP_SLAB_CACHE_KEY, p);
+	if (!data) {
+		data = new (apr_palloc(p, sizeof(custom::SlabCache))) custom::SlabCache();
+		apr_pool_userdata_setn(data, SP_SLAB_CACHE_KEY, &slab_cleanup, p);
+	}
+
+	tl_slabMagazine = SlabMagazine{p, (custom::SlabCache *)data, epoch};
+	return tl_slabMagazine.cache;
+}
+
 void initialize() {
 	apr_pool_initialize();
 }
@@ -129,6 +165,27 @@ void free(pool_t *p, void *ptr, size_t size) {
 	}
 }
 
+void *slab_alloc(pool_t *p, size_t &size) {
+	if (size >= custom::BlockThreshold) {
+		return pool::alloc(p, size);
+	}
+
+	if (auto ret = slab_get(p)->alloc(size)) {
+		return ret;
+	}
+
+	allocmngr_get(p)->increment_alloc(size);
+	return apr_palloc(p, size);
+}
+
+void slab_free(pool_t *p, void *ptr, size_t size) {
+	if (size >= custom::BlockThreshold) {
+		pool::free(p, ptr, size);
+	} else {
+		slab_get(p)->free(ptr, size);
+	}
+}
+
 void *palloc(pool_t *p, size_t size) {
 	return pool::alloc(p, size);
 }
@@ -203,6 +260,8 @@ static void destroy(custom::Pool *p) { }
 static void clear(custom::Pool *p) { }
 static void *alloc(custom::Pool *p, size_t &size) { return nullptr; }
 static void free(custom::Pool *p, void *ptr, size_t size) { }
+static void *slab_alloc(custom::Pool *p, size_t &size) { return nullptr; }
+static void slab_free(custom::Pool *p, void *ptr, size_t size) { }
 static void *palloc(custom::Pool *p, size_t size) { return nullptr; }
 static void *calloc(custom::Pool *p, size_t count, size_t eltsize) { return nullptr; }
 static void cleanup_register(custom::Pool *p, void *ptr, custom::Status(*cb)(void *)) { }
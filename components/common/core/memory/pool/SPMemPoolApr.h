@@ -71,6 +71,9 @@ void clear(pool_t *p);
 void *alloc(pool_t *p, size_t &size);
 void free(pool_t *p, void *ptr, size_t size);
 
+void *slab_alloc(pool_t *p, size_t &size);
+void slab_free(pool_t *p, void *ptr, size_t size);
+
 void *palloc(pool_t *p, size_t size);
 void *calloc(pool_t *p, size_t count, size_t eltsize);
 
@@ -381,6 +381,25 @@ void free(pool_t *pool, void *ptr, size_t size) {
 	((custom::Pool *)pool)->free(ptr, size);
 }
 
+void *slab_alloc(pool_t *pool, size_t &size) {
+	if constexpr (apr::SPAprDefined) {
+		if (!isCustom(pool)) {
+			return apr::pool::slab_alloc(pool, size);
+		}
+	}
+	return ((custom::Pool *)pool)->slab_alloc(size);
+}
+
+void slab_free(pool_t *pool, void *ptr, size_t size) {
+	if constexpr (apr::SPAprDefined) {
+		if (!isCustom(pool)) {
+			apr::pool::slab_free(pool, ptr, size);
+			return;
+		}
+	}
+	((custom::Pool *)pool)->slab_free(ptr, size);
+}
+
 void cleanup_register(pool_t *pool, void *ptr, cleanup_fn cb) {
 	if constexpr (apr::SPAprDefined) {
 		if (!isCustom(pool)) {
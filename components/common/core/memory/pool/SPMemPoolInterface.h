@@ -117,6 +117,12 @@ void *palloc(pool_t *, size_t);
 void *calloc(pool_t *, size_t count, size_t eltsize);
 void free(pool_t *, void *ptr, size_t size);
 
+// size-class allocation for small fixed-size objects: size is rounded up to 16-byte class,
+// freed blocks are reused in O(1) until pool is cleared; sizes above BlockThreshold
+// are forwarded to alloc/free. Blocks from slab_alloc should be returned with slab_free only
+void *slab_alloc(pool_t *, size_t &);
+void slab_free(pool_t *, void *ptr, size_t size);
+
 void cleanup_register(pool_t *, void *, cleanup_fn);
 void cleanup_register(pool_t *p, memory::function<void()> &&cb);
 
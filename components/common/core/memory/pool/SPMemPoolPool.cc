@@ -45,6 +45,30 @@ void Pool::free(void *ptr, size_t sizeInBytes) {
 	}
 }
 
+void *Pool::slab_alloc(size_t &sizeInBytes) {
+	if (sizeInBytes >= BlockThreshold) {
+		return alloc(sizeInBytes);
+	}
+
+	std::unique_lock<Pool> lock(*this);
+	if (auto ret = slab.alloc(sizeInBytes)) {
+		return ret;
+	}
+
+	allocmngr.increment_alloc(sizeInBytes);
+	return palloc(sizeInBytes);
+}
+
+void Pool::slab_free(void *ptr, size_t sizeInBytes) {
+	if (sizeInBytes >= BlockThreshold) {
+		free(ptr, sizeInBytes);
+		return;
+	}
+
+	std::unique_lock<Pool> lock(*this);
+	slab.free(ptr, sizeInBytes);
+}
+
 void *Pool::palloc(size_t in_size) {
 	MemNode *active, *node;
 	void *mem;
@@ -150,6 +174,7 @@ void Pool::clear() {
 
 	if (active->next == active) {
 		this->allocmngr.reset(this);
+		this->slab.reset();
 		return;
 	}
 
@@ -160,6 +185,7 @@ void Pool::clear() {
 	active->next = active;
 	active->ref = &active->next;
 	this->allocmngr.reset(this);
+	this->slab.reset();
 }
 
 Pool *Pool::create(Allocator *alloc, bool threadSafe) {
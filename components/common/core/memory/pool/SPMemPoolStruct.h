@@ -59,6 +59,32 @@ struct AllocManager {
 	size_t get_return() { return returned; }
 };
 
+// Size-class free lists for small fixed-size objects (rbtree nodes, values)
+// Unlike AllocManager, both alloc and free are O(1): freed blocks are pushed into
+// an intrusive list for their class and reused until the owning pool is cleared
+struct SlabCache {
+	struct Block {
+		Block *next;
+	};
+
+	static constexpr size_t Granularity = 16;
+	static constexpr size_t Classes = BlockThreshold / Granularity;
+
+	// rounds size up to class boundary, blocks from slab_alloc always have this size
+	static constexpr size_t class_size(size_t s) { return ALIGN(s, Granularity); }
+
+	Block *classes[Classes] = { nullptr };
+	size_t reused = 0;
+
+	void reset();
+
+	// returns cached block of class for size, or nullptr, size is rounded up to class
+	void *alloc(size_t &sizeInBytes);
+
+	// returns block of at least sizeInBytes into cache
+	void free(void *ptr, size_t sizeInBytes);
+};
+
 struct Pool;
 struct HashTable;
 
@@ -135,6 +161,7 @@ struct Pool {
     HashTable *user_data = nullptr;
 
 	AllocManager allocmngr;
+	SlabCache slab;
 	bool threadSafe = false;
 
 	static Pool *create(Allocator *alloc = nullptr, bool threadSafe = false);
@@ -148,6 +175,9 @@ struct Pool {
 	void *alloc(size_t &sizeInBytes);
 	void free(void *ptr, size_t sizeInBytes);
 
+	void *slab_alloc(size_t &sizeInBytes);
+	void slab_free(void *ptr, size_t sizeInBytes);
+
 	void *palloc(size_t);
 	void *calloc(size_t count, size_t eltsize);
 
@@ -100,6 +100,34 @@ void AllocManager::free(void *ptr, size_t sizeInBytes, AllocFn allocFn) {
 	}
 }
 
+void SlabCache::reset() {
+	memset(classes, 0, sizeof(Block *) * Classes);
+	reused = 0;
+}
+
+void *SlabCache::alloc(size_t &sizeInBytes) {
+	sizeInBytes = class_size(sizeInBytes);
+	auto &head = classes[sizeInBytes / Granularity - 1];
+	if (auto b = head) {
+		head = b->next;
+		++ reused;
+		return b;
+	}
+	return nullptr;
+}
+
+void SlabCache::free(void *ptr, size_t sizeInBytes) {
+	// round down: block, allocated outside of slab, should fit class it returned into
+	auto idx = sizeInBytes / Granularity;
+	if (!ptr || idx == 0 || idx > Classes) {
+		return;
+	}
+
+	auto b = (Block *)ptr;
+	b->next = classes[idx - 1];
+	classes[idx - 1] = b;
+}
+
 void MemNode::insert(MemNode *point) {
 	this->ref = point->ref;
 	*this->ref = this;
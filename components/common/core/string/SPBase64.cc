@@ -26,9 +26,15 @@ THE SOFTWARE.
 #include "SPCommon.h"
 #include "SPString.h"
 
-NS_SP_EXT_BEGIN(base64)
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if __SSSE3__
+#include <tmmintrin.h>
+#endif
 
-using Reader = BytesViewNetwork;
+NS_SP_EXT_BEGIN(base64)
 
 // Mapping from 6 bit pattern to ASCII character.
 static const char * base64EncodeLookup = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -62,47 +68,151 @@ constexpr int Base64Unit = 4;
 size_t encodeSize(size_t l) { return ((l / BinaryUnit) + ((l % BinaryUnit) ? 1 : 0)) * Base64Unit; }
 size_t decodeSize(size_t l) { return ((l+Base64Unit-1) / Base64Unit) * BinaryUnit; }
 
-template <typename Callback>
-static void make_encode(const CoderSource &data, const Callback &cb) {
-	Reader inputBuffer(data.data(), data.size());
-	auto length = inputBuffer.size();
+// Size of input chunk for stream coders
+constexpr size_t StreamUnits = 1024;
+
+#if __SSE2__
+
+static inline __m128i Base64_inRange(__m128i v, char first, char last) {
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(first - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(last + 1)));
+}
+
+// Encodes 12 bytes into 16 chars
+static inline void Base64_encodeBlock(char *out, const uint8_t *in, char c62, char c63) {
+	// 24-bit groups, one per 32-bit lane
+#if __SSSE3__
+	auto v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)in),
+			_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1));
+#else
+	auto v = _mm_setr_epi32((in[0] << 16) | (in[1] << 8) | in[2], (in[3] << 16) | (in[4] << 8) | in[5],
+			(in[6] << 16) | (in[7] << 8) | in[8], (in[9] << 16) | (in[10] << 8) | in[11]);
+#endif
+
+	// split groups into sextets, one per byte
+	const auto mask = _mm_set1_epi32(0x3F);
+	auto s = _mm_or_si128(
+		_mm_or_si128(_mm_srli_epi32(v, 18), _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 12), mask), 8)),
+		_mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 6), mask), 16), _mm_slli_epi32(_mm_and_si128(v, mask), 24)));
+
+	// sextet to char offsets: [0, 26) -> 'A', [26, 52) -> 'a', [52, 62) -> '0', 62 and 63 -> alphabet-specific
+	auto is62 = _mm_cmpeq_epi8(s, _mm_set1_epi8(62));
+	auto is63 = _mm_cmpeq_epi8(s, _mm_set1_epi8(63));
+	auto off = _mm_add_epi8(_mm_set1_epi8('A'),
+			_mm_add_epi8(_mm_and_si128(_mm_cmpgt_epi8(s, _mm_set1_epi8(25)), _mm_set1_epi8('a' - 26 - 'A')),
+				_mm_and_si128(_mm_cmpgt_epi8(s, _mm_set1_epi8(51)), _mm_set1_epi8('0' - 52 - ('a' - 26)))));
+	off = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(is62, is63), off),
+			_mm_or_si128(_mm_and_si128(is62, _mm_set1_epi8(c62 - 62)), _mm_and_si128(is63, _mm_set1_epi8(c63 - 63))));
+
+	_mm_storeu_si128((__m128i *)out, _mm_add_epi8(s, off));
+}
+
+// Decodes 16 chars into 12 bytes, fails if block contains chars outside of alphabet
+static inline bool Base64_decodeBlock(uint8_t *out, const char *in) {
+	auto v = _mm_loadu_si128((const __m128i *)in);
+	auto upper = Base64_inRange(v, 'A', 'Z');
+	auto lower = Base64_inRange(v, 'a', 'z');
+	auto digit = Base64_inRange(v, '0', '9');
+	auto c62 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')), _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+	auto c63 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+	if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, c62), c63))) != 0xFFFF) {
+		return false;
+	}
+
+	auto off = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+			_mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+	auto s = _mm_add_epi8(v, off);
+	s = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(c62, c63), s),
+			_mm_or_si128(_mm_and_si128(c62, _mm_set1_epi8(62)), _mm_and_si128(c63, _mm_set1_epi8(63))));
+
+	// merge sextets into 12-bit, then into 24-bit groups
+	auto t = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(s, _mm_set1_epi16(0x00FF)), 6), _mm_srli_epi16(s, 8));
+	auto g = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xFFFF)), 12), _mm_srli_epi32(t, 16));
+
+#if __SSSE3__
+	g = _mm_shuffle_epi8(g, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	_mm_storel_epi64((__m128i *)out, g);
+	uint32_t tail = uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(g, 8)));
+	memcpy(out + 8, &tail, 4);
+#else
+	alignas(16) uint32_t groups[4];
+	_mm_store_si128((__m128i *)groups, g);
+	for (auto &it : groups) {
+		*out++ = uint8_t(it >> 16);
+		*out++ = uint8_t(it >> 8);
+		*out++ = uint8_t(it);
+	}
+#endif
+	return true;
+}
+
+#endif
 
+// Encodes input into buffer with at least encodeSize(length) bytes, returns number of written chars
+static size_t Base64_encode(char *out, const uint8_t *in, size_t length, const char *table, bool padding) {
+	auto target = out;
 	size_t i = 0;
+#if __SSE2__
+	// SSSE3 version reads 16 bytes for every 12 encoded
+	for (; i + 16 <= length; i += 12) {
+		Base64_encodeBlock(target, in + i, table[62], table[63]);
+		target += 16;
+	}
+#endif
 	for (; i + BinaryUnit - 1 < length; i += BinaryUnit) {
-		// Inner loop: turn 48 bytes into 64 base64 characters
-		cb(base64EncodeLookup[(inputBuffer[i] & 0xFC) >> 2]);
-		cb(base64EncodeLookup[((inputBuffer[i] & 0x03) << 4) | ((inputBuffer[i + 1] & 0xF0) >> 4)]);
-		cb(base64EncodeLookup[((inputBuffer[i + 1] & 0x0F) << 2) | ((inputBuffer[i + 2] & 0xC0) >> 6)]);
-		cb(base64EncodeLookup[inputBuffer[i + 2] & 0x3F]);
+		target[0] = table[(in[i] & 0xFC) >> 2];
+		target[1] = table[((in[i] & 0x03) << 4) | ((in[i + 1] & 0xF0) >> 4)];
+		target[2] = table[((in[i + 1] & 0x0F) << 2) | ((in[i + 2] & 0xC0) >> 6)];
+		target[3] = table[in[i + 2] & 0x3F];
+		target += Base64Unit;
 	}
 
 	if (i + 1 < length) {
 		// Handle the single '=' case
-		cb(base64EncodeLookup[(inputBuffer[i] & 0xFC) >> 2]);
-		cb(base64EncodeLookup[((inputBuffer[i] & 0x03) << 4) | ((inputBuffer[i + 1] & 0xF0) >> 4)]);
-		cb(base64EncodeLookup[(inputBuffer[i + 1] & 0x0F) << 2]);
-		cb('=');
+		*target++ = table[(in[i] & 0xFC) >> 2];
+		*target++ = table[((in[i] & 0x03) << 4) | ((in[i + 1] & 0xF0) >> 4)];
+		*target++ = table[(in[i + 1] & 0x0F) << 2];
+		if (padding) {
+			*target++ = '=';
+		}
 	} else if (i < length) {
 		// Handle the double '=' case
-		cb(base64EncodeLookup[(inputBuffer[i] & 0xFC) >> 2]);
-		cb(base64EncodeLookup[(inputBuffer[i] & 0x03) << 4]);
-		cb('=');
-		cb('=');
+		*target++ = table[(in[i] & 0xFC) >> 2];
+		*target++ = table[(in[i] & 0x03) << 4];
+		if (padding) {
+			*target++ = '=';
+			*target++ = '=';
+		}
 	}
+	return target - out;
 }
 
-template <typename Callback>
-static void make_decode(const CoderSource &data, const Callback &cb) {
-	StringView inputBuffer((char *)data.data(), data.size());
-	auto length = inputBuffer.size();
+// Decodes input into buffer, stops when buffer is full. Chars outside of alphabet are ignored.
+// With `partial`, stops before the last incomplete unit, so it can be continued with next chunk.
+// Returns number of consumed chars and written bytes.
+static Pair<size_t, size_t> Base64_decode(uint8_t *out, size_t bsize, const char *in, size_t length, bool partial) {
+	auto target = out;
+	auto targetEnd = out + bsize;
 
 	size_t i = 0;
-	while (i < length) {
+	while (i < length && target < targetEnd) {
+		if (partial && targetEnd - target < BinaryUnit) {
+			break;
+		}
+#if __SSE2__
+		if (i + 16 <= length && targetEnd - target >= 12) {
+			if (Base64_decodeBlock(target, in + i)) {
+				target += 12;
+				i += 16;
+				continue;
+			}
+		}
+#endif
 		// Accumulate 4 valid characters (ignore everything else)
 		unsigned char accumulated[Base64Unit];
 		size_t accumulateIndex = 0;
-		while (i < length) {
-			unsigned char decode = base64DecodeLookup[(unsigned char)inputBuffer[i++]];
+		size_t next = i;
+		while (next < length) {
+			unsigned char decode = base64DecodeLookup[(unsigned char)in[next++]];
 			if (decode != xx) {
 				accumulated[accumulateIndex] = decode;
 				accumulateIndex++;
@@ -112,128 +222,119 @@ static void make_decode(const CoderSource &data, const Callback &cb) {
 			}
 		}
 
-		if(accumulateIndex >= 2)
-			cb((accumulated[0] << 2) | (accumulated[1] >> 4));
-		if(accumulateIndex >= 3)
-			cb((accumulated[1] << 4) | (accumulated[2] >> 2));
-		if(accumulateIndex >= 4)
-			cb((accumulated[2] << 6) | accumulated[3]);
+		if (partial && accumulateIndex < Base64Unit) {
+			break;
+		}
+
+		i = next;
+		if (accumulateIndex >= 2 && target < targetEnd) {
+			*target++ = (accumulated[0] << 2) | (accumulated[1] >> 4);
+		}
+		if (accumulateIndex >= 3 && target < targetEnd) {
+			*target++ = (accumulated[1] << 4) | (accumulated[2] >> 2);
+		}
+		if (accumulateIndex >= 4 && target < targetEnd) {
+			*target++ = (accumulated[2] << 6) | accumulated[3];
+		}
 	}
+	return pair(i, size_t(target - out));
 }
 
-#undef xx
+static void Base64_encodeStream(std::basic_ostream<char> &stream, const CoderSource &source, const char *table, bool padding) {
+	char buf[StreamUnits * Base64Unit];
+	auto ptr = source.data();
+	auto length = source.size();
+	while (length > 0) {
+		auto chunk = std::min(length, StreamUnits * BinaryUnit);
+		stream.write(buf, Base64_encode(buf, ptr, chunk, table, padding));
+		ptr += chunk;
+		length -= chunk;
+	}
+}
 
-typename memory::PoolInterface::StringType __encode_pool(const CoderSource &source) {
-	typename memory::PoolInterface::StringType output;
-	output.reserve(encodeSize(source.size()));
-	make_encode(source, [&] (const char &c) {
-		output.push_back(c);
-	});
+template <typename Container>
+static Container Base64_encodeContainer(const CoderSource &source, const char *table, bool padding) {
+	Container output; output.resize(encodeSize(source.size()));
+	output.resize(Base64_encode(output.data(), source.data(), source.size(), table, padding));
 	return output;
 }
-typename memory::StandartInterface::StringType __encode_std(const CoderSource &source) {
-	typename memory::StandartInterface::StringType output;
-	output.reserve(encodeSize(source.size()));
-	make_encode(source, [&] (const char &c) {
-		output.push_back(c);
-	});
+
+template <typename Container>
+static Container Base64_decodeContainer(const CoderSource &source) {
+	Container output; output.resize(decodeSize(source.size()));
+	output.resize(Base64_decode(output.data(), output.size(), (const char *)source.data(), source.size(), false).second);
 	return output;
 }
+
+typename memory::PoolInterface::StringType __encode_pool(const CoderSource &source) {
+	return Base64_encodeContainer<typename memory::PoolInterface::StringType>(source, base64EncodeLookup, true);
+}
+typename memory::StandartInterface::StringType __encode_std(const CoderSource &source) {
+	return Base64_encodeContainer<typename memory::StandartInterface::StringType>(source, base64EncodeLookup, true);
+}
 void encode(std::basic_ostream<char> &stream, const CoderSource &source) {
-	make_encode(source, [&] (const char &c) {
-		stream << c;
-	});
+	Base64_encodeStream(stream, source, base64EncodeLookup, true);
+}
+size_t encode(char *buf, size_t bsize, const CoderSource &source) {
+	// only complete units, that fits into buffer
+	auto length = std::min(source.size(), (bsize / Base64Unit) * BinaryUnit);
+	return Base64_encode(buf, source.data(), length, base64EncodeLookup, true);
 }
 
 typename memory::PoolInterface::BytesType __decode_pool(const CoderSource &source) {
-	typename memory::PoolInterface::BytesType output;
-	output.reserve(encodeSize(source.size()));
-	make_decode(source, [&] (const uint8_t &c) {
-		output.emplace_back(c);
-	});
-	return output;
+	return Base64_decodeContainer<typename memory::PoolInterface::BytesType>(source);
 }
 typename memory::StandartInterface::BytesType __decode_std(const CoderSource &source) {
-	typename memory::StandartInterface::BytesType output;
-	output.reserve(encodeSize(source.size()));
-	make_decode(source, [&] (const uint8_t &c) {
-		output.emplace_back(c);
-	});
-	return output;
+	return Base64_decodeContainer<typename memory::StandartInterface::BytesType>(source);
 }
 void decode(std::basic_ostream<char> &stream, const CoderSource &source) {
-	make_decode(source, [&] (const uint8_t &c) {
-		stream << char(c);
-	});
+	uint8_t buf[StreamUnits * BinaryUnit];
+	auto ptr = (const char *)source.data();
+	auto length = source.size();
+	auto chunk = StreamUnits * Base64Unit;
+	while (length > 0) {
+		auto ret = Base64_decode(buf, sizeof(buf), ptr, std::min(length, chunk), chunk < length);
+		if (ret.first == 0) {
+			// no complete unit within chunk
+			chunk *= 2;
+			continue;
+		}
+		stream.write((const char *)buf, ret.second);
+		ptr += ret.first;
+		length -= ret.first;
+	}
+}
+size_t decode(uint8_t *buf, size_t bsize, const CoderSource &source) {
+	return Base64_decode(buf, bsize, (const char *)source.data(), source.size(), false).second;
 }
 
+#undef xx
+
 NS_SP_EXT_END(base64)
 
 NS_SP_EXT_BEGIN(base64url)
 
-using Reader = BytesViewNetwork;
-
 // Mapping from 6 bit pattern to ASCII character.
 static const char * base64EncodeLookup = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
 
-// Fundamental sizes of the binary and base64 encode/decode units in bytes
-constexpr int BinaryUnit = 3;
-constexpr int Base64Unit = 4;
-
-template <typename Callback>
-static void make_encode(const CoderSource &data, const Callback &cb) {
-	Reader inputBuffer(data.data(), data.size());
-	auto length = inputBuffer.size();
-
-	size_t i = 0;
-	for (; i + BinaryUnit - 1 < length; i += BinaryUnit) {
-		// Inner loop: turn 48 bytes into 64 base64 characters
-		cb(base64EncodeLookup[(inputBuffer[i] & 0xFC) >> 2]);
-		cb(base64EncodeLookup[((inputBuffer[i] & 0x03) << 4) | ((inputBuffer[i + 1] & 0xF0) >> 4)]);
-		cb(base64EncodeLookup[((inputBuffer[i + 1] & 0x0F) << 2) | ((inputBuffer[i + 2] & 0xC0) >> 6)]);
-		cb(base64EncodeLookup[inputBuffer[i + 2] & 0x3F]);
-	}
-
-	if (i + 1 < length) {
-		// Handle the single '=' case
-		cb(base64EncodeLookup[(inputBuffer[i] & 0xFC) >> 2]);
-		cb(base64EncodeLookup[((inputBuffer[i] & 0x03) << 4) | ((inputBuffer[i + 1] & 0xF0) >> 4)]);
-		cb(base64EncodeLookup[(inputBuffer[i + 1] & 0x0F) << 2]);
-	} else if (i < length) {
-		// Handle the double '=' case
-		cb(base64EncodeLookup[(inputBuffer[i] & 0xFC) >> 2]);
-		cb(base64EncodeLookup[(inputBuffer[i] & 0x03) << 4]);
-	}
-}
-
 typename memory::PoolInterface::StringType __encode_pool(const CoderSource &source) {
-	typename memory::PoolInterface::StringType output;
-	output.reserve(encodeSize(source.size()));
-	make_encode(source, [&] (const char &c) {
-		output.push_back(c);
-	});
-	return output;
+	return base64::Base64_encodeContainer<typename memory::PoolInterface::StringType>(source, base64EncodeLookup, false);
 }
 typename memory::StandartInterface::StringType __encode_std(const CoderSource &source) {
-	typename memory::StandartInterface::StringType output;
-	output.reserve(encodeSize(source.size()));
-	make_encode(source, [&] (const char &c) {
-		output.push_back(c);
-	});
-	return output;
+	return base64::Base64_encodeContainer<typename memory::StandartInterface::StringType>(source, base64EncodeLookup, false);
 }
 void encode(std::basic_ostream<char> &stream, const CoderSource &source) {
-	make_encode(source, [&] (const char &c) {
-		stream << c;
-	});
+	base64::Base64_encodeStream(stream, source, base64EncodeLookup, false);
+}
+size_t encode(char *buf, size_t bsize, const CoderSource &source) {
+	auto length = std::min(source.size(), (bsize / base64::Base64Unit) * base64::BinaryUnit);
+	return base64::Base64_encode(buf, source.data(), length, base64EncodeLookup, false);
 }
 
 NS_SP_EXT_END(base64url)
 
 NS_SP_EXT_BEGIN(base16)
 
-using Reader = BytesViewNetwork;
-
 static const char* s_hexTable_lower[256] = {
     "00", "01", "02", "03", "04", "05", "06", "07", "08", "09", "0a", "0b", "0c", "0d", "0e", "0f", "10", "11",
     "12", "13", "14", "15", "16", "17", "18", "19", "1a", "1b", "1c", "1d", "1e", "1f", "20", "21", "22", "23",
@@ -297,102 +398,131 @@ uint8_t hexToChar(const char &c, const char &d) {
 }
 
 
-template <>
-auto encode<memory::PoolInterface>(const CoderSource &source) -> typename memory::PoolInterface::StringType {
-	Reader inputBuffer(source.data(), source.size());
-	const auto length = inputBuffer.size();
+// Encodes input into buffer with at least 2 * length bytes
+static void Base16_encode(char *out, const uint8_t *in, size_t length) {
+	size_t i = 0;
+#if __SSE2__
+	const auto mask = _mm_set1_epi8(0x0F);
+	const auto nine = _mm_set1_epi8(9);
+	const auto zero = _mm_set1_epi8('0');
+	const auto alpha = _mm_set1_epi8('a' - '0' - 10);
+	for (; i + 16 <= length; i += 16) {
+		auto v = _mm_loadu_si128((const __m128i *)(in + i));
+		auto hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+		auto lo = _mm_and_si128(v, mask);
+
+		// nibbles in output order
+		auto n1 = _mm_unpacklo_epi8(hi, lo);
+		auto n2 = _mm_unpackhi_epi8(hi, lo);
+		n1 = _mm_add_epi8(_mm_add_epi8(n1, zero), _mm_and_si128(_mm_cmpgt_epi8(n1, nine), alpha));
+		n2 = _mm_add_epi8(_mm_add_epi8(n2, zero), _mm_and_si128(_mm_cmpgt_epi8(n2, nine), alpha));
+		_mm_storeu_si128((__m128i *)(out + i * 2), n1);
+		_mm_storeu_si128((__m128i *)(out + i * 2 + 16), n2);
+	}
+#endif
+	for (; i < length; ++i) {
+		memcpy(out + i * 2, s_hexTable_lower[in[i]], 2);
+	}
+}
 
-	memory::PoolInterface::StringType output; output.resize(length * 2);
-	for (size_t i = 0; i < length; ++i) {
-		memcpy(output.data() + i * 2, s_hexTable_lower[inputBuffer[i]], 2);
+#if __SSE2__
+
+static inline __m128i Base16_inRange(__m128i v, char first, char last) {
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(first - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(last + 1)));
+}
+
+// Converts hex chars to nibbles, chars outside of alphabet are decoded as 0
+static inline __m128i Base16_decodeNibbles(__m128i v) {
+	auto digit = Base16_inRange(v, '0', '9');
+	auto l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	auto alpha = Base16_inRange(l, 'a', 'f');
+	return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+			_mm_and_si128(alpha, _mm_sub_epi8(l, _mm_set1_epi8('a' - 10))));
+}
+
+#endif
+
+// Decodes pairs of hex chars into buffer with at least `count` bytes, returns number of written bytes
+static size_t Base16_decode(uint8_t *out, size_t count, const uint8_t *in, size_t length) {
+	count = std::min(count, (length + 1) / 2);
+
+	size_t i = 0;
+#if __SSE2__
+	const auto low = _mm_set1_epi16(0x00FF);
+	for (; i + 16 <= count; i += 16) {
+		auto n1 = Base16_decodeNibbles(_mm_loadu_si128((const __m128i *)(in + i * 2)));
+		auto n2 = Base16_decodeNibbles(_mm_loadu_si128((const __m128i *)(in + i * 2 + 16)));
+		n1 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n1, low), 4), _mm_srli_epi16(n1, 8));
+		n2 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n2, low), 4), _mm_srli_epi16(n2, 8));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(n1, n2));
+	}
+#endif
+	for (; i < count; ++ i) {
+		out[i] = uint8_t((s_decTable[in[i * 2]] << 4) | ((i * 2 + 1 < length) ? s_decTable[in[i * 2 + 1]] : 0));
 	}
-    return output;
+	return count;
 }
 
 template <>
-auto encode<memory::StandartInterface>(const CoderSource &source) -> typename memory::StandartInterface::StringType {
-	Reader inputBuffer(source.data(), source.size());
-	const auto length = inputBuffer.size();
-
-	memory::StandartInterface::StringType output; output.reserve(length * 2);
-    for (size_t i = 0; i < length; ++i) {
-    	output.append(s_hexTable_lower[inputBuffer[i]], 2);
-    }
+auto encode<memory::PoolInterface>(const CoderSource &source) -> typename memory::PoolInterface::StringType {
+	memory::PoolInterface::StringType output; output.resize(source.size() * 2);
+	Base16_encode(output.data(), source.data(), source.size());
+	return output;
+}
 
-    return output;
+template <>
+auto encode<memory::StandartInterface>(const CoderSource &source) -> typename memory::StandartInterface::StringType {
+	memory::StandartInterface::StringType output; output.resize(source.size() * 2);
+	Base16_encode(output.data(), source.data(), source.size());
+	return output;
 }
 
 void encode(std::basic_ostream<char> &stream, const CoderSource &source) {
-	Reader inputBuffer(source.data(), source.size());
-	const auto length = inputBuffer.size();
-    for (size_t i = 0; i < length; ++i) {
-    	stream << s_hexTable_lower[inputBuffer[i]];
-    }
+	char buf[1024 * 2];
+	auto ptr = source.data();
+	auto length = source.size();
+	while (length > 0) {
+		auto chunk = std::min(length, sizeof(buf) / 2);
+		Base16_encode(buf, ptr, chunk);
+		stream.write(buf, chunk * 2);
+		ptr += chunk;
+		length -= chunk;
+	}
 }
 size_t encode(char *buf, size_t bsize, const CoderSource &source) {
-	Reader inputBuffer(source.data(), source.size());
-	const auto length = inputBuffer.size();
-
-	size_t bytes = 0;
-    for (size_t i = 0; i < length; ++i) {
-    	if (bytes + 2 <= bsize) {
-        	memcpy(buf + i * 2, s_hexTable_lower[inputBuffer[i]], 2);
-        	bytes += 2;
-    	} else {
-    		break;
-    	}
-    }
-    return bytes;
+	auto length = std::min(source.size(), bsize / 2);
+	Base16_encode(buf, source.data(), length);
+	return length * 2;
 }
 
 template <>
 auto decode<memory::PoolInterface>(const CoderSource &source) -> typename memory::PoolInterface::BytesType {
-	const auto length = source.size();
-	memory::PoolInterface::BytesType outputBuffer; outputBuffer.reserve(length / 2);
-	for (size_t i = 0; i < length; i += 2) {
-		outputBuffer.push_back(
-				(s_decTable[source[i]] << 4)
-					| s_decTable[source[i + 1]]);
-	}
+	memory::PoolInterface::BytesType outputBuffer; outputBuffer.resize((source.size() + 1) / 2);
+	Base16_decode(outputBuffer.data(), outputBuffer.size(), source.data(), source.size());
 	return outputBuffer;
 }
 
 template <>
 auto decode<memory::StandartInterface>(const CoderSource &source) -> typename memory::StandartInterface::BytesType {
-	const auto length = source.size();
-	memory::StandartInterface::BytesType outputBuffer; outputBuffer.reserve(length / 2);
-	for (size_t i = 0; i < length; i += 2) {
-		outputBuffer.push_back(
-				(s_decTable[source[i]] << 4)
-					| s_decTable[source[i + 1]]);
-	}
+	memory::StandartInterface::BytesType outputBuffer; outputBuffer.resize((source.size() + 1) / 2);
+	Base16_decode(outputBuffer.data(), outputBuffer.size(), source.data(), source.size());
 	return outputBuffer;
 }
 
 void decode(std::basic_ostream<char> &stream, const CoderSource &source) {
-	const auto length = source.size();
-
-	for (size_t i = 0; i < length; i += 2) {
-		stream << char(
-				(s_decTable[source[i]] << 4)
-					| s_decTable[source[i + 1]]);
+	uint8_t buf[1024];
+	auto ptr = source.data();
+	auto length = source.size();
+	while (length > 0) {
+		auto chunk = std::min(length, sizeof(buf) * 2);
+		auto count = Base16_decode(buf, sizeof(buf), ptr, chunk);
+		stream.write((const char *)buf, count);
+		ptr += chunk;
+		length -= chunk;
 	}
 }
 size_t decode(uint8_t *buf, size_t bsize, const CoderSource &source) {
-	const auto length = source.size();
-
-	size_t bytes = 0;
-	for (size_t i = 0; i < length; i += 2) {
-		if (bytes + 1 <= bsize) {
-			buf[bytes] = uint8_t(
-					(s_decTable[source[i]] << 4)
-						| s_decTable[source[i + 1]]);
-			++ bytes;
-		} else {
-			break;
-		}
-	}
-	return bytes;
+	return Base16_decode(buf, bsize, source.data(), source.size());
 }
 
 NS_SP_EXT_END(base16)
@@ -28,10 +28,17 @@ THE SOFTWARE.
 
 NS_SP_EXT_BEGIN(string)
 
+// number of utf16 chars for utf8 string, zero chars included
 size_t getUtf16Length(const StringView &str);
 size_t getUtf16HtmlLength(const StringView &str);
 size_t getUtf8Length(const WideStringView &str);
 
+// decode utf8 into buffer (zero chars included), stops when buffer is full, returns number of written chars
+size_t decodeUtf8(char16_t *buf, size_t bufSize, const char *str, size_t len);
+
+// encode into utf8 buffer, stops when buffer is full, returns number of written bytes
+size_t encodeUtf8(char *buf, size_t bufSize, const char16_t *str, size_t len);
+
 Pair<char16_t, uint8_t> read(const char *);
 
 char charToKoi8r(char16_t c);
@@ -465,12 +472,14 @@ template <typename Interface = memory::DefaultInterface>
 auto encode(const CoderSource &source) -> typename Interface::StringType;
 
 void encode(std::basic_ostream<char> &stream, const CoderSource &source);
+size_t encode(char *, size_t bsize, const CoderSource &source);
 
 
 template <typename Interface = memory::DefaultInterface>
 auto decode(const CoderSource &source) -> typename Interface::BytesType;
 
 void decode(std::basic_ostream<char> &stream, const CoderSource &source);
+size_t decode(uint8_t *, size_t bsize, const CoderSource &source);
 
 NS_SP_EXT_END(base64)
 
@@ -484,12 +493,14 @@ template <typename Interface = memory::DefaultInterface>
 auto encode(const CoderSource &source) -> typename Interface::StringType;
 
 void encode(std::basic_ostream<char> &stream, const CoderSource &source);
+size_t encode(char *, size_t bsize, const CoderSource &source);
 
 
 template <typename Interface = memory::DefaultInterface>
 auto decode(const CoderSource &source) -> typename Interface::BytesType;
 
 void decode(std::basic_ostream<char> &stream, const CoderSource &source);
+size_t decode(uint8_t *, size_t bsize, const CoderSource &source);
 
 NS_SP_EXT_END(base64url)
 
@@ -748,15 +759,9 @@ auto StringTraits<Interface>::urldecode(const StringView &str) -> String {
 template <typename Interface>
 auto StringTraits<Interface>::toUtf16(const StringView &utf8_str) -> WideString {
 	const auto size = string::getUtf16Length(utf8_str);
-	WideString utf16_str; utf16_str.reserve(size);
-
-	auto ptr = (char_const_ptr_t)utf8_str.data();
-	auto end = ptr + utf8_str.size();
-	while (ptr < end) {
-		utf16_str.push_back(char16_t(utf8Decode(ptr)));
-	}
-
-    return utf16_str;
+	WideString utf16_str; utf16_str.resize(size);
+	utf16_str.resize(string::decodeUtf8(utf16_str.data(), size, utf8_str.data(), utf8_str.size()));
+	return utf16_str;
 }
 
 template <typename Interface>
@@ -776,14 +781,8 @@ auto StringTraits<Interface>::toUtf16Html(const StringView &utf8_str) -> WideStr
 template <typename Interface>
 auto StringTraits<Interface>::toUtf8(const WideStringView &str) -> String {
 	const auto size = string::getUtf8Length(str);
-	String ret; ret.reserve(size);
-
-	auto ptr = str.data();
-	auto end = ptr + str.size();
-	while (ptr < end) {
-		utf8Encode(ret, *ptr++);
-	}
-
+	String ret; ret.resize(size);
+	ret.resize(string::encodeUtf8(ret.data(), size, str.data(), str.size()));
 	return ret;
 }
 
@@ -1017,6 +1016,10 @@ inline void decode(std::basic_ostream<char> &stream, const CoderSource &source)
 	base64::decode(stream, source);
 }
 
+inline size_t decode(uint8_t *buf, size_t bsize, const CoderSource &source) {
+	return base64::decode(buf, bsize, source);
+}
+
 NS_SP_EXT_END(base64url)
 
 
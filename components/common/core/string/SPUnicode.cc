@@ -27,6 +27,10 @@ THE SOFTWARE.
 #include "SPString.h"
 #include "SPUnicode.h"
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace stappler::unicode {
 
 }
@@ -34,83 +38,126 @@ namespace stappler::unicode {
 
 namespace stappler::string {
 
-static const char * const sp_uppercase_set = "АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
-static const char * const sp_lowercase_set = "абвгдеёжзийклмнопрстуфхцчшщъыьэюя";
-
-static const char16_t * const sp_uppercase_set_16 = u"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
-static const char16_t * const sp_lowercase_set_16 = u"абвгдеёжзийклмнопрстуфхцчшщъыьэюя";
-
 inline size_t Utf8CharLength(const uint8_t *ptr, uint8_t &mask) SPUNUSED;
 
-static inline void sp_str_replace(const char *target, const char *str, char &b, char &c) {
-	int i = 0;
-	while (str[1] != 0) {
-		if (str[0] == b && str[1] == c) {
-			if (i % 2 == 0) {
-				b = target[i];
-				c = target[i + 1];
-			}
-			return;
-		}
-		++ i; ++ str;
+// Case mapping for two-byte utf8 sequences of Russian alphabet (U+0410 - U+044F, Ё and ё)
+static inline void Utf8_tolower(uint8_t *p) {
+	if (p[0] != 0xD0) {
+		return;
+	}
+	if (p[1] == 0x81) { p[0] = 0xD1; p[1] = 0x91; } // Ё
+	else if (p[1] >= 0x90 && p[1] < 0xA0) { p[1] += 0x20; } // А-П
+	else if (p[1] >= 0xA0 && p[1] < 0xB0) { p[0] = 0xD1; p[1] -= 0x20; } // Р-Я
+}
+
+static inline void Utf8_toupper(uint8_t *p) {
+	if (p[0] == 0xD0) {
+		if (p[1] >= 0xB0 && p[1] < 0xC0) { p[1] -= 0x20; } // а-п
+	} else if (p[0] == 0xD1) {
+		if (p[1] >= 0x80 && p[1] < 0x90) { p[0] = 0xD0; p[1] += 0x20; } // р-я
+		else if (p[1] == 0x91) { p[0] = 0xD0; p[1] = 0x81; } // ё
 	}
 }
 
 void toupper(char &b, char &c) {
-	sp_str_replace(sp_uppercase_set, sp_lowercase_set, b, c);
+	uint8_t buf[2] = { uint8_t(b), uint8_t(c) };
+	Utf8_toupper(buf);
+	b = char(buf[0]); c = char(buf[1]);
 }
 
 void tolower(char &b, char &c) {
-	sp_str_replace(sp_lowercase_set, sp_uppercase_set, b, c);
+	uint8_t buf[2] = { uint8_t(b), uint8_t(c) };
+	Utf8_tolower(buf);
+	b = char(buf[0]); c = char(buf[1]);
 }
 
 char16_t tolower(char16_t c) {
-	if (c < 128) {
-		return (char16_t) ::tolower(c);
-	} else {
-		size_t index = 0;
-		const char16_t *str = sp_uppercase_set_16;
-		while (*str != 0) {
-			if (*str == c) {
-				return sp_lowercase_set_16[index];
-			}
-			index ++;
-			str ++;
-		}
-		return c;
+	if (c < 0x80) {
+		return (c >= u'A' && c <= u'Z') ? char16_t(c + 0x20) : c;
+	} else if (c >= 0x410 && c < 0x430) {
+		return char16_t(c + 0x20);
+	} else if (c == 0x401) {
+		return char16_t(0x451);
 	}
+	return c;
 }
 
 char16_t toupper(char16_t c) {
-	if (c < 128) {
-		return (char16_t) ::toupper(c);
-	} else {
-		size_t index = 0;
-		const char16_t *str = sp_lowercase_set_16;
-		while (*str != 0) {
-			if (*str == c) {
-				return sp_uppercase_set_16[index];
-			}
-			index ++;
-			str ++;
-		}
-		return c;
+	if (c < 0x80) {
+		return (c >= u'a' && c <= u'z') ? char16_t(c - 0x20) : c;
+	} else if (c >= 0x430 && c < 0x450) {
+		return char16_t(c - 0x20);
+	} else if (c == 0x451) {
+		return char16_t(0x401);
+	}
+	return c;
+}
+
+#if __SSE2__
+
+// mask of 8-bit lanes in [first, last], valid for ascii ranges only
+static inline __m128i Ascii_inRange(__m128i v, char first, char last) {
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(first - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(last + 1)));
+}
+
+// mask of 16-bit lanes in [first, last], valid for ranges below 0x8000
+static inline __m128i Utf16_inRange(__m128i v, int16_t first, int16_t last) {
+	return _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(first - 1)), _mm_cmplt_epi16(v, _mm_set1_epi16(last + 1)));
+}
+
+// Checks if 16 bytes of utf8 contains only ascii chars (zero included) and complete two-byte sequences,
+// in this case number of decoded chars is a number of non-continuation bytes
+static inline bool Utf8_isSimpleBlock(__m128i v, uint32_t &cont) {
+	auto high = uint32_t(_mm_movemask_epi8(v));
+	if (!high) {
+		cont = 0;
+		return true;
 	}
+
+	cont = uint32_t(_mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(char(0xC0)))));
+	auto lead = high & ~cont;
+	auto longLead = uint32_t(_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(0xDF))))) & high;
+
+	// every lead should be followed by continuation within block
+	return !longLead && !(lead & 0x8000) && cont == (lead << 1);
+}
+
+static inline bool Utf8_hasZero(__m128i v) {
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0;
 }
 
+
+#endif
+
 void toupper_buf(char *str, size_t len) {
 	if (len == maxOf<size_t>()) {
 		len = std::char_traits<char>::length(str);
 	}
 
-	char b = 0, c = 0;
-	for (size_t i = 0; i < len; i++) {
-		b = c;
-		c = str[i];
-		if (b & (0x80)) {
-			toupper(str[i-1], str[i]);
+	auto ptr = (uint8_t *)str;
+	auto end = ptr + len;
+#if __SSE2__
+	while (end - ptr >= 16) {
+		auto v = _mm_loadu_si128((const __m128i *)ptr);
+		auto lower = Ascii_inRange(v, 'a', 'z');
+		_mm_storeu_si128((__m128i *)ptr, _mm_andnot_si128(_mm_and_si128(lower, _mm_set1_epi8(0x20)), v));
+		if (_mm_movemask_epi8(v)) {
+			// non-ascii chars: sequence can continue in next block
+			for (auto blockEnd = ptr + 16; ptr < blockEnd; ++ ptr) {
+				if (*ptr >= 0xC0 && ptr + 1 < end) {
+					Utf8_toupper(ptr);
+				}
+			}
 		} else {
-			str[i] = ::toupper(c);
+			ptr += 16;
+		}
+	}
+#endif
+	for (; ptr < end; ++ ptr) {
+		if (*ptr < 0x80) {
+			if (*ptr >= 'a' && *ptr <= 'z') { *ptr -= 0x20; }
+		} else if (*ptr >= 0xC0 && ptr + 1 < end) {
+			Utf8_toupper(ptr);
 		}
 	}
 }
@@ -120,23 +167,49 @@ void tolower_buf(char *str, size_t len) {
 		len = std::char_traits<char>::length(str);
 	}
 
-	char b = 0, c = 0;
-	for (size_t i = 0; i < len; i++) {
-		b = c;
-		c = str[i];
-		if (b & (0x80)) {
-			tolower(str[i-1], str[i]);
+	auto ptr = (uint8_t *)str;
+	auto end = ptr + len;
+#if __SSE2__
+	while (end - ptr >= 16) {
+		auto v = _mm_loadu_si128((const __m128i *)ptr);
+		auto upper = Ascii_inRange(v, 'A', 'Z');
+		_mm_storeu_si128((__m128i *)ptr, _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+		if (_mm_movemask_epi8(v)) {
+			for (auto blockEnd = ptr + 16; ptr < blockEnd; ++ ptr) {
+				if (*ptr >= 0xC0 && ptr + 1 < end) {
+					Utf8_tolower(ptr);
+				}
+			}
 		} else {
-			str[i] = ::tolower(c);
+			ptr += 16;
+		}
+	}
+#endif
+	for (; ptr < end; ++ ptr) {
+		if (*ptr < 0x80) {
+			if (*ptr >= 'A' && *ptr <= 'Z') { *ptr += 0x20; }
+		} else if (*ptr >= 0xC0 && ptr + 1 < end) {
+			Utf8_tolower(ptr);
 		}
 	}
 }
+
 void toupper_buf(char16_t *str, size_t len) {
 	if (len == maxOf<size_t>()) {
 		len = std::char_traits<char16_t>::length(str);
 	}
 
-	for (size_t i = 0; i < len; i++) {
+	size_t i = 0;
+#if __SSE2__
+	for (; i + 8 <= len; i += 8) {
+		auto v = _mm_loadu_si128((const __m128i *)(str + i));
+		auto m20 = _mm_or_si128(Utf16_inRange(v, u'a', u'z'), Utf16_inRange(v, 0x430, 0x44F));
+		auto m50 = _mm_cmpeq_epi16(v, _mm_set1_epi16(0x451));
+		auto d = _mm_or_si128(_mm_and_si128(m20, _mm_set1_epi16(0x20)), _mm_and_si128(m50, _mm_set1_epi16(0x50)));
+		_mm_storeu_si128((__m128i *)(str + i), _mm_sub_epi16(v, d));
+	}
+#endif
+	for (; i < len; i++) {
 		str[i] = string::toupper(str[i]);
 	}
 }
@@ -146,7 +219,17 @@ void tolower_buf(char16_t *str, size_t len) {
 		len = std::char_traits<char16_t>::length(str);
 	}
 
-	for (size_t i = 0; i < len; i++) {
+	size_t i = 0;
+#if __SSE2__
+	for (; i + 8 <= len; i += 8) {
+		auto v = _mm_loadu_si128((const __m128i *)(str + i));
+		auto m20 = _mm_or_si128(Utf16_inRange(v, u'A', u'Z'), Utf16_inRange(v, 0x410, 0x42F));
+		auto m50 = _mm_cmpeq_epi16(v, _mm_set1_epi16(0x401));
+		auto d = _mm_or_si128(_mm_and_si128(m20, _mm_set1_epi16(0x20)), _mm_and_si128(m50, _mm_set1_epi16(0x50)));
+		_mm_storeu_si128((__m128i *)(str + i), _mm_add_epi16(v, d));
+	}
+#endif
+	for (; i < len; i++) {
 		str[i] = string::tolower(str[i]);
 	}
 }
@@ -230,6 +313,17 @@ bool isValidUtf8(StringView r) {
 	char_const_ptr_t ptr = r.data();
 	const char_const_ptr_t end = ptr + r.size();
 	while (ptr < end && *ptr != 0) {
+#if __SSE2__
+		if (end - ptr >= 16) {
+			// validation stops on zero char, so blocks with zero are checked with scalar code
+			uint32_t cont = 0;
+			auto v = _mm_loadu_si128((const __m128i *)ptr);
+			if (!Utf8_hasZero(v) && Utf8_isSimpleBlock(v, cont)) {
+				ptr += 16;
+				continue;
+			}
+		}
+#endif
 		auto l = utf8_valid_data[ ((const uint8_t *)ptr)[0] ];
 		if (l == 0) {
 			return false;
@@ -284,17 +378,86 @@ Pair<char16_t, uint8_t> read(char_const_ptr_t ptr) {
 	return pair((char16_t)ret, len);
 }
 
+// zero char has no length in utf8_length_data, but within string view it's decoded as a regular char
+static inline uint8_t Utf8_charLength(char_const_ptr_t ptr) {
+	auto l = unicode::utf8_length_data[ ((const uint8_t *)ptr)[0] ];
+	return l ? l : 1;
+}
+
 size_t getUtf16Length(const StringView &input) {
 	size_t counter = 0;
 	char_const_ptr_t ptr = input.data();
 	const char_const_ptr_t end = ptr + input.size();
-	while (ptr < end && *ptr != 0) {
-		ptr += unicode::utf8_length_data[ ((const uint8_t *)ptr)[0] ];
+	while (ptr < end) {
+#if __SSE2__
+		if (end - ptr >= 16) {
+			uint32_t cont = 0;
+			if (Utf8_isSimpleBlock(_mm_loadu_si128((const __m128i *)ptr), cont)) {
+				counter += 16 - __builtin_popcount(cont);
+				ptr += 16;
+			} else {
+				auto blockEnd = ptr + 16;
+				while (ptr < blockEnd) {
+					ptr += Utf8_charLength(ptr);
+					++ counter;
+				}
+			}
+			continue;
+		}
+#endif
+		ptr += Utf8_charLength(ptr);
 		++ counter;
 	};
 	return counter;
 }
 
+size_t decodeUtf8(char16_t *buf, size_t bufSize, const char *ptr, size_t len) {
+	auto target = buf;
+	const auto targetEnd = buf + bufSize;
+	const auto end = ptr + len;
+	while (ptr < end && target < targetEnd) {
+#if __SSE2__
+		if (end - ptr >= 16 && targetEnd - target >= 16) {
+			uint32_t cont = 0;
+			auto v = _mm_loadu_si128((const __m128i *)ptr);
+			if (Utf8_isSimpleBlock(v, cont)) {
+				if (!cont) {
+					auto zero = _mm_setzero_si128();
+					_mm_storeu_si128((__m128i *)target, _mm_unpacklo_epi8(v, zero));
+					_mm_storeu_si128((__m128i *)(target + 8), _mm_unpackhi_epi8(v, zero));
+					target += 16;
+				} else {
+					// block is already validated
+					auto p = (const uint8_t *)ptr;
+					auto blockEnd = p + 16;
+					while (p < blockEnd) {
+						if (p[0] < 0x80) {
+							*target++ = char16_t(*p++);
+						} else {
+							*target++ = char16_t(((p[0] & 0x1F) << 6) | (p[1] & 0x3F));
+							p += 2;
+						}
+					}
+				}
+				ptr += 16;
+			} else {
+				auto blockEnd = ptr + 16;
+				while (ptr < blockEnd) {
+					uint8_t offset = 0;
+					*target++ = unicode::utf8Decode(ptr, offset);
+					ptr += offset ? offset : 1;
+				}
+			}
+			continue;
+		}
+#endif
+		uint8_t offset = 0;
+		*target++ = unicode::utf8Decode(ptr, offset);
+		ptr += offset ? offset : 1;
+	}
+	return target - buf;
+}
+
 size_t getUtf16HtmlLength(const StringView &input) {
 	size_t counter = 0;
 	char_const_ptr_t ptr = input.data();
@@ -327,12 +490,56 @@ size_t getUtf8Length(const WideStringView &str) {
 	const char16_t *ptr = str.data();
 	const char16_t *end = ptr + str.size();
 	size_t ret = 0;
+#if __SSE2__
+	// every char takes one byte, plus one for chars above 0x7F, plus one for chars above 0x7FF
+	const auto zero = _mm_setzero_si128();
+	while (end - ptr >= 8) {
+		auto v = _mm_loadu_si128((const __m128i *)ptr);
+		auto ascii = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(int16_t(0xFF80))), zero));
+		auto twoBytes = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(int16_t(0xF800))), zero));
+		ret += 8 + (32 - __builtin_popcount(ascii) - __builtin_popcount(twoBytes)) / 2;
+		ptr += 8;
+	}
+#endif
 	while (ptr < end) {
 		ret += unicode::utf8EncodeLength(*ptr++);
 	}
 	return ret;
 }
 
+size_t encodeUtf8(char *buf, size_t bufSize, const char16_t *ptr, size_t len) {
+	auto target = buf;
+	const auto targetEnd = buf + bufSize;
+	const auto end = ptr + len;
+	while (ptr < end) {
+#if __SSE2__
+		if (end - ptr >= 16 && targetEnd - target >= 16) {
+			auto v1 = _mm_loadu_si128((const __m128i *)ptr);
+			auto v2 = _mm_loadu_si128((const __m128i *)(ptr + 8));
+			auto high = _mm_and_si128(_mm_or_si128(v1, v2), _mm_set1_epi16(int16_t(0xFF80)));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF) {
+				_mm_storeu_si128((__m128i *)target, _mm_packus_epi16(v1, v2));
+				target += 16;
+				ptr += 16;
+			} else {
+				for (auto blockEnd = ptr + 16; ptr < blockEnd; ++ ptr) {
+					if (size_t(targetEnd - target) < unicode::utf8EncodeLength(*ptr)) {
+						return target - buf;
+					}
+					target += unicode::utf8EncodeBuf(target, *ptr);
+				}
+			}
+			continue;
+		}
+#endif
+		if (size_t(targetEnd - target) < unicode::utf8EncodeLength(*ptr)) {
+			break;
+		}
+		target += unicode::utf8EncodeBuf(target, *ptr++);
+	}
+	return target - buf;
+}
+
 //static constexpr const char16_t utf8_small[64] = {
 //	u'А', u'Б', u'В', u'Г', u'Д', u'Е', u'Ж', u'З', u'И', u'Й', u'К', u'Л', u'М', u'Н', u'О', u'П',
 //	u'Р', u'С', u'Т', u'У', u'Ф', u'Х', u'Ц', u'Ч', u'Ш', u'Щ', u'Ъ', u'Ы', u'Ь', u'Э', u'Ю', u'Я',
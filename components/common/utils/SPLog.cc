@@ -30,8 +30,17 @@ NS_SP_EXT_BEGIN(log)
 
 static const constexpr int MAX_LOG_FUNC = 16;
 
-static CustomLog::log_fn s_logFuncArr[MAX_LOG_FUNC] = { 0 };
-static std::atomic<int> s_logFuncCount;
+// hooks are read without lock: reader pins current snapshot with reference counter, writer fills
+// another snapshot, publishes it, then waits for readers of previous one, so, after removal returns,
+// hook is not called anymore (and it's data can be released)
+struct CustomLog_Registry {
+	std::atomic<int> refs;
+	int count;
+	CustomLog::log_fn funcs[MAX_LOG_FUNC];
+};
+
+static CustomLog_Registry s_logRegistry[2];
+static std::atomic<CustomLog_Registry *> s_logCurrent(&s_logRegistry[0]);
 static std::mutex s_logFuncMutex;
 
 static void DefaultLog2(const StringView &tag, const StringView &text) {
@@ -66,42 +75,81 @@ static void DefaultLog(const StringView &tag, CustomLog::Type t, CustomLog::VA &
 	}
 }
 
+static CustomLog_Registry *CustomLog_acquire() {
+	while (true) {
+		auto reg = s_logCurrent.load();
+		reg->refs.fetch_add(1);
+		// snapshot can be replaced before it was pinned, so, it's valid only if it's still current
+		if (reg == s_logCurrent.load()) {
+			return reg;
+		}
+		reg->refs.fetch_sub(1);
+	}
+}
+
+static void CustomLog_release(CustomLog_Registry *reg) {
+	reg->refs.fetch_sub(1);
+}
+
+static void CustomLog_wait(CustomLog_Registry *reg) {
+	while (reg->refs.load() > 0) {
+		std::this_thread::yield();
+	}
+}
+
+// should be called with s_logFuncMutex; hook should not be removed from within hook itself
+static void CustomLog_publish(const CustomLog::log_fn *funcs, int count) {
+	auto prev = s_logCurrent.load();
+	auto next = (prev == &s_logRegistry[0]) ? &s_logRegistry[1] : &s_logRegistry[0];
+
+	CustomLog_wait(next); // readers, that failed to pin it as current
+	memcpy(next->funcs, funcs, sizeof(CustomLog::log_fn) * count);
+	next->count = count;
+	s_logCurrent.store(next);
+
+	CustomLog_wait(prev);
+}
+
+// hooks are called without lock, so logging threads are not serialized
 static void __log3(const StringView tag, CustomLog::Type t, CustomLog::VA &va) {
-	int count = s_logFuncCount.load();
-	if (count == 0) {
+	auto reg = CustomLog_acquire();
+	if (reg->count == 0) {
 		DefaultLog(tag, t, va);
 	} else {
-		s_logFuncMutex.lock();
-		count = s_logFuncCount.load();
-		for (int i = 0; i < count; i++) {
-			s_logFuncArr[i](tag, t, va);
+		for (int i = 0; i < reg->count; i++) {
+			reg->funcs[i](tag, t, va);
 		}
-		s_logFuncMutex.unlock();
 	}
+	CustomLog_release(reg);
 }
 
 static void CustomLog_insert(CustomLog::log_fn fn) {
-	s_logFuncMutex.lock();
-	if (s_logFuncCount.load() < MAX_LOG_FUNC) {
-		s_logFuncArr[s_logFuncCount] = fn;
-		++ s_logFuncCount;
+	std::unique_lock<std::mutex> lock(s_logFuncMutex);
+	auto reg = s_logCurrent.load();
+	if (reg->count < MAX_LOG_FUNC) {
+		CustomLog::log_fn funcs[MAX_LOG_FUNC];
+		memcpy(funcs, reg->funcs, sizeof(CustomLog::log_fn) * reg->count);
+		funcs[reg->count] = fn;
+		CustomLog_publish(funcs, reg->count + 1);
 	}
-	s_logFuncMutex.unlock();
 }
 
 static void CustomLog_remove(CustomLog::log_fn fn) {
-	s_logFuncMutex.lock();
-	int count = s_logFuncCount.load();
-	for (int i = 0; i < count; i++) {
-		if (s_logFuncArr[i] == fn) {
-			if (i != count - 1) {
-				memmove(&s_logFuncArr[i], &s_logFuncArr[i + 1], (count - i - 1) * sizeof(CustomLog::log_fn));
-			}
-			-- s_logFuncCount;
-			break;
+	std::unique_lock<std::mutex> lock(s_logFuncMutex);
+	auto reg = s_logCurrent.load();
+	CustomLog::log_fn funcs[MAX_LOG_FUNC];
+	int count = 0;
+	bool found = false;
+	for (int i = 0; i < reg->count; i++) {
+		if (!found && reg->funcs[i] == fn) {
+			found = true;
+		} else {
+			funcs[count ++] = reg->funcs[i];
 		}
 	}
-	s_logFuncMutex.unlock();
+	if (found) {
+		CustomLog_publish(funcs, count);
+	}
 }
 
 CustomLog::CustomLog(log_fn fn) : fn(fn) {
@@ -120,6 +168,9 @@ CustomLog::CustomLog(CustomLog && other) : fn(other.fn) {
 	other.fn = nullptr;
 }
 CustomLog& CustomLog::operator=(CustomLog && other) {
+	if (fn) {
+		CustomLog_remove(fn);
+	}
 	fn = other.fn;
 	other.fn = nullptr;
 	return *this;
@@ -141,4 +192,784 @@ void text(const StringView &tag, const StringView &text) {
 	__log3(tag, CustomLog::Text, va);
 }
 
+// Deferred formatting: printf arguments are serialized on calling thread, and
+// reformatted by background thread with normalized conversion specifiers
+
+enum class LogArgKind : uint8_t {
+	Int,
+	Unsigned,
+	Double,
+	String,
+	Pointer,
+};
+
+enum class LogArgLength : uint8_t {
+	None,
+	Char,
+	Short,
+	Long,
+	LongLong,
+	IntMax,
+	Size,
+	PtrDiff,
+	LongDouble,
+};
+
+struct LogFormatSpec {
+	StringView flags;
+	StringView width;
+	StringView precision;
+	bool hasPrecision = false;
+	LogArgLength length = LogArgLength::None;
+	char conv = 0;
+};
+
+static const char *Log_parseSpec(const char *p, LogFormatSpec &spec) {
+	auto b = p;
+	while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'') { ++ p; }
+	spec.flags = StringView(b, p - b);
+
+	b = p;
+	if (*p == '*') { ++ p; } else { while (*p >= '0' && *p <= '9') { ++ p; } }
+	spec.width = StringView(b, p - b);
+
+	if (*p == '.') {
+		++ p;
+		spec.hasPrecision = true;
+		b = p;
+		if (*p == '*') { ++ p; } else { while (*p >= '0' && *p <= '9') { ++ p; } }
+		spec.precision = StringView(b, p - b);
+	}
+
+	switch (*p) {
+	case 'h':
+		++ p;
+		if (*p == 'h') { ++ p; spec.length = LogArgLength::Char; } else { spec.length = LogArgLength::Short; }
+		break;
+	case 'l':
+		++ p;
+		if (*p == 'l') { ++ p; spec.length = LogArgLength::LongLong; } else { spec.length = LogArgLength::Long; }
+		break;
+	case 'q': ++ p; spec.length = LogArgLength::LongLong; break;
+	case 'j': ++ p; spec.length = LogArgLength::IntMax; break;
+	case 'z': ++ p; spec.length = LogArgLength::Size; break;
+	case 't': ++ p; spec.length = LogArgLength::PtrDiff; break;
+	case 'L': ++ p; spec.length = LogArgLength::LongDouble; break;
+	default: break;
+	}
+
+	spec.conv = *p;
+	if (*p) {
+		++ p;
+	}
+	return p;
+}
+
+template <typename T>
+static void Log_pushArg(std::string &out, LogArgKind kind, T value) {
+	out.push_back(char(kind));
+	out.append((const char *)&value, sizeof(T));
+}
+
+template <typename T>
+static T Log_readArg(StringView &r) {
+	T ret;
+	++ r; // kind
+	memcpy(&ret, r.data(), sizeof(T));
+	r += sizeof(T);
+	return ret;
+}
+
+static bool Log_captureFormat(const char *fmt, va_list args, std::string &out) {
+	auto p = fmt;
+	while (*p) {
+		if (*p != '%') {
+			++ p;
+			continue;
+		}
+
+		++ p;
+		if (*p == '%') {
+			++ p;
+			continue;
+		}
+
+		int precision = -1;
+		LogFormatSpec spec;
+		p = Log_parseSpec(p, spec);
+		if (spec.width == "*") {
+			Log_pushArg(out, LogArgKind::Int, int64_t(va_arg(args, int)));
+		}
+		if (spec.hasPrecision) {
+			if (spec.precision == "*") {
+				precision = va_arg(args, int);
+				Log_pushArg(out, LogArgKind::Int, int64_t(precision));
+			} else {
+				precision = int(StringView(spec.precision).readInteger().get(0));
+			}
+		}
+
+		switch (spec.conv) {
+		case 'd': case 'i': {
+			int64_t val = 0;
+			switch (spec.length) {
+			case LogArgLength::None: val = va_arg(args, int); break;
+			case LogArgLength::Char: val = (signed char)va_arg(args, int); break;
+			case LogArgLength::Short: val = (short)va_arg(args, int); break;
+			case LogArgLength::Long: val = va_arg(args, long); break;
+			case LogArgLength::LongLong: val = va_arg(args, long long); break;
+			case LogArgLength::IntMax: val = va_arg(args, intmax_t); break;
+			case LogArgLength::Size: val = va_arg(args, ssize_t); break;
+			case LogArgLength::PtrDiff: val = va_arg(args, ptrdiff_t); break;
+			default: return false; break;
+			}
+			Log_pushArg(out, LogArgKind::Int, val);
+			break;
+		}
+		case 'u': case 'o': case 'x': case 'X': {
+			uint64_t val = 0;
+			switch (spec.length) {
+			case LogArgLength::None: val = va_arg(args, unsigned int); break;
+			case LogArgLength::Char: val = (unsigned char)va_arg(args, unsigned int); break;
+			case LogArgLength::Short: val = (unsigned short)va_arg(args, unsigned int); break;
+			case LogArgLength::Long: val = va_arg(args, unsigned long); break;
+			case LogArgLength::LongLong: val = va_arg(args, unsigned long long); break;
+			case LogArgLength::IntMax: val = va_arg(args, uintmax_t); break;
+			case LogArgLength::Size: val = va_arg(args, size_t); break;
+			case LogArgLength::PtrDiff: val = va_arg(args, ptrdiff_t); break;
+			default: return false; break;
+			}
+			Log_pushArg(out, LogArgKind::Unsigned, val);
+			break;
+		}
+		case 'c':
+			if (spec.length != LogArgLength::None) {
+				return false;
+			}
+			Log_pushArg(out, LogArgKind::Int, int64_t(va_arg(args, int)));
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			if (spec.length == LogArgLength::LongDouble) {
+				return false;
+			}
+			Log_pushArg(out, LogArgKind::Double, va_arg(args, double));
+			break;
+		case 's': {
+			if (spec.length != LogArgLength::None) {
+				return false;
+			}
+			auto str = va_arg(args, const char *);
+			if (!str) {
+				str = "(null)";
+			}
+			auto len = uint32_t((precision >= 0) ? strnlen(str, size_t(precision)) : strlen(str));
+			out.push_back(char(LogArgKind::String));
+			out.append((const char *)&len, sizeof(uint32_t));
+			out.append(str, len);
+			break;
+		}
+		case 'p':
+			Log_pushArg(out, LogArgKind::Pointer, va_arg(args, void *));
+			break;
+		default:
+			return false; // %n, wide strings and unknown conversions
+			break;
+		}
+	}
+	return true;
+}
+
+static void Log_renderFormat(StringView fmt, StringView args, std::string &out) {
+	char specBuf[64];
+	char stackBuf[256];
+
+	auto print = [&] (auto ... val) {
+		int size = snprintf(stackBuf, sizeof(stackBuf), specBuf, val...);
+		if (size >= int(sizeof(stackBuf))) {
+			auto tmpSize = out.size();
+			out.resize(tmpSize + size + 1);
+			snprintf(&out[tmpSize], size + 1, specBuf, val...);
+			out.resize(tmpSize + size);
+		} else if (size > 0) {
+			out.append(stackBuf, size);
+		}
+	};
+
+	while (!fmt.empty()) {
+		auto literal = fmt.readUntil<StringView::Chars<'%'>>();
+		out.append(literal.data(), literal.size());
+		if (fmt.empty()) {
+			break;
+		}
+
+		++ fmt;
+		if (fmt.is('%')) {
+			out.push_back('%');
+			++ fmt;
+			continue;
+		}
+
+		LogFormatSpec spec;
+		auto next = Log_parseSpec(fmt.data(), spec);
+		fmt += (next - fmt.data());
+
+		auto widthStr = std::string(spec.width.data(), spec.width.size());
+		if (spec.width == "*" && args.is(char(LogArgKind::Int))) {
+			widthStr = std::to_string(Log_readArg<int64_t>(args));
+		}
+
+		auto precisionStr = std::string(spec.precision.data(), spec.precision.size());
+		if (spec.hasPrecision && spec.precision == "*" && args.is(char(LogArgKind::Int))) {
+			precisionStr = std::to_string(Log_readArg<int64_t>(args));
+		}
+
+		auto makeSpec = [&] (const char *length, char conv) {
+			snprintf(specBuf, sizeof(specBuf), "%%%.*s%s%s%s%s%c", int(spec.flags.size()), spec.flags.data(),
+					widthStr.data(), spec.hasPrecision ? "." : "", precisionStr.data(), length, conv);
+		};
+
+		if (args.empty()) {
+			break;
+		}
+
+		switch (LogArgKind(args[0])) {
+		case LogArgKind::Int:
+			if (spec.conv == 'c') {
+				makeSpec("", 'c');
+				print(int(Log_readArg<int64_t>(args)));
+			} else {
+				makeSpec("ll", spec.conv);
+				print((long long)Log_readArg<int64_t>(args));
+			}
+			break;
+		case LogArgKind::Unsigned:
+			makeSpec("ll", spec.conv);
+			print((unsigned long long)Log_readArg<uint64_t>(args));
+			break;
+		case LogArgKind::Double:
+			makeSpec("", spec.conv);
+			print(Log_readArg<double>(args));
+			break;
+		case LogArgKind::Pointer:
+			makeSpec("", 'p');
+			print(Log_readArg<void *>(args));
+			break;
+		case LogArgKind::String: {
+			auto len = Log_readArg<uint32_t>(args);
+			auto str = std::string(args.data(), std::min(size_t(len), args.size()));
+			args += str.size();
+			makeSpec("", 's');
+			print(str.data());
+			break;
+		}
+		}
+	}
+}
+
+struct AsyncLog::Data {
+	static constexpr uint16_t FlagPadding = 1;
+	static constexpr uint16_t FlagDeferred = 2;
+
+	struct Header {
+		uint32_t size;
+		uint16_t flags;
+		uint16_t tagSize;
+		uint32_t textSize;
+		uint32_t reserved;
+	};
+
+	// single producer - single consumer byte ring
+	struct Ring {
+		Ring(size_t s) : buffer(new uint8_t[s]), size(s) { }
+
+		std::unique_ptr<uint8_t[]> buffer;
+		size_t size;
+		uint32_t sampleCounter = 0;
+		std::atomic<bool> attached;
+		alignas(64) std::atomic<uint64_t> head; // written by producer
+		alignas(64) std::atomic<uint64_t> tail; // written by consumer
+	};
+
+	struct ThreadRing {
+		~ThreadRing() {
+			if (ring) {
+				ring->attached.store(false);
+			}
+		}
+
+		uint64_t owner = 0;
+		std::shared_ptr<Ring> ring;
+	};
+
+	static uint64_t getNextId() {
+		static std::atomic<uint64_t> s_id(1);
+		return s_id.fetch_add(1);
+	}
+
+	static uint32_t align(size_t size) {
+		return uint32_t((size + sizeof(Header) - 1) & ~(sizeof(Header) - 1));
+	}
+
+	Data(AsyncLog *, const AsyncLog::Config &);
+
+	void start();
+	void stop();
+
+	Ring *getRing();
+	bool write(Ring *, const StringView &tag, uint16_t flags, const StringView &a, const StringView &b);
+	void push(const StringView &tag, CustomLog::Type, CustomLog::VA &);
+
+	void run();
+	void drain();
+	void drain(Ring *);
+	void writeBatch();
+	void rotate();
+	void notify();
+
+	uint64_t id = getNextId();
+	AsyncLog *owner = nullptr;
+	AsyncLog::Config config;
+	std::string path;
+
+	std::mutex ringsMutex;
+	std::vector<std::shared_ptr<Ring>> rings;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::condition_variable flushed;
+	std::atomic<bool> running;
+	bool notified = false;
+	uint64_t drainCount = 0;
+	std::thread thread;
+
+	FILE *file = nullptr;
+	size_t fileSize = 0;
+	std::string batch;
+	std::string formatBuffer;
+	uint64_t reportedDropped = 0;
+	uint64_t reportedSampled = 0;
+
+	std::atomic<uint64_t> written;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> sampled;
+	std::atomic<uint64_t> blocked;
+
+	CustomLog hook;
+};
+
+static std::atomic<AsyncLog::Data *> s_asyncLog(nullptr);
+
+static void AsyncLog_hook(const StringView &tag, CustomLog::Type t, CustomLog::VA &va) {
+	if (auto log = s_asyncLog.load()) {
+		log->push(tag, t, va);
+	} else {
+		DefaultLog(tag, t, va);
+	}
+}
+
+AsyncLog::Data::Data(AsyncLog *log, const AsyncLog::Config &cfg)
+: owner(log), config(cfg), path(cfg.path.data(), cfg.path.size()), hook(nullptr) {
+	size_t size = 4_KiB;
+	while (size < config.bufferSize) {
+		size <<= 1;
+	}
+	config.bufferSize = size;
+	config.path = StringView(path);
+	if (config.sampleRate == 0) {
+		config.sampleRate = 1;
+	}
+	running.store(false);
+	written.store(0);
+	dropped.store(0);
+	sampled.store(0);
+	blocked.store(0);
+}
+
+void AsyncLog::Data::start() {
+	if (!path.empty()) {
+		file = fopen(path.data(), "a");
+		if (file) {
+			fseek(file, 0, SEEK_END);
+			fileSize = size_t(ftell(file));
+		}
+	}
+
+	running = true;
+	thread = std::thread([this] {
+		run();
+	});
+	hook = CustomLog(&AsyncLog_hook);
+}
+
+void AsyncLog::Data::stop() {
+	hook = CustomLog(nullptr);
+
+	mutex.lock();
+	running = false;
+	mutex.unlock();
+	cond.notify_all();
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+
+	if (file) {
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+auto AsyncLog::Data::getRing() -> Ring * {
+	static thread_local ThreadRing tl_ring;
+	if (tl_ring.owner == id && tl_ring.ring) {
+		return tl_ring.ring.get();
+	}
+
+	if (tl_ring.ring) {
+		tl_ring.ring->attached.store(false);
+		tl_ring.ring = nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(ringsMutex);
+	for (auto &it : rings) {
+		// reuse buffer, abandoned by finished thread
+		bool expected = false;
+		if (it->attached.compare_exchange_strong(expected, true)) {
+			tl_ring.ring = it;
+			break;
+		}
+	}
+
+	if (!tl_ring.ring) {
+		auto ring = std::make_shared<Ring>(config.bufferSize);
+		ring->attached.store(true);
+		ring->head.store(0);
+		ring->tail.store(0);
+		rings.emplace_back(ring);
+		tl_ring.ring = ring;
+	}
+
+	tl_ring.owner = id;
+	return tl_ring.ring.get();
+}
+
+bool AsyncLog::Data::write(Ring *ring, const StringView &tag, uint16_t flags, const StringView &a, const StringView &b) {
+	auto tagSize = std::min(tag.size(), size_t(maxOf<uint16_t>()));
+	auto textSize = a.size() + b.size();
+	auto need = align(sizeof(Header) + tagSize + textSize);
+	if (need > ring->size / 2) {
+		return false;
+	}
+
+	auto head = ring->head.load(std::memory_order_relaxed);
+	auto tail = ring->tail.load(std::memory_order_acquire);
+	auto offset = size_t(head & (ring->size - 1));
+	auto contiguous = ring->size - offset;
+	auto total = need + ((contiguous < need) ? contiguous : 0);
+
+	if (ring->size - size_t(head - tail) < total) {
+		return false;
+	}
+
+	if (contiguous < need) {
+		auto pad = (Header *)(ring->buffer.get() + offset);
+		pad->size = uint32_t(contiguous);
+		pad->flags = FlagPadding;
+		head += contiguous;
+		offset = 0;
+	}
+
+	auto h = (Header *)(ring->buffer.get() + offset);
+	h->size = need;
+	h->flags = flags;
+	h->tagSize = uint16_t(tagSize);
+	h->textSize = uint32_t(textSize);
+	h->reserved = 0;
+
+	auto data = ring->buffer.get() + offset + sizeof(Header);
+	memcpy(data, tag.data(), tagSize);
+	memcpy(data + tagSize, a.data(), a.size());
+	memcpy(data + tagSize + a.size(), b.data(), b.size());
+
+	ring->head.store(head + need, std::memory_order_release);
+	return true;
+}
+
+void AsyncLog::Data::push(const StringView &tag, CustomLog::Type t, CustomLog::VA &va) {
+	static thread_local std::string tl_buffer;
+
+	auto ring = getRing();
+
+	if (config.policy == Policy::Sample) {
+		auto used = size_t(ring->head.load(std::memory_order_relaxed) - ring->tail.load(std::memory_order_acquire));
+		if (used > ring->size / 2 && (++ ring->sampleCounter % config.sampleRate) != 0) {
+			++ sampled;
+			return;
+		}
+	}
+
+	uint16_t flags = 0;
+	StringView a, b;
+
+	if (t == CustomLog::Text) {
+		a = va.text;
+	} else {
+		tl_buffer.clear();
+		if (config.deferFormat) {
+			uint32_t fmtSize = uint32_t(strlen(va.format.format));
+			tl_buffer.append((const char *)&fmtSize, sizeof(uint32_t));
+			tl_buffer.append(va.format.format, fmtSize);
+
+			va_list tmpList;
+			va_copy(tmpList, va.format.args);
+			if (Log_captureFormat(va.format.format, tmpList, tl_buffer)) {
+				flags = FlagDeferred;
+			}
+			va_end(tmpList);
+		}
+
+		if (flags != FlagDeferred) {
+			tl_buffer.clear();
+			va_list tmpList;
+			va_copy(tmpList, va.format.args);
+			int size = vsnprintf(nullptr, 0, va.format.format, tmpList);
+			va_end(tmpList);
+			if (size > 0) {
+				tl_buffer.resize(size + 1);
+				va_copy(tmpList, va.format.args);
+				vsnprintf(&tl_buffer[0], size + 1, va.format.format, tmpList);
+				va_end(tmpList);
+				tl_buffer.resize(size);
+			}
+		}
+		a = StringView(tl_buffer);
+	}
+
+	auto maxText = ring->size / 2 - sizeof(Header) * 2 - std::min(tag.size(), size_t(maxOf<uint16_t>()));
+	if (a.size() > maxText) {
+		if (flags == FlagDeferred) {
+			++ dropped;
+			return;
+		}
+		a = StringView(a.data(), maxText - 3);
+		b = StringView("...");
+	}
+
+	if (write(ring, tag, flags, a, b)) {
+		auto used = size_t(ring->head.load(std::memory_order_relaxed) - ring->tail.load(std::memory_order_relaxed));
+		if (used > ring->size / 2) {
+			notify();
+		}
+		return;
+	}
+
+	if (config.policy == Policy::Block) {
+		++ blocked;
+		do {
+			notify();
+			std::this_thread::yield();
+			if (!running) {
+				break;
+			}
+		} while (!write(ring, tag, flags, a, b));
+		if (running) {
+			return;
+		}
+	}
+
+	++ dropped;
+}
+
+void AsyncLog::Data::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (running) {
+		cond.wait_for(lock, std::chrono::microseconds(config.flushInterval.toMicroseconds()), [&] {
+			return !running || notified;
+		});
+		notified = false;
+		lock.unlock();
+
+		drain();
+
+		lock.lock();
+		++ drainCount;
+		flushed.notify_all();
+	}
+	lock.unlock();
+
+	drain();
+
+	lock.lock();
+	++ drainCount;
+	flushed.notify_all();
+}
+
+void AsyncLog::Data::drain() {
+	ringsMutex.lock();
+	auto tmpRings = rings;
+	ringsMutex.unlock();
+
+	for (auto &it : tmpRings) {
+		drain(it.get());
+	}
+
+	auto d = dropped.load();
+	auto s = sampled.load();
+	if (d != reportedDropped || s != reportedSampled) {
+		batch.append(toString("[Log] ", d - reportedDropped, " messages dropped, ",
+				s - reportedSampled, " skipped by sampling\n").data());
+		reportedDropped = d;
+		reportedSampled = s;
+	}
+
+	writeBatch();
+}
+
+void AsyncLog::Data::drain(Ring *ring) {
+	auto tail = ring->tail.load(std::memory_order_relaxed);
+	auto head = ring->head.load(std::memory_order_acquire);
+
+	while (tail < head) {
+		auto h = (Header *)(ring->buffer.get() + size_t(tail & (ring->size - 1)));
+		if ((h->flags & FlagPadding) == 0) {
+			auto data = (const char *)h + sizeof(Header);
+			batch.push_back('[');
+			batch.append(data, h->tagSize);
+			batch.append("] ");
+			if (h->flags & FlagDeferred) {
+				StringView r(data + h->tagSize, h->textSize);
+				uint32_t fmtSize = 0;
+				memcpy(&fmtSize, r.data(), sizeof(uint32_t));
+				r += sizeof(uint32_t);
+				auto fmt = StringView(r.data(), fmtSize);
+				r += fmtSize;
+				Log_renderFormat(fmt, r, batch);
+			} else {
+				batch.append(data + h->tagSize, h->textSize);
+			}
+			batch.push_back('\n');
+			++ written;
+		}
+		tail += h->size;
+
+		if (batch.size() > 64_KiB) {
+			ring->tail.store(tail, std::memory_order_release);
+			writeBatch();
+		}
+	}
+
+	ring->tail.store(tail, std::memory_order_release);
+}
+
+void AsyncLog::Data::writeBatch() {
+	if (batch.empty()) {
+		return;
+	}
+
+	if (file) {
+		fwrite(batch.data(), 1, batch.size(), file);
+		fflush(file);
+		fileSize += batch.size();
+		if (config.maxFileSize && fileSize >= config.maxFileSize) {
+			rotate();
+		}
+	} else {
+#if MSYS
+		fwrite(batch.data(), 1, batch.size(), stdout);
+		fflush(stdout);
+#else
+		fwrite(batch.data(), 1, batch.size(), stderr);
+		fflush(stderr);
+#endif
+	}
+	batch.clear();
+}
+
+void AsyncLog::Data::rotate() {
+	fclose(file);
+
+	if (config.maxFiles > 0) {
+		::remove(toString(path, ".", config.maxFiles).data());
+		for (size_t i = config.maxFiles - 1; i > 0; -- i) {
+			::rename(toString(path, ".", i).data(), toString(path, ".", i + 1).data());
+		}
+		::rename(path.data(), toString(path, ".", 1).data());
+	}
+
+	file = fopen(path.data(), "w");
+	fileSize = 0;
+}
+
+void AsyncLog::Data::notify() {
+	mutex.lock();
+	notified = true;
+	mutex.unlock();
+	cond.notify_one();
+}
+
+AsyncLog *AsyncLog::getInstance() {
+	if (auto data = s_asyncLog.load()) {
+		return data->owner;
+	}
+	return nullptr;
+}
+
+AsyncLog::AsyncLog(const Config &cfg) {
+	_data = new Data(this, cfg);
+
+	Data *expected = nullptr;
+	if (s_asyncLog.compare_exchange_strong(expected, _data)) {
+		_data->start();
+	} else {
+		delete _data;
+		_data = nullptr;
+		text("Log", "AsyncLog is already active");
+	}
+}
+
+AsyncLog::~AsyncLog() {
+	if (_data) {
+		// hook removal waits for threads, that are still in AsyncLog_hook, so data can be deleted after stop
+		_data->stop();
+		s_asyncLog.store(nullptr);
+		delete _data;
+		_data = nullptr;
+	}
+}
+
+bool AsyncLog::isActive() const {
+	return _data != nullptr;
+}
+
+auto AsyncLog::getStats() const -> Stats {
+	Stats ret;
+	if (_data) {
+		ret.written = _data->written.load();
+		ret.dropped = _data->dropped.load();
+		ret.sampled = _data->sampled.load();
+		ret.blocked = _data->blocked.load();
+	}
+	return ret;
+}
+
+void AsyncLog::flush() {
+	if (!_data) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_data->mutex);
+	// wait for two drain cycles, so one of them starts after the call
+	auto target = _data->drainCount + 2;
+	_data->notified = true;
+	_data->cond.notify_one();
+	while (_data->running && _data->drainCount < target) {
+		_data->flushed.wait(lock);
+		if (_data->drainCount < target) {
+			_data->notified = true;
+			_data->cond.notify_one();
+		}
+	}
+}
+
+
 NS_SP_EXT_END(log)
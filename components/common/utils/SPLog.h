@@ -26,6 +26,7 @@ THE SOFTWARE.
 #include "SPStringView.h"
 #include "SPCommon.h"
 #include "SPString.h"
+#include "SPTime.h"
 
 NS_SP_EXT_BEGIN(log)
 
@@ -59,6 +60,60 @@ struct CustomLog {
 	log_fn fn;
 };
 
+// Asynchronous log backend
+//
+// Messages are copied into per-thread lock-free ring buffers, background thread drains them
+// in batches and writes into file (with size-based rotation) or into stderr. With deferFormat,
+// format() only captures its arguments, and formatting is performed by background thread.
+// Messages from different threads are not strictly ordered in output.
+//
+// AsyncLog is attached to log as CustomLog, only one instance can be active at a time.
+class AsyncLog {
+public:
+	enum class Policy {
+		Drop, // drop new messages when thread buffer is full
+		Block, // wait for background thread, when thread buffer is full
+		Sample, // when thread buffer is more then half full, keep only one of sampleRate messages
+	};
+
+	struct Config {
+		StringView path; // empty path for stderr
+		size_t maxFileSize = 0; // rotate file when it exceeds this size, 0 to disable rotation
+		size_t maxFiles = 4; // number of rotated files to keep: path.1 ... path.N
+		size_t bufferSize = 64_KiB; // ring buffer size for every writing thread
+		Policy policy = Policy::Drop;
+		uint32_t sampleRate = 16;
+		TimeInterval flushInterval = TimeInterval::milliseconds(100);
+		bool deferFormat = false;
+	};
+
+	struct Stats {
+		uint64_t written = 0;
+		uint64_t dropped = 0;
+		uint64_t sampled = 0;
+		uint64_t blocked = 0;
+	};
+
+	static AsyncLog *getInstance();
+
+	AsyncLog(const Config &);
+	~AsyncLog();
+
+	AsyncLog(const AsyncLog &) = delete;
+	AsyncLog& operator=(const AsyncLog &) = delete;
+
+	bool isActive() const;
+	Stats getStats() const;
+
+	// wait until all messages, pushed before the call, are written
+	void flush();
+
+	struct Data;
+
+protected:
+	Data *_data = nullptr;
+};
+
 void format(const StringView &tag, const char *, ...) SPPRINTF(2, 3);
 void text(const StringView &tag, const StringView &);
 
@@ -48,8 +48,10 @@ THE SOFTWARE.
 #include "SPSearchParser.cc"
 #include "SPSearchIndex.cc"
 #include "SPSearchConfiguration.cc"
+#include "SPSearchInvertedIndex.cc"
 #include "SPSerenityPathQuery.cc"
 #include "SPValid.cc"
+#include "SPZip.cc"
 
 #include "SPThreadTask.cc"
 #include "SPThreadTaskQueue.cc"
@@ -0,0 +1,585 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPZip.h"
+#include "SPThreadTaskQueue.h"
+#include "SPTime.h"
+#include "SPLog.h"
+
+namespace stappler {
+
+static constexpr uint32_t ZipLocalHeaderSignature = 0x04034b50;
+static constexpr uint32_t ZipDescriptorSignature = 0x08074b50;
+static constexpr uint32_t ZipCentralHeaderSignature = 0x02014b50;
+static constexpr uint32_t ZipEndSignature = 0x06054b50;
+static constexpr uint32_t ZipEnd64Signature = 0x06064b50;
+static constexpr uint32_t ZipEnd64LocatorSignature = 0x07064b50;
+
+static constexpr uint16_t ZipFlagDescriptor = 0x0008;
+static constexpr uint16_t ZipFlagUtf8 = 0x0800;
+
+static constexpr uint16_t ZipVersion = 20;
+static constexpr uint16_t ZipVersion64 = 45;
+static constexpr uint16_t ZipVersionMadeBy = (3 << 8) | ZipVersion64; // unix
+
+static constexpr uint16_t ZipMethodStore = 0;
+static constexpr uint16_t ZipMethodDeflate = 8;
+
+static constexpr size_t ZipStreamChunk = 64_KiB;
+
+struct ZipWriter::Job {
+	Record record;
+	Bytes data;
+	bool ready = false;
+	bool success = false;
+};
+
+struct ZipWriter::Sync {
+	std::mutex mutex;
+	std::condition_variable cond;
+};
+
+struct ZipWriter::Stream {
+	Record record;
+	z_stream stream;
+	Bytes buffer;
+};
+
+struct ZipWriter_Buffer {
+	uint8_t data[128];
+	uint8_t *ptr = data;
+
+	void put16(uint16_t v) { *ptr++ = uint8_t(v); *ptr++ = uint8_t(v >> 8); }
+	void put32(uint32_t v) { put16(uint16_t(v)); put16(uint16_t(v >> 16)); }
+	void put64(uint64_t v) { put32(uint32_t(v)); put32(uint32_t(v >> 32)); }
+
+	size_t size() const { return ptr - data; }
+};
+
+static uint32_t ZipWriter_crc(uint32_t crc, const uint8_t *data, size_t size) {
+	while (size > 0) {
+		auto len = std::min(size, size_t(1_GiB));
+		crc = uint32_t(crc32(crc, data, uInt(len)));
+		data += len;
+		size -= len;
+	}
+	return crc;
+}
+
+static bool ZipWriter_deflate(const uint8_t *data, size_t size, ZipWriter::Bytes &out) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	// raw deflate stream, as required by zip format
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+
+	out.resize(deflateBound(&stream, uLong(size)));
+
+	stream.next_in = (Bytef *)data;
+	stream.avail_in = uInt(size);
+	stream.next_out = out.data();
+	stream.avail_out = uInt(out.size());
+
+	auto err = deflate(&stream, Z_FINISH);
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+	return err == Z_STREAM_END;
+}
+
+static bool ZipWriter_isOverflow(uint64_t value) {
+	return value >= uint64_t(maxOf<uint32_t>());
+}
+
+// name length is stored as 16-bit value in local and central headers
+static bool ZipWriter_isValidName(StringView name) {
+	if (name.size() > size_t(maxOf<uint16_t>())) {
+		log::format("ZipWriter", "Entry name is too long: %lu bytes", (unsigned long)name.size());
+		return false;
+	}
+	return true;
+}
+
+ZipWriter::ZipWriter(const io::Consumer &consumer, thread::TaskQueue *queue, size_t maxPending)
+: _consumer(consumer), _queue(queue), _maxPending(std::max(maxPending, size_t(1))) {
+	sp_time_exp_t t(Time::now(), true);
+	// MS-DOS date and time, as in any other zip writer; 1980 is the lowest representable year
+	_dosTime = uint16_t((t.tm_hour << 11) | (t.tm_min << 5) | (t.tm_sec >> 1));
+	_dosDate = uint16_t((std::max(t.tm_year - 80, 0) << 9) | ((t.tm_mon + 1) << 5) | t.tm_mday);
+
+	if (_queue) {
+		_sync = std::make_shared<Sync>();
+	}
+}
+
+ZipWriter::~ZipWriter() {
+	// tasks hold only weak references to jobs, so unfinished entries are just dropped
+	if (_stream) {
+		if (_stream->record.method == ZipMethodDeflate) {
+			deflateEnd(&_stream->stream);
+		}
+		_stream = nullptr;
+	}
+}
+
+bool ZipWriter::addDir(StringView name) {
+	if (_failed || _finalized || _stream) {
+		return false;
+	}
+
+	Record record;
+	record.name = name.str<memory::StandartInterface>();
+	if (record.name.empty() || record.name.back() != '/') {
+		record.name.push_back('/');
+	}
+
+	if (!ZipWriter_isValidName(record.name)) {
+		return false;
+	}
+
+	if (!_pending.empty()) {
+		auto job = std::make_shared<Job>();
+		job->record = move(record);
+		job->ready = job->success = true;
+		return pushJob(move(job));
+	}
+
+	return emitRecord(move(record), BytesView());
+}
+
+bool ZipWriter::addFile(StringView name, BytesView data, bool uncompressed) {
+	if (_failed || _finalized || _stream) {
+		return false;
+	}
+
+	if (!ZipWriter_isValidName(name)) {
+		return false;
+	}
+
+	if (!_queue || (uncompressed && _pending.empty())) {
+		// no need to copy data, when it can be written right now
+		Record record;
+		record.name = name.str<memory::StandartInterface>();
+		record.uncompressedSize = data.size();
+		record.crc = ZipWriter_crc(0, data.data(), data.size());
+		if (uncompressed) {
+			record.method = ZipMethodStore;
+			return emitRecord(move(record), data);
+		}
+
+		Bytes out;
+		record.method = ZipMethodDeflate;
+		if (!ZipWriter_deflate(data.data(), data.size(), out)) {
+			_failed = true;
+			return false;
+		}
+		return emitRecord(move(record), BytesView(out.data(), out.size()));
+	}
+
+	return addFile(name, Bytes(data.data(), data.data() + data.size()), uncompressed);
+}
+
+bool ZipWriter::addFile(StringView name, StringView data, bool uncompressed) {
+	return addFile(name, BytesView((const uint8_t *)data.data(), data.size()), uncompressed);
+}
+
+bool ZipWriter::addFile(StringView name, Bytes &&data, bool uncompressed) {
+	if (_failed || _finalized || _stream) {
+		return false;
+	}
+
+	if (!_queue) {
+		return addFile(name, BytesView(data.data(), data.size()), uncompressed);
+	}
+
+	if (!ZipWriter_isValidName(name)) {
+		return false;
+	}
+
+	auto job = std::make_shared<Job>();
+	job->record.name = name.str<memory::StandartInterface>();
+	job->record.method = uncompressed ? ZipMethodStore : ZipMethodDeflate;
+	job->record.uncompressedSize = data.size();
+	job->data = move(data);
+
+	if (uncompressed) {
+		job->record.crc = ZipWriter_crc(0, job->data.data(), job->data.size());
+		job->ready = job->success = true;
+		return pushJob(move(job));
+	}
+
+	// completed tasks stay in queue until it's updated, so task should not own the job
+	// and compressed data should be released as soon as entry is written
+	auto sync = _sync;
+	_queue->perform(Rc<thread::Task>::create([weakJob = std::weak_ptr<Job>(job), sync] (const thread::Task &) -> bool {
+		auto job = weakJob.lock();
+		if (!job) {
+			return false; // writer was destroyed
+		}
+
+		Bytes out;
+		auto crc = ZipWriter_crc(0, job->data.data(), job->data.size());
+		auto success = ZipWriter_deflate(job->data.data(), job->data.size(), out);
+
+		std::unique_lock<std::mutex> lock(sync->mutex);
+		job->record.crc = crc;
+		job->data = move(out);
+		job->success = success;
+		job->ready = true;
+		sync->cond.notify_all();
+		return success;
+	}));
+
+	return pushJob(move(job));
+}
+
+bool ZipWriter::beginFile(StringView name, bool uncompressed) {
+	if (_failed || _finalized || _stream) {
+		return false;
+	}
+
+	if (!ZipWriter_isValidName(name) || !emitJobs(0)) {
+		return false;
+	}
+
+	_stream = std::unique_ptr<Stream>(new Stream);
+	_stream->record.name = name.str<memory::StandartInterface>();
+	_stream->record.method = uncompressed ? ZipMethodStore : ZipMethodDeflate;
+	_stream->record.offset = _offset;
+	_stream->record.descriptor = true;
+
+	if (!uncompressed) {
+		memset(&_stream->stream, 0, sizeof(z_stream));
+		if (deflateInit2(&_stream->stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			_stream = nullptr;
+			_failed = true;
+			return false;
+		}
+		_stream->buffer.resize(ZipStreamChunk);
+	}
+
+	return writeLocalHeader(_stream->record);
+}
+
+bool ZipWriter::write(BytesView data) {
+	if (!_stream || _failed) {
+		return false;
+	}
+
+	auto &record = _stream->record;
+	record.crc = ZipWriter_crc(record.crc, data.data(), data.size());
+	record.uncompressedSize += data.size();
+
+	if (record.method == ZipMethodStore) {
+		record.compressedSize += data.size();
+		return writeData(data.data(), data.size());
+	}
+
+	auto &stream = _stream->stream;
+	while (!data.empty()) {
+		auto len = std::min(data.size(), size_t(1_GiB));
+		stream.next_in = (Bytef *)data.data();
+		stream.avail_in = uInt(len);
+		do {
+			stream.next_out = _stream->buffer.data();
+			stream.avail_out = uInt(_stream->buffer.size());
+
+			// Z_BUF_ERROR only means that no progress was possible, it's not fatal
+			auto err = deflate(&stream, Z_NO_FLUSH);
+			if (err != Z_OK && err != Z_BUF_ERROR) {
+				log::format("ZipWriter", "Fail to compress entry: %s", record.name.data());
+				_failed = true;
+				return false;
+			}
+
+			auto out = _stream->buffer.size() - stream.avail_out;
+			record.compressedSize += out;
+			if (out > 0 && !writeData(_stream->buffer.data(), out)) {
+				return false;
+			}
+		} while (stream.avail_out == 0);
+		data.offset(len);
+	}
+	return true;
+}
+
+bool ZipWriter::write(StringView data) {
+	return write(BytesView((const uint8_t *)data.data(), data.size()));
+}
+
+bool ZipWriter::endFile() {
+	if (!_stream) {
+		return false;
+	}
+
+	auto s = move(_stream);
+	auto &record = s->record;
+	if (record.method == ZipMethodDeflate) {
+		auto &stream = s->stream;
+		stream.next_in = nullptr;
+		stream.avail_in = 0;
+
+		int err = Z_OK;
+		do {
+			stream.next_out = s->buffer.data();
+			stream.avail_out = uInt(s->buffer.size());
+			err = deflate(&stream, Z_FINISH);
+
+			auto out = s->buffer.size() - stream.avail_out;
+			record.compressedSize += out;
+			if (out > 0 && !writeData(s->buffer.data(), out)) {
+				break;
+			}
+		} while (err == Z_OK);
+		deflateEnd(&stream);
+
+		if (err != Z_STREAM_END) {
+			_failed = true;
+		}
+	}
+
+	if (_failed || !writeDescriptor(record)) {
+		return false;
+	}
+
+	_records.emplace_back(move(record));
+	return true;
+}
+
+bool ZipWriter::finalize() {
+	if (_finalized) {
+		return !_failed;
+	}
+
+	if (_stream) {
+		endFile();
+	}
+
+	if (emitJobs(0) && !_failed) {
+		_finalized = true;
+		if (writeCentralDirectory()) {
+			_consumer.flush();
+			return true;
+		}
+	}
+
+	_finalized = true;
+	return false;
+}
+
+bool ZipWriter::pushJob(std::shared_ptr<Job> &&job) {
+	_pending.emplace_back(move(job));
+	return emitJobs(_maxPending);
+}
+
+bool ZipWriter::emitJobs(size_t maxPending) {
+	while (!_pending.empty()) {
+		auto &job = _pending.front();
+		if (_sync) {
+			std::unique_lock<std::mutex> lock(_sync->mutex);
+			if (!job->ready) {
+				if (_pending.size() <= maxPending) {
+					break;
+				}
+				_sync->cond.wait(lock, [&] { return job->ready; });
+			}
+		}
+
+		auto j = move(job);
+		_pending.pop_front();
+
+		if (!j->success) {
+			log::format("ZipWriter", "Fail to compress entry: %s", j->record.name.data());
+			_failed = true;
+		}
+
+		if (_failed || !emitRecord(move(j->record), BytesView(j->data.data(), j->data.size()))) {
+			_pending.clear();
+			return false;
+		}
+
+		// worker can still hold the job until its task returns, compressed data is not needed anymore
+		Bytes().swap(j->data);
+	}
+	return !_failed;
+}
+
+bool ZipWriter::emitRecord(Record &&record, BytesView data) {
+	record.offset = _offset;
+	record.compressedSize = data.size();
+	record.descriptor = (record.method == ZipMethodDeflate);
+
+	if (record.descriptor) {
+		if (!writeLocalHeader(record) || !writeData(data.data(), data.size()) || !writeDescriptor(record)) {
+			return false;
+		}
+	} else {
+		// stored entries are written with sizes in local header, without data descriptor,
+		// so mimetype entry of ODF or EPUB container can be detected by magic bytes
+		if (!writeLocalHeader(record) || !writeData(data.data(), data.size())) {
+			return false;
+		}
+	}
+
+	_records.emplace_back(move(record));
+	return true;
+}
+
+bool ZipWriter::writeLocalHeader(const Record &record) {
+	// local headers has no zip64 extra fields, so entry size is limited with 4GiB
+	if (ZipWriter_isOverflow(record.uncompressedSize) || ZipWriter_isOverflow(record.compressedSize)) {
+		log::format("ZipWriter", "Entry is too large: %s", record.name.data());
+		_failed = true;
+		return false;
+	}
+
+	ZipWriter_Buffer buf;
+	buf.put32(ZipLocalHeaderSignature);
+	buf.put16(ZipVersion);
+	buf.put16(ZipFlagUtf8 | (record.descriptor ? ZipFlagDescriptor : 0));
+	buf.put16(record.method);
+	buf.put16(_dosTime);
+	buf.put16(_dosDate);
+	buf.put32(record.descriptor ? 0 : record.crc);
+	buf.put32(record.descriptor ? 0 : uint32_t(record.compressedSize));
+	buf.put32(record.descriptor ? 0 : uint32_t(record.uncompressedSize));
+	buf.put16(uint16_t(record.name.size()));
+	buf.put16(0);
+
+	return writeData(buf.data, buf.size()) && writeData((const uint8_t *)record.name.data(), record.name.size());
+}
+
+bool ZipWriter::writeDescriptor(const Record &record) {
+	if (ZipWriter_isOverflow(record.uncompressedSize) || ZipWriter_isOverflow(record.compressedSize)) {
+		log::format("ZipWriter", "Entry is too large: %s", record.name.data());
+		_failed = true;
+		return false;
+	}
+
+	ZipWriter_Buffer buf;
+	buf.put32(ZipDescriptorSignature);
+	buf.put32(record.crc);
+	buf.put32(uint32_t(record.compressedSize));
+	buf.put32(uint32_t(record.uncompressedSize));
+	return writeData(buf.data, buf.size());
+}
+
+bool ZipWriter::writeCentralDirectory() {
+	const uint64_t start = _offset;
+
+	for (auto &it : _records) {
+		const bool isDir = !it.name.empty() && it.name.back() == '/';
+		const bool zip64 = ZipWriter_isOverflow(it.offset);
+
+		ZipWriter_Buffer buf;
+		buf.put32(ZipCentralHeaderSignature);
+		buf.put16(ZipVersionMadeBy);
+		buf.put16(zip64 ? ZipVersion64 : ZipVersion);
+		buf.put16(ZipFlagUtf8 | (it.descriptor ? ZipFlagDescriptor : 0));
+		buf.put16(it.method);
+		buf.put16(_dosTime);
+		buf.put16(_dosDate);
+		buf.put32(it.crc);
+		buf.put32(uint32_t(it.compressedSize));
+		buf.put32(uint32_t(it.uncompressedSize));
+		buf.put16(uint16_t(it.name.size()));
+		buf.put16(zip64 ? 12 : 0);
+		buf.put16(0); // comment
+		buf.put16(0); // disk number
+		buf.put16(0); // internal attributes
+		buf.put32(isDir ? ((040755 << 16) | 0x10) : (0100644 << 16));
+		buf.put32(zip64 ? maxOf<uint32_t>() : uint32_t(it.offset));
+
+		if (!writeData(buf.data, buf.size()) || !writeData((const uint8_t *)it.name.data(), it.name.size())) {
+			return false;
+		}
+
+		if (zip64) {
+			ZipWriter_Buffer extra;
+			extra.put16(0x0001);
+			extra.put16(8);
+			extra.put64(it.offset);
+			if (!writeData(extra.data, extra.size())) {
+				return false;
+			}
+		}
+	}
+
+	const uint64_t size = _offset - start;
+	const uint64_t count = _records.size();
+	const bool zip64 = ZipWriter_isOverflow(start) || ZipWriter_isOverflow(size) || count >= maxOf<uint16_t>();
+
+	if (zip64) {
+		const uint64_t end64 = _offset;
+
+		ZipWriter_Buffer buf;
+		buf.put32(ZipEnd64Signature);
+		buf.put64(44);
+		buf.put16(ZipVersionMadeBy);
+		buf.put16(ZipVersion64);
+		buf.put32(0);
+		buf.put32(0);
+		buf.put64(count);
+		buf.put64(count);
+		buf.put64(size);
+		buf.put64(start);
+
+		buf.put32(ZipEnd64LocatorSignature);
+		buf.put32(0);
+		buf.put64(end64);
+		buf.put32(1);
+
+		if (!writeData(buf.data, buf.size())) {
+			return false;
+		}
+	}
+
+	ZipWriter_Buffer buf;
+	buf.put32(ZipEndSignature);
+	buf.put16(0);
+	buf.put16(0);
+	buf.put16(uint16_t(std::min(count, uint64_t(maxOf<uint16_t>()))));
+	buf.put16(uint16_t(std::min(count, uint64_t(maxOf<uint16_t>()))));
+	buf.put32(uint32_t(std::min(size, uint64_t(maxOf<uint32_t>()))));
+	buf.put32(uint32_t(std::min(start, uint64_t(maxOf<uint32_t>()))));
+	buf.put16(0);
+	return writeData(buf.data, buf.size());
+}
+
+bool ZipWriter::writeData(const uint8_t *data, size_t size) {
+	if (size == 0) {
+		return true;
+	}
+
+	if (_consumer.write(data, size) != size) {
+		_failed = true;
+		return false;
+	}
+	_offset += size;
+	return true;
+}
+
+}
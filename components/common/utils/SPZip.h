@@ -28,6 +28,13 @@ THE SOFTWARE.
 
 #include "libzip.h"
 #include "SPBytesView.h"
+#include "SPIO.h"
+
+namespace stappler::thread {
+
+class TaskQueue;
+
+}
 
 namespace stappler {
 
@@ -199,6 +206,90 @@ auto ZipArchive<Interface>::save() -> ZipArchive<Interface>::Buffer {
 	return move(_data);
 }
 
+/* Streaming ZIP writer
+ *
+ * Entries are written into consumer as soon as they are compressed, only central directory
+ * records are kept in memory. Local headers use data descriptors (general purpose flag bit 3),
+ * so neither entry nor archive size should be known in advance, and output can be
+ * a socket or any other non-seekable stream.
+ *
+ * With TaskQueue, independent entries added with addFile are deflated in parallel on
+ * queue's workers, and emitted in order of addition. No more then maxPending entries are
+ * held in memory; addFile blocks until the oldest one is written, when this limit is reached.
+ *
+ * Internal buffers use standard allocator, because compression is performed on worker threads.
+ */
+class ZipWriter : public memory::AllocBase {
+public:
+	using Bytes = std::vector<uint8_t>;
+
+	static constexpr size_t DefaultMaxPending = 16;
+
+	ZipWriter(const io::Consumer &, thread::TaskQueue * = nullptr, size_t maxPending = DefaultMaxPending);
+	~ZipWriter();
+
+	ZipWriter(const ZipWriter &) = delete;
+	ZipWriter & operator=(const ZipWriter &) = delete;
+
+	bool addDir(StringView name);
+	bool addFile(StringView name, BytesView data, bool uncompressed = false);
+	bool addFile(StringView name, StringView data, bool uncompressed = false);
+	bool addFile(StringView name, Bytes &&data, bool uncompressed = false);
+
+	// Sequential entry, compressed and written in chunks while data is produced;
+	// waits for pending parallel entries before start
+	bool beginFile(StringView name, bool uncompressed = false);
+	bool write(BytesView);
+	bool write(StringView);
+	bool endFile();
+
+	// waits for pending entries and writes central directory; no entries can be added after
+	bool finalize();
+
+	size_t getWrittenSize() const { return _offset; }
+
+	operator bool () const { return !_failed; }
+
+protected:
+	struct Job;
+	struct Sync;
+	struct Stream;
+
+	struct Record {
+		std::string name;
+		uint16_t method = 0;
+		uint32_t crc = 0;
+		uint64_t compressedSize = 0;
+		uint64_t uncompressedSize = 0;
+		uint64_t offset = 0;
+		bool descriptor = false;
+	};
+
+	bool pushJob(std::shared_ptr<Job> &&);
+	bool emitJobs(size_t maxPending);
+	bool emitRecord(Record &&, BytesView);
+
+	bool writeLocalHeader(const Record &);
+	bool writeDescriptor(const Record &);
+	bool writeCentralDirectory();
+	bool writeData(const uint8_t *, size_t);
+
+	io::Consumer _consumer;
+	thread::TaskQueue *_queue = nullptr;
+	size_t _maxPending = DefaultMaxPending;
+
+	uint16_t _dosTime = 0;
+	uint16_t _dosDate = 0;
+	uint64_t _offset = 0;
+	bool _failed = false;
+	bool _finalized = false;
+
+	std::vector<Record> _records;
+	std::deque<std::shared_ptr<Job>> _pending;
+	std::shared_ptr<Sync> _sync;
+	std::unique_ptr<Stream> _stream;
+};
+
 }
 
 #endif /* COMPONENTS_COMMON_UTILS_SPZIP_H_ */
@@ -139,6 +139,10 @@ public:
 	bool loadData(const uint8_t * data, size_t dataLen, const StrideFn &strideFn = nullptr);
 	bool loadData(const Bytes &, const StrideFn &strideFn = nullptr);
 
+	// init with encoded data, that will be displayed with size not greater, then minWidth x minHeight:
+	// decoder can reduce image (jpeg - by 1/2, 1/4 or 1/8), but not below requested size; bitmap still can be larger
+	bool loadData(const uint8_t * data, size_t dataLen, uint32_t minWidth, uint32_t minHeight, const StrideFn &strideFn = nullptr);
+
 	// init with raw data
 	void loadBitmap(const uint8_t *d, uint32_t w, uint32_t h, PixelFormat c, Alpha a = Bitmap::Alpha::Unpremultiplied, uint32_t stride = 0);
 	void loadBitmap(const Bytes &d, uint32_t w, uint32_t h, PixelFormat c, Alpha a = Bitmap::Alpha::Unpremultiplied, uint32_t stride = 0);
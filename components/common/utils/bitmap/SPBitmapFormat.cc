@@ -60,9 +60,11 @@ struct JpegError {
 	}
 };
 
-static bool loadJpg(const uint8_t *inputData, size_t size,
+// with nonzero minWidth and minHeight image is downscaled by decoder (by 1/2, 1/4 or 1/8), while it's not less
+// than requested size; it's much faster and uses less memory, then full decoding with resampling after it
+static bool loadJpgScaled(const uint8_t *inputData, size_t size,
 		Bytes &outputData, Color &color, Alpha &alpha, uint32_t &width, uint32_t &height,
-		uint32_t &stride, const Bitmap::StrideFn &strideFn) {
+		uint32_t &stride, const Bitmap::StrideFn &strideFn, uint32_t minWidth, uint32_t minHeight) {
 	/* these are standard libjpeg structures for reading(decompression) */
 	struct jpeg_decompress_struct cinfo;
 	struct JpegError jerr;
@@ -96,6 +98,16 @@ static bool loadJpg(const uint8_t *inputData, size_t size,
 			color = Color::RGB888;
 		}
 
+		if (minWidth > 0 && minHeight > 0) {
+			unsigned int denom = 8;
+			while (denom > 1 && ((cinfo.image_width + denom - 1) / denom < minWidth
+					|| (cinfo.image_height + denom - 1) / denom < minHeight)) {
+				denom /= 2;
+			}
+			cinfo.scale_num = 1;
+			cinfo.scale_denom = denom;
+		}
+
 		/* Start decompression jpeg here */
 		jpeg_start_decompress( &cinfo );
 
@@ -149,6 +161,12 @@ static bool loadJpg(const uint8_t *inputData, size_t size,
 	return ret;
 }
 
+static bool loadJpg(const uint8_t *inputData, size_t size,
+		Bytes &outputData, Color &color, Alpha &alpha, uint32_t &width, uint32_t &height,
+		uint32_t &stride, const Bitmap::StrideFn &strideFn) {
+	return loadJpgScaled(inputData, size, outputData, color, alpha, width, height, stride, strideFn, 0, 0);
+}
+
 struct JpegStruct {
 	struct jpeg_compress_struct cinfo;
 	struct jpeg_error_mgr jerr;
@@ -1699,4 +1717,15 @@ bool Bitmap::loadData(const Bytes &d, const StrideFn &strideFn) {
 	return loadData(d.data(), d.size(), strideFn);
 }
 
+bool Bitmap::loadData(const uint8_t * data, size_t dataLen, uint32_t minWidth, uint32_t minHeight, const StrideFn &strideFn) {
+	if (minWidth > 0 && minHeight > 0 && BitmapFormat_isJpg(data, dataLen)) {
+		if (jpeg::loadJpgScaled(data, dataLen, _data, _color, _alpha, _width, _height, _stride, strideFn, minWidth, minHeight)) {
+			_originalFormat = FileFormat::Jpeg;
+			_originalFormatName = s_defaultFormats[toInt(FileFormat::Jpeg)].getName().str();
+			return true;
+		}
+	}
+	return loadData(data, dataLen, strideFn);
+}
+
 NS_SP_END
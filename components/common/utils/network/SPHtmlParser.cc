@@ -26,6 +26,10 @@ THE SOFTWARE.
 #include "SPCommon.h"
 #include "SPHtmlParser.h"
 
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
 NS_SP_EXT_BEGIN(html)
 
 using HtmlIdentifier16 = chars::Compose<char16_t,
@@ -43,67 +47,29 @@ using HtmlIdentifier8 = chars::Compose<char,
 >;
 
 
-template <> StringViewUtf8 Tag_readName<StringViewUtf8>(StringViewUtf8 &is, bool keepClean) {
-	StringViewUtf8 s = is;
-	s.skipUntil<HtmlIdentifier16, StringViewUtf8::MatchChars<'>', '?'>>();
-	StringViewUtf8 name(s.readChars<HtmlIdentifier16, StringViewUtf8::MatchChars<'?'>>());
-	if (!keepClean) {
-		string::tolower_buf((char *)name.data(), name.size());
-	}
-	if (name.size() > 1 && name.back() == '/') {
-		name.set(name.data(), name.size() - 1);
-		is += (is.size() - s.size() - 1);
-	} else {
-		s.skipUntil<HtmlIdentifier16, StringViewUtf8::MatchChars<'>'>>();
-		is = s;
-	}
-	return name;
-}
-
-template <> StringViewUtf8 Tag_readAttrName<StringViewUtf8>(StringViewUtf8 &s, bool keepClean) {
-	s.skipUntil<HtmlIdentifier16>();
-	StringViewUtf8 name(s.readChars<HtmlIdentifier16>());
-	if (!keepClean) {
-		string::tolower_buf((char *)name.data(), name.size());
+const char *Tokenizer_findChar(const char *ptr, const char *end, char c) {
+#if __SSE2__
+	auto v = _mm_set1_epi8(c);
+	while (end - ptr >= 16) {
+		auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)ptr), v));
+		if (mask) {
+			return ptr + __builtin_ctz(mask);
+		}
+		ptr += 16;
 	}
-	return name;
-}
-
-template <> StringViewUtf8 Tag_readAttrValue<StringViewUtf8>(StringViewUtf8 &s, bool keepClean) {
-	if (!s.is('=')) {
-		s.skipUntil<HtmlIdentifier16>();
-		return StringViewUtf8();
+	while (ptr < end && *ptr != c) {
+		++ ptr;
 	}
-
-	s ++;
-	char quoted = 0;
-	if (s.is('"') || s.is('\'')) {
-		quoted = s[0];
-		s ++;
-		StringViewUtf8 tmp = s;
-		while (!s.empty() && !s.is(quoted)) {
-			if (quoted == '"') {
-				s.skipUntil<StringViewUtf8::MatchChars<u'\\', u'"'>>();
-			} else {
-				s.skipUntil<StringViewUtf8::MatchChars<u'\\', u'\''>>();
-			}
-			if (s.is('\\')) {
-				s += 2;
-			}
-		}
-
-		StringViewUtf8 ret(tmp.data(), tmp.size() - s.size());
-		if (s.is(quoted)) {
-			s ++;
-		}
-		s.skipUntil<HtmlIdentifier16, StringViewUtf8::MatchChars<'>'>>();
-		return ret;
+	return ptr;
+#else
+	if (ptr >= end) {
+		return end;
 	}
-
-	return s.readChars<HtmlIdentifier16>();
+	auto ret = (const char *)memchr(ptr, c, end - ptr);
+	return ret ? ret : end;
+#endif
 }
 
-
 template <> StringView Tag_readName<StringView>(StringView &is, bool keepClean) {
 	StringView s = is;
 	s.skipUntil<HtmlIdentifier8, StringView::MatchChars<'>', '?'>>();
@@ -165,6 +131,30 @@ template <> StringView Tag_readAttrValue<StringView>(StringView &s, bool keepCle
 }
 
 
+// Identifiers are ASCII, so UTF-8 data can be processed with single-byte readers
+
+template <> StringViewUtf8 Tag_readName<StringViewUtf8>(StringViewUtf8 &is, bool keepClean) {
+	auto s = Tokenizer_makeReader<StringView>(is.data(), is.size());
+	auto ret = Tag_readName(s, keepClean);
+	is.set(s.data(), s.size());
+	return Tokenizer_makeReader<StringViewUtf8>(ret.data(), ret.size());
+}
+
+template <> StringViewUtf8 Tag_readAttrName<StringViewUtf8>(StringViewUtf8 &is, bool keepClean) {
+	auto s = Tokenizer_makeReader<StringView>(is.data(), is.size());
+	auto ret = Tag_readAttrName(s, keepClean);
+	is.set(s.data(), s.size());
+	return Tokenizer_makeReader<StringViewUtf8>(ret.data(), ret.size());
+}
+
+template <> StringViewUtf8 Tag_readAttrValue<StringViewUtf8>(StringViewUtf8 &is, bool keepClean) {
+	auto s = Tokenizer_makeReader<StringView>(is.data(), is.size());
+	auto ret = Tag_readAttrValue(s, keepClean);
+	is.set(s.data(), s.size());
+	return Tokenizer_makeReader<StringViewUtf8>(ret.data(), ret.size());
+}
+
+
 template <> WideStringView Tag_readName<WideStringView>(WideStringView &is, bool keepClean) {
 	WideStringView s = is;
 	s.skipUntil<HtmlIdentifier16, WideStringView::MatchChars<u'>', u'?'>>();
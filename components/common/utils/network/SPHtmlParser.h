@@ -103,76 +103,194 @@ auto Tag_readAttrName(StringReader &s, bool keepClean = false) -> StringReader;
 template <typename StringReader>
 auto Tag_readAttrValue(StringReader &s, bool keepClean = false) -> StringReader;
 
-template <typename __StringReader>
-struct Tag : public ReaderClassBase<char16_t> {
-	using StringReader = __StringReader;
+/* Tokenizer sample:
+struct TokenReader {
+	using Tokenizer = html::Tokenizer<TokenReader>;
+	using StringReader = Tokenizer::StringReader;
+	using TagReader = Tokenizer::TagReader;
+
+	// text run or CDATA section
+	inline void onText(Tokenizer &t, StringReader &s) { }
+
+	// tag attributes can be read with TagReader::readAttribute, rest of the tag is skipped after return
+	inline void onTag(Tokenizer &t, StringReader &name, TagReader &tag) {
+		StringReader attrName, attrValue;
+		while (tag.readAttribute(attrName, attrValue)) { }
+	}
 
-	Tag(const StringReader &name) : name(name) {
-		if (name.is('!')) {
-			closable = false;
-		}
+	// return false to stop tokenizer after this tag
+	inline bool onCloseTag(Tokenizer &t, StringReader &name) { return true; }
+};
+ */
+
+template <typename T>
+struct TokenizerTraits {
+	using success = char;
+	using failure = long;
+
+	InvokerCallTest_MakeCallTest(onText, success, failure);
+	InvokerCallTest_MakeCallTest(onTag, success, failure);
+	InvokerCallTest_MakeCallTest(onCloseTag, success, failure);
+	InvokerCallTest_MakeCallTest(onReadTagName, success, failure);
+	InvokerCallTest_MakeCallTest(onReadAttributeName, success, failure);
+	InvokerCallTest_MakeCallTest(onReadAttributeValue, success, failure);
+};
+
+// Finds first byte c in [begin, end), returns end if there is none; scans 16 bytes at a time when SSE2 is available
+const char *Tokenizer_findChar(const char *begin, const char *end, char c);
+
+// Reader constructors check data for null-terminator, this one just sets bounds
+template <typename StringReader, typename CharType>
+inline auto Tokenizer_makeReader(const CharType *ptr, size_t len) -> StringReader {
+	StringReader ret;
+	ret.set(ptr, len);
+	return ret;
+}
+
+// For single-byte and UTF-8 readers markup characters are found bytewise: they are all ASCII,
+// and bytes of UTF-8 multibyte sequences never match them, so text is never decoded
+template <char C, typename StringReader>
+inline auto Tokenizer_readUntil(StringReader &s) -> StringReader {
+	if constexpr (sizeof(typename StringReader::CharType) == 1) {
+		auto ptr = Tokenizer_findChar(s.data(), s.data() + s.size(), C);
+		auto ret = Tokenizer_makeReader<StringReader>(s.data(), ptr - s.data());
+		s.set(ptr, s.size() - ret.size());
+		return ret;
+	} else {
+		return s.template readUntil<typename StringReader::template MatchChars<C>>();
 	}
+}
 
-	const StringReader &getName() const { return name; }
+template <typename StringReader>
+inline bool Tokenizer_skipUntilString(StringReader &s, const StringReader &str, bool stopBeforeString = true) {
+	if constexpr (sizeof(typename StringReader::CharType) == 1) {
+		if (!s.data()) {
+			return false;
+		}
 
-	void setClosable(bool v) { closable = v; }
-	bool isClosable() const { return closable; }
+		auto ptr = s.data();
+		auto end = s.data() + s.size();
+		while (ptr < end) {
+			ptr = Tokenizer_findChar(ptr, end, str.data()[0]);
+			if (size_t(end - ptr) >= str.size() && memcmp(ptr, str.data(), str.size()) == 0) {
+				break;
+			} else if (ptr < end) {
+				++ ptr;
+			}
+		}
 
-	void setHasContent(bool v) { content = v; }
-	bool hasContent() const { return content; }
+		if (ptr < end && *ptr != 0 && !stopBeforeString) {
+			ptr += str.size();
+		}
 
-	StringReader name;
-	bool closable = true;
-	bool content = false;
-};
+		s.set(ptr, end - ptr);
+		return ptr < end && *ptr != 0;
+	} else {
+		return s.skipUntilString(str, stopBeforeString);
+	}
+}
 
-template <typename ReaderType, typename __StringReader = StringViewUtf8,
-		typename TagType = typename html::Tag<__StringReader>,
-		typename Traits = ParserTraits<ReaderType>>
-struct Parser {
+template <typename StringReader>
+inline auto Tokenizer_readUntilString(StringReader &s, const StringReader &str) -> StringReader {
+	auto tmp = s;
+	Tokenizer_skipUntilString(s, str);
+	return Tokenizer_makeReader<StringReader>(tmp.data(), tmp.size() - s.size());
+}
+
+template <typename TokenReader, typename __StringReader = StringViewUtf8, typename Traits = TokenizerTraits<TokenReader>>
+struct Tokenizer {
 	using StringReader = __StringReader;
 	using OrigCharType = typename StringReader::CharType;
 	using CharType = typename StringReader::MatchCharType;
-	using Tag = TagType;
-
-	template <CharType ... Args>
-	using Chars = chars::Chars<CharType, Args...>;
-
-	template <CharType First, CharType Last>
-	using Range = chars::Chars<CharType, First, Last>;
 
 	using GroupId = CharGroupId;
 
 	template <GroupId G>
 	using Group = chars::CharGroup<CharType, G>;
 
-	using LtChar = Chars<'<'>;
+	struct TagReader {
+		// returns false, when there is no more attributes in tag
+		bool readAttribute(StringReader &name, StringReader &value) {
+			auto &current = tokenizer->current;
+			while (!finalized && !current.empty() && !current.is('>') && !current.is('/')) {
+				name = tokenizer->onReadAttributeName(current);
+				if (name.empty()) {
+					continue;
+				}
 
-	Parser(ReaderType &r) : reader(&r) {
-		if constexpr (Traits::shouldLowercaseTokens) {
-			lowercase = reader->shouldLowercaseTokens(*this);
+				value = tokenizer->onReadAttributeValue(current);
+				return true;
+			}
+			return false;
 		}
-	}
+
+		// skips rest of the tag, returns true for self-closed tag
+		bool finalize() {
+			if (!finalized) {
+				StringReader name, value;
+				while (readAttribute(name, value)) { }
+
+				auto &current = tokenizer->current;
+				closed = current.is('/');
+				Tokenizer_readUntil<'>'>(current);
+				if (current.is('>')) {
+					++ current;
+				}
+				finalized = true;
+			}
+			return closed;
+		}
+
+		// reads content of non-parsed tag (like <script>) until its closing tag,
+		// returns false if there is no closing tag until the end of data
+		bool readRawContent(const StringReader &name, StringReader &content) {
+			finalize();
+
+			auto &current = tokenizer->current;
+			auto start = current;
+			while (!current.empty()) {
+				Tokenizer_readUntil<'<'>(current);
+				if (current.is('<')) {
+					auto tmp = current.sub(1);
+					if (tmp.is('/')) {
+						++ tmp;
+						if (tmp.starts_with(name)) {
+							tmp += name.size();
+							tmp.template skipChars<Group<GroupId::WhiteSpace>>();
+							if (tmp.is('>')) {
+								content = Tokenizer_makeReader<StringReader>(start.data(), current.data() - start.data());
+								++ tmp;
+								current = tmp;
+								return true;
+							}
+						}
+					}
+					++ current;
+				}
+			}
+			return false;
+		}
+
+		TagReader(Tokenizer *t) : tokenizer(t) { }
+
+		Tokenizer *tokenizer = nullptr;
+		bool finalized = false;
+		bool closed = false;
+	};
+
+	Tokenizer(TokenReader &r, bool lowercase = true) : lowercase(lowercase), reader(&r) { }
 
 	inline void cancel() {
 		current.clear();
 		canceled = true;
 	}
 
-	bool parse(const StringReader &r, bool rootOnly) {
+	bool tokenize(const StringReader &r) {
 		current = r;
 		while (!current.empty()) {
-			auto prefix = current.template readUntil<LtChar>(); // move to next tag
+			auto prefix = Tokenizer_readUntil<'<'>(current); // move to next tag
 			if (!prefix.empty()) {
-				if (!tagStack.empty()) {
-					tagStack.back().setHasContent(true);
-					onTagContent(tagStack.back(), prefix);
-				} else {
-					StringReader r;
-					Tag t(r);
-					t.setHasContent(true);
-					onTagContent(t, prefix);
-				}
+				onText(prefix);
 			}
 
 			if (!current.is('<')) {
@@ -183,35 +301,10 @@ struct Parser {
 			if (current.is('/')) { // close some parsed tag
 				++ current; // drop '/'
 
-				auto tag = current.template readUntil<Chars<'>'>>();
-				if (!tag.empty() && current.is('>') && !tagStack.empty()) {
-					auto it = tagStack.end();
-					do {
-						-- it;
-						auto &name = it->getName();
-						if (lowercase) {
-							if constexpr (sizeof(OrigCharType) == 2) {
-								string::tolower_buf((char16_t *)tag.data(), tag.size());
-							} else {
-								string::tolower_buf((char *)tag.data(), tag.size());
-							}
-						}
-						if (tag.size() == name.size() && tag.compare(name.data(), name.size())) {
-							// close all tag after <tag>
-							auto nit = tagStack.end();
-							do {
-								-- nit;
-								onPopTag(*nit);
-								tagStack.pop_back();
-							} while (nit != it);
-							break;
-						}
-					} while(it != tagStack.begin());
-
-					if (rootOnly && tagStack.empty()) {
-						if (current.is('>')) {
-							++ current; // drop '>'
-						}
+				auto tag = Tokenizer_readUntil<'>'>(current);
+				if (!tag.empty() && current.is('>')) {
+					if (!onCloseTag(tag)) {
+						++ current; // drop '>'
 						break;
 					}
 				} else if (current.empty()) {
@@ -221,7 +314,7 @@ struct Parser {
 			} else {
 				auto name = onReadTagName(current);
 				if (name.empty()) { // found tag without readable name
-					current.template skipUntil<Chars<'>'>>();
+					Tokenizer_readUntil<'>'>(current);
 					if (current.is('>')) {
 						current ++;
 					}
@@ -230,22 +323,22 @@ struct Parser {
 
 				if constexpr (sizeof(OrigCharType) == 2) {
 					if (name.prefix(u"!--", "!--"_len)) { // process comment
-						current.skipUntilString(u"-->", false);
+						Tokenizer_skipUntilString(current, StringReader(u"-->"), false);
 						continue;
 					}
 
 					if (name.is(u'?')) { // found processing-instruction
-						current.skipUntilString(u"?>", false);
+						Tokenizer_skipUntilString(current, StringReader(u"?>"), false);
 						continue;
 					}
 				} else {
 					if (name.prefix("!--", "!--"_len)) { // process comment
-						current.skipUntilString("-->", false);
+						Tokenizer_skipUntilString(current, StringReader("-->"), false);
 						continue;
 					}
 
 					if (name.is('?')) { // found processing-instruction
-						current.skipUntilString("?>", false);
+						Tokenizer_skipUntilString(current, StringReader("?>"), false);
 						continue;
 					}
 				}
@@ -254,103 +347,146 @@ struct Parser {
 					StringReader cdata;
 					if constexpr (sizeof(OrigCharType) == 2) {
 						if (current.starts_with(u"CDATA[")) {
-							cdata = current.readUntilString(u"]]>");
+							cdata = Tokenizer_readUntilString(current, StringReader(u"]]>"));
 							cdata += "CDATA["_len;
 							current += "]]>"_len;
 						}
 					} else {
 						if (current.starts_with("CDATA[")) {
-							cdata = current.readUntilString("]]>");
+							cdata = Tokenizer_readUntilString(current, StringReader("]]>"));
 							cdata += "CDATA["_len;
 							current += "]]>"_len;
 						}
 					}
 
 					if (!cdata.empty()) {
-						if (!tagStack.empty()) {
-							tagStack.back().setHasContent(true);
-							onTagContent(tagStack.back(), cdata);
-						} else {
-							StringReader r;
-							Tag t(r);
-							t.setHasContent(true);
-							onTagContent(t, cdata);
-						}
-						continue;
+						onText(cdata);
 					} else {
-						current.template skipUntil<Chars<'>'>>();
+						Tokenizer_readUntil<'>'>(current);
 						if (current.is('>')) {
 							++ current;
 						}
-						continue;
 					}
+					continue;
 				}
 
-				TagType tag(name);
-				onBeginTag(tag);
+				TagReader tag(this);
+				onTag(name, tag);
+				tag.finalize();
+			}
+		}
 
-				StringReader attrName;
-				StringReader attrValue;
-				while (!current.empty() && !current.is('>') && !current.is('/')) {
-					attrName.clear();
-					attrValue.clear();
+		return !canceled;
+	}
 
-					attrName = onReadAttributeName(current);
-					if (attrName.empty()) {
-						continue;
-					}
+	inline StringReader onReadTagName(StringReader &str) {
+		if constexpr (Traits::onReadTagName) {
+			return reader->onReadTagName(*this, str);
+		} else {
+			return Tag_readName(str, !lowercase);
+		}
+	}
 
-					attrValue = onReadAttributeValue(current);
-					onTagAttribute(tag, attrName, attrValue);
-				}
+	inline StringReader onReadAttributeName(StringReader &str) {
+		if constexpr (Traits::onReadAttributeName) {
+			return reader->onReadAttributeName(*this, str);
+		} else {
+			return Tag_readAttrName(str, !lowercase);
+		}
+	}
 
-				if (current.is('/')) {
-					tag.setClosable(false);
-				}
+	inline StringReader onReadAttributeValue(StringReader &str) {
+		if constexpr (Traits::onReadAttributeValue) {
+			return reader->onReadAttributeValue(*this, str);
+		} else {
+			return Tag_readAttrValue(str, !lowercase);
+		}
+	}
 
-				current.template skipUntil<Chars<'>'>>();
-				if (current.is('>')) {
-					++ current;
-				}
+	inline void onText(StringReader &s) {
+		if constexpr (Traits::onText) { reader->onText(*this, s); }
+	}
+	inline void onTag(StringReader &name, TagReader &tag) {
+		if constexpr (Traits::onTag) { reader->onTag(*this, name, tag); }
+	}
+	inline bool onCloseTag(StringReader &name) {
+		if constexpr (Traits::onCloseTag) { return reader->onCloseTag(*this, name); }
+		return true;
+	}
 
-				onEndTag(tag, !tag.isClosable());
-				if (tag.isClosable()) {
-					onPushTag(tag);
-					tagStack.emplace_back(std::move(tag));
-					if (!shouldParseTag(tag)) {
-						auto start = current;
-						while (!current.empty()) {
-							current.template skipUntil<Chars<'<'>>();
-							if (current.is('<')) {
-								auto tmp = current.sub(1);
-								if (tmp.is('/')) {
-									++ tmp;
-									if (tmp.starts_with(tag.name)) {
-										tmp += tag.name.size();
-										tmp.template skipChars<Group<GroupId::WhiteSpace>>();
-										if (tmp.is('>')) {
-											StringReader content(start.data(), current.data() - start.data());
-											if (!content.empty()) {
-												onTagContent(tag, content);
-											}
-											onPopTag(tag);
-											tagStack.pop_back();
-
-											++ tmp;
-											current = tmp;
-											break;
-										}
-									}
-								}
-								++ current;
-							}
-						}
-					}
-				} else {
-					onInlineTag(tag);
-				}
-			}
+	bool lowercase = true;
+	bool canceled = false;
+	TokenReader *reader;
+	StringReader current;
+};
+
+template <typename __StringReader>
+struct Tag : public ReaderClassBase<char16_t> {
+	using StringReader = __StringReader;
+
+	Tag(const StringReader &name) : name(name) {
+		if (name.is('!')) {
+			closable = false;
+		}
+	}
+
+	const StringReader &getName() const { return name; }
+
+	void setClosable(bool v) { closable = v; }
+	bool isClosable() const { return closable; }
+
+	void setHasContent(bool v) { content = v; }
+	bool hasContent() const { return content; }
+
+	StringReader name;
+	bool closable = true;
+	bool content = false;
+};
+
+template <typename ReaderType, typename __StringReader = StringViewUtf8,
+		typename TagType = typename html::Tag<__StringReader>,
+		typename Traits = ParserTraits<ReaderType>>
+struct Parser {
+	using StringReader = __StringReader;
+	using OrigCharType = typename StringReader::CharType;
+	using CharType = typename StringReader::MatchCharType;
+	using Tag = TagType;
+
+	template <CharType ... Args>
+	using Chars = chars::Chars<CharType, Args...>;
+
+	template <CharType First, CharType Last>
+	using Range = chars::Chars<CharType, First, Last>;
+
+	using GroupId = CharGroupId;
+
+	template <GroupId G>
+	using Group = chars::CharGroup<CharType, G>;
+
+	using LtChar = Chars<'<'>;
+
+	Parser(ReaderType &r) : reader(&r) {
+		if constexpr (Traits::shouldLowercaseTokens) {
+			lowercase = reader->shouldLowercaseTokens(*this);
+		}
+	}
+
+	using Tokenizer = html::Tokenizer<Parser, StringReader>;
+	using TagReader = typename Tokenizer::TagReader;
+
+	inline void cancel() {
+		if (tokenizer) {
+			tokenizer->cancel();
 		}
+		canceled = true;
+	}
+
+	bool parse(const StringReader &r, bool rootOnly) {
+		Tokenizer t(*this, lowercase);
+		tokenizer = &t;
+		this->rootOnly = rootOnly;
+		t.tokenize(r);
+		tokenizer = nullptr;
 
 		if (!tagStack.empty()) {
 			auto nit = tagStack.end();
@@ -364,7 +500,83 @@ struct Parser {
 		return !canceled;
 	}
 
-	inline StringReader onReadTagName(StringReader &str) {
+	inline void onText(Tokenizer &, StringReader &s) {
+		if (!tagStack.empty()) {
+			tagStack.back().setHasContent(true);
+			onTagContent(tagStack.back(), s);
+		} else {
+			StringReader r;
+			Tag t(r);
+			t.setHasContent(true);
+			onTagContent(t, s);
+		}
+	}
+
+	inline void onTag(Tokenizer &, StringReader &name, TagReader &reader) {
+		TagType tag(name);
+		onBeginTag(tag);
+
+		StringReader attrName;
+		StringReader attrValue;
+		while (reader.readAttribute(attrName, attrValue)) {
+			onTagAttribute(tag, attrName, attrValue);
+		}
+
+		if (reader.finalize()) {
+			tag.setClosable(false);
+		}
+
+		onEndTag(tag, !tag.isClosable());
+		if (tag.isClosable()) {
+			onPushTag(tag);
+			tagStack.emplace_back(std::move(tag));
+			if (!shouldParseTag(tag)) {
+				StringReader content;
+				if (reader.readRawContent(tag.name, content)) {
+					if (!content.empty()) {
+						onTagContent(tag, content);
+					}
+					onPopTag(tag);
+					tagStack.pop_back();
+				}
+			}
+		} else {
+			onInlineTag(tag);
+		}
+	}
+
+	inline bool onCloseTag(Tokenizer &, StringReader &tag) {
+		if (tagStack.empty()) {
+			return true;
+		}
+
+		auto it = tagStack.end();
+		do {
+			-- it;
+			auto &name = it->getName();
+			if (lowercase) {
+				if constexpr (sizeof(OrigCharType) == 2) {
+					string::tolower_buf((char16_t *)tag.data(), tag.size());
+				} else {
+					string::tolower_buf((char *)tag.data(), tag.size());
+				}
+			}
+			if (tag.size() == name.size() && tag.compare(name.data(), name.size())) {
+				// close all tag after <tag>
+				auto nit = tagStack.end();
+				do {
+					-- nit;
+					onPopTag(*nit);
+					tagStack.pop_back();
+				} while (nit != it);
+				break;
+			}
+		} while(it != tagStack.begin());
+
+		return !(rootOnly && tagStack.empty());
+	}
+
+	inline StringReader onReadTagName(Tokenizer &, StringReader &str) {
 		if constexpr (Traits::onReadTagName) {
 			StringReader ret(str);
 			reader->onReadTagName(*this, ret);
@@ -374,7 +586,7 @@ struct Parser {
 		}
 	}
 
-	inline StringReader onReadAttributeName(StringReader &str) {
+	inline StringReader onReadAttributeName(Tokenizer &, StringReader &str) {
 		if constexpr (Traits::onReadAttributeName) {
 			StringReader ret(str);
 			reader->onReadAttributeName(*this, ret);
@@ -384,7 +596,7 @@ struct Parser {
 		}
 	}
 
-	inline StringReader onReadAttributeValue(StringReader &str) {
+	inline StringReader onReadAttributeValue(Tokenizer &, StringReader &str) {
 		if constexpr (Traits::onReadAttributeValue) {
 			StringReader ret(str);
 			reader->onReadAttributeValue(*this, ret);
@@ -422,8 +634,9 @@ struct Parser {
 
 	bool lowercase = true;
 	bool canceled = false;
+	bool rootOnly = true;
 	ReaderType *reader;
-	StringReader current;
+	Tokenizer *tokenizer = nullptr;
 	Vector<TagType> tagStack;
 };
 
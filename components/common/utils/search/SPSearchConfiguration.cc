@@ -335,6 +335,16 @@ bool Configuration::stemWord(const StringView &word, ParserToken tok, const Stem
 	}
 }
 
+void Configuration::stemWords(SpanView<StringView> words, ParserToken tok, const StemWordCallback &cb) const {
+	Vector<StringView> list(words.begin(), words.end());
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+
+	for (auto &it : list) {
+		stemWord(it, tok, cb);
+	}
+}
+
 StemmerEnv *Configuration_makeLocalConfig(StemmerEnv *orig) {
 	auto p = memory::pool::acquire();
 
@@ -89,6 +89,9 @@ public:
 
 	bool stemWord(const StringView &, ParserToken, const StemWordCallback &) const;
 
+	// stem every unique word from list only once, callback called for every stem of unique word
+	void stemWords(SpanView<StringView>, ParserToken, const StemWordCallback &) const;
+
 	String makeHeadline(const HeadlineConfig &, const StringView &origin, const Vector<String> &stemList) const;
 
 	String makeHtmlHeadlines(const HeadlineConfig &, const StringView &origin, const Vector<String> &stemList, size_t count = 1) const;
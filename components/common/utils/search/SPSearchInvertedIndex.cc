@@ -0,0 +1,766 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPSearchInvertedIndex.h"
+#include "SPLog.h"
+
+namespace stappler::search {
+
+using InvertedIndexBytes = InvertedIndex::Vector<uint8_t>;
+
+static void InvertedIndex_writeVarint(InvertedIndexBytes &buf, uint64_t value) {
+	while (value >= 0x80) {
+		buf.emplace_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	buf.emplace_back(uint8_t(value));
+}
+
+static bool InvertedIndex_readVarint(const uint8_t *&ptr, const uint8_t *end, uint64_t &value) {
+	value = 0;
+	uint32_t shift = 0;
+	while (ptr < end && shift < 64) {
+		auto b = *ptr ++;
+		value |= uint64_t(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+static int InvertedIndex_compare(StringView l, StringView r) {
+	auto len = std::min(l.size(), r.size());
+	if (len > 0) {
+		if (auto c = ::memcmp(l.data(), r.data(), len)) {
+			return c;
+		}
+	}
+	return (l.size() < r.size()) ? -1 : ((l.size() > r.size()) ? 1 : 0);
+}
+
+template <typename Callback>
+static void InvertedIndex_readPositions(BytesView data, const Callback &cb) {
+	auto ptr = data.data();
+	auto end = ptr + data.size();
+	uint64_t value = 0;
+	uint32_t pos = 0;
+	while (InvertedIndex_readVarint(ptr, end, value)) {
+		pos += uint32_t(value >> 3);
+		cb(pos, SearchData::Rank(value & 0x7));
+	}
+}
+
+struct InvertedIndex_Cursor {
+	InvertedIndex_Cursor(const InvertedIndex::Segment &seg, const InvertedIndex::TermEntry &entry)
+	: docs(seg.header.docs) {
+		auto data = seg.getPostings(entry);
+		ptr = data.data();
+		end = data.data() + data.size();
+	}
+
+	bool next() {
+		if (ptr == end) {
+			valid = false;
+			return false;
+		}
+
+		// documents should be strictly ordered and within segment, otherwise postings are malformed
+		uint64_t delta, count, size;
+		if (!InvertedIndex_readVarint(ptr, end, delta) || !InvertedIndex_readVarint(ptr, end, count)
+				|| !InvertedIndex_readVarint(ptr, end, size) || size_t(end - ptr) < size
+				|| (valid && delta == 0) || (valid ? uint64_t(doc) + delta : delta) >= docs) {
+			ptr = end;
+			valid = false;
+			failed = true;
+			return false;
+		}
+
+		doc = valid ? doc + uint32_t(delta) : uint32_t(delta);
+		freq = uint32_t(count);
+		positions = BytesView(ptr, size_t(size));
+		ptr += size;
+		valid = true;
+		return true;
+	}
+
+	// move to first document >= target
+	bool advance(uint32_t target) {
+		while (!valid || doc < target) {
+			if (!next()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const uint8_t *ptr = nullptr;
+	const uint8_t *end = nullptr;
+	uint32_t docs = 0;
+	bool valid = false;
+	bool failed = false;
+	uint32_t doc = 0;
+	uint32_t freq = 0;
+	BytesView positions;
+};
+
+struct InvertedIndex_Writer {
+	using DocEntry = InvertedIndex::DocEntry;
+	using TermEntry = InvertedIndex::TermEntry;
+	using SegmentHeader = InvertedIndex::SegmentHeader;
+	using Segment = InvertedIndex::Segment;
+
+	void pushDoc(uint32_t doc, uint32_t freq, BytesView positions) {
+		InvertedIndex_writeVarint(postings, (termDocs == 0) ? doc : doc - prevDoc);
+		InvertedIndex_writeVarint(postings, freq);
+		InvertedIndex_writeVarint(postings, positions.size());
+		postings.insert(postings.end(), positions.data(), positions.data() + positions.size());
+		prevDoc = doc;
+		++ termDocs;
+	}
+
+	void pushTerm(StringView term) {
+		if (termDocs == 0) {
+			return;
+		}
+
+		TermEntry entry;
+		entry.stringOffset = uint32_t(strings.size());
+		entry.stringSize = uint32_t(term.size());
+		entry.postingsOffset = uint32_t(termStart);
+		entry.postingsSize = uint32_t(postings.size() - termStart);
+		entry.docs = termDocs;
+		terms.emplace_back(entry);
+
+		strings.insert(strings.end(), (const uint8_t *)term.data(), (const uint8_t *)term.data() + term.size());
+
+		termStart = postings.size();
+		termDocs = 0;
+		prevDoc = 0;
+	}
+
+	Segment *finalize() {
+		SegmentHeader header;
+		header.docs = uint32_t(docs.size());
+		header.terms = uint32_t(terms.size());
+		header.totalLength = totalLength;
+		header.docsOffset = uint32_t(sizeof(SegmentHeader));
+		header.termsOffset = uint32_t(header.docsOffset + docs.size() * sizeof(DocEntry));
+		header.stringsOffset = uint32_t(header.termsOffset + terms.size() * sizeof(TermEntry));
+		header.postingsOffset = uint32_t(header.stringsOffset + strings.size());
+		header.size = uint32_t(header.postingsOffset + postings.size());
+
+		auto seg = new Segment;
+		seg->header = header;
+		seg->buffer.resize(header.size);
+
+		auto target = seg->buffer.data();
+		memcpy(target, &header, sizeof(SegmentHeader));
+		if (!docs.empty()) {
+			memcpy(target + header.docsOffset, docs.data(), docs.size() * sizeof(DocEntry));
+		}
+		if (!terms.empty()) {
+			memcpy(target + header.termsOffset, terms.data(), terms.size() * sizeof(TermEntry));
+		}
+		if (!strings.empty()) {
+			memcpy(target + header.stringsOffset, strings.data(), strings.size());
+		}
+		if (!postings.empty()) {
+			memcpy(target + header.postingsOffset, postings.data(), postings.size());
+		}
+		return seg;
+	}
+
+	InvertedIndex::Vector<DocEntry> docs;
+	InvertedIndex::Vector<TermEntry> terms;
+	InvertedIndexBytes strings;
+	InvertedIndexBytes postings;
+	uint64_t totalLength = 0;
+
+	size_t termStart = 0;
+	uint32_t termDocs = 0;
+	uint32_t prevDoc = 0;
+};
+
+struct InvertedIndex_DocSet {
+	InvertedIndex::Vector<uint32_t> docs;
+	bool negated = false;
+};
+
+static InvertedIndex::Vector<uint32_t> InvertedIndex_intersect(const InvertedIndex::Vector<uint32_t> &l, const InvertedIndex::Vector<uint32_t> &r) {
+	InvertedIndex::Vector<uint32_t> ret;
+	std::set_intersection(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(ret));
+	return ret;
+}
+
+static InvertedIndex::Vector<uint32_t> InvertedIndex_unite(const InvertedIndex::Vector<uint32_t> &l, const InvertedIndex::Vector<uint32_t> &r) {
+	InvertedIndex::Vector<uint32_t> ret;
+	std::set_union(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(ret));
+	return ret;
+}
+
+static InvertedIndex::Vector<uint32_t> InvertedIndex_subtract(const InvertedIndex::Vector<uint32_t> &l, const InvertedIndex::Vector<uint32_t> &r) {
+	InvertedIndex::Vector<uint32_t> ret;
+	std::set_difference(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(ret));
+	return ret;
+}
+
+static InvertedIndex::Vector<uint32_t> InvertedIndex_getTermDocs(const InvertedIndex::Segment &seg, StringView term) {
+	InvertedIndex::Vector<uint32_t> ret;
+	InvertedIndex::TermEntry entry;
+	if (seg.findTerm(term, entry)) {
+		ret.reserve(entry.docs);
+		InvertedIndex_Cursor cursor(seg, entry);
+		while (cursor.next()) {
+			ret.emplace_back(cursor.doc);
+		}
+	}
+	return ret;
+}
+
+// same rules as Configuration_isFollow: every next word should follow previous within offset with the same rank
+static bool InvertedIndex_isFollow(InvertedIndex::Vector<InvertedIndex_Cursor> &cursors, const InvertedIndex::Vector<uint32_t> &offsets) {
+	InvertedIndex::Vector<Pair<SearchData::Rank, uint32_t>> path;
+	InvertedIndex_readPositions(cursors.front().positions, [&] (uint32_t pos, SearchData::Rank rank) {
+		path.emplace_back(rank, pos);
+	});
+
+	InvertedIndex::Vector<Pair<uint32_t, SearchData::Rank>> positions;
+	for (size_t i = 1; i < cursors.size() && !path.empty(); ++ i) {
+		auto offset = std::max(offsets[i], uint32_t(1));
+
+		positions.clear();
+		InvertedIndex_readPositions(cursors[i].positions, [&] (uint32_t pos, SearchData::Rank rank) {
+			positions.emplace_back(pos, rank);
+		});
+
+		auto it = path.begin();
+		while (it != path.end()) {
+			auto target = it->second;
+			auto iit = std::upper_bound(positions.begin(), positions.end(), target,
+					[] (uint32_t l, const Pair<uint32_t, SearchData::Rank> &r) {
+				return l < r.first;
+			});
+			while (iit != positions.end() && iit->second != it->first) {
+				++ iit;
+			}
+
+			if (iit != positions.end() && iit->first - target <= offset) {
+				it->second = iit->first;
+				++ it;
+			} else {
+				it = path.erase(it);
+			}
+		}
+	}
+
+	return !path.empty();
+}
+
+static InvertedIndex_DocSet InvertedIndex_evalFollow(const InvertedIndex::Segment &seg, const SearchQuery &q) {
+	InvertedIndex_DocSet ret;
+	InvertedIndex::Vector<InvertedIndex_Cursor> cursors;
+	InvertedIndex::Vector<uint32_t> offsets;
+	for (auto &it : q.args) {
+		InvertedIndex::TermEntry entry;
+		if (!seg.findTerm(it.value, entry)) {
+			return ret;
+		}
+		cursors.emplace_back(seg, entry);
+		offsets.emplace_back(uint32_t(it.offset));
+	}
+
+	if (cursors.empty()) {
+		return ret;
+	}
+
+	uint32_t target = 0;
+	while (true) {
+		bool aligned = true;
+		for (auto &it : cursors) {
+			if (!it.advance(target)) {
+				return ret;
+			}
+			if (it.doc != target) {
+				target = it.doc;
+				aligned = false;
+				break;
+			}
+		}
+
+		if (aligned) {
+			if (InvertedIndex_isFollow(cursors, offsets)) {
+				ret.docs.emplace_back(target);
+			}
+			++ target;
+		}
+	}
+
+	return ret;
+}
+
+static InvertedIndex_DocSet InvertedIndex_eval(const InvertedIndex::Segment &seg, const SearchQuery &q) {
+	InvertedIndex_DocSet ret;
+	if (!q.args.empty()) {
+		switch (q.op) {
+		case SearchOp::None: break;
+		case SearchOp::Not:
+			ret = InvertedIndex_eval(seg, q.args.front());
+			ret.negated = !ret.negated;
+			break;
+		case SearchOp::And: {
+			// a AND NOT b == a \ b; NOT a AND NOT b == NOT (a OR b)
+			bool hasPositive = false;
+			InvertedIndex::Vector<uint32_t> negative;
+			for (auto &it : q.args) {
+				auto tmp = InvertedIndex_eval(seg, it);
+				if (tmp.negated) {
+					negative = InvertedIndex_unite(negative, tmp.docs);
+				} else if (!hasPositive) {
+					ret.docs = move(tmp.docs);
+					hasPositive = true;
+				} else {
+					ret.docs = InvertedIndex_intersect(ret.docs, tmp.docs);
+				}
+				if (hasPositive && ret.docs.empty()) {
+					return ret;
+				}
+			}
+			if (hasPositive) {
+				ret.docs = InvertedIndex_subtract(ret.docs, negative);
+			} else {
+				ret.docs = move(negative);
+				ret.negated = true;
+			}
+			break;
+		}
+		case SearchOp::Or: {
+			// a OR NOT b == NOT (b \ a); NOT a OR NOT b == NOT (a AND b)
+			bool hasNegative = false;
+			InvertedIndex::Vector<uint32_t> positive;
+			for (auto &it : q.args) {
+				auto tmp = InvertedIndex_eval(seg, it);
+				if (!tmp.negated) {
+					positive = InvertedIndex_unite(positive, tmp.docs);
+				} else if (!hasNegative) {
+					ret.docs = move(tmp.docs);
+					hasNegative = true;
+				} else {
+					ret.docs = InvertedIndex_intersect(ret.docs, tmp.docs);
+				}
+			}
+			if (hasNegative) {
+				ret.docs = InvertedIndex_subtract(ret.docs, positive);
+				ret.negated = true;
+			} else {
+				ret.docs = move(positive);
+			}
+			break;
+		}
+		case SearchOp::Follow:
+			ret = InvertedIndex_evalFollow(seg, q);
+			break;
+		}
+	} else if (!q.value.empty()) {
+		ret.docs = InvertedIndex_getTermDocs(seg, q.value);
+		ret.negated = (q.op == SearchOp::Not);
+	}
+	return ret;
+}
+
+static void InvertedIndex_collectStems(const SearchQuery &q, InvertedIndex::Vector<InvertedIndex::String> &stems) {
+	if (q.op == SearchOp::Not) {
+		return;
+	}
+
+	if (!q.args.empty()) {
+		for (auto &it : q.args) {
+			InvertedIndex_collectStems(it, stems);
+		}
+	} else if (!q.value.empty()) {
+		stems.emplace_back(q.value);
+	}
+}
+
+bool InvertedIndex::Segment::init(BytesView data, bool copy) {
+	if (data.size() < sizeof(SegmentHeader)) {
+		return false;
+	}
+
+	memcpy(&header, data.data(), sizeof(SegmentHeader));
+	if (header.magic != Magic || header.version != Version || header.size > data.size()
+			|| header.docsOffset < sizeof(SegmentHeader)
+			|| header.termsOffset < header.docsOffset + uint64_t(header.docs) * sizeof(DocEntry)
+			|| header.stringsOffset < header.termsOffset + uint64_t(header.terms) * sizeof(TermEntry)
+			|| header.postingsOffset < header.stringsOffset
+			|| header.size < header.postingsOffset) {
+		return false;
+	}
+
+	if (copy) {
+		buffer.assign(data.data(), data.data() + header.size);
+		external = BytesView();
+	} else {
+		buffer.clear();
+		external = BytesView(data.data(), header.size);
+	}
+
+	auto stringsSize = header.postingsOffset - header.stringsOffset;
+	auto postingsSize = header.size - header.postingsOffset;
+	for (uint32_t i = 0; i < header.terms; ++ i) {
+		auto entry = getTermEntry(i);
+		if (uint64_t(entry.stringOffset) + entry.stringSize > stringsSize
+				|| uint64_t(entry.postingsOffset) + entry.postingsSize > postingsSize) {
+			return false;
+		}
+
+		// document indexes from postings are used to access doc entries without checks
+		uint32_t count = 0;
+		InvertedIndex_Cursor cursor(*this, entry);
+		while (cursor.next()) {
+			++ count;
+		}
+		if (cursor.failed || count != entry.docs) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+BytesView InvertedIndex::Segment::getData() const {
+	return buffer.empty() ? external : BytesView(buffer);
+}
+
+InvertedIndex::DocEntry InvertedIndex::Segment::getDoc(uint32_t idx) const {
+	DocEntry ret;
+	memcpy(&ret, getData().data() + header.docsOffset + idx * sizeof(DocEntry), sizeof(DocEntry));
+	return ret;
+}
+
+InvertedIndex::TermEntry InvertedIndex::Segment::getTermEntry(uint32_t idx) const {
+	TermEntry ret;
+	memcpy(&ret, getData().data() + header.termsOffset + idx * sizeof(TermEntry), sizeof(TermEntry));
+	return ret;
+}
+
+StringView InvertedIndex::Segment::getTerm(const TermEntry &entry) const {
+	return StringView((const char *)getData().data() + header.stringsOffset + entry.stringOffset, entry.stringSize);
+}
+
+BytesView InvertedIndex::Segment::getPostings(const TermEntry &entry) const {
+	return BytesView(getData().data() + header.postingsOffset + entry.postingsOffset, entry.postingsSize);
+}
+
+bool InvertedIndex::Segment::findTerm(StringView term, TermEntry &entry) const {
+	uint32_t first = 0;
+	uint32_t count = header.terms;
+	while (count > 0) {
+		auto step = count / 2;
+		auto tmp = getTermEntry(first + step);
+		auto c = InvertedIndex_compare(getTerm(tmp), term);
+		if (c == 0) {
+			entry = tmp;
+			return true;
+		} else if (c < 0) {
+			first += step + 1;
+			count -= step + 1;
+		} else {
+			count = step;
+		}
+	}
+	return false;
+}
+
+InvertedIndex::InvertedIndex(const Configuration &cfg) : _config(&cfg) { }
+
+void InvertedIndex::add(int64_t id, StringView str, SearchData::Rank rank) {
+	SearchVector vec;
+	_config->makeSearchVector(vec, str, rank);
+	add(id, vec);
+}
+
+void InvertedIndex::add(int64_t id, const Vector<SearchData> &data) {
+	SearchVector vec;
+	size_t counter = 0;
+	for (auto &it : data) {
+		counter = _config->makeSearchVector(vec, it.buffer, it.rank, counter);
+	}
+	add(id, vec);
+}
+
+void InvertedIndex::add(int64_t id, const SearchVector &vec) {
+	auto doc = uint32_t(_pendingDocs.size());
+	auto &entry = _pendingDocs.emplace_back();
+	entry.id = id;
+
+	for (auto &it : vec) {
+		entry.length += uint32_t(it.second.size());
+
+		auto iit = _pendingTerms.find(it.first);
+		if (iit == _pendingTerms.end()) {
+			iit = _pendingTerms.emplace(it.first, Vector<PendingPosting>()).first;
+		}
+		iit->second.emplace_back(PendingPosting{doc, it.second});
+	}
+}
+
+void InvertedIndex::commit() {
+	if (_pendingDocs.empty()) {
+		return;
+	}
+
+	InvertedIndex_Writer writer;
+	writer.docs = move(_pendingDocs);
+	for (auto &it : writer.docs) {
+		writer.totalLength += it.length;
+	}
+
+	InvertedIndexBytes positions;
+	for (auto &it : _pendingTerms) {
+		for (auto &p : it.second) {
+			uint32_t prev = 0;
+			positions.clear();
+			for (auto &pos : p.positions) {
+				InvertedIndex_writeVarint(positions, (uint64_t(pos.first - prev) << 3) | uint64_t(toInt(pos.second)));
+				prev = uint32_t(pos.first);
+			}
+			writer.pushDoc(p.doc, uint32_t(p.positions.size()), positions);
+		}
+		writer.pushTerm(it.first);
+	}
+
+	_pendingDocs.clear();
+	_pendingTerms.clear();
+
+	_segments.emplace_back(writer.finalize());
+
+	if (_mergeFactor > 0 && _segments.size() > _mergeFactor) {
+		merge();
+	}
+}
+
+void InvertedIndex::merge() {
+	if (_segments.size() <= 1) {
+		return;
+	}
+
+	InvertedIndex_Writer writer;
+
+	Vector<uint32_t> bases;
+	Vector<uint32_t> terms;
+	bases.reserve(_segments.size());
+	terms.reserve(_segments.size());
+	for (auto &seg : _segments) {
+		bases.emplace_back(uint32_t(writer.docs.size()));
+		terms.emplace_back(0);
+		for (uint32_t i = 0; i < seg->header.docs; ++ i) {
+			writer.docs.emplace_back(seg->getDoc(i));
+		}
+		writer.totalLength += seg->header.totalLength;
+	}
+
+	// k-way merge of sorted term tables, postings are re-based with segment's first document
+	while (true) {
+		bool found = false;
+		StringView term;
+		for (size_t i = 0; i < _segments.size(); ++ i) {
+			if (terms[i] < _segments[i]->header.terms) {
+				auto t = _segments[i]->getTerm(_segments[i]->getTermEntry(terms[i]));
+				if (!found || InvertedIndex_compare(t, term) < 0) {
+					term = t;
+					found = true;
+				}
+			}
+		}
+
+		if (!found) {
+			break;
+		}
+
+		for (size_t i = 0; i < _segments.size(); ++ i) {
+			auto seg = _segments[i];
+			if (terms[i] < seg->header.terms) {
+				auto entry = seg->getTermEntry(terms[i]);
+				if (seg->getTerm(entry) == term) {
+					InvertedIndex_Cursor cursor(*seg, entry);
+					while (cursor.next()) {
+						writer.pushDoc(bases[i] + cursor.doc, cursor.freq, cursor.positions);
+					}
+					++ terms[i];
+				}
+			}
+		}
+
+		writer.pushTerm(term);
+	}
+
+	auto seg = writer.finalize();
+	for (auto &it : _segments) {
+		it->buffer.clear();
+	}
+	_segments.clear();
+	_segments.emplace_back(seg);
+}
+
+BytesView InvertedIndex::encode() {
+	commit();
+	merge();
+	if (_segments.empty()) {
+		_segments.emplace_back(InvertedIndex_Writer().finalize());
+	}
+	return _segments.front()->getData();
+}
+
+bool InvertedIndex::load(BytesView data, bool copy) {
+	auto seg = new Segment;
+	if (!seg->init(data, copy)) {
+		log::text("InvertedIndex", "Invalid segment data");
+		return false;
+	}
+
+	_segments.emplace_back(seg);
+	return true;
+}
+
+auto InvertedIndex::performSearch(StringView str, size_t limit) const -> Vector<Result> {
+	return performSearch(_config->parseQuery(str), limit);
+}
+
+auto InvertedIndex::performSearch(const SearchQuery &q, size_t limit) const -> Vector<Result> {
+	Vector<Result> ret;
+
+	uint64_t docsCount = 0;
+	uint64_t totalLength = 0;
+	for (auto &it : _segments) {
+		docsCount += it->header.docs;
+		totalLength += it->header.totalLength;
+	}
+
+	if (docsCount == 0) {
+		return ret;
+	}
+
+	auto stems = getQueryStems(q);
+	auto avgLength = std::max(float(totalLength) / float(docsCount), 1.0f);
+
+	Vector<float> idf;
+	idf.reserve(stems.size());
+	for (auto &stem : stems) {
+		uint64_t df = 0;
+		for (auto &it : _segments) {
+			TermEntry entry;
+			if (it->findTerm(stem, entry)) {
+				df += entry.docs;
+			}
+		}
+		idf.emplace_back(logf(1.0f + (float(docsCount - df) + 0.5f) / (float(df) + 0.5f)));
+	}
+
+	Vector<float> scores;
+	for (auto &seg : _segments) {
+		auto set = InvertedIndex_eval(*seg, q);
+		if (set.negated) {
+			Vector<uint32_t> docs;
+			auto it = set.docs.begin();
+			for (uint32_t i = 0; i < seg->header.docs; ++ i) {
+				while (it != set.docs.end() && *it < i) {
+					++ it;
+				}
+				if (it == set.docs.end() || *it != i) {
+					docs.emplace_back(i);
+				}
+			}
+			set.docs = move(docs);
+		}
+
+		if (set.docs.empty()) {
+			continue;
+		}
+
+		scores.clear();
+		scores.resize(set.docs.size(), 0.0f);
+
+		for (size_t i = 0; i < stems.size(); ++ i) {
+			TermEntry entry;
+			if (!seg->findTerm(stems[i], entry)) {
+				continue;
+			}
+
+			InvertedIndex_Cursor cursor(*seg, entry);
+			for (size_t j = 0; j < set.docs.size(); ++ j) {
+				if (!cursor.advance(set.docs[j])) {
+					break;
+				}
+				if (cursor.doc != set.docs[j]) {
+					continue;
+				}
+
+				float tf = 0.0f;
+				InvertedIndex_readPositions(cursor.positions, [&] (uint32_t, SearchData::Rank rank) {
+					tf += _scoring.rank[std::min(toInt(rank), toInt(SearchData::Rank::Unknown))];
+				});
+
+				auto length = float(seg->getDoc(set.docs[j]).length);
+				scores[j] += idf[i] * (tf * (_scoring.k1 + 1.0f))
+						/ (tf + _scoring.k1 * (1.0f - _scoring.b + _scoring.b * length / avgLength));
+			}
+		}
+
+		for (size_t j = 0; j < set.docs.size(); ++ j) {
+			ret.emplace_back(Result{seg->getDoc(set.docs[j]).id, scores[j]});
+		}
+	}
+
+	std::stable_sort(ret.begin(), ret.end(), [] (const Result &l, const Result &r) {
+		return l.score > r.score;
+	});
+
+	if (limit > 0 && ret.size() > limit) {
+		ret.resize(limit);
+	}
+
+	return ret;
+}
+
+auto InvertedIndex::getQueryStems(const SearchQuery &q) const -> Vector<String> {
+	Vector<String> ret;
+	InvertedIndex_collectStems(q, ret);
+	std::sort(ret.begin(), ret.end());
+	ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+	return ret;
+}
+
+auto InvertedIndex::makeHeadline(const HeadlineConfig &cfg, StringView origin, const SearchQuery &q) const -> String {
+	return _config->makeHeadline(cfg, origin, getQueryStems(q));
+}
+
+size_t InvertedIndex::getDocumentsCount() const {
+	size_t ret = _pendingDocs.size();
+	for (auto &it : _segments) {
+		ret += it->header.docs;
+	}
+	return ret;
+}
+
+}
@@ -0,0 +1,175 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#ifndef COMPONENTS_COMMON_UTILS_SEARCH_SPSEARCHINVERTEDINDEX_H_
+#define COMPONENTS_COMMON_UTILS_SEARCH_SPSEARCHINVERTEDINDEX_H_
+
+#include "SPSearchConfiguration.h"
+
+namespace stappler::search {
+
+/* Embeddable inverted index over Configuration search vectors
+ *
+ * Documents are collected in memory and flushed into immutable segments with commit().
+ * Segment is a single flat buffer (host byte order), that can be used in place
+ * (e.g. directly from mmap-ed file) without decoding:
+ *
+ * header | documents table | terms table (sorted) | terms strings | postings
+ *
+ * Posting list for term is a sequence of documents, each encoded as
+ * varint(docDelta) varint(freq) varint(positionsSize) positions,
+ * where every position is varint((positionDelta << 3) | rank)
+ *
+ * Queries are SearchQuery trees from Configuration::parseQuery with same semantics as
+ * Configuration::isMatch; Follow (phrase) operator is checked with positional data.
+ * Results are ranked with BM25, term frequency is weighted by SearchData::Rank
+ */
+class InvertedIndex : public memory::AllocPool {
+public:
+	template <typename K, typename V>
+	using Map = Configuration::Map<K, V>;
+
+	template <typename T>
+	using Vector = Configuration::Vector<T>;
+
+	using String = Configuration::String;
+	using SearchVector = Configuration::SearchVector;
+	using HeadlineConfig = Configuration::HeadlineConfig;
+
+	static constexpr uint32_t Magic = 0x49495053; // 'SPII'
+	static constexpr uint32_t Version = 1;
+	static constexpr size_t DefaultMergeFactor = 8;
+
+	struct SegmentHeader {
+		uint32_t magic = Magic;
+		uint32_t version = Version;
+		uint32_t docs = 0;
+		uint32_t terms = 0;
+		uint64_t totalLength = 0;
+		uint32_t docsOffset = 0;
+		uint32_t termsOffset = 0;
+		uint32_t stringsOffset = 0;
+		uint32_t postingsOffset = 0;
+		uint32_t size = 0;
+		uint32_t reserved = 0;
+	};
+
+	struct DocEntry {
+		int64_t id = 0;
+		uint32_t length = 0;
+		uint32_t reserved = 0;
+	};
+
+	struct TermEntry {
+		uint32_t stringOffset = 0;
+		uint32_t stringSize = 0;
+		uint32_t postingsOffset = 0;
+		uint32_t postingsSize = 0;
+		uint32_t docs = 0;
+	};
+
+	struct Segment : memory::AllocPool {
+		BytesView external;
+		Vector<uint8_t> buffer;
+		SegmentHeader header;
+
+		bool init(BytesView, bool copy);
+
+		BytesView getData() const;
+		DocEntry getDoc(uint32_t) const;
+		TermEntry getTermEntry(uint32_t) const;
+		StringView getTerm(const TermEntry &) const;
+		BytesView getPostings(const TermEntry &) const;
+
+		bool findTerm(StringView, TermEntry &) const;
+	};
+
+	struct Scoring {
+		float k1 = 1.2f;
+		float b = 0.75f;
+
+		// term frequency weight for SearchData::Rank (A, B, C, D, Unknown), as in ts_rank
+		float rank[5] = { 1.0f, 0.4f, 0.2f, 0.1f, 0.1f };
+	};
+
+	struct Result {
+		int64_t id = 0;
+		float score = 0.0f;
+	};
+
+	InvertedIndex(const Configuration &);
+
+	const Configuration &getConfiguration() const { return *_config; }
+
+	void setScoring(const Scoring &s) { _scoring = s; }
+	const Scoring &getScoring() const { return _scoring; }
+
+	// commit() merges all segments, when their number exceeds merge factor; 0 to disable
+	void setMergeFactor(size_t v) { _mergeFactor = v; }
+	size_t getMergeFactor() const { return _mergeFactor; }
+
+	void add(int64_t id, StringView, SearchData::Rank = SearchData::Rank::Unknown);
+	void add(int64_t id, const Vector<SearchData> &);
+	void add(int64_t id, const SearchVector &);
+
+	// flush pending documents into new segment
+	void commit();
+
+	// merge all segments into one
+	void merge();
+
+	// commit and merge, then return flat segment data, suitable for load()
+	BytesView encode();
+
+	// with copy == false data should be valid until index is destroyed (e.g. mmap-ed file)
+	bool load(BytesView, bool copy = true);
+
+	Vector<Result> performSearch(StringView, size_t limit = 0) const;
+	Vector<Result> performSearch(const SearchQuery &, size_t limit = 0) const;
+
+	// sorted unique stems, that was not negated in query
+	Vector<String> getQueryStems(const SearchQuery &) const;
+
+	String makeHeadline(const HeadlineConfig &, StringView origin, const SearchQuery &) const;
+
+	size_t getSegmentsCount() const { return _segments.size(); }
+	size_t getDocumentsCount() const;
+	size_t getPendingCount() const { return _pendingDocs.size(); }
+
+protected:
+	struct PendingPosting {
+		uint32_t doc;
+		Vector<Pair<size_t, SearchData::Rank>> positions;
+	};
+
+	const Configuration *_config = nullptr;
+	Scoring _scoring;
+	size_t _mergeFactor = DefaultMergeFactor;
+
+	Vector<DocEntry> _pendingDocs;
+	Map<String, Vector<PendingPosting>> _pendingTerms;
+	Vector<Segment *> _segments;
+};
+
+}
+
+#endif /* COMPONENTS_COMMON_UTILS_SEARCH_SPSEARCHINVERTEDINDEX_H_ */
@@ -55,6 +55,79 @@ static const StringView *getLanguageStopwords(Language lang) {
 	return nullptr;
 }
 
+// Collision-free hash table for builtin stopwords lists, built once on first use:
+// seed and size are selected, so every word has it's own slot, and lookup costs one hash and one compare
+struct StopwordsTable {
+	static uint32_t hash(StringView word, uint32_t seed) {
+		return (hash::hash32(word.data(), word.size()) ^ seed) * 0x9E3779B1u;
+	}
+
+	void init(const StringView *list) {
+		source = list;
+		if (!list) {
+			return;
+		}
+
+		size_t count = 0;
+		while (!list[count].empty()) {
+			++ count;
+		}
+
+		uint32_t bits = 1;
+		while ((size_t(1) << bits) < count * 2) {
+			++ bits;
+		}
+
+		while (true) {
+			slots.assign(size_t(1) << bits, nullptr);
+			for (seed = 0; seed < 64; ++ seed) {
+				std::fill(slots.begin(), slots.end(), nullptr);
+				bool success = true;
+				for (size_t i = 0; i < count; ++ i) {
+					auto &slot = slots[hash(list[i], seed) >> (32 - bits)];
+					if (slot && *slot != list[i]) {
+						success = false;
+						break;
+					}
+					slot = &list[i];
+				}
+				if (success) {
+					shift = 32 - bits;
+					return;
+				}
+			}
+			++ bits;
+		}
+	}
+
+	bool contains(StringView word) const {
+		auto slot = slots[hash(word, seed) >> shift];
+		return slot && *slot == word;
+	}
+
+	const StringView *source = nullptr;
+	uint32_t seed = 0;
+	uint32_t shift = 0;
+	std::vector<const StringView *> slots;
+};
+
+static const StopwordsTable *getStopwordsTable(const StringView *stopwords) {
+	static std::array<StopwordsTable, toInt(Language::Simple) + 1> s_tables = [] {
+		std::array<StopwordsTable, toInt(Language::Simple) + 1> ret;
+		for (size_t i = 0; i < ret.size(); ++ i) {
+			ret[i].init(getLanguageStopwords(Language(i)));
+		}
+		return ret;
+	}();
+
+	for (auto &it : s_tables) {
+		if (it.source == stopwords) {
+			return &it;
+		}
+	}
+	return nullptr;
+}
+
 StringView SearchData::getLanguage() const {
 	return getLanguageName(language);
 }
@@ -903,6 +976,10 @@ bool isStopword(const StringView &word, StemmerEnv *env) {
 
 bool isStopword(const StringView &word, const StringView *stopwords) {
 	if (stopwords) {
+		if (auto table = getStopwordsTable(stopwords)) {
+			return table->contains(word);
+		}
+
 		while (stopwords && !stopwords->empty()) {
 			if (word == *stopwords) {
 				return true;
@@ -914,15 +991,123 @@ bool isStopword(const StringView &word, const StringView *stopwords) {
 	return false;
 }
 
+// Per-thread direct-mapped cache for stemmer results (including stopwords), keyed by language and word
+// Stemming is pure function of word and language, so cache is shared between all stemmer envs on thread
+struct StemCache {
+	static constexpr size_t WordSize = 30;
+
+	struct Slot {
+		uint32_t hash = 0;
+		Language lang = Language::Unknown;
+		uint8_t wordSize = 0;
+		uint8_t stemSize = 0;
+		bool stopword = false;
+		char word[WordSize];
+		char stem[WordSize];
+	};
+
+	static StemCache *get() {
+		static thread_local StemCache tl_cache;
+		auto size = s_stemCacheSize.load();
+		if (tl_cache.slots.size() != size) {
+			tl_cache.slots.clear();
+			tl_cache.slots.resize(size);
+		}
+		return tl_cache.slots.empty() ? nullptr : &tl_cache;
+	}
+
+	Slot *find(StringView word, Language lang, uint32_t hash) {
+		auto &slot = slots[hash & (slots.size() - 1)];
+		if (slot.hash == hash && slot.lang == lang && slot.wordSize == word.size() && memcmp(slot.word, word.data(), word.size()) == 0) {
+			return &slot;
+		}
+		return nullptr;
+	}
+
+	void store(StringView word, Language lang, uint32_t hash, bool stopword, StringView stem) {
+		if (stem.size() > WordSize) {
+			return;
+		}
+
+		auto &slot = slots[hash & (slots.size() - 1)];
+		slot.hash = hash;
+		slot.lang = lang;
+		slot.wordSize = uint8_t(word.size());
+		slot.stemSize = uint8_t(stem.size());
+		slot.stopword = stopword;
+		memcpy(slot.word, word.data(), word.size());
+		memcpy(slot.stem, stem.data(), stem.size());
+	}
+
+	static std::atomic<size_t> s_stemCacheSize;
+
+	std::vector<Slot> slots;
+};
+
+std::atomic<size_t> StemCache::s_stemCacheSize = StemCacheDefaultSize;
+
+void setStemCacheSize(size_t size) {
+	size_t ret = 0;
+	if (size > 0) {
+		ret = 1;
+		while (ret < size) {
+			ret <<= 1;
+		}
+	}
+	StemCache::s_stemCacheSize.store(ret);
+}
+
+size_t getStemCacheSize() {
+	return StemCache::s_stemCacheSize.load();
+}
+
 bool stemWord(StringView word, const Callback<void(StringView)> &cb, StemmerEnv *env) {
+	StemCache *cache = nullptr;
+	uint32_t hash = 0;
+	if (word.size() <= StemCache::WordSize && env->mod) {
+		if ((cache = StemCache::get())) {
+			hash = hash::hash32(word.data(), word.size());
+			if (auto slot = cache->find(word, env->mod->name, hash)) {
+				if (slot->stopword) {
+					return false;
+				}
+				cb(StringView(slot->stem, slot->stemSize));
+				return true;
+			}
+		}
+	}
+
 	if (isStopword(word, env)) {
+		if (cache) {
+			cache->store(word, env->mod->name, hash, true, StringView());
+		}
 		return false;
 	}
 	auto w = sb_stemmer_stem(env, (const unsigned char *)word.data(), int(word.size()));
-	cb(StringView((const char *)w,  size_t(env->l)));
+	auto stem = StringView((const char *)w,  size_t(env->l));
+	if (cache) {
+		cache->store(word, env->mod->name, hash, false, stem);
+	}
+	cb(stem);
 	return true;
 }
 
+bool stemWords(SpanView<StringView> words, const Callback<void(StringView word, StringView stem)> &cb, StemmerEnv *env) {
+	memory::PoolInterface::VectorType<StringView> list(words.begin(), words.end());
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+
+	bool ret = false;
+	for (auto &it : list) {
+		if (stemWord(it, [&] (StringView stem) {
+			cb(it, stem);
+		}, env)) {
+			ret = true;
+		}
+	}
+	return ret;
+}
+
 bool stemWord(StringView word, const Callback<void(StringView)> &cb, Language lang) {
 	if (lang == Language::Unknown) {
 		lang = detectLanguage(word);
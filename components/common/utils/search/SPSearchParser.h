@@ -24,6 +24,7 @@ THE SOFTWARE.
 #define COMPONENTS_COMMON_UTILS_SEARCH_SPSEARCHPARSER_H_
 
 #include "SPStringView.h"
+#include "SPSpanView.h"
 
 namespace stappler::search {
 
@@ -186,6 +187,15 @@ StemmerEnv *getStemmer(Language lang);
 bool stemWord(StringView word, const Callback<void(StringView)> &, StemmerEnv *env);
 bool stemWord(StringView word, const Callback<void(StringView)> &, Language lang = Language::Unknown);
 
+// stem every unique word from list only once, callback receives source word and it's stem
+bool stemWords(SpanView<StringView> words, const Callback<void(StringView word, StringView stem)> &, StemmerEnv *env);
+
+// stemmer results are cached per thread for every language; size is number of cached words, 0 to disable
+static constexpr size_t StemCacheDefaultSize = 4096;
+
+void setStemCacheSize(size_t);
+size_t getStemCacheSize();
+
 // lowercase, remove soft hyphens
 mem_pool::String normalizeWord(const StringView &str);
 
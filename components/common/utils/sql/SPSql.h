@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "SPString.h"
 #include "SPData.h"
+#include <shared_mutex>
 
 NS_SP_EXT_BEGIN(sql)
 
@@ -70,10 +71,90 @@ struct SimpleBinder : public AllocBase {
 		stream << val;
 	}
 	void writeBind(std::ostream &stream, const Bytes &val) {
-		stream << base16::encode(val);
+		base16::encode(stream, val);
 	}
 };
 
+/* Query shape: parameterized SQL text, produced once by a regular builder with every
+ * variable value bound as a placeholder. Later queries of the same shape reuse the text
+ * and only bind their parameters. Shape key is stable within a process, so drivers
+ * can use it to name server-side prepared statements */
+struct QueryShape : AllocBase {
+	uint64_t key = 0;
+	std::string text;
+	size_t params = 0;
+};
+
+/* Incremental FNV-1 key for query shapes, built from scheme and field names
+ * without writing query text */
+struct QueryShapeKey {
+	uint64_t value = hash::_fnv_offset_basis<uint64_t>();
+
+	QueryShapeKey &add(const StringView &str) {
+		for (size_t i = 0; i < str.size(); ++ i) {
+			value *= hash::_fnv_prime<uint64_t>();
+			value ^= uint8_t(str.data()[i]);
+		}
+		// separator, so ("ab", "c") and ("a", "bc") produce different keys
+		value *= hash::_fnv_prime<uint64_t>();
+		value ^= 0xFF;
+		return *this;
+	}
+
+	QueryShapeKey &add(uint64_t val) {
+		for (size_t i = 0; i < sizeof(uint64_t); ++ i) {
+			value *= hash::_fnv_prime<uint64_t>();
+			value ^= uint8_t(val >> (i * 8));
+		}
+		return *this;
+	}
+
+	// zero key is reserved for queries without shape
+	uint64_t get() const { return value ? value : 1; }
+};
+
+/* Process-wide thread-safe storage for query shapes. Shapes are never removed,
+ * so pointers, returned by cache, are valid for a process lifetime */
+class QueryShapeCache : public AllocBase {
+public:
+	static constexpr size_t MaxShapes = 1024;
+
+	const QueryShape *get(uint64_t key) const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		auto it = _shapes.find(key);
+		if (it != _shapes.end()) {
+			return it->second.get();
+		}
+		return nullptr;
+	}
+
+	// returns nullptr when cache is full; caller should build query text as usual
+	const QueryShape *emplace(uint64_t key, const StringView &text, size_t params) {
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		auto it = _shapes.find(key);
+		if (it != _shapes.end()) {
+			return it->second.get();
+		}
+		if (_shapes.size() >= MaxShapes) {
+			return nullptr;
+		}
+		auto shape = std::make_unique<QueryShape>();
+		shape->key = key;
+		shape->text.assign(text.data(), text.size());
+		shape->params = params;
+		return _shapes.emplace(key, move(shape)).first->second.get();
+	}
+
+	size_t size() const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		return _shapes.size();
+	}
+
+protected:
+	mutable std::shared_mutex _mutex;
+	std::unordered_map<uint64_t, std::unique_ptr<QueryShape>> _shapes;
+};
+
 template <typename Binder, typename Interface = memory::DefaultInterface>
 class Query : public AllocBase {
 public:
@@ -474,11 +555,16 @@ public:
 
 	StringView getTarget() const;
 
+	// when shape is set, driver uses shape text, and stream contains only bound placeholders
+	void setShape(const QueryShape *);
+	const QueryShape *getShape() const;
+
 protected:
 	FinalizationState finalization = FinalizationState::None;
 	Binder binder;
 	Stream stream;
 	StringView target;
+	const QueryShape *shape = nullptr;
 	bool subquery = false;
 };
 
@@ -591,6 +677,16 @@ auto Query<Binder, Interface>::getTarget() const -> StringView {
 	return target;
 }
 
+template <typename Binder, typename Interface>
+void Query<Binder, Interface>::setShape(const QueryShape *s) {
+	shape = s;
+}
+
+template <typename Binder, typename Interface>
+auto Query<Binder, Interface>::getShape() const -> const QueryShape * {
+	return shape;
+}
+
 template <typename Binder, typename Interface>
 void Query<Binder, Interface>::finalize() {
 	if (subquery) {
@@ -49,17 +49,19 @@ protected:
 	TaskQueue *_queue;
 	std::thread::id _threadId;
 	std::atomic<int32_t> _refCount;
-	std::atomic_flag _shouldQuit;
+	std::atomic<bool> _shouldQuit; // set in constructor, so, release before thread started is not lost
 	memory::pool_t *_pool = nullptr;
 	memory::pool_t *_rootPool = nullptr;
 
 	uint32_t _managerId;
 	uint32_t _workerId;
 	StringView _name;
-	std::thread _thread;
 
 	std::mutex _localMutex;
 	std::vector<Rc<Task>> _localQueue;
+
+	// thread is started in constructor, so it should be initialized after all other members
+	std::thread _thread;
 };
 
 thread_local ThreadInfo tl_threadInfo;
@@ -163,7 +165,7 @@ TaskQueue::~TaskQueue() {
 
 void TaskQueue::finalize() {
 	_finalized = true;
-	_sleepCondition.notify_all();
+	wakeup(true);
 }
 
 void TaskQueue::performAsync(Rc<Task> &&task) {
@@ -194,7 +196,7 @@ void TaskQueue::perform(Rc<Task> &&task) {
 	_inputQueue.push_back(std::move(task));
 	_inputMutex.unlock();
 
-	_sleepCondition.notify_one();
+	wakeup(false);
 }
 
 void TaskQueue::perform(Map<uint32_t, Vector<Rc<Task>>> &&tasks) {
@@ -219,7 +221,7 @@ void TaskQueue::perform(Map<uint32_t, Vector<Rc<Task>>> &&tasks) {
 		}
 	}
 
-	_sleepCondition.notify_all();
+	wakeup(true);
 }
 
 void TaskQueue::performWithPriority(Rc<Task> &&task, bool performFirst) {
@@ -257,7 +259,7 @@ void TaskQueue::performWithPriority(Rc<Task> &&task, bool performFirst) {
 	}
 	_inputMutex.unlock();
 
-	_sleepCondition.notify_one();
+	wakeup(false);
 }
 
 Rc<Task> TaskQueue::popTask(uint32_t idx) {
@@ -328,10 +330,7 @@ void TaskQueue::onMainThreadWorker(Rc<Task> &&task) {
 }
 
 void TaskQueue::wait() {
-	if (_finalized.load() != true) {
-		std::unique_lock<std::mutex> sleepLock(_sleepMutex);
-		_sleepCondition.wait(sleepLock);
-	}
+	wait(getWakeupCounter());
 }
 
 bool TaskQueue::spawnWorkers() {
@@ -359,7 +358,7 @@ void TaskQueue::cancelWorkers() {
 		it->release();
 	}
 
-	_sleepCondition.notify_all();
+	wakeup(true);
 
 	for (auto &it : _workers) {
 		it->getThread().join();
@@ -376,6 +375,28 @@ void TaskQueue::performAll() {
 	cancelWorkers();
 }
 
+uint64_t TaskQueue::getWakeupCounter() {
+	std::unique_lock<std::mutex> sleepLock(_sleepMutex);
+	return _wakeupCounter;
+}
+
+void TaskQueue::wait(uint64_t wakeupCounter) {
+	std::unique_lock<std::mutex> sleepLock(_sleepMutex);
+	_sleepCondition.wait(sleepLock, [&] {
+		return _finalized.load() || _wakeupCounter != wakeupCounter;
+	});
+}
+
+void TaskQueue::wakeup(bool all) {
+	std::unique_lock<std::mutex> sleepLock(_sleepMutex);
+	++ _wakeupCounter;
+	if (all) {
+		_sleepCondition.notify_all();
+	} else {
+		_sleepCondition.notify_one();
+	}
+}
+
 void TaskQueue::waitForAll(TimeInterval iv) {
 	update();
 	while (tasksCounter.load() != 0) {
@@ -387,7 +408,7 @@ void TaskQueue::waitForAll(TimeInterval iv) {
 
 
 Worker::Worker(TaskQueue *queue, uint32_t threadId, uint32_t workerId, const StringView &name, memory::pool_t *p)
-: _queue(queue), _refCount(1), _shouldQuit(), _rootPool(p), _managerId(threadId), _workerId(workerId), _name(name)
+: _queue(queue), _refCount(1), _shouldQuit(false), _rootPool(p), _managerId(threadId), _workerId(workerId), _name(name)
 , _thread(ThreadHandlerInterface::workerThread, this, queue) {
 	_queue->retain();
 }
@@ -402,7 +423,7 @@ void Worker::retain() {
 
 void Worker::release() {
 	if (--_refCount <= 0) {
-		_shouldQuit.clear();
+		_shouldQuit.store(true);
 	}
 }
 
@@ -418,7 +439,6 @@ void Worker::threadInit() {
 	memory::pool::initialize();
 	_pool = memory::pool::create((memory::pool_t *)_rootPool);
 
-	_shouldQuit.test_and_set();
 	_threadId = std::this_thread::get_id();
 
 	tl_threadInfo.threadId = _managerId;
@@ -428,7 +448,11 @@ void Worker::threadInit() {
 }
 
 bool Worker::worker() {
-	if (!_shouldQuit.test_and_set()) {
+	// counter is taken before queues are checked, so task or release, that comes after check,
+	// prevents worker from sleeping
+	auto wakeupCounter = _queue->getWakeupCounter();
+
+	if (_shouldQuit.load()) {
 		memory::pool::destroy(_pool);
 		memory::pool::terminate();
 		return false;
@@ -450,7 +474,7 @@ bool Worker::worker() {
 	}
 
 	if (!task) {
-		_queue->wait();
+		_queue->wait(wakeupCounter);
 		return true;
 	}
 
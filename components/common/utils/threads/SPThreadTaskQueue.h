@@ -79,8 +79,15 @@ protected:
 	Rc<Task> popTask(uint32_t idx);
 	void onMainThreadWorker(Rc<Task> &&task);
 
+	// wakeup counter is changed under sleep mutex with every notification; worker takes it before it checks
+	// for tasks and sleeps only while it's unchanged, so notification between check and sleep is not lost
+	uint64_t getWakeupCounter();
+	void wait(uint64_t wakeupCounter);
+	void wakeup(bool all);
+
 	std::mutex _sleepMutex;
 	std::condition_variable _sleepCondition;
+	uint64_t _wakeupCounter = 0;
 
 	std::mutex _inputMutex;
 	std::vector<Rc<Task>> _inputQueue;
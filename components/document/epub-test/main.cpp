@@ -0,0 +1,264 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPData.h"
+#include "SPFilesystem.h"
+#include "SPTime.h"
+#include "SPThreadTaskQueue.h"
+#include "EpubDocument.h"
+#include "SLBuilder.h"
+#include "SLFontLibrary.h"
+
+#include <sys/resource.h>
+
+NS_SP_EXT_BEGIN(app)
+
+// current resident set size, in KiB
+static size_t getCurrentRss() {
+	size_t pages = 0, resident = 0;
+	if (auto f = fopen("/proc/self/statm", "r")) {
+		if (fscanf(f, "%zu %zu", &pages, &resident) != 2) {
+			resident = 0;
+		}
+		fclose(f);
+	}
+	return resident * size_t(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+// peak resident set size, in KiB
+static size_t getPeakRss() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		return size_t(usage.ru_maxrss);
+	}
+	return 0;
+}
+
+// Measures time to first page (time before root page is available for layout) and memory of opened document;
+// with 'eager' all spine documents are parsed just after opening, as it was done before on-demand parsing
+bool processFile(StringView path, bool eager, size_t budget) {
+	auto rssStart = getCurrentRss();
+	auto start = Time::now();
+
+	auto doc = Rc<epub::Document>::create(layout::FilePath(path));
+	if (!doc || !doc->prepare()) {
+		std::cout << "==== " << path << ": fail to open\n";
+		return false;
+	}
+
+	doc->setMemoryBudget(budget);
+
+	auto &spine = static_cast<const layout::Document *>(doc.get())->getSpine(); // paths of linear spine pages
+	if (eager) {
+		doc->setPrefetchWindow(0);
+		for (auto &it : spine) {
+			doc->getContentPage(it);
+		}
+	}
+
+	auto root = doc->getRoot();
+	auto firstPage = Time::now() - start;
+	auto rssFirstPage = getCurrentRss();
+
+	// sequential reading: every page is requested in spine order and used while pages are locked,
+	// like layout builder does; pages, requested without lock, are never released
+	for (auto &it : spine) {
+		doc->lockPages();
+		doc->getContentPage(it);
+		doc->unlockPages();
+	}
+
+	auto allPages = Time::now() - start;
+
+	std::cout << "==== " << path << (eager ? " (eager)" : " (on demand)") << "\n"
+			<< "\tspine: " << spine.size() << " items, root: " << (root ? "yes" : "no") << "\n"
+			<< "\ttime to first page: " << firstPage.toMicros() / 1000.0 << " ms\n"
+			<< "\ttime to read all pages: " << allPages.toMicros() / 1000.0 << " ms\n"
+			<< "\trss at first page: " << (rssFirstPage - std::min(rssFirstPage, rssStart)) << " KiB\n"
+			<< "\trss after reading: " << (getCurrentRss() - std::min(getCurrentRss(), rssStart)) << " KiB\n"
+			<< "\tpeak rss: " << getPeakRss() << " KiB\n"
+			<< "\tparsed pages memory: " << doc->getPagesMemory() / 1024 << " KiB\n";
+	return true;
+}
+
+// Font source for layout test: every family is drawn with single font file; FreeType faces can not be
+// shared between threads, so, every thread uses it's own interface, like font library of application does
+class TestFontSource : public layout::FontSource {
+public:
+	virtual ~TestFontSource() { }
+
+	bool init(const String &font) {
+		FontFaceMap faces;
+		faces.emplace("default", Vector<layout::FontFace>{layout::FontFace(String(font))});
+		if (!layout::FontSource::init(move(faces), nullptr)) {
+			return false;
+		}
+
+		_metricCallback = [font] (const layout::FontSource *source, const Vector<layout::FontFace::FontFaceSource> &srcs,
+				uint16_t size, const layout::ReceiptCallback &cb) {
+			return getInterface(font)->requestMetrics(source, srcs, size, cb);
+		};
+
+		_layoutCallback = [font] (const layout::FontSource *source, const Vector<layout::FontFace::FontFaceSource> &srcs,
+				const Rc<layout::FontData> &data, const Vector<char16_t> &chars, const layout::ReceiptCallback &cb) {
+			return getInterface(font)->requestLayoutUpgrade(source, srcs, data, chars, cb);
+		};
+
+		return true;
+	}
+
+protected:
+	static layout::FreeTypeInterface *getInterface(const String &font) {
+		static thread_local Rc<layout::FreeTypeInterface> tl_interface;
+		if (!tl_interface) {
+			tl_interface = Rc<layout::FreeTypeInterface>::create(font);
+		}
+		return tl_interface;
+	}
+};
+
+// Lays out document as book pages and returns serialized result; without queue spine is laid out sequentially
+static Bytes renderDocument(epub::Document *doc, layout::FontSource *fonts, thread::TaskQueue *queue) {
+	layout::MediaParameters media;
+	media.surfaceSize = layout::Size(600.0f, 800.0f);
+	media.flags = layout::RenderFlag::PaginatedLayout;
+
+	layout::Builder builder(doc, media, fonts);
+	builder.setLayoutQueue(queue);
+	builder.render();
+
+	// cache data stores every object of result, so, equal data means equal layout
+	return builder.getResult()->encodeCache(1);
+}
+
+// Checks, that concurrent layout of spine items gives exactly the same result, as sequential layout;
+// same queue is used for two renders, as it's used by renderer of application
+bool processLayout(StringView path, StringView font, uint16_t threads) {
+	auto doc = Rc<epub::Document>::create(layout::FilePath(path));
+	if (!doc || !doc->prepare()) {
+		std::cout << "==== " << path << ": fail to open\n";
+		return false;
+	}
+
+	auto fonts = Rc<TestFontSource>::create(font.str());
+
+	auto start = Time::now();
+	auto sequential = renderDocument(doc, fonts, nullptr);
+	auto sequentialTime = Time::now() - start;
+
+	auto queue = Rc<thread::TaskQueue>::alloc(threads);
+	queue->spawnWorkers();
+
+	bool success = !sequential.empty();
+	TimeInterval concurrentTime;
+	for (size_t i = 0; i < 2; ++ i) {
+		start = Time::now();
+		auto concurrent = renderDocument(doc, fonts, queue);
+		concurrentTime = Time::now() - start;
+		if (concurrent != sequential) {
+			std::cout << "==== " << path << ": concurrent layout " << i << " differs from sequential ("
+					<< concurrent.size() << " bytes vs " << sequential.size() << " bytes)\n";
+			success = false;
+		}
+	}
+
+	queue->cancelWorkers();
+
+	std::cout << "==== " << path << " (layout, " << threads << " threads): " << (success ? "identical" : "failed") << "\n"
+			<< "\tresult: " << sequential.size() << " bytes\n"
+			<< "\tsequential: " << sequentialTime.toMicros() / 1000.0 << " ms\n"
+			<< "\tconcurrent: " << concurrentTime.toMicros() / 1000.0 << " ms\n";
+	return success;
+}
+
+NS_SP_EXT_END(app)
+
+using namespace stappler;
+
+int parseOptionSwitch(data::Value &ret, char c, const char *str) {
+	if (c == 'h') {
+		ret.setBool(true, "help");
+	} else if (c == 'e') {
+		ret.setBool(true, "eager");
+	}
+	return 1;
+}
+
+int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
+	if (str == "help") {
+		ret.setBool(true, "help");
+	} else if (str == "eager") {
+		ret.setBool(true, "eager");
+	} else if (str.is("budget=")) {
+		StringView r(str); r += "budget="_len;
+		ret.setInteger(r.readInteger().get(0), "budget");
+	} else if (str.is("layout=")) {
+		StringView r(str); r += "layout="_len;
+		ret.setString(r, "layout");
+	} else if (str.is("threads=")) {
+		StringView r(str); r += "threads="_len;
+		ret.setInteger(r.readInteger().get(0), "threads");
+	}
+	return 1;
+}
+
+// Usage: epub-test [--eager] [--budget=<bytes>] <file.epub> ...
+//        epub-test --layout=<font.ttf> [--threads=<n>] <file.epub> ...
+// Peak RSS is per process, so, on-demand and eager modes should be compared with separate runs;
+// with --layout books are laid out sequentially and concurrently with the font, results should be identical
+int _spMain(argc, argv) {
+	data::Value opts = data::parseCommandLineOptions(argc, argv,
+			&parseOptionSwitch, &parseOptionString);
+
+	stappler::data::Value &args = opts.getValue("args");
+	if (opts.getBool("help") || args.size() < 2) {
+		std::cout << "Usage: epub-test [--eager] [--budget=<bytes>] <file.epub> ...\n"
+				<< "       epub-test --layout=<font.ttf> [--threads=<n>] <file.epub> ...\n";
+		return 0;
+	}
+
+	if (opts.isString("layout")) {
+		auto threads = uint16_t(std::max(opts.getInteger("threads"), int64_t(2)));
+		size_t failed = 0;
+		for (size_t i = 1; i < args.size(); ++ i) {
+			if (!app::processLayout(args.getString(i), opts.getString("layout"), threads)) {
+				++ failed;
+			}
+		}
+		return failed ? 1 : 0;
+	}
+
+	bool eager = opts.getBool("eager");
+	size_t budget = size_t(opts.getInteger("budget"));
+
+	size_t failed = 0;
+	for (size_t i = 1; i < args.size(); ++ i) {
+		if (!app::processFile(args.getString(i), eager, budget)) {
+			++ failed;
+		}
+	}
+	return failed ? 1 : 0;
+}
@@ -27,16 +27,99 @@ THE SOFTWARE.
 #include "SPData.h"
 #include "SPFilesystem.h"
 #include "SPLog.h"
+#include "MMDEngine.h"
 #include "MMDHtmlOutputProcessor.h"
 
 #include <stdlib.h>
+#include <random>
 
 NS_SP_EXT_BEGIN(app)
 
-void processFile(const String &path, bool print) {
+static String renderEngine(mmd::Engine &e) {
+	StringStream stream;
+	e.process([&] (const mmd::Content &c, const StringView &s, const mmd::Token &t) {
+		mmd::HtmlOutputProcessor p; p.init(&stream);
+		p.process(c, s, t);
+	});
+	return stream.str();
+}
+
+static String renderFull(StringView source) {
+	StringStream stream;
+	mmd::HtmlOutputProcessor::run(&stream, source);
+	return stream.str();
+}
+
+// edits are made on character boundaries, as in editor; parser does not support broken utf-8
+static size_t alignToChar(StringView source, size_t pos) {
+	while (pos < source.size() && (uint8_t(source[pos]) & 0xC0) == 0x80) {
+		++ pos;
+	}
+	return pos;
+}
+
+// applies random edits to source, result of incremental update should be the same, as result of full parse
+bool processIncremental(const StringView &name, const String &text) {
+	static constexpr size_t EditsCount = 200;
+	static const StringView fragments[] = {
+		"\n", "\n\n", "text ", "# Header\n", "* item\n", "1. item\n", "> quote\n", "    code\n",
+		"```\n", "~~~\n", "<!--", "-->", "| a | b |\n", "|---|---|\n", "Title: value\n", "[link]",
+		"[link]: http://example.com \"title\" class=\"external\" width=\"40px\"\n",
+		"[^note]", "[^note]: footnote text\n", "*[MMD]: MultiMarkdown\n", "MMD ", "*emphasis* ", "<div>\n", "</div>\n",
+	};
+
+	if (text.empty()) {
+		return true;
+	}
+
+	std::mt19937 gen(uint32_t(std::hash<String>()(name.str())));
+
+	auto source = new String(text);
+
+	// source is split into chunks and parsed on several threads, it should not change result
+	mmd::Engine e; e.init(*source);
+	e.setParsingThreads(2);
+	if (renderEngine(e) != renderFull(*source)) {
+		std::cout << "==== Incremental: " << name << ": chunked parse differs from full parse\n";
+		delete source;
+		return false;
+	}
+
+	bool success = true;
+	for (size_t i = 0; i < EditsCount; ++ i) {
+		auto start = alignToChar(*source, size_t(gen() % (source->size() + 1)));
+		auto oldLen = alignToChar(*source, start + std::min(size_t(gen() % 16), source->size() - start)) - start;
+		auto &fragment = fragments[gen() % (sizeof(fragments) / sizeof(StringView))];
+
+		auto next = new String();
+		next->reserve(source->size() - oldLen + fragment.size());
+		next->append(source->data(), start);
+		next->append(fragment.data(), fragment.size());
+		next->append(source->data() + start + oldLen, source->size() - start - oldLen);
+
+		e.update(*next, start, oldLen, fragment.size());
+
+		// engine does not own source, previous buffer should not be used after update
+		std::fill(source->begin(), source->end(), '?');
+		delete source;
+		source = next;
+
+		if (renderEngine(e) != renderFull(*source)) {
+			std::cout << "==== Incremental: " << name << ": differs from full parse after edit " << i
+					<< " (" << start << ", " << oldLen << ", " << fragment.size() << ")\n";
+			success = false;
+			break;
+		}
+	}
+
+	delete source;
+	return success;
+}
+
+void processFile(StringView path, bool print) {
 	auto text = filesystem::readTextFile(path);
 	if (!text.empty()) {
-		auto name = filepath::name(path);
+		auto name = filepath::name(path).str();
 		auto target = filesystem::currentDir("output/" + name + ".html");
 
 		if (!print) {
@@ -73,7 +156,7 @@ int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 	return 1;
 }
 
-int parseOptionString(data::Value &ret, const String &str, int argc, const char * argv[]) {
+int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
 	if (str == "print") {
 		ret.setBool(true, "print");
 	} else if (str == "verbose") {
@@ -104,11 +187,31 @@ int _spMain(argc, argv) {
 
 	std::cout << filesystem::currentDir(dir) << "\n";
 
-	filesystem::ftw(filesystem::currentDir(dir), [&] (const String &path, bool isFile) {
+	filesystem::ftw(filesystem::currentDir(dir), [&] (StringView path, bool isFile) {
 		if (isFile) {
 			app::processFile(path, print);
 		}
 	});
 
+	if (!print) {
+		// single files are smaller then chunk, so, all files are also joined to test edits across chunks
+		size_t failed = 0;
+		String all;
+		filesystem::ftw(filesystem::currentDir(dir), [&] (StringView path, bool isFile) {
+			if (isFile) {
+				auto text = filesystem::readTextFile(path);
+				if (!app::processIncremental(filepath::name(path), text)) {
+					++ failed;
+				}
+				all.append(text).append("\n\n");
+			}
+		});
+		if (!app::processIncremental("All files", all)) {
+			++ failed;
+		}
+		std::cout << "==== Incremental: " << failed << " failed\n";
+		return failed ? 1 : 0;
+	}
+
 	return 0;
 }
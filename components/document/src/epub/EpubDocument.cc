@@ -42,13 +42,25 @@ static Rc<layout::Document> loadEpub(const StringView &path, const StringView &c
 
 Document::DocumentFormat Document::EpubFormat(&checkEpub, &loadEpub, nullptr, nullptr);
 
+// documents, locked with lockPages by current thread
+static thread_local std::vector<const Document *> tl_lockedDocuments;
+
 bool Document::isEpub(const StringView &path) {
 	return Info::isEpub(path);
 }
 
 Document::Document() { }
 
+Document::~Document() {
+	if (_prefetchQueue) {
+		_prefetchQueue->cancelWorkers();
+		_prefetchQueue = nullptr;
+	}
+}
+
 bool Document::init(const FilePath &path) {
+	_filePath = path.get().str(); // used only as a cache key source, file data is read with Info
+	_ownerThread = std::this_thread::get_id();
 	_info = Rc<Info>::create(path.get());
 	if (_info && _info->valid()) {
 		auto &tocFile = _info->getTocFile();
@@ -66,21 +78,46 @@ bool Document::init(const FilePath &path) {
 					processCss(file.path, StringView((const char *)data.data(), data.size()));
 				}
 			} else if (file.type == ManifestFile::Image) {
-				_images.emplace(it.first, Image(file.width, file.height, file.size, file.path));
+				// actual size is resolved lazily with getImageSize, when layout requests it
+				_images.emplace(it.first, Image(0, 0, file.size, file.path));
 			}
 		}
 
+		// spine documents are parsed on first request (see getContentPage)
 		auto &spineRef = _info->getSpine();
 		for (const SpineFile &it : spineRef) {
-			auto file = _info->getFileData(it);
-			if (!file.empty() && it.entry->type == ManifestFile::Source) {
-				processHtml(it.entry->path, StringView((const char *)file.data(), file.size()), it.linear);
+			if (it.entry->size > 0 && it.entry->type == ManifestFile::Source) {
+				auto lazyIt = _lazyPages.find(it.entry->path);
+				if (lazyIt == _lazyPages.end()) {
+					lazyIt = _lazyPages.emplace(it.entry->path, LazyPage{
+						ContentPage{it.entry->path, layout::Node("html", it.entry->path), it.linear},
+						it.entry, _lazySpine.size()}).first;
+					_lazySpine.emplace_back(&lazyIt->second);
+
+					// document-wide data (like gallery) is defined with <meta> in document head; it's read here,
+					// so, this data is complete after init and it's not modified, when pages are parsed
+					auto head = _info->getFileHead(*it.entry, "<body");
+					if (!head.empty()) {
+						epub::Reader r;
+						Vector<Pair<String, String>> meta;
+						ContentPage headPage{it.entry->path, layout::Node("html", it.entry->path), it.linear};
+						if (r.readHtml(headPage, StringView((const char *)head.data(), head.size()), meta)) {
+							processMeta(headPage, meta);
+						}
+					}
+				}
 				if (it.linear) {
 					_spine.push_back(it.entry->path);
 				}
 			}
 		}
-		return true;
+
+		// root page should be available after init, it's returned by getRoot without lock, so, it's pinned
+		while (!_spine.empty() && !hydratePage(_lazyPages.find(_spine.front())->second, true)) {
+			_spine.erase(_spine.begin());
+		}
+
+		return !_spine.empty() || !_pages.empty();
 	}
 	return false;
 }
@@ -112,11 +149,253 @@ Pair<uint16_t, uint16_t> Document::getImageSize(const StringView &ipath) {
 	auto &manifest = _info->getManifest();
 	auto fileIt = manifest.find(path);
 	if (fileIt != manifest.end()) {
-		return pair(fileIt->second.width, fileIt->second.height);
+		return _info->getImageSize(fileIt->second);
 	}
 	return pair(uint16_t(0), uint16_t(0));
 }
 
+const Document::ContentPage *Document::getContentPage(const StringView &name) const {
+	auto it = _lazyPages.find(name);
+	if (it == _lazyPages.end()) {
+		return layout::Document::getContentPage(name);
+	}
+
+	auto &page = it->second;
+	_pagesMutex.lock();
+	_currentSpineIndex = page.spineIndex;
+	_pagesMutex.unlock();
+
+	auto ret = hydratePage(page, !isLockedByThread());
+	prefetchPages(page.spineIndex);
+	return ret;
+}
+
+Pair<const Document::ContentPage *, const Document::Node *> Document::getNodeByIdGlobal(const StringView &id) const {
+	auto ret = layout::Document::getNodeByIdGlobal(id);
+	if (ret.first) {
+		return ret;
+	}
+
+	// ids are known only for parsed pages, so, all pages should be parsed to search for id
+	const bool pin = !isLockedByThread();
+	for (auto &it : _lazySpine) {
+		if (auto page = hydratePage(*it, pin)) {
+			auto idIt = page->ids.find(id);
+			if (idIt != page->ids.end()) {
+				return Pair<const ContentPage *, const Node *>(page, idIt->second);
+			}
+		}
+	}
+	return Pair<const ContentPage *, const Node *>(nullptr, nullptr);
+}
+
+void Document::lockPages() const {
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	++ _pagesLocked;
+	tl_lockedDocuments.emplace_back(this);
+}
+
+void Document::unlockPages() const {
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	auto it = std::find(tl_lockedDocuments.begin(), tl_lockedDocuments.end(), this);
+	if (it != tl_lockedDocuments.end()) {
+		tl_lockedDocuments.erase(it);
+	}
+	if (_pagesLocked > 0) {
+		-- _pagesLocked;
+	}
+	evictPages();
+}
+
+bool Document::isLockedByThread() const {
+	return std::find(tl_lockedDocuments.begin(), tl_lockedDocuments.end(), this) != tl_lockedDocuments.end();
+}
+
+void Document::setMemoryBudget(size_t value) {
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	_memoryBudget = value;
+	evictPages();
+}
+
+size_t Document::getMemoryBudget() const {
+	return _memoryBudget;
+}
+
+size_t Document::getPagesMemory() const {
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	return _pagesMemory;
+}
+
+void Document::setPrefetchWindow(uint16_t value) {
+	_prefetchWindow = value;
+}
+
+uint16_t Document::getPrefetchWindow() const {
+	return _prefetchWindow;
+}
+
+void Document::updateNodes() {
+	layout::Document::updateNodes();
+
+	// every node takes at least one byte of source, so, page can not use more then (size + 1) ids
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	NodeId nextId = _maxNodeId;
+	for (auto &it : _lazySpine) {
+		it->firstNodeId = nextId;
+		nextId += NodeId(it->file->size + 1);
+		if (it->status == LazyPage::Ready) {
+			NodeId id = it->firstNodeId;
+			it->page.root.foreach([&] (Node &node, size_t level) {
+				node.setNodeId(id ++);
+			});
+		}
+	}
+	_maxNodeId = nextId;
+	_nodeIdsReserved = true;
+}
+
+const Document::ContentPage *Document::hydratePage(LazyPage &page, bool pin) const {
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	page.access = ++ _pagesAccess;
+	while (page.status == LazyPage::Loading) {
+		_pagesCondition.wait(lock);
+	}
+
+	switch (page.status) {
+	case LazyPage::Ready:
+		page.pinned = page.pinned || pin;
+		return &page.page;
+		break;
+	case LazyPage::Failed: return nullptr; break;
+	default: break;
+	}
+
+	// page is not accessed by other threads while it's loading, so, it can be parsed without lock
+	page.status = LazyPage::Loading;
+	const NodeId firstNodeId = _nodeIdsReserved ? page.firstNodeId : layout::NodeIdNone();
+	lock.unlock();
+
+	bool success = false;
+	size_t nodes = 0;
+	Vector<Pair<String, String>> meta; // meta was processed in init, it's not used here
+	auto data = _info->getFileData(*page.file);
+	if (!data.empty()) {
+		epub::Reader r;
+		page.page.queries = layout::style::MediaQuery::getDefaultQueries(page.page.strings);
+		if (r.readHtml(page.page, StringView((const char *)data.data(), data.size()), meta)) {
+			NodeId nextId = firstNodeId;
+			page.page.root.foreach([&] (Node &node, size_t level) {
+				if (firstNodeId != layout::NodeIdNone()) {
+					node.setNodeId(nextId ++);
+				}
+				auto htmlId = node.getHtmlId();
+				if (!htmlId.empty()) {
+					page.page.ids.insert(pair(htmlId, &node));
+				}
+				++ nodes;
+			});
+			success = true;
+		}
+	}
+
+	lock.lock();
+	if (success) {
+		// parsed tree holds about the same amount of text, as source, plus node objects
+		page.cost = data.size() * 2 + nodes * sizeof(Node);
+		page.status = LazyPage::Ready;
+		page.pinned = page.pinned || pin;
+		_pagesMemory += page.cost;
+	} else {
+		page.page = ContentPage{page.page.path, layout::Node("html", page.page.path), page.page.linear};
+		page.status = LazyPage::Failed;
+	}
+	_pagesCondition.notify_all();
+	evictPages();
+
+	return success ? &page.page : nullptr;
+}
+
+void Document::prefetchPages(size_t idx) const {
+	if (_prefetchWindow == 0) {
+		return;
+	}
+
+	Vector<LazyPage *> pages;
+
+	std::unique_lock<std::mutex> lock(_pagesMutex);
+	auto schedule = [&] (size_t i) {
+		auto page = _lazySpine[i];
+		if (page->status == LazyPage::Empty && !page->prefetch) {
+			page->prefetch = true;
+			pages.emplace_back(page);
+		}
+	};
+
+	// next pages are more likely to be requested, so, they are scheduled first
+	for (size_t i = 1; i <= _prefetchWindow && idx + i < _lazySpine.size(); ++ i) {
+		schedule(idx + i);
+	}
+	for (size_t i = 1; i <= _prefetchWindow && i <= idx; ++ i) {
+		schedule(idx - i);
+	}
+
+	if (pages.empty()) {
+		return;
+	}
+
+	if (!_prefetchQueue) {
+		_prefetchQueue = Rc<thread::TaskQueue>::alloc(1);
+		_prefetchQueue->spawnWorkers();
+	}
+	lock.unlock();
+
+	for (auto &it : pages) {
+		_prefetchQueue->perform(Rc<thread::Task>::create([this, page = it] (const thread::Task &) -> bool {
+			hydratePage(*page);
+
+			std::unique_lock<std::mutex> lock(_pagesMutex);
+			page->prefetch = false;
+			return true;
+		}));
+	}
+
+	// completed tasks can be released only on queue owner's thread, others are released later or with queue
+	if (std::this_thread::get_id() == _ownerThread) {
+		_prefetchQueue->update();
+	}
+}
+
+void Document::evictPages() const {
+	if (_memoryBudget == 0 || _pagesLocked > 0 || _pagesMemory <= _memoryBudget) {
+		return;
+	}
+
+	// pages around current one and last accessed page are never released
+	const size_t windowStart = (_currentSpineIndex > _prefetchWindow) ? _currentSpineIndex - _prefetchWindow : 0;
+	const size_t windowEnd = _currentSpineIndex + _prefetchWindow;
+
+	while (_pagesMemory > _memoryBudget) {
+		LazyPage *target = nullptr;
+		for (auto &it : _lazySpine) {
+			if (it->status == LazyPage::Ready && !it->pinned && it->access != _pagesAccess
+					&& (it->spineIndex < windowStart || it->spineIndex > windowEnd)) {
+				if (!target || it->access < target->access) {
+					target = it;
+				}
+			}
+		}
+
+		if (!target) {
+			break;
+		}
+
+		_pagesMemory -= target->cost;
+		target->cost = 0;
+		target->page = ContentPage{target->page.path, layout::Node("html", target->page.path), target->page.linear};
+		target->status = LazyPage::Empty;
+	}
+}
+
 bool Document::valid() const {
 	return _info->valid();
 }
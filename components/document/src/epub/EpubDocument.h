@@ -26,6 +26,7 @@ THE SOFTWARE.
 #include "EpubInfo.h"
 #include "SLDocument.h"
 #include "SLRendererTypes.h"
+#include "SPThreadTaskQueue.h"
 
 NS_EPUB_BEGIN
 
@@ -37,10 +38,13 @@ public:
 	using Node = layout::Node;
 	using MediaParameters = layout::MediaParameters;
 	using FilePath = layout::FilePath;
+	using ContentPage = layout::ContentPage;
+	using NodeId = layout::NodeId;
 
 	static bool isEpub(const StringView &path);
 
 	Document();
+	virtual ~Document();
 
 	virtual bool init(const FilePath &);
 	virtual bool isFileExists(const StringView &) const override;
@@ -48,6 +52,25 @@ public:
 	virtual Bytes getImageData(const StringView &) override;
 	virtual Pair<uint16_t, uint16_t> getImageSize(const StringView &) override;
 
+	// spine documents are parsed on first request, next documents are parsed in background;
+	// page, requested by thread, that does not hold lockPages, is never released, because document
+	// can not know, when caller stops to use it
+	virtual const ContentPage *getContentPage(const StringView &) const override;
+	virtual Pair<const ContentPage *, const Node *> getNodeByIdGlobal(const StringView &id) const override;
+
+	virtual void lockPages() const override;
+	virtual void unlockPages() const override;
+
+	// approximate memory limit for parsed spine documents; when it's exceeded and pages are not locked,
+	// least recently used documents outside of prefetch window are released; 0 - no limit
+	void setMemoryBudget(size_t);
+	size_t getMemoryBudget() const;
+	size_t getPagesMemory() const;
+
+	// number of spine items before and after requested one, that are parsed in background; 0 - no prefetch
+	void setPrefetchWindow(uint16_t);
+	uint16_t getPrefetchWindow() const;
+
 	bool valid() const;
 	operator bool () const;
 
@@ -72,6 +95,35 @@ public: // meta
 	String getLanguage() const;
 
 protected:
+	// spine document, parsed on demand; node ids for it are reserved at init, so, they do not depend
+	// on order of parsing: every node takes at least one byte of source, so, source size is enough
+	struct LazyPage {
+		enum Status {
+			Empty,
+			Loading,
+			Ready,
+			Failed,
+		};
+
+		ContentPage page;
+		const ManifestFile *file = nullptr;
+		size_t spineIndex = 0;
+		NodeId firstNodeId = layout::NodeIdNone();
+		size_t cost = 0; // approximate memory, used by parsed page
+		uint64_t access = 0; // last access tick for eviction
+		Status status = Empty;
+		bool prefetch = false; // parsing is scheduled in background
+		bool pinned = false; // page was returned without lock, it can not be released
+	};
+
+	virtual void updateNodes() override;
+
+	// if pin is true, page is marked as pinned before it can be released
+	const ContentPage *hydratePage(LazyPage &, bool pin = false) const;
+	bool isLockedByThread() const;
+	void prefetchPages(size_t spineIndex) const;
+	void evictPages() const; // should be called with _pagesMutex locked
+
 	virtual void onStyleAttribute(Style &style, const StringView &tag, const StringView &name, const StringView &value,
 		const MediaParameters &) const override;
 
@@ -84,6 +136,22 @@ protected:
 	data::Value encodeContents(const ContentRecord &);
 
 	Rc<Info> _info;
+
+	// keys are not changed after init, so, maps itself can be used without lock, while LazyPage data is protected
+	// with _pagesMutex; page can be released only while pages are not locked and it's not pinned
+	mutable Map<String, LazyPage> _lazyPages;
+	mutable Vector<LazyPage *> _lazySpine;
+	mutable std::mutex _pagesMutex;
+	mutable std::condition_variable _pagesCondition;
+	mutable uint32_t _pagesLocked = 0;
+	mutable uint64_t _pagesAccess = 0;
+	mutable size_t _pagesMemory = 0;
+	mutable size_t _currentSpineIndex = 0;
+	mutable Rc<thread::TaskQueue> _prefetchQueue;
+	std::thread::id _ownerThread; // completed prefetch tasks are released only on thread, that called init
+	size_t _memoryBudget = 0;
+	uint16_t _prefetchWindow = 2;
+	bool _nodeIdsReserved = false;
 };
 
 NS_EPUB_END
@@ -32,14 +32,120 @@ THE SOFTWARE.
 #include "SPLocale.h"
 #include "unzip.h"
 
+#if LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 NS_EPUB_BEGIN
 
+// Container stream for the archive itself: whole file is mapped into memory when possible,
+// so central directory walk and entry reads are plain memcpy without syscalls;
+// falls back to buffered ifile for relative (possibly bundled) paths and platforms without mmap
+struct EpubContainerStream {
+	filesystem::ifile file;
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	size_t pos = 0;
+
+	static EpubContainerStream *open(const StringView &path) {
+		auto ret = new EpubContainerStream();
+#if LINUX
+		if (filepath::isAbsolute(path)) {
+			auto fullPath = path.str();
+			int fd = ::open(fullPath.data(), O_RDONLY);
+			if (fd >= 0) {
+				struct stat st;
+				if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+					auto ptr = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+					if (ptr != MAP_FAILED) {
+						::madvise(ptr, size_t(st.st_size), MADV_RANDOM);
+						ret->data = (const uint8_t *)ptr;
+						ret->size = size_t(st.st_size);
+					}
+				}
+				::close(fd);
+			}
+		}
+#endif
+		if (!ret->data) {
+			ret->file = filesystem::openForReading(path);
+			if (!ret->file) {
+				delete ret;
+				return nullptr;
+			}
+		}
+		return ret;
+	}
+
+	~EpubContainerStream() {
+#if LINUX
+		if (data) {
+			::munmap((void *)data, size);
+		}
+#endif
+		if (file) {
+			file.close();
+		}
+	}
+
+	size_t read(uint8_t *buf, size_t nbytes) {
+		if (!data) {
+			return file.read(buf, nbytes);
+		}
+		nbytes = std::min(nbytes, size - pos);
+		memcpy(buf, data + pos, nbytes);
+		pos += nbytes;
+		return nbytes;
+	}
+
+	size_t seek(int64_t offset, io::Seek s) {
+		if (!data) {
+			return file.seek(offset, s);
+		}
+		int64_t target = offset;
+		switch (s) {
+		case io::Seek::Set: break;
+		case io::Seek::Current: target += int64_t(pos); break;
+		case io::Seek::End: target += int64_t(size); break;
+		}
+		if (target < 0 || size_t(target) > size) {
+			return maxOf<size_t>();
+		}
+		pos = size_t(target);
+		return pos;
+	}
+
+	size_t tell() const {
+		return data ? pos : file.tell();
+	}
+};
+
 struct EpubFileApi {
 	cocos2d::zlib_filefunc64_def pathFunc;
 	cocos2d::zlib_filefunc64_def fileFunc;
 
 	static void *api_open(void *, const void *filename, int mode) {
-		return new filesystem::ifile(filesystem::openForReading(*(const StringView *)filename));
+		return EpubContainerStream::open(*(const StringView *)filename);
+	}
+
+	static uLong api_stream_read(void *, void * stream, void * buf, uLong size) {
+		return ((EpubContainerStream *)stream)->read((uint8_t *)buf, size);
+	}
+
+	static cocos2d::ZPOS64_T api_stream_tell(void * opaque, void * stream) {
+		return ((EpubContainerStream *)stream)->tell();
+	}
+
+	static long api_stream_seek(void *, void * stream, cocos2d::ZPOS64_T offset, int origin) {
+		return (((EpubContainerStream *)stream)->seek(offset, getSeek(origin)) != maxOf<size_t>())?0:-1;
+	}
+
+	static int api_stream_close(void *, void * stream) {
+		delete (EpubContainerStream *)stream;
+		return 0;
 	}
 
 	static void *api_open_file(void *, const void *filename, int mode) {
@@ -62,24 +168,18 @@ struct EpubFileApi {
 		return filePtr->tell();
 	}
 
-	static long api_seek(void *, void * stream, cocos2d::ZPOS64_T offset, int origin) {
-		auto filePtr = (filesystem::ifile *)stream;
-		io::Seek seek = io::Seek::Set;
-		if (origin == SEEK_SET) {
-			seek = io::Seek::Set;
-		} else if (origin == SEEK_CUR) {
-			seek = io::Seek::Current;
+	static io::Seek getSeek(int origin) {
+		if (origin == SEEK_CUR) {
+			return io::Seek::Current;
 		} else if (origin == SEEK_END) {
-			seek = io::Seek::End;
+			return io::Seek::End;
 		}
-		return (filePtr->seek(offset, seek) != maxOf<size_t>())?0:-1;
+		return io::Seek::Set;
 	}
 
-	static int api_close(void *, void * stream) {
+	static long api_seek(void *, void * stream, cocos2d::ZPOS64_T offset, int origin) {
 		auto filePtr = (filesystem::ifile *)stream;
-		filePtr->close();
-		delete filePtr;
-		return 0;
+		return (filePtr->seek(offset, getSeek(origin)) != maxOf<size_t>())?0:-1;
 	}
 
 	static int api_close_file(void *, void * stream) {
@@ -93,11 +193,11 @@ struct EpubFileApi {
 	EpubFileApi() {
 		pathFunc.opaque = this;
 		pathFunc.zopen64_file = &api_open;
-		pathFunc.zread_file = &api_read;
+		pathFunc.zread_file = &api_stream_read;
 		pathFunc.zwrite_file = &api_write;
-		pathFunc.ztell64_file = &api_tell;
-		pathFunc.zseek64_file = &api_seek;
-		pathFunc.zclose_file = &api_close;
+		pathFunc.ztell64_file = &api_stream_tell;
+		pathFunc.zseek64_file = &api_stream_seek;
+		pathFunc.zclose_file = &api_stream_close;
 		pathFunc.zerror_file = &api_error;
 
 		fileFunc.opaque = this;
@@ -210,6 +310,7 @@ Bytes Info::openFile(const String &file) const {
 }
 
 Bytes Info::openFile(const ManifestFile &file) const {
+	std::unique_lock<std::mutex> lock(_fileMutex);
 	Bytes ret;
 	cocos2d::unz64_file_pos pos;
 	pos.pos_in_zip_directory = file.zip_pos;
@@ -358,7 +459,19 @@ data::Value Info::encode() const {
 	return ret;
 }
 
+static bool Info_isImageName(const StringView &name) {
+	auto ext = filepath::lastExtension(name);
+	for (auto &it : { "png", "jpg", "jpeg", "gif", "webp", "svg", "tif", "tiff" }) {
+		if (string::compareCaseInsensivive(ext, StringView(it)) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 Map<String, ManifestFile> Info::getFileList(FilePtr file) {
+	// Only central directory is walked here; entries are not inflated until requested,
+	// image dimensions are probed on first use with getImageSize
 	Map<String, ManifestFile> ret;
 	char buf[1_KiB] = { 0 };
 	cocos2d::unz_file_info64 info;
@@ -375,42 +488,19 @@ Map<String, ManifestFile> Info::getFileList(FilePtr file) {
 			break;
 		}
 
-		err = cocos2d::unzOpenCurrentFile(file);
-		if (err != UNZ_OK) {
-			break;
-		}
-
-		DocumentFile docFile{file, 0, (size_t)info.uncompressed_size};
-
-		size_t width = 0, height = 0;
-		if (Bitmap::getImageSize(docFile, width, height)) {
-			ret.emplace(String(buf), ManifestFile{
-				String(buf),
-				(size_t)info.uncompressed_size,
-				infoPos.pos_in_zip_directory,
-				infoPos.num_of_file,
-				ManifestFile::Image,
-				uint16_t(width),
-				uint16_t(height)
-			});
-			//log::format("EpubFile", "%s %llu %lu %lu", buf, info.uncompressed_size, width, height);
-		} else {
-			ret.emplace(String(buf), ManifestFile{
-				String(buf),
-				(size_t)info.uncompressed_size,
-				infoPos.pos_in_zip_directory,
-				infoPos.num_of_file,
-				ManifestFile::Unknown, 0, 0
-			});
-			//log::format("EpubFile", "%s %llu", buf, info.uncompressed_size);
-		}
-		cocos2d::unzCloseCurrentFile(file);
+		ret.emplace(String(buf), ManifestFile{
+			String(buf),
+			(size_t)info.uncompressed_size,
+			infoPos.pos_in_zip_directory,
+			infoPos.num_of_file,
+			Info_isImageName(StringView(buf)) ? ManifestFile::Image : ManifestFile::Unknown,
+			0, 0, false
+		});
 		err = cocos2d::unzGoToNextFile64(file, &info, buf, 1_KiB);
 	}
 	return ret;
 }
 
-
 String Info::getRootPath() {
 	String ret;
 	auto container = openFile("META-INF/container.xml");
@@ -680,6 +770,8 @@ void Info::processPublication() {
 						fileIt->second.type = ManifestFile::Source;
 					} else if (m == "text/css") {
 						fileIt->second.type = ManifestFile::Css;
+					} else if (m.compare(0, "image/"_len, "image/") == 0) {
+						fileIt->second.type = ManifestFile::Image;
 					}
 				}
 			}
@@ -881,12 +973,46 @@ Bytes Info::getFileData(const SpineFile &file) const {
 Bytes Info::getFileData(const ManifestFile &file) const {
 	return openFile(file);
 }
+Bytes Info::getFileHead(const ManifestFile &file, const StringView &terminator) const {
+	std::unique_lock<std::mutex> lock(_fileMutex);
+	Bytes ret;
+	cocos2d::unz64_file_pos pos;
+	pos.pos_in_zip_directory = file.zip_pos;
+	pos.num_of_file = file.file_num;
+	if (cocos2d::unzGoToFilePos64(_file, &pos) == UNZ_OK) {
+		if (cocos2d::unzOpenCurrentFile(_file) == UNZ_OK) {
+			while (ret.size() < file.size) {
+				const size_t offset = ret.size();
+				const size_t chunk = std::min(size_t(4_KiB), file.size - offset);
+				ret.resize(offset + chunk);
+				auto readed = cocos2d::unzReadCurrentFile(_file, ret.data() + offset, unsigned(chunk));
+				if (readed <= 0) {
+					ret.resize(offset);
+					break;
+				}
+				ret.resize(offset + readed);
+
+				// terminator can be split between chunks
+				const size_t searchOffset = (offset > terminator.size()) ? offset - terminator.size() : 0;
+				StringView r((const char *)ret.data() + searchOffset, ret.size() - searchOffset);
+				r.skipUntilString(terminator);
+				if (!r.empty()) {
+					ret.resize(r.data() - (const char *)ret.data());
+					break;
+				}
+			}
+			cocos2d::unzCloseCurrentFile(_file);
+		}
+	}
+	return ret;
+}
 
 bool Info::isImage(const String &path, const String &root) const {
 	auto str = resolvePath(path, root);
 	auto it = _manifest.find(str);
-	if (it != _manifest.end()) {
-		return it->second.type == ManifestFile::Type::Image;
+	if (it != _manifest.end() && it->second.type == ManifestFile::Type::Image) {
+		auto size = getImageSize(it->second);
+		return size.first > 0 && size.second > 0;
 	}
 	return false;
 }
@@ -895,14 +1021,44 @@ bool Info::isImage(const String &path, size_t &width, size_t &height, const Stri
 	auto it = _manifest.find(str);
 	if (it != _manifest.end()) {
 		if (it->second.type == ManifestFile::Type::Image) {
-			width = it->second.width;
-			height = it->second.height;
-			return true;
+			auto size = getImageSize(it->second);
+			if (size.first > 0 && size.second > 0) {
+				width = size.first;
+				height = size.second;
+				return true;
+			}
 		}
 	}
 	return false;
 }
 
+Pair<uint16_t, uint16_t> Info::getImageSize(const ManifestFile &file) const {
+	if (file.type != ManifestFile::Type::Image) {
+		return pair(uint16_t(0), uint16_t(0));
+	}
+
+	// size can be requested from concurrent layout threads, probe uses shared archive handle
+	std::unique_lock<std::mutex> lock(_fileMutex);
+	if (!file.sizeResolved) {
+		cocos2d::unz64_file_pos pos;
+		pos.pos_in_zip_directory = file.zip_pos;
+		pos.num_of_file = file.file_num;
+		if (cocos2d::unzGoToFilePos64(_file, &pos) == UNZ_OK) {
+			if (cocos2d::unzOpenCurrentFile(_file) == UNZ_OK) {
+				DocumentFile docFile{_file, 0, file.size};
+				size_t width = 0, height = 0;
+				if (Bitmap::getImageSize(docFile, width, height)) {
+					file.width = uint16_t(width);
+					file.height = uint16_t(height);
+				}
+				cocos2d::unzCloseCurrentFile(_file);
+			}
+		}
+		file.sizeResolved = true;
+	}
+	return pair(file.width, file.height);
+}
+
 String Info::resolvePath(const String &path, const String &root) const {
 	if (root.empty()) {
 		return filepath::reconstructPath(path);
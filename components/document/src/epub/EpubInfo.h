@@ -104,8 +104,10 @@ struct ManifestFile {
 		Css,
 	} type;
 
-	uint16_t width;
-	uint16_t height;
+	// image size is probed lazily on first request under archive lock, see Info::getImageSize
+	mutable uint16_t width;
+	mutable uint16_t height;
+	mutable bool sizeResolved;
 
 	// Manifest data
 	String id;
@@ -156,9 +158,17 @@ public:
 	Bytes getFileData(const SpineFile &file) const;
 	Bytes getFileData(const ManifestFile &file) const;
 
+	// reads entry until terminator is found, terminator itself is not included;
+	// whole entry is returned if there is no terminator
+	Bytes getFileHead(const ManifestFile &file, const StringView &terminator) const;
+
 	bool isImage(const String &path, const String &root) const;
 	bool isImage(const String &path, size_t &width, size_t &height, const String &root) const;
 
+	// reads only the header of the image entry; result is cached within manifest,
+	// (0, 0) if entry is not an image or it's header can not be recognized
+	Pair<uint16_t, uint16_t> getImageSize(const ManifestFile &) const;
+
 	String resolvePath(const String &path, const String &root) const;
 
 	bool isHtml(const String &path);
@@ -170,6 +180,8 @@ protected:
 	String getRootPath();
 	void processPublication();
 
+	// archive handle has single current entry, so reading from it should be serialized
+	mutable std::mutex _fileMutex;
 	FilePtr _file = nullptr;
 	String _rootFile;
 	String _rootPath;
@@ -390,7 +390,10 @@ void Content::Link::parseAttributes(AttrVec &attr, const StringView &str) {
 		r += scan_len;
 
 		value.trimChars<StringView::Chars<'"'>>();
-		attr.emplace_back(key, value);
+
+		// links from definitions are kept between incremental updates, while source buffer is not, so,
+		// attributes are copied into pool of the link
+		attr.emplace_back(key.pdup(), value.pdup());
 	}
 }
 
@@ -541,7 +544,7 @@ auto Content::explicitLink(const StringView &s, const Extensions &ext, token * b
 	return l;
 }
 
-Content::Content(const Extensions &ext) : extensions(ext) {
+Content::Content(const Extensions &ext) : extensions(ext), initialExtensions(ext) {
 	headers.reserve(64);
 	definitions.reserve(64);
 	tables.reserve(64);
@@ -563,6 +566,8 @@ QuotesLanguage Content::getQuotesLanguage() const {
 }
 
 void Content::reset() {
+	extensions = initialExtensions;
+
 	headers.clear(); headers.reserve(64);
 	definitions.clear(); definitions.reserve(64);
 	tables.clear(); tables.reserve(64);
@@ -670,7 +675,52 @@ void Content::process(const StringView &str) {
 	processDefinitions(str);
 	processHeaders(str);
 	processTables(str);
+	processViews();
+}
+
+void Content::processPart(const StringView &str) {
+	partLinks[0] = links.size();
+	processDefinitions(str);
+	partLinks[1] = links.size();
+	processHeaders(str);
+	partLinks[2] = links.size();
+	processTables(str);
+}
+
+void Content::processParts(const Vector<const Content *> &parts) {
+	for (auto &part : parts) {
+		for (auto &it : part->headers) {
+			headers.emplace_back(it.getToken());
+		}
+		for (auto &it : part->definitions) {
+			definitions.emplace_back(it.getToken());
+		}
+		for (auto &it : part->tables) {
+			tables.emplace_back(it.getToken());
+		}
+		for (auto &it : part->meta) {
+			meta.emplace(it.first, it.second);
+		}
+
+		abbreviation.insert(abbreviation.end(), part->abbreviation.begin(), part->abbreviation.end());
+		citation.insert(citation.end(), part->citation.begin(), part->citation.end());
+		glossary.insert(glossary.end(), part->glossary.begin(), part->glossary.end());
+		footnotes.insert(footnotes.end(), part->footnotes.begin(), part->footnotes.end());
+	}
+
+	// html ids, then links from definitions, headers and tables, like when whole source is processed
+	for (size_t i = 0; i < 4; ++ i) {
+		for (auto &part : parts) {
+			auto first = (i == 0) ? 0 : part->partLinks[i - 1];
+			auto last = (i == 3) ? part->links.size() : part->partLinks[i];
+			links.insert(links.end(), part->links.begin() + first, part->links.begin() + last);
+		}
+	}
+
+	processViews();
+}
 
+void Content::processViews() {
 	linksView.reserve(links.size());
 	for (auto &it : links) {
 		linksView.try_emplace(it->clean_text, it);
@@ -115,6 +115,12 @@ public:
 
 	void process(const StringView &);
 
+	// process independently parsed part of source
+	void processPart(const StringView &);
+
+	// collect results from processed parts in the same order, as if whole source was processed
+	void processParts(const Vector<const Content *> &);
+
 	void emplaceMeta(String &&, String &&);
 	void emplaceHtmlId(Token &&, const StringView &);
 
@@ -148,7 +154,10 @@ protected:
 	void processTables(const StringView &);
 	void processTable(const StringView &, const Token &);
 
+	void processViews();
+
 	Extensions extensions = Extensions::None;
+	Extensions initialExtensions = Extensions::None; // processors can add flags from metadata, reset() drops them
 	QuotesLanguage quotes = QuotesLanguage::English;
 
 	Vector<Token> headers;
@@ -163,6 +172,8 @@ protected:
 
 	Dict<String> meta;
 
+	size_t partLinks[3] = { 0 }; // where links from definitions, headers and tables start, when processed as part
+
 	DictView<Content::Link *> linksView;
 	DictView<Content::Footnote *> citationView;
 	DictView<Content::Footnote *> footnotesView;
@@ -47,6 +47,7 @@
 #include "MMDAhoCorasick.h"
 
 #include "SPLog.h"
+#include "SPThreadTaskQueue.h"
 
 NS_MMD_BEGIN
 
@@ -73,6 +74,18 @@ struct Engine::Internal : memory::PoolInterface {
 	using mmd_engine = _sp_mmd_engine;
 	using token = _sp_mmd_token;
 
+	struct Chunk {
+		memory::pool_t *pool = nullptr; // tokens and content of chunk
+		size_t start = 0;
+		size_t len = 0;
+		Content *content = nullptr; // headers, definitions, tables, html ids and meta from chunk
+		token *first = nullptr; // top-level blocks of chunk
+		token *last = nullptr;
+		bool fresh = true; // chunk should be parsed again
+
+		Chunk(size_t start, size_t len) : start(start), len(len) { }
+	};
+
 	Internal(memory::pool_t *p, const StringView &v, const Extensions &ext);
 	~Internal();
 
@@ -80,6 +93,15 @@ struct Engine::Internal : memory::PoolInterface {
 	bool prepare();
 	void reset();
 
+	size_t splitChunks(size_t start, Content::Vector<Chunk> &, const Chunk *next = nullptr, size_t count = 0,
+			int64_t offset = 0, size_t minStop = 0);
+	void parseChunk(Chunk &);
+	void parseChunks();
+	void unlinkChunks();
+	bool prepareChunks();
+
+	void update(const StringView &, size_t start, size_t oldLen, size_t newLen);
+
 	void process(const ProcessCallback &);
 
 	StringView source;
@@ -89,6 +111,12 @@ struct Engine::Internal : memory::PoolInterface {
 
 	TokenPairEngine * pairs = nullptr;
 
+	bool chunked = false;
+	uint16_t threads = 1;
+	Content::Vector<Chunk> chunks;
+	token *chunksRoot = nullptr;
+	uint64_t searchHash = 0; // abbreviations and glossary terms, chunks were searched with
+
 	bool isDebug = false;
 	StringStreamType debug;
 };
@@ -120,6 +148,12 @@ Engine::Internal::Internal(memory::pool_t *p, const StringView &v, const Extensi
 }
 
 Engine::Internal::~Internal() {
+	for (auto &it : chunks) {
+		if (it.pool) {
+			memory::pool::destroy(it.pool);
+		}
+	}
+
 	if (!debug.empty()) {
 		memory::pool::push(pool);
 		std::cout << StringView(debug.weak());
@@ -354,6 +388,10 @@ auto Engine::Internal::parse(const StringView &str) -> token * {
 
 bool Engine::Internal::prepare() {
 	if (!engine.root) {
+		if (chunked) {
+			return prepareChunks();
+		}
+
 		memory::pool::push(pool);
 
 		engine.root = parse(source);
@@ -389,6 +427,443 @@ bool Engine::Internal::prepare() {
 	return true;
 }
 
+/// Chunk of source can be parsed independently, if it starts with a line after empty line, that can not continue
+/// any previous block (it starts with letter or ATX header, and it's not a metadata or table line), and if this
+/// line is not in fenced code block or html comment; lines, that can start or end such blocks, are classified
+/// with tokenizer itself
+struct ChunkSplitter {
+	enum class State {
+		None,
+		Fence,
+		Comment,
+		Unknown, // parser can recover from error in any way, no more chunks can be started
+	};
+
+	static bool isEmptyLine(const StringView &);
+	static bool canStartChunk(const StringView &);
+
+	ChunkSplitter(const _sp_mmd_engine &e, const Extensions &ext) : engine(e), content(ext) {
+		engine.root = nullptr;
+		engine.recurse_depth = 0;
+		engine.definition_stack = (void *)&content.getDefinitions();
+		engine.header_stack = (void *)&content.getHeaders();
+		engine.table_stack = (void *)&content.getTables();
+		engine.content = &content;
+	}
+
+	// returns true if chunk can be started with this line
+	bool readLine(size_t start, size_t len);
+
+	void readLineType(unsigned short);
+
+	_sp_mmd_engine engine;
+	Content content;
+	State state = State::None;
+	unsigned short fence = 0;
+	bool empty = false;
+};
+
+bool ChunkSplitter::isEmptyLine(const StringView &line) {
+	StringView r(line);
+	r.skipChars<StringView::Chars<' ', '\t'>>();
+	return r.empty() || r == "\n" || r == "\r\n";
+}
+
+bool ChunkSplitter::canStartChunk(const StringView &line) {
+	auto c = line.empty() ? 0 : uint8_t(line[0]);
+	if (!chars::isAlpha(char(c)) && c != '#' && c < 0x80) {
+		return false;
+	}
+
+	if (memchr(line.data(), '|', line.size()) || scan_meta_line(line.data())) {
+		return false;
+	}
+
+	return true;
+}
+
+bool ChunkSplitter::readLine(size_t start, size_t len) {
+	StringView line(engine.str + start, len);
+
+	bool ret = empty && state == State::None && canStartChunk(line);
+
+	if (state != State::Unknown) {
+		auto cr = (const char *)memchr(line.data(), '\r', line.size());
+		if (cr && cr + 1 != line.data() + line.size() && cr[1] != '\n') {
+			// line breaks, that we can not track
+			state = State::Unknown;
+		} else {
+			size_t indent = 0;
+			while (indent < 4 && indent < line.size() && line[indent] == ' ') {
+				++ indent;
+			}
+
+			if (indent < 4) {
+				auto r = line.sub(indent);
+				if (r.is('`') || r.is("<!--") || r.is("-->")) {
+					auto root = sp_mmd_mmd_tokenize_string(&engine, start, len, false);
+					if (root->child) {
+						readLineType(root->child->type);
+					}
+				}
+			}
+		}
+	}
+
+	empty = isEmptyLine(line);
+	return ret;
+}
+
+void ChunkSplitter::readLineType(unsigned short type) {
+	unsigned short level = 0;
+	switch (type) {
+		case LINE_FENCE_BACKTICK_3:
+		case LINE_FENCE_BACKTICK_START_3: level = 3; break;
+		case LINE_FENCE_BACKTICK_4:
+		case LINE_FENCE_BACKTICK_START_4: level = 4; break;
+		case LINE_FENCE_BACKTICK_5:
+		case LINE_FENCE_BACKTICK_START_5: level = 5; break;
+		default: break;
+	}
+
+	switch (type) {
+		case LINE_FENCE_BACKTICK_3:
+		case LINE_FENCE_BACKTICK_4:
+		case LINE_FENCE_BACKTICK_5:
+			switch (state) {
+				case State::None: state = State::Fence; fence = level; break;
+				case State::Fence: if (level >= fence) { state = State::None; } break;
+				default: state = State::Unknown; break;
+			}
+			break;
+
+		case LINE_FENCE_BACKTICK_START_3:
+		case LINE_FENCE_BACKTICK_START_4:
+		case LINE_FENCE_BACKTICK_START_5:
+			switch (state) {
+				case State::None: state = State::Fence; fence = level; break;
+				case State::Fence: if (level >= fence) { state = State::Unknown; } break;
+				default: state = State::Unknown; break;
+			}
+			break;
+
+		case LINE_START_COMMENT:
+			switch (state) {
+				case State::None: state = State::Comment; break;
+				case State::Comment: state = State::Unknown; break;
+				default: break;
+			}
+			break;
+
+		case LINE_STOP_COMMENT:
+			if (state == State::Comment) {
+				state = State::None;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+static constexpr size_t ChunkSize = 8 * 1024; // minimal size of chunk, when it can be split
+
+static void mmd_shift_tokens(token *t, int64_t offset) {
+	while (t) {
+		t->start = uint32_t(int64_t(t->start) + offset);
+		if (t->child) {
+			mmd_shift_tokens(t->child, offset);
+		}
+		t = t->next;
+	}
+}
+
+size_t Engine::Internal::splitChunks(size_t start, Content::Vector<Chunk> &ret, const Chunk *next, size_t count,
+		int64_t offset, size_t minStop) {
+	size_t idx = 0;
+	size_t chunkStart = start;
+	size_t pos = start;
+	const size_t end = source.size();
+
+	auto p = memory::pool::create(pool);
+	memory::pool::push(p);
+
+	do {
+		// splitter should be destroyed before it's pool
+		ChunkSplitter splitter(engine, content.getExtensions());
+
+		while (pos < end) {
+			auto nl = (const char *)memchr(source.data() + pos, '\n', end - pos);
+			size_t lineEnd = nl ? size_t(nl - source.data()) + 1 : end;
+
+			if (splitter.readLine(pos, lineEnd - pos)) {
+				if (next && pos >= minStop) {
+					while (idx < count && int64_t(next[idx].start) + offset < int64_t(pos)) {
+						++ idx;
+					}
+					if (idx < count && int64_t(next[idx].start) + offset == int64_t(pos)) {
+						// rest of the source will be split in the same way as before
+						break;
+					}
+				}
+
+				if (pos - chunkStart >= ChunkSize) {
+					ret.emplace_back(chunkStart, pos - chunkStart);
+					chunkStart = pos;
+				}
+			}
+
+			pos = lineEnd;
+		}
+	} while (0);
+
+	memory::pool::pop();
+	memory::pool::destroy(p);
+
+	if (pos > chunkStart) {
+		ret.emplace_back(chunkStart, pos - chunkStart);
+	}
+
+	return (pos < end) ? idx : count;
+}
+
+void Engine::Internal::parseChunk(Chunk &chunk) {
+	memory::pool::push(chunk.pool);
+
+	chunk.content = new (chunk.pool) Content(content.getExtensions());
+
+	mmd_engine e = engine;
+	e.root = nullptr;
+	e.recurse_depth = 0;
+	e.definition_stack = (void *)&chunk.content->getDefinitions();
+	e.header_stack = (void *)&chunk.content->getHeaders();
+	e.table_stack = (void *)&chunk.content->getTables();
+	e.content = chunk.content;
+
+	token * doc = sp_mmd_mmd_tokenize_string(&e, chunk.start, chunk.len, false);
+
+	// tokenizer adds empty line after last line break, but only last chunk actually has it
+	if (chunk.start + chunk.len < source.size() && doc->child && doc->child != doc->child->tail
+			&& doc->child->tail->type == LINE_EMPTY && !doc->child->tail->child) {
+		sp_mmd_token_remove_last_child(doc);
+	}
+
+	sp_mmd_parse_token_chain(&e, doc);
+
+	sp_mmd_assign_ambidextrous_tokens_in_block(&e, doc, 0);
+
+	TokenVec pair_stack; pair_stack.reserve(64);
+
+	mmd_pair_tokens_in_block(doc, pairs->pairings1, pair_stack);
+	mmd_pair_tokens_in_block(doc, pairs->pairings2, pair_stack);
+	mmd_pair_tokens_in_block(doc, pairs->pairings3, pair_stack);
+	mmd_pair_tokens_in_block(doc, pairs->pairings4, pair_stack);
+
+	pair_emphasis_tokens(source, doc);
+
+	chunk.content->processPart(source);
+
+	chunk.first = doc->child;
+	chunk.last = doc->child ? doc->child->tail : nullptr;
+
+	memory::pool::pop();
+}
+
+// previous tree is split back into chunks
+void Engine::Internal::unlinkChunks() {
+	for (auto &it : chunks) {
+		if (it.first) {
+			it.first->prev = nullptr;
+			it.first->tail = it.last;
+			it.last->next = nullptr;
+		}
+	}
+}
+
+void Engine::Internal::parseChunks() {
+	Content::Vector<Chunk *> fresh;
+	for (auto &it : chunks) {
+		if (it.fresh) {
+			if (it.pool) {
+				memory::pool::destroy(it.pool);
+			}
+			// chunk can be parsed on other thread, so it uses it's own allocator
+			it.pool = memory::pool::create((memory::pool_t *)nullptr);
+			it.first = it.last = nullptr;
+			fresh.emplace_back(&it);
+		}
+	}
+
+	if (threads > 1 && fresh.size() > 1) {
+		auto queue = Rc<thread::TaskQueue>::alloc(std::min(size_t(threads), fresh.size()));
+		queue->spawnWorkers();
+		for (auto &it : fresh) {
+			queue->perform(Rc<thread::Task>::create([this, it] (const thread::Task &) -> bool {
+				parseChunk(*it);
+				return true;
+			}));
+		}
+		queue->waitForAll();
+		queue->cancelWorkers();
+	} else {
+		for (auto &it : fresh) {
+			parseChunk(*it);
+		}
+	}
+}
+
+bool Engine::Internal::prepareChunks() {
+	memory::pool::push(pool);
+
+	if (chunks.empty()) {
+		splitChunks(0, chunks);
+	}
+
+	unlinkChunks();
+
+	const bool search = !content.getExtensions().hasFlag(Extensions::Compatibility);
+	uint64_t hash = 0;
+
+	while (true) {
+		parseChunks();
+
+		Content::Vector<const Content *> parts; parts.reserve(chunks.size());
+		for (auto &it : chunks) {
+			parts.emplace_back(it.content);
+		}
+
+		content.reset();
+		content.processParts(parts);
+
+		hash = 0;
+		if (search && content.getAbbreviations().size() + content.getGlossary().size() > 0) {
+			StringStreamType stream;
+			for (auto &it : content.getAbbreviations()) {
+				stream << it->label_text << '\0';
+			}
+			stream << '\0';
+			for (auto &it : content.getGlossary()) {
+				stream << it->clean_text << '\0';
+			}
+			hash = hash::hash64(stream.data(), stream.size());
+		}
+
+		if (hash != searchHash) {
+			// reused chunks was searched with other terms
+			bool reused = false;
+			for (auto &it : chunks) {
+				if (!it.fresh) {
+					it.fresh = reused = true;
+				}
+			}
+			searchHash = hash;
+			if (reused) {
+				continue;
+			}
+		}
+		break;
+	}
+
+	// Process abbreviations, glossary, etc.
+	if (hash) {
+		Trie ac;
+		for (auto &it : content.getAbbreviations()) {
+			ac.insert(it->label_text.data(), PAIR_BRACKET_ABBREVIATION);
+		}
+
+		for (auto &it : content.getGlossary()) {
+			ac.insert(it->clean_text.data(), PAIR_BRACKET_GLOSSARY);
+		}
+
+		ac.prepare();
+		for (auto &it : chunks) {
+			if (it.fresh && it.first) {
+				memory::pool::push(it.pool);
+				automatic_search(source.data(), it.first, ac);
+				memory::pool::pop();
+			}
+		}
+	}
+
+	if (!chunksRoot) {
+		chunksRoot = sp_mmd_token_new(DOC_START_TOKEN, 0, 0);
+	}
+
+	chunksRoot->child = nullptr;
+	chunksRoot->len = 0;
+	for (auto &it : chunks) {
+		if (it.first) {
+			it.last = it.first->tail;
+			sp_mmd_token_append_child(chunksRoot, it.first);
+		}
+		it.fresh = false;
+	}
+
+	engine.root = chunksRoot;
+
+	memory::pool::pop();
+
+	return engine.root != nullptr;
+}
+
+void Engine::Internal::update(const StringView &str, size_t start, size_t oldLen, size_t newLen) {
+	const int64_t offset = int64_t(newLen) - int64_t(oldLen);
+
+	source = str;
+	engine.str = str.data();
+	engine.len = str.size();
+
+	reset();
+
+	if (!chunked || chunks.empty()) {
+		chunked = true;
+		return;
+	}
+
+	memory::pool::push(pool);
+
+	unlinkChunks();
+
+	// chunk with first changed line and previous one, which can be merged with it, are split again
+	size_t first = 0;
+	while (first + 1 < chunks.size() && chunks[first + 1].start + 1 <= start) {
+		++ first;
+	}
+	if (first > 0) {
+		-- first;
+	}
+
+	Content::Vector<Chunk> split;
+	auto next = splitChunks(chunks[first].start, split, chunks.data() + first + 1, chunks.size() - first - 1,
+			offset, start + newLen) + first + 1;
+
+	Content::Vector<Chunk> tmp; tmp.reserve(first + split.size() + chunks.size() - next);
+	for (size_t i = 0; i < first; ++ i) {
+		tmp.emplace_back(chunks[i]);
+	}
+	for (size_t i = first; i < next; ++ i) {
+		if (chunks[i].pool) {
+			memory::pool::destroy(chunks[i].pool);
+		}
+	}
+	for (auto &it : split) {
+		tmp.emplace_back(it);
+	}
+	for (size_t i = next; i < chunks.size(); ++ i) {
+		tmp.emplace_back(chunks[i]);
+
+		auto &it = tmp.back();
+		it.start = size_t(int64_t(it.start) + offset);
+		if (offset != 0) {
+			mmd_shift_tokens(it.first, offset);
+		}
+	}
+
+	chunks = move(tmp);
+
+	memory::pool::pop();
+}
+
 void Engine::Internal::reset() {
 	if (engine.root) {
 		engine.root = nullptr;
@@ -464,6 +939,29 @@ QuotesLanguage Engine::getQuotesLanguage() const {
 	return (_internal)?_internal->content.getQuotesLanguage():QuotesLanguage::English;
 }
 
+void Engine::setParsingThreads(uint16_t value) {
+	if (_internal) {
+		_internal->threads = std::max(value, uint16_t(1));
+		if (_internal->threads > 1 && !_internal->chunked) {
+			_internal->reset();
+			_internal->chunked = true;
+		}
+	}
+}
+
+uint16_t Engine::getParsingThreads() const {
+	return (_internal)?_internal->threads:1;
+}
+
+bool Engine::update(const StringView &source, size_t start, size_t oldLen, size_t newLen) {
+	if (!_internal || start + newLen > source.size() || source.size() + oldLen != _internal->source.size() + newLen) {
+		return false;
+	}
+
+	_internal->update(source, start, oldLen, newLen);
+	return true;
+}
+
 void Engine::process(const ProcessCallback &cb) {
 	if (_internal) {
 		_internal->process(cb);
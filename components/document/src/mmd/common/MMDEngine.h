@@ -61,6 +61,15 @@ public:
 	void setQuotesLanguage(QuotesLanguage);
 	QuotesLanguage getQuotesLanguage() const;
 
+	// Source is split into chunks of top-level blocks, that can be parsed independently,
+	// chunks are parsed on `threads` workers when there is more than one
+	void setParsingThreads(uint16_t);
+	uint16_t getParsingThreads() const;
+
+	// `oldLen` bytes at `start` of previous source was replaced with `newLen` bytes, `source` is the new full text;
+	// only chunks, touched by this edit, are parsed again, token trees of other chunks are reused
+	bool update(const StringView &source, size_t start, size_t oldLen, size_t newLen);
+
 	void process(const ProcessCallback &);
 
 protected:
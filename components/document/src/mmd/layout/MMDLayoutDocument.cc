@@ -502,4 +502,9 @@ layout::Style LayoutDocument::endStyle(const Node &node, const Vector<const Node
 	return Document::endStyle(node, stack, media);
 }
 
+// table rows in tbody are striped by child index in beginStyle
+bool LayoutDocument::canShareStyle(const Node &node, const Node &sibling, const Vector<const Node *> &stack) const {
+	return node.getHtmlName() != "tr";
+}
+
 NS_MMD_END
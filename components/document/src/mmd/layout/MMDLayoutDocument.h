@@ -51,6 +51,8 @@ public:
 	// Default style, that can NOT be redefined with css
 	virtual Style endStyle(const Node &, const Vector<const Node *> &, const MediaParameters &) const override;
 
+	virtual bool canShareStyle(const Node &, const Node &sibling, const Vector<const Node *> &) const override;
+
 protected:
 	friend class LayoutProcessor;
 
@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include "SPCommon.h"
 #include "MMDHtmlOutputProcessor.h"
 #include "MMDEngine.h"
+#include "SPLog.h"
 
 NS_MMD_BEGIN
 
@@ -58,7 +59,7 @@ void HtmlOutputProcessor::pushNode(token *t, const StringView &name, InitList &&
 		}
 	}
 	*output << ">";
-	tagStack.emplace_back(name, 0);
+	tagStack.emplace_back(String(name.data(), name.size()), 0);
 }
 
 void HtmlOutputProcessor::pushInlineNode(token *t, const StringView &name, InitList &&attr, VecList && vec) {
@@ -79,6 +80,12 @@ void HtmlOutputProcessor::pushInlineNode(token *t, const StringView &name, InitL
 
 void HtmlOutputProcessor::popNode() {
 	flushBuffer();
+	// malformed blocks (e.g. definitions with broken paragraphs, or closing raw html tags) can close more nodes,
+	// than was opened
+	if (tagStack.empty()) {
+		log::text("MMD", "HtmlOutputProcessor: node was closed, but there are no open nodes");
+		return;
+	}
 	*output << "</" << tagStack.back().first << ">";
 	tagStack.pop_back();
 }
@@ -39,7 +39,8 @@ protected:
 
 	virtual void flushBuffer() override;
 
-	Vector<Pair<StringView, size_t>> tagStack;
+	// names are copied: raw html in block can close block's node, so node can outlive name, that was passed to pushNode
+	Vector<Pair<String, size_t>> tagStack;
 };
 
 NS_MMD_END
@@ -932,8 +932,6 @@ void HtmlProcessor::exportPairBracketCitation(std::ostream &out, token *t) {
 		// Classify this use
 		auto temp_short2 = used_citations.size();
 		auto temp_note = parseCitationBracket(t);
-		auto temp_short = temp_note->count;
-
 		if (!temp_note) {
 			// This instance is not properly formed
 			out << "[#";
@@ -942,6 +940,8 @@ void HtmlProcessor::exportPairBracketCitation(std::ostream &out, token *t) {
 			return;
 		}
 
+		auto temp_short = temp_note->count;
+
 		if (temp_bool) {
 			// This is a regular citation
 
@@ -995,9 +995,6 @@ void HtmlProcessor::exportPairBracketFootnote(std::ostream &out, token *t) {
 		// Classify this use
 		auto temp_short2 = used_footnotes.size();
 		auto temp_note = parseFootnoteBracket(t);
-		auto temp_short = temp_note->count;
-		uint16_t temp_short3 = 0;
-
 		if (!temp_note) {
 			// This instance is not properly formed
 			out << "[^";
@@ -1006,6 +1003,9 @@ void HtmlProcessor::exportPairBracketFootnote(std::ostream &out, token *t) {
 			return;
 		}
 
+		auto temp_short = temp_note->count;
+		uint16_t temp_short3 = 0;
+
 		if (content->getExtensions().hasFlag(Extensions::RandomFoot)) {
 			srand(unsigned(random_seed_base + temp_short));
 			temp_short3 = rand() % 32000 + 1;
@@ -1038,8 +1038,6 @@ void HtmlProcessor::exportPairBracketGlossary(std::ostream &out, token *t) {
 		// Classify this use
 		auto temp_short2 = used_glossaries.size();
 		auto temp_note = parseGlossaryBracket(t);
-		auto temp_short = temp_note->count;
-
 		if (!temp_note) {
 			// This instance is not properly formed
 			out << "[?";
@@ -1052,6 +1050,7 @@ void HtmlProcessor::exportPairBracketGlossary(std::ostream &out, token *t) {
 			return;
 		}
 
+		auto temp_short = temp_note->count;
 		String ref = Traits::toString("#gn_", temp_short);
 		if (temp_short2 == used_glossaries.size()) {
 			pushNode(nullptr, "a", { pair("href", ref), pair("title", localize("see glossary")), pair("class", "glossary") });
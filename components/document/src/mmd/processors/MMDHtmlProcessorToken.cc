@@ -960,8 +960,9 @@ void HtmlProcessor::exportFootnoteList(std::ostream &out) {
 		padded = 0;
 
 		auto i = 0;
-		for (auto &it : used_footnotes) {
-			auto & note = it;
+		// notes can reference other notes, that are added to the list while exporting, so, list is iterated by index
+		for (size_t n = 0; n < used_footnotes.size(); ++ n) {
+			auto note = used_footnotes[n];
 			pad(out, 2);
 
 			String id = Traits::toString("fn_", (i + 1));
@@ -1020,8 +1021,8 @@ void HtmlProcessor::exportGlossaryList(std::ostream &out) {
 		padded = 0;
 
 		auto i = 0;
-		for (auto &it : used_glossaries) {
-			auto & note = it;
+		for (size_t n = 0; n < used_glossaries.size(); ++ n) {
+			auto note = used_glossaries[n];
 			// Export glossary
 			pad(out, 2);
 
@@ -1085,8 +1086,8 @@ void HtmlProcessor::exportCitationList(std::ostream &out) {
 		padded = 0;
 
 		auto i = 0;
-		for (auto &it : used_citations) {
-			auto & note = it;
+		for (size_t n = 0; n < used_citations.size(); ++ n) {
+			auto note = used_citations[n];
 			// Export footnote
 			pad(out, 2);
 
@@ -537,64 +537,87 @@ static auto s_manifestBegin = R"(<?xml version="1.0" encoding="UTF-8"?>
 static auto s_manifestEnd = R"(</manifest:manifest>
 )";
 
-Buffer Document::save() const {
-	stappler::ZipArchive<Interface> archive;
+template <typename Archive>
+bool Document::writeArchive(Archive &archive) const {
+	Buffer tmp;
 
-	auto writeData = [&] () -> bool {
-		Buffer tmp;
+	auto cb = [&] (const StringView &bytes) {
+		tmp.put(bytes.data(), bytes.size());
+	};
 
-		auto cb = [&] (const StringView &bytes) {
-			tmp.put(bytes.data(), bytes.size());
-		};
+	if (!archive.addFile("mimetype", "application/vnd.oasis.opendocument.text", true)) {
+		return false;
+	}
 
-		cb << s_manifestBegin <<"<manifest:file-entry manifest:full-path=\"/\" manifest:version=\"1.2\" manifest:media-type=\"";
-		switch (_type) {
-		case DocumentType::Text: cb << "application/vnd.oasis.opendocument.text"; break;
-		}
-		cb << "\"/>\n";
+	cb << s_manifestBegin <<"<manifest:file-entry manifest:full-path=\"/\" manifest:version=\"1.2\" manifest:media-type=\"";
+	switch (_type) {
+	case DocumentType::Text: cb << "application/vnd.oasis.opendocument.text"; break;
+	}
+	cb << "\"/>\n";
 
-		for (auto &it : _files) {
-			cb << "<manifest:file-entry manifest:full-path=\"" << Escaped(it.name) << "\" manifest:media-type=\""
-				<< Escaped(it.type) << "\"/>\n";
-		}
+	for (auto &it : _files) {
+		cb << "<manifest:file-entry manifest:full-path=\"" << Escaped(it.name) << "\" manifest:media-type=\""
+			<< Escaped(it.type) << "\"/>\n";
+	}
 
-		cb << s_manifestEnd;
-		archive.addFile("META-INF/manifest.xml", tmp.get());
-		tmp.clear();
+	cb << s_manifestEnd;
+	archive.addFile("META-INF/manifest.xml", tmp.get());
+	tmp.clear();
 
-		for (auto &it : _files) {
-			switch (it.fileType) {
-			case Text:
-			case Binary:
-				if (!archive.addFile(it.name, BytesView((const uint8_t *)it.data.data(), it.data.size()))) {
+	for (auto &it : _files) {
+		switch (it.fileType) {
+		case Text:
+		case Binary:
+			if (!archive.addFile(it.name, BytesView((const uint8_t *)it.data.data(), it.data.size()))) {
+				return false;
+			}
+			break;
+		case Filesystem: {
+			auto bytes = stappler::filesystem::readIntoMemory(StringView((const char *)it.data.data(), it.data.size() - 1));
+			if (!archive.addFile(it.name, BytesView((const uint8_t *)bytes.data(), bytes.size()))) {
+				return false;
+			}
+			break;
+		}
+		case Functional:
+			if constexpr (std::is_same<Archive, stappler::ZipWriter>::value) {
+				// streaming writer compresses callback output without intermediate buffer
+				if (!archive.beginFile(it.name)) {
 					return false;
 				}
-				break;
-			case Filesystem: {
-				auto bytes = stappler::filesystem::readIntoMemory(StringView((const char *)it.data.data(), it.data.size() - 1));
-				if (!archive.addFile(it.name, BytesView((const uint8_t *)bytes.data(), bytes.size()))) {
+				it.callback([&] (const StringView &bytes) {
+					archive.write(bytes);
+				});
+				if (!archive.endFile()) {
 					return false;
 				}
-				break;
-			}
-			case Functional:
+			} else {
 				it.callback([&] (const StringView &bytes) {
 					tmp.put(bytes.data(), bytes.size());
 				});
 				archive.addFile(it.name, tmp.get());
 				tmp.clear();
-				break;
 			}
+			break;
 		}
-		return true;
-	};
+	}
+	return true;
+}
 
-	if (archive.addFile("mimetype", "application/vnd.oasis.opendocument.text", true)) {
-		if (writeData()) {
-			return archive.save();
-		}
+Buffer Document::save() const {
+	stappler::ZipArchive<Interface> archive;
+	if (writeArchive(archive)) {
+		return archive.save();
 	}
 	return Buffer();
 }
 
+bool Document::save(const stappler::io::Consumer &consumer, stappler::thread::TaskQueue *queue) const {
+	stappler::ZipWriter archive(consumer, queue);
+	if (writeArchive(archive)) {
+		return archive.finalize();
+	}
+	return false;
+}
+
 }
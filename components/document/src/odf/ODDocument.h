@@ -6,6 +6,12 @@
 #include "ODStyle.h"
 #include "ODContent.h"
 
+namespace stappler::thread {
+
+class TaskQueue;
+
+}
+
 namespace opendocument {
 
 class Document : public AllocBase {
@@ -22,6 +28,9 @@ public: // content
 
 	Buffer save() const;
 
+	// writes archive into consumer while entries are produced; with queue, entries are compressed in parallel
+	bool save(const stappler::io::Consumer &, stappler::thread::TaskQueue * = nullptr) const;
+
 public: // meta
 	void setMetaGenerator(const StringView &);
 	StringView getMetaGenerator() const;
@@ -82,6 +91,9 @@ public: // meta
 	MasterPage *addMasterPage(const StringView &, const style::Style *pageLayout);
 
 protected:
+	template <typename Archive>
+	bool writeArchive(Archive &) const;
+
 	void setUserMetaType(const StringView &, const StringView &, MetaFormat);
 
 	void setMeta(MetaType, const StringView &);
@@ -488,14 +488,10 @@ size_t ListenerView::Selection::getSelectedSourceIndex() const {
 }
 
 const rich_text::Object *ListenerView::Selection::getSelectedObject(rich_text::Result *res, const Vec2 &loc) const {
-	auto &objs = res->getObjects();
-	for (auto &it : objs) {
+	for (auto &it : res->hitTest(loc, 8.0f)) {
 		if (it->isLabel()) {
 			if (_mode != SelectMode::Indexed || (!it->asLabel()->hash.empty() && it->asLabel()->sourceIndex != 0)) {
-				if (loc.x >= it->bbox.getMinX() - 8.0f && loc.x <= it->bbox.getMaxX() + 8.0f
-						&& loc.y >= it->bbox.getMinY() - 8.0f && loc.y <= it->bbox.getMaxY() + 8.0f) {
-					return it;
-				}
+				return it;
 			}
 		}
 	}
@@ -598,8 +594,7 @@ void ListenerView::onTap(int count, const Vec2 &vec) {
 		if (_linksEnabled) {
 			if (auto res = getResult()) {
 				auto loc = convertToObjectSpace(vec);
-				auto &objs = res->getRefs();
-				for (auto &it : objs) {
+				for (auto &it : res->hitTestRefs(loc, getObjectTapPadding())) {
 					if (isObjectTapped(loc, *it)) {
 						return;
 					}
@@ -249,20 +249,25 @@ void View::onId(const StringView &ref, const StringView &target, const Vec2 &vec
 	}
 
 	if (ids.size() == 1) {
+		// node is valid only while document pages are locked
+		bool processed = true;
+		doc->lockPages();
 		auto node = doc->getNodeByIdGlobal(ids.front());
-
 		if (!node.first || !node.second) {
-			return;
-		}
-
-		if (node.second->getHtmlName() == "figure") {
+			// node not found, nothing to display
+		} else if (node.second->getHtmlName() == "figure") {
 			onFigure(node.second);
-			return;
+		} else {
+			auto attrIt = node.second->getAttributes().find("x-type");
+			if (node.second->getHtmlName() == "img" || (attrIt != node.second->getAttributes().end() && attrIt->second == "image")) {
+				onImage(ids.front(), vec);
+			} else {
+				processed = false;
+			}
 		}
+		doc->unlockPages();
 
-		auto attrIt = node.second->getAttributes().find("x-type");
-		if (node.second->getHtmlName() == "img" || (attrIt != node.second->getAttributes().end() && attrIt->second == "image")) {
-			onImage(ids.front(), vec);
+		if (processed) {
 			return;
 		}
 	}
@@ -289,9 +294,12 @@ void View::onId(const StringView &ref, const StringView &target, const Vec2 &vec
 }
 
 void View::onImage(const StringView &id, const Vec2 &) {
-	auto node = _source->getDocument()->getNodeByIdGlobal(id);
+	auto doc = _source->getDocument();
+	doc->lockPages();
 
+	auto node = doc->getNodeByIdGlobal(id);
 	if (!node.first || !node.second) {
+		doc->unlockPages();
 		return;
 	}
 
@@ -343,6 +351,8 @@ void View::onImage(const StringView &id, const Vec2 &) {
 		}
 	}
 
+	doc->unlockPages();
+
 	if (view) {
 		material::Scene::getRunningScene()->pushContentNode(view);
 	}
@@ -165,7 +165,8 @@ bool CommonView::isObjectActive(const Object &obj) const {
 
 bool CommonView::isObjectTapped(const Vec2 & loc, const Object &obj) const {
 	if (obj.type == layout::Object::Type::Ref) {
-		if (loc.x >= obj.bbox.getMinX() - 8.0f && loc.x <= obj.bbox.getMaxX() + 8.0f && loc.y >= obj.bbox.getMinY() - 8.0f && loc.y <= obj.bbox.getMaxY() + 8.0f) {
+		auto padding = getObjectTapPadding();
+		if (loc.x >= obj.bbox.getMinX() - padding && loc.x <= obj.bbox.getMaxX() + padding && loc.y >= obj.bbox.getMinY() - padding && loc.y <= obj.bbox.getMaxY() + padding) {
 			return true;
 		}
 		return false;
@@ -174,6 +175,10 @@ bool CommonView::isObjectTapped(const Vec2 & loc, const Object &obj) const {
 	}
 }
 
+float CommonView::getObjectTapPadding() const {
+	return 8.0f;
+}
+
 void CommonView::onObjectPressBegin(const Vec2 &, const Object &obj) { }
 
 void CommonView::onObjectPressEnd(const Vec2 &, const Object &obj) { }
@@ -196,7 +201,7 @@ bool CommonView::onPressBegin(const Vec2 &vec) {
 
 	if (_linksEnabled) {
 		auto loc = convertToObjectSpace(vec);
-		for (auto &it : refs) {
+		for (auto &it : res->hitTestRefs(loc, getObjectTapPadding())) {
 			if (isObjectTapped(loc, *it)) {
 				onObjectPressBegin(vec, *it);
 				return true;
@@ -225,7 +230,7 @@ bool CommonView::onPressEnd(const Vec2 &vec, const TimeInterval &r) {
 
 	if (_linksEnabled) {
 		auto loc = convertToObjectSpace(vec);
-		for (auto &it : refs) {
+		for (auto &it : res->hitTestRefs(loc, getObjectTapPadding())) {
 			if (isObjectActive(*it)) {
 				if (isObjectTapped(loc, *it)) {
 					onObjectPressEnd(vec, *it);
@@ -79,6 +79,7 @@ protected:
 	virtual Vec2 convertToObjectSpace(const Vec2 &) const;
 	virtual bool isObjectActive(const Object &) const;
 	virtual bool isObjectTapped(const Vec2 &, const Object &) const;
+	virtual float getObjectTapPadding() const; // extra tap area around active objects, in object space
 	virtual void onObjectPressBegin(const Vec2 &, const Object &); // called with original world location
 	virtual void onObjectPressEnd(const Vec2 &, const Object &); // called with original world location
 
@@ -200,27 +200,23 @@ void Request::prepareBackgroundImage(const Rect &bbox, const Background &bg) {
 }
 
 void Request::draw(cocos2d::Texture2D *data) {
-	Vector<const Object *> drawObjects;
-	auto &objs = _result->getObjects();
-	for (auto &obj : objs) {
-		if (obj->bbox.intersectsRect(_rect)) {
-			drawObjects.push_back(obj);
-			if (obj->type == Object::Type::Label) {
-				auto l = obj->asLabel();
-				for (auto &it : l->format.ranges) {
-					_font->addTextureChars(it.layout->getName(), l->format.chars, it.start, it.count);
-				}
-			} else if (obj->type == Object::Type::Background && !_isThumbnail) {
-				auto bg = obj->asBackground();
-				if (!bg->background.backgroundImage.empty()) {
-					prepareBackgroundImage(obj->bbox, bg->background);
-				}
+	Vector<const Object *> drawObjects = _result->query(_rect);
+	for (auto &obj : drawObjects) {
+		if (obj->type == Object::Type::Label) {
+			auto l = obj->asLabel();
+			for (auto &it : l->format.ranges) {
+				_font->addTextureChars(it.layout->getName(), l->format.chars, it.start, it.count);
+			}
+		} else if (obj->type == Object::Type::Background && !_isThumbnail) {
+			auto bg = obj->asBackground();
+			if (!bg->background.backgroundImage.empty()) {
+				prepareBackgroundImage(obj->bbox, bg->background);
 			}
 		}
 	}
 
-	for (auto &obj : _result->getRefs()) {
-		if (obj->bbox.intersectsRect(_rect) && obj->type == Object::Type::Ref) {
+	for (auto &obj : _result->queryRefs(_rect)) {
+		if (obj->type == Object::Type::Ref) {
 			auto link = obj->asLink();
 			if (link->mode == "video" && !_isThumbnail) {
 				drawObjects.push_back(obj);
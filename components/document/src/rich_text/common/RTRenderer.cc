@@ -56,6 +56,9 @@ Renderer::~Renderer() {
 	if (_drawer) {
 		_drawer->free();
 	}
+	if (_layoutQueue) {
+		_layoutQueue->cancelWorkers();
+	}
 }
 
 bool Renderer::init(const Vector<String> &ids) {
@@ -287,6 +290,16 @@ bool Renderer::requestRendering() {
 		layout::Builder * impl = new layout::Builder(document, media, fontSet, _ids);
 		impl->setExternalAssetsMeta(s->getExternalAssetMeta());
 		impl->setHyphens(s->getHyphens());
+		impl->setCacheEnabled(true);
+		if (!_styleCache) {
+			_styleCache = Rc<layout::StyleCache>::create();
+		}
+		impl->setStyleCache(_styleCache);
+		if (!_layoutQueue && std::thread::hardware_concurrency() > 1) {
+			_layoutQueue = Rc<thread::TaskQueue>::alloc(uint16_t(std::thread::hardware_concurrency()));
+			_layoutQueue->spawnWorkers();
+		}
+		impl->setLayoutQueue(_layoutQueue);
 		_renderingInProgress = true;
 		if (_renderingCallback) {
 			_renderingCallback(nullptr, true);
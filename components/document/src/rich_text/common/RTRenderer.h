@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "RTCommon.h"
 #include "RTDrawer.h"
+#include "SLBuilder.h"
 #include "2d/CCComponent.h"
 
 NS_RT_BEGIN
@@ -99,6 +100,8 @@ protected:
 	Size _surfaceSize;
 	MediaParameters _media;
 	Rc<layout::Result> _result;
+	Rc<layout::StyleCache> _styleCache;
+	Rc<thread::TaskQueue> _layoutQueue; // workers for concurrent layout of spine, shared between renders
 	Rc<Drawer> _drawer;
 	RenderingCallback _renderingCallback = nullptr;
 };
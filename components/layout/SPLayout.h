@@ -81,6 +81,7 @@ class Result;
 class Node;
 class Reader;
 class Builder;
+class StyleCache;
 
 struct MediaParameters;
 class MediaResolver;
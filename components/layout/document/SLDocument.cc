@@ -322,7 +322,7 @@ void Document::storeData(const BytesViewNetwork &data) {
 }
 
 bool Document::prepare() {
-	if (!_pages.empty()) {
+	if (!_pages.empty() || !_spine.empty()) { // spine pages can be parsed on demand
 		updateNodes();
 		return true;
 	}
@@ -456,6 +456,10 @@ const ContentPage *Document::getContentPage(const StringView &name) const {
 	return nullptr;
 }
 
+void Document::lockPages() const { }
+
+void Document::unlockPages() const { }
+
 const Document::ImageMap & Document::getImages() const {
 	return _images;
 }
@@ -476,6 +480,16 @@ NodeId Document::getMaxNodeId() const {
 	return _maxNodeId;
 }
 
+uint64_t Document::getContentHash() const {
+	if (!_filePath.empty()) {
+		auto str = toString(_filePath, ":", filesystem::size(_filePath), ":", filesystem::mtime_v(_filePath).toMicros());
+		return hash::hash64(str.data(), str.size());
+	} else if (!_data.empty()) {
+		return hash::hash64((const char *)_data.data(), _data.size());
+	}
+	return 0;
+}
+
 const Node *Document::getNodeById(const StringView &path, const StringView &str) const {
 	if (auto page = getContentPage(path)) {
 		auto it = page->ids.find(str);
@@ -565,6 +579,10 @@ Style Document::endStyle(const Node &node, const Vector<const Node *> &stack, co
 	return Style();
 }
 
+bool Document::canShareStyle(const Node &node, const Node &sibling, const Vector<const Node *> &stack) const {
+	return true;
+}
+
 void Document::onStyleAttribute(Style &style, const StringView &tag, const StringView &name, const StringView &value, const MediaParameters &) const {
 	if (name == "align") {
 		style.read("text-align", value);
@@ -131,9 +131,14 @@ public:
 	const Vector<String> &getSpine() const;
 
 	const ContentPage *getRoot() const;
-	const ContentPage *getContentPage(const StringView &) const;
+	virtual const ContentPage *getContentPage(const StringView &) const;
 	const Node *getNodeById(const StringView &pagePath, const StringView &id) const;
-	Pair<const ContentPage *, const Node *> getNodeByIdGlobal(const StringView &id) const;
+	virtual Pair<const ContentPage *, const Node *> getNodeByIdGlobal(const StringView &id) const;
+
+	// Document can parse pages on first request and release them to fit into memory budget (see epub::Document);
+	// while pages are locked (e.g. by layout builder), nodes, received from document, stay valid
+	virtual void lockPages() const;
+	virtual void unlockPages() const;
 
 	const ImageMap & getImages() const;
 	const GalleryMap & getGalleryMap() const;
@@ -142,12 +147,18 @@ public:
 
 	NodeId getMaxNodeId() const;
 
+	// hash of document source, used as a part of layout cache key; 0 if document can not be cached
+	virtual uint64_t getContentHash() const;
+
 	// Default style, that can be redefined with css
 	virtual Style beginStyle(const Node &, const Vector<const Node *> &, const MediaParameters &) const;
 
 	// Default style, that can NOT be redefined with css
 	virtual Style endStyle(const Node &, const Vector<const Node *> &, const MediaParameters &) const;
 
+	// Can computed style of previous sibling be reused for node with same tag, attributes and parent
+	virtual bool canShareStyle(const Node &, const Node &sibling, const Vector<const Node *> &) const;
+
 protected:
 	Bytes readData(size_t offset, size_t len);
 
@@ -157,7 +168,7 @@ protected:
 
 	virtual void onStyleAttribute(Style &style, const StringView &tag, const StringView &name, const StringView &value, const MediaParameters &) const;
 
-	void updateNodes();
+	virtual void updateNodes();
 
 	Map<String, ContentPage> _pages;
 	Vector<String> _spine;
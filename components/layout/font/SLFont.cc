@@ -293,17 +293,19 @@ Rc<FontLayout> FontSource::getLayout(const FontParameters &style, float scale) {
 }
 
 Rc<FontLayout> FontSource::getLayout(const FontLayout *l) {
+	return getLayout(l->getFamily(), l->getStyle(), l->getSize());
+}
+
+Rc<FontLayout> FontSource::getLayout(const StringView &f, const FontParameters &dstyle, uint16_t dsize) {
 	Rc<FontLayout> ret = nullptr;
 
-	StringView family = l->getFamily();
+	StringView family = f;
 	if (family.empty()) {
 		family = StringView(FontSource_defaultFontFamily);
 	}
 
-	auto dstyle = l->getStyle();
 	auto face = getFontFace(family, dstyle);
 	if (face) {
-		auto dsize = l->getSize();
 		auto name = face->getConfigName(family, dsize);
 		_mutex.lock();
 		auto l_it = _layouts.find(name);
@@ -412,6 +414,31 @@ float FontSource::getFontScale() const {
 	return _fontScale;
 }
 
+uint64_t FontSource::getHash() const {
+	StringStream stream;
+	stream << _density << ":" << _fontScale;
+	for (auto &it : _fontFaces) {
+		stream << "|" << it.first;
+		for (auto &face : it.second) {
+			stream << ":" << int(toInt(face.fontStyle)) << "." << int(toInt(face.fontWeight)) << "." << int(toInt(face.fontStretch));
+			for (auto &src : face.src) {
+				if (!src.file.empty()) {
+					// font file can be replaced with the same name, so, its size and mtime are hashed too
+					stream << "." << src.file;
+					if (filesystem::exists(src.file)) {
+						stream << "." << filesystem::size(src.file) << "." << filesystem::mtime(src.file);
+					}
+				} else {
+					stream << "." << src.bytes.size() << "." << hash::hash64((const char *)src.bytes.data(), src.bytes.size());
+				}
+			}
+		}
+	}
+
+	auto str = stream.str();
+	return hash::hash64(str.data(), str.size());
+}
+
 void FontSource::update() {
 	if (_dirty) {
 		auto v = (++ _version);
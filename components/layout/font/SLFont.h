@@ -180,6 +180,7 @@ public:
 
 	Rc<FontLayout> getLayout(const FontParameters &, float scale = nan()); // returns persistent ptr, Layout will be created if needed
 	Rc<FontLayout> getLayout(const String &); // returns persistent ptr
+	Rc<FontLayout> getLayout(const StringView &family, const FontParameters &, uint16_t dsize); // layout for exact device font size
 
 	bool hasLayout(const FontParameters &);
 	bool hasLayout(const String &);
@@ -194,6 +195,9 @@ public:
 	float getFontScale() const;
 	void update();
 
+	// hash of persistent face map, scale and density; layouts from sources with same hash are interchangeable
+	uint64_t getHash() const;
+
 	String getFamilyName(uint32_t id) const;
 
 	void addTextureString(const String &, const String &);
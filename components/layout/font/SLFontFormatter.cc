@@ -1277,6 +1277,8 @@ uint32_t FormatSpec::selectChar(int32_t x, int32_t y, SelectMode mode) const {
 	return getChar(x, y, mode).first;
 }
 
+static constexpr size_t HyphenMap_WordCacheSize = 64 * 1024;
+
 HyphenMap::~HyphenMap() {
 	for (auto &it : _dicts) {
 		hnj_hyphen_free(it.second);
@@ -1298,6 +1300,7 @@ void HyphenMap::addHyphenDict(CharGroupId id, FilePath file) {
 				hnj_hyphen_free(it->second);
 				it->second = dict;
 			}
+			clearWordCache();
 		}
 	}
 }
@@ -1313,6 +1316,7 @@ void HyphenMap::addHyphenDict(CharGroupId id, BytesView data) {
 				hnj_hyphen_free(it->second);
 				it->second = dict;
 			}
+			clearWordCache();
 		}
 	}
 }
@@ -1322,6 +1326,27 @@ Vector<uint8_t> HyphenMap::makeWordHyphens(const char16_t *ptr, size_t len) {
 		return Vector<uint8_t>();
 	}
 
+	WideString key(ptr, len);
+	auto &shard = _words[hash::hash32((const char *)ptr, len * sizeof(char16_t)) % WordCacheShards];
+
+	std::unique_lock<Mutex> lock(shard.mutex);
+	auto it = shard.words.find(key);
+	if (it != shard.words.end()) {
+		return it->second;
+	}
+	lock.unlock();
+
+	auto ret = makeWordHyphensUncached(ptr, len);
+
+	lock.lock();
+	if (shard.words.size() >= HyphenMap_WordCacheSize / WordCacheShards) {
+		shard.words.clear();
+	}
+	shard.words.emplace(move(key), ret);
+	return ret;
+}
+
+Vector<uint8_t> HyphenMap::makeWordHyphensUncached(const char16_t *ptr, size_t len) {
 	HyphenDict *dict = nullptr;
 	for (auto &it : _dicts) {
 		if (inCharGroup(it.first, ptr[0])) {
@@ -1366,6 +1391,14 @@ void HyphenMap::purgeHyphenDicts() {
 	for (auto &it : _dicts) {
 		hnj_hyphen_free(it.second);
 	}
+	clearWordCache();
+}
+
+void HyphenMap::clearWordCache() {
+	for (auto &it : _words) {
+		std::unique_lock<Mutex> lock(it.mutex);
+		it.words.clear();
+	}
 }
 
 String HyphenMap::convertWord(HyphenDict *dict, const char16_t *ptr, size_t len) {
@@ -156,10 +156,25 @@ public:
 	Vector<uint8_t> makeWordHyphens(const WideStringView &);
 	void purgeHyphenDicts();
 
+	// hyphens are cached by word, so, relayout with another font size does not run dictionaries again
+	void clearWordCache();
+
 protected:
+	Vector<uint8_t> makeWordHyphensUncached(const char16_t *ptr, size_t len);
 	String convertWord(HyphenDict *, const char16_t *ptr, size_t len);
 
+	// word cache is sharded by word hash, so, builders for different spine items, that run in parallel,
+	// rarely wait for the same lock
+	static constexpr size_t WordCacheShards = 16;
+
+	struct WordCacheShard {
+		Mutex mutex;
+		Map<WideString, Vector<uint8_t>> words;
+	};
+
 	Map<CharGroupId, HyphenDict *> _dicts;
+
+	std::array<WordCacheShard, WordCacheShards> _words;
 };
 
 class Formatter {
@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "SLNode.h"
 #include "SLResult.h"
 #include "SPString.h"
+#include "SPThreadTaskQueue.h"
 
 //#define SP_RTBUILDER_LOG(...) log::format("RTBuilder", __VA_ARGS__)
 #define SP_RTBUILDER_LOG(...)
@@ -73,6 +74,111 @@ void Builder::compileNodeStyle(Style &style, const ContentPage *page, const Node
 	}
 }
 
+// how many siblings with distinct computed styles are kept per parent for style sharing
+static constexpr size_t Builder_StyleShareCandidates = 4;
+
+uint64_t Builder::StyleIndex::getKey(Kind kind, Atom tag, Atom name) {
+	return (uint64_t(kind) << 62) | (uint64_t(tag & 0x7FFFFFFF) << 31) | uint64_t(name & 0x7FFFFFFF);
+}
+
+Builder::StyleIndex::StyleIndex(const ContentPage::StyleMap &styles) {
+	auto intern = [&] (const StringView &str) -> Atom {
+		if (str.empty()) {
+			return 0;
+		}
+		auto it = atoms.find(str);
+		if (it == atoms.end()) {
+			it = atoms.emplace(str.str(), Atom(atoms.size() + 1)).first;
+		}
+		return it->second;
+	};
+
+	for (auto &it : styles) {
+		StringView sel(it.first);
+		if (sel == "*") {
+			universal = &it.second;
+			continue;
+		}
+
+		auto tag = sel.readUntil<StringView::Chars<'.', '#'>>();
+		if (sel.empty()) {
+			if (!tag.empty()) {
+				rules.emplace(getKey(Tag, intern(tag), 0), &it.second);
+			}
+		} else {
+			auto kind = sel.is('.') ? Class : Id;
+			++ sel;
+			if (!sel.empty()) {
+				rules.emplace(getKey(kind, intern(tag), intern(sel)), &it.second);
+			}
+		}
+	}
+}
+
+Builder::StyleIndex::Atom Builder::StyleIndex::getAtom(const StringView &str) const {
+	auto it = atoms.find(str);
+	if (it != atoms.end()) {
+		return it->second;
+	}
+	return 0;
+}
+
+const style::ParameterList *Builder::StyleIndex::get(Kind kind, Atom tag, Atom name) const {
+	auto it = rules.find(getKey(kind, tag, name));
+	if (it != rules.end()) {
+		return it->second;
+	}
+	return nullptr;
+}
+
+void Builder::compileNodeStyle(Style &style, const StyleIndex &index, const Node &node, const Vector<bool> &resolved) {
+	if (index.universal) {
+		style.merge(*index.universal, resolved, true);
+	}
+
+	if (index.rules.empty()) {
+		return;
+	}
+
+	auto tag = index.getAtom(node.getHtmlName());
+	if (tag) {
+		if (auto rule = index.get(StyleIndex::Tag, tag, 0)) {
+			style.merge(*rule, resolved);
+		}
+	}
+
+	auto &attr = node.getAttributes();
+	auto attr_it = attr.find("class");
+	if (attr_it != attr.end()) {
+		StringView v(attr_it->second);
+		v.split<StringView::CharGroup<CharGroupId::WhiteSpace>>([&] (const StringView &classStr) {
+			if (auto cl = index.getAtom(classStr)) {
+				if (auto rule = index.get(StyleIndex::Class, 0, cl)) {
+					style.merge(*rule, resolved);
+				}
+				if (tag) {
+					if (auto rule = index.get(StyleIndex::Class, tag, cl)) {
+						style.merge(*rule, resolved);
+					}
+				}
+			}
+		});
+	}
+
+	if (!node.getHtmlId().empty()) {
+		if (auto id = index.getAtom(node.getHtmlId())) {
+			if (auto rule = index.get(StyleIndex::Id, 0, id)) {
+				style.merge(*rule, resolved);
+			}
+			if (tag) {
+				if (auto rule = index.get(StyleIndex::Id, tag, id)) {
+					style.merge(*rule, resolved);
+				}
+			}
+		}
+	}
+}
+
 Builder::Builder(Document *doc, const MediaParameters &media, FontSource *cfg, const Vector<String> &spine) {
 	_document = doc;
 	_media = media;
@@ -106,7 +212,32 @@ Builder::Builder(Document *doc, const MediaParameters &media, FontSource *cfg, c
 	}
 }
 
-Builder::~Builder() { }
+// Builder for single spine item: shares document and final media parameters with origin,
+// but has it's own styles, layouts, contexts and result
+Builder::Builder(const Builder *origin) {
+	_document = origin->_document;
+	_media = origin->_media;
+	_margin = origin->_margin;
+	_fontSet = origin->_fontSet;
+	_externalAssets = origin->_externalAssets;
+	_hyphens = origin->_hyphens;
+	_maxNodeId = origin->_maxNodeId;
+	_styleCache = origin->_styleCache;
+	_styleCachePages = origin->_styleCachePages;
+
+	_result = Rc<Result>::create(_media, _fontSet, _document);
+
+	_layoutStack.reserve(4);
+}
+
+Builder::~Builder() {
+	for (auto &it : _spineBuilders) {
+		delete it;
+	}
+	if (_layoutQueue && _layoutQueueOwned) {
+		_layoutQueue->cancelWorkers();
+	}
+}
 
 void Builder::setExternalAssetsMeta(ExternalAssetsMap &&assets) {
 	_externalAssets = move(assets);
@@ -120,6 +251,57 @@ void Builder::setMargin(const Margin &m) {
 	_margin = m;
 }
 
+void Builder::setLayoutThreads(uint16_t count) {
+	_layoutThreads = std::max(count, uint16_t(1));
+}
+
+uint16_t Builder::getLayoutThreads() const {
+	return _layoutThreads;
+}
+
+void Builder::setLayoutQueue(thread::TaskQueue *queue) {
+	if (_layoutQueue && _layoutQueueOwned) {
+		_layoutQueue->cancelWorkers();
+	}
+	_layoutQueue = queue;
+	_layoutQueueOwned = false;
+	if (_layoutQueue) {
+		_layoutThreads = std::max(uint16_t(_layoutQueue->getThreadsCount()), uint16_t(1));
+	}
+}
+
+thread::TaskQueue *Builder::getLayoutQueue() const {
+	return _layoutQueue;
+}
+
+bool StyleCache::init() {
+	return true;
+}
+
+void StyleCache::clear() {
+	_document = nullptr;
+	_renderById = false;
+	_options.clear();
+	_resolvedMedia.clear();
+	_styles.clear();
+}
+
+void Builder::setStyleCache(StyleCache *cache) {
+	_styleCache = cache;
+}
+
+StyleCache *Builder::getStyleCache() const {
+	return _styleCache;
+}
+
+void Builder::setCacheEnabled(bool value) {
+	_cacheEnabled = value;
+}
+
+bool Builder::isCacheEnabled() const {
+	return _cacheEnabled;
+}
+
 Result *Builder::getResult() const {
 	return _result;
 }
@@ -222,8 +404,29 @@ const Style * Builder::compileStyle(const Node &node) {
 	}
 
 	it = styles.emplace(node.getNodeId(), Style()).first;
+	if (auto cached = getCachedStyle(node)) {
+		it->second = *cached;
+		if (push) {
+			_nodeStack.pop_back();
+		}
+		return &it->second;
+	}
+
+	if (_styleCache && !isMediaHooked() && node.getNodeId() <= _document->getMaxNodeId()) {
+		_stylePages.emplace_back(node.getNodeId(), _currentPage);
+	}
+
+	if (auto shared = getSharedStyle(node)) {
+		it->second = *shared;
+		if (push) {
+			_nodeStack.pop_back();
+		}
+		return &it->second;
+	}
+
+	const Node *parent = nullptr;
 	if (_nodeStack.size() > 1) {
-		const Node *parent = _nodeStack.at(_nodeStack.size() - 2);
+		parent = _nodeStack.at(_nodeStack.size() - 2);
 		if (parent) {
 			auto p_it = styles.find(parent->getNodeId());
 			if (p_it != styles.end()) {
@@ -237,15 +440,22 @@ const Style * Builder::compileStyle(const Node &node) {
 	for (auto &ref_it : _currentPage->styleReferences) {
 		if (auto page = _document->getContentPage(ref_it)) {
 			auto resv = resolvePage(page);
-			compileNodeStyle(it->second, page, node, _nodeStack, _media, *resv);
+			compileNodeStyle(it->second, *getStyleIndex(page), node, *resv);
 		}
 	}
 
-	compileNodeStyle(it->second, _currentPage, node, _nodeStack, _media, *_currentMedia);
+	compileNodeStyle(it->second, *_currentIndex, node, *_currentMedia);
 
 	it->second.merge(_document->endStyle(node, _nodeStack, _media));
 	it->second.merge(node.getStyle());
 
+	if (parent && node.getStyle().data.empty() && !isMediaHooked()) {
+		auto &siblings = _styleShare[parent];
+		if (siblings.size() < Builder_StyleShareCandidates) {
+			siblings.emplace_back(&node);
+		}
+	}
+
 	if (push) {
 		_nodeStack.pop_back();
 	}
@@ -392,6 +602,21 @@ void Builder::render() {
 		_spine = _document->getSpine();
 	}
 
+	uint64_t cacheKey = _cacheEnabled ? getCacheKey() : 0;
+	if (cacheKey) {
+		if (auto result = Result::readCache(Result::getCachePath(cacheKey), cacheKey, _media, _fontSet, _document)) {
+			_result = result;
+			return;
+		}
+	}
+
+	// pages of document can not be released while builder uses it's nodes
+	_document->lockPages();
+
+	if (_styleCache) {
+		loadStyleCache();
+	}
+
 	auto root = _document->getRoot();
 	setPage(root);
 	_nodeStack.push_back(&root->root);
@@ -437,6 +662,8 @@ void Builder::render() {
 						processChildNode(l, *node.second, pos, height, collapsableMarginTop, pageBreak);
 					}
 				}
+			} else if (pageBreak && _layoutThreads > 1 && _spine.size() > 1) {
+				renderSpine(l, pos, height, collapsableMarginTop);
 			} else {
 				for (auto &it : _spine) {
 					if (auto page = _document->getContentPage(it)) {
@@ -467,6 +694,320 @@ void Builder::render() {
 		addLayoutObjects(l);
 	}
 	_result->finalize();
+
+	if (_styleCache) {
+		storeStyleCache();
+	}
+
+	if (cacheKey) {
+		_result->writeCache(Result::getCachePath(cacheKey), cacheKey);
+	}
+
+	_document->unlockPages();
+}
+
+uint64_t Builder::getCacheKey() const {
+	auto contentHash = _document->getContentHash();
+	if (!contentHash) {
+		return 0;
+	}
+
+	Bytes data;
+	auto append = [&] (const void *ptr, size_t size) {
+		data.insert(data.end(), (const uint8_t *)ptr, (const uint8_t *)ptr + size);
+	};
+	auto appendValue = [&] (const auto &val) {
+		append(&val, sizeof(val));
+	};
+	auto appendString = [&] (const StringView &str) {
+		appendValue(uint32_t(str.size()));
+		append(str.data(), str.size());
+	};
+
+	appendValue(contentHash);
+	appendValue(_fontSet->getHash());
+	appendValue(bool(_hyphens));
+
+	appendValue(_media.surfaceSize.width);
+	appendValue(_media.surfaceSize.height);
+	appendValue(_media.dpi);
+	appendValue(_media.density);
+	appendValue(_media.fontScale);
+	appendValue(_media.mediaType);
+	appendValue(_media.orientation);
+	appendValue(_media.pointer);
+	appendValue(_media.hover);
+	appendValue(_media.lightLevel);
+	appendValue(_media.scripting);
+	appendValue(_media.flags);
+	for (auto &it : _media._options) {
+		appendValue(it.first);
+	}
+	appendValue(_media.pageMargin.top);
+	appendValue(_media.pageMargin.right);
+	appendValue(_media.pageMargin.bottom);
+	appendValue(_media.pageMargin.left);
+	appendValue(_media.defaultBackground);
+
+	appendValue(_margin.top);
+	appendValue(_margin.right);
+	appendValue(_margin.bottom);
+	appendValue(_margin.left);
+
+	for (auto &it : _spine) {
+		appendString(it);
+	}
+
+	for (auto &it : _externalAssets) {
+		appendString(it.first);
+		appendString(it.second.type);
+		appendValue(it.second.image.width);
+		appendValue(it.second.image.height);
+	}
+
+	return hash::hash64((const char *)data.data(), data.size());
+}
+
+void Builder::loadStyleCache() {
+	_styleCachePages.clear();
+
+	bool renderById = (_media.flags & RenderFlag::RenderById);
+	if (_styleCache->_document != _document || _styleCache->_renderById != renderById || _styleCache->_options != _media._options) {
+		_styleCache->clear();
+		_styleCache->_document = _document;
+		_styleCache->_renderById = renderById;
+		_styleCache->_options = _media._options;
+		return;
+	}
+
+	// only queries are resolved again, styles of page are compiled only if some of it's queries flipped
+	Set<const ContentPage *> unchanged;
+	for (auto &it : _styleCache->_resolvedMedia) {
+		if (_media.resolveMediaQueries(it.first->queries) == it.second) {
+			unchanged.emplace(it.first);
+		}
+	}
+
+	for (auto &page : unchanged) {
+		bool valid = true;
+		for (auto &ref : page->styleReferences) {
+			auto refPage = _document->getContentPage(ref);
+			if (refPage && unchanged.find(refPage) == unchanged.end()) {
+				valid = false;
+				break;
+			}
+		}
+		if (valid) {
+			_styleCachePages.emplace(page);
+		}
+	}
+}
+
+void Builder::storeStyleCache() {
+	auto &cache = *_styleCache;
+
+	for (auto it = cache._styles.begin(); it != cache._styles.end();) {
+		if (_styleCachePages.find(it->second.first) == _styleCachePages.end()) {
+			it = cache._styles.erase(it);
+		} else {
+			++ it;
+		}
+	}
+
+	for (auto it = cache._resolvedMedia.begin(); it != cache._resolvedMedia.end();) {
+		if (_styleCachePages.find(it->first) == _styleCachePages.end()) {
+			it = cache._resolvedMedia.erase(it);
+		} else {
+			++ it;
+		}
+	}
+
+	auto store = [&] (const Builder *b) {
+		for (auto &it : b->_stylePages) {
+			auto s_it = b->styles.find(it.first);
+			if (s_it != b->styles.end()) {
+				cache._styles[it.first] = pair(it.second, s_it->second);
+			}
+		}
+		for (auto &it : b->_resolvedMedia) {
+			cache._resolvedMedia[it.first] = it.second;
+		}
+	};
+
+	store(this);
+	for (auto &it : _spineBuilders) {
+		store(it);
+	}
+}
+
+// same as doPageBreak, but without layout modification
+static float Builder_getPageBreakPosition(const Layout *l, float y, float pageHeight) {
+	while (l) {
+		if (l->pos.margin.bottom > 0) {
+			y -= l->pos.margin.bottom;
+		}
+		if (l->pos.padding.bottom > 0) {
+			y -= l->pos.padding.bottom;
+		}
+		l = l->layouts.empty() ? nullptr : l->layouts.back();
+	}
+
+	float curr = std::ceil((y - 1.1f) / pageHeight);
+	return (y > 0) ? curr * pageHeight : y;
+}
+
+// In paginated layout every spine item starts from new page, so, items can be laid out independently
+// with separate builders. First pass lays out every item from the top of the page to count it's pages,
+// second pass lays out items from predicted positions. Then items are merged in spine order; item,
+// that was started from wrong position or depends on state of previous items (floats or inline context
+// in root layout), is laid out again sequentially, so, result is identical to sequential layout
+void Builder::renderSpine(Layout &l, Vec2 &pos, float &height, float &collapsableMarginTop) {
+	const float pageHeight = _media.surfaceSize.height;
+
+	// document can parse pages on demand, so, pages are requested by workers to be parsed in parallel
+	Vector<SpineItem> items; items.reserve(_spine.size());
+	for (auto &it : _spine) {
+		items.emplace_back(SpineItem{it});
+	}
+
+	if (items.empty()) {
+		return;
+	}
+
+	Vec2 start = pos;
+	doPageBreak(nullptr, start);
+
+	for (auto &it : items) {
+		it.start = Vec2(start.x, 0.0f);
+	}
+	items.front().start = start;
+	items.front().firstNodeId = _maxNodeId;
+
+	// own queue is spawned once and used for all spine renders of builder
+	if (!_layoutQueue) {
+		_layoutQueue = Rc<thread::TaskQueue>::alloc(_layoutThreads);
+		_layoutQueue->spawnWorkers();
+		_layoutQueueOwned = true;
+	}
+
+	auto queue = _layoutQueue.get();
+
+	auto perform = [&] (size_t first) {
+		for (size_t i = first; i < items.size(); ++ i) {
+			auto item = &items[i];
+			if (item->builder) {
+				delete item->builder;
+			}
+			item->builder = new Builder(this);
+			item->builder->_maxNodeId = item->firstNodeId;
+			queue->perform(Rc<thread::Task>::create([this, item, &l] (const thread::Task &) -> bool {
+				// pages are locked by render, lock on worker thread marks, that page is used only within layout
+				_document->lockPages();
+				if (!item->page) {
+					item->page = _document->getContentPage(item->name);
+				}
+				if (item->page) {
+					item->builder->renderSpineItem(l, *item);
+				} else {
+					// item, that can not be parsed, is skipped, next item starts from the same page
+					item->pos = item->start;
+					item->nextPage = roundf(item->start.y / item->builder->_media.surfaceSize.height);
+					item->nodeIds = 0;
+				}
+				_document->unlockPages();
+				return true;
+			}));
+		}
+		queue->waitForAll();
+	};
+
+	// number of generated node ids (e.g. for table cells) is not known before layout, so, in first pass
+	// remaining id space is divided between items; first item starts from the actual id, so it's result
+	// can be used as is
+	NodeId nextNodeId = _maxNodeId;
+	const NodeId nodeIdRange = (maxOf<NodeId>() - nextNodeId) / NodeId(items.size());
+	for (size_t i = 1; i < items.size(); ++ i) {
+		items[i].firstNodeId = nextNodeId + NodeId(i) * nodeIdRange;
+	}
+
+	perform(0);
+
+	// first item was laid out from it's actual position, next items - from the top of the page;
+	// second pass reserves exact id ranges, counted in first pass
+	float page = items.front().nextPage;
+	nextNodeId += items.front().nodeIds;
+	for (size_t i = 1; i < items.size(); ++ i) {
+		items[i].start = Vec2(start.x, page * pageHeight);
+		items[i].firstNodeId = nextNodeId;
+		page += items[i].nextPage;
+		nextNodeId += items[i].nodeIds;
+	}
+
+	perform(1);
+
+	for (auto &it : items) {
+		if (!it.page) {
+			delete it.builder;
+			it.builder = nullptr;
+			continue;
+		}
+
+		setPage(it.page);
+		doPageBreak(l.layouts.empty() ? nullptr : l.layouts.back(), pos);
+		collapsableMarginTop = 0;
+
+		if (it.valid && !l.context && it.start.x == pos.x && it.start.y == pos.y && it.firstNodeId == _maxNodeId
+				&& _floatStack.back()->floatLeft.empty() && _floatStack.back()->floatRight.empty()) {
+			for (auto &iit : it.layouts) {
+				l.layouts.emplace_back(iit);
+			}
+
+			pos = it.pos;
+			height += it.height;
+			collapsableMarginTop = it.collapsableMarginTop;
+
+			_floatStack.back()->floatLeft = move(it.floatLeft);
+			_floatStack.back()->floatRight = move(it.floatRight);
+
+			_maxNodeId += it.nodeIds;
+			_result->append(it.builder->getResult());
+			_spineBuilders.emplace_back(it.builder);
+		} else {
+			delete it.builder;
+			processChildNode(l, it.page->root, pos, height, collapsableMarginTop, false);
+		}
+		it.builder = nullptr;
+	}
+}
+
+void Builder::renderSpineItem(const Layout &origin, SpineItem &item) {
+	setPage(item.page);
+
+	Layout &l = makeLayout(Layout::NodeInfo(origin.node), Layout::PositionInfo(origin.pos));
+	l.node.context = style::Display::Block;
+
+	FloatContext f{ &l, _media.surfaceSize.height };
+	_floatStack.push_back(&f);
+	_layoutStack.push_back(&l);
+
+	item.pos = item.start;
+	item.height = 0.0f;
+	item.collapsableMarginTop = 0.0f;
+	processChildNode(l, item.page->root, item.pos, item.height, item.collapsableMarginTop, false);
+
+	_layoutStack.pop_back();
+	_floatStack.pop_back();
+
+	// root height should be accumulated with single addition to be the same, as in sequential layout
+	item.valid = !l.context && isnanf(l.pos.maxHeight) && (l.layouts.empty()
+			|| (l.layouts.size() == 1 && l.layouts.front()->node.block.display != style::Display::Table));
+	item.layouts = l.layouts;
+	item.floatLeft = move(f.floatLeft);
+	item.floatRight = move(f.floatRight);
+
+	auto next = Builder_getPageBreakPosition(l.layouts.empty() ? nullptr : l.layouts.back(), item.pos.y, _media.surfaceSize.height);
+	item.nextPage = (next > 0) ? roundf(next / _media.surfaceSize.height) : 0.0f;
+	item.nodeIds = _maxNodeId - item.firstNodeId;
 }
 
 Pair<float, float> Builder::getFloatBounds(const Layout *l, float y, float height) {
@@ -569,11 +1110,62 @@ const Vector<bool> * Builder::resolvePage(const ContentPage *page) {
 	return &p_it->second;
 }
 
+const Builder::StyleIndex * Builder::getStyleIndex(const ContentPage *page) {
+	auto it = _styleIndex.find(page);
+	if (it == _styleIndex.end()) {
+		it = _styleIndex.emplace(page, StyleIndex(page->styles)).first;
+	}
+	return &it->second;
+}
+
 void Builder::setPage(const ContentPage *page) {
 	_currentMedia = resolvePage(page);
+	_currentIndex = getStyleIndex(page);
 	_currentPage = page;
 }
 
+const Style *Builder::getCachedStyle(const Node &node) const {
+	if (!_styleCache || isMediaHooked() || _styleCachePages.find(_currentPage) == _styleCachePages.end()) {
+		return nullptr;
+	}
+
+	auto it = _styleCache->_styles.find(node.getNodeId());
+	if (it != _styleCache->_styles.end() && it->second.first == _currentPage) {
+		return &it->second.second;
+	}
+	return nullptr;
+}
+
+// Siblings with same tag, id, attributes and parent (so, with same parent style) get the same computed style,
+// unless node has its own inline style or document computes default style from something else
+const Style *Builder::getSharedStyle(const Node &node) {
+	if (_nodeStack.size() < 2 || !node.getStyle().data.empty() || isMediaHooked()) {
+		return nullptr;
+	}
+
+	auto parent = _nodeStack.at(_nodeStack.size() - 2);
+	auto it = _styleShare.find(parent);
+	if (it == _styleShare.end()) {
+		return nullptr;
+	}
+
+	for (auto &sibling : it->second) {
+		if (sibling->getHtmlName() == node.getHtmlName() && sibling->getHtmlId() == node.getHtmlId()
+				&& sibling->getAttributes() == node.getAttributes()) {
+			if (!_document->canShareStyle(node, *sibling, _nodeStack)) {
+				return nullptr;
+			}
+			auto s_it = styles.find(sibling->getNodeId());
+			if (s_it != styles.end()) {
+				return &s_it->second;
+			}
+			return nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
 void Builder::addLayoutObjects(Layout &l) {
 	if (l.node.node) {
 		if (!l.node.node->getHtmlId().empty()) {
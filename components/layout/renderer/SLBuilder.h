@@ -29,15 +29,67 @@ THE SOFTWARE.
 #include "SLTable.h"
 #include "SLFloatContext.h"
 
+namespace stappler::thread {
+
+class TaskQueue;
+
+}
+
 NS_LAYOUT_BEGIN
 
+// Compiled styles, that can be reused by next builder for the same document: styles of page stay valid,
+// while media queries of page and it's style references resolve the same way and media options are not changed
+//
+// Relayout is not incremental beyond that: inline text is formatted again and every chapter is laid out,
+// because Result can not represent partially laid out document (page count and index need whole geometry)
+class StyleCache : public Ref {
+public:
+	bool init();
+
+	void clear();
+
+protected:
+	friend class Builder;
+
+	Rc<Document> _document;
+	bool _renderById = false;
+	Map<CssStringId, String> _options;
+	Map<const ContentPage *, Vector<bool>> _resolvedMedia;
+	Map<NodeId, Pair<const ContentPage *, Style>> _styles;
+};
+
 class Builder : public RendererInterface {
 public:
 	using ExternalAssetsMap = Map<String, Document::AssetMeta>;
 
+	// Page stylesheet, compiled for node matching: simple selectors (`*`, `tag`, `.class`, `tag.class`,
+	// `#id`, `tag#id`) are keyed by interned atoms, so rules for node can be found without allocations
+	struct StyleIndex {
+		using Atom = uint32_t;
+
+		enum Kind : uint8_t {
+			Tag,
+			Class,
+			Id,
+		};
+
+		static uint64_t getKey(Kind, Atom tag, Atom name);
+
+		StyleIndex(const ContentPage::StyleMap &);
+
+		Atom getAtom(const StringView &) const; // 0 if string is not used in any selector
+		const style::ParameterList *get(Kind, Atom tag, Atom name) const;
+
+		const style::ParameterList *universal = nullptr;
+		Map<String, Atom> atoms;
+		Map<uint64_t, const style::ParameterList *> rules;
+	};
+
 	static void compileNodeStyle(Style &style, const ContentPage *page, const Node &node,
 			const Vector<const Node *> &stack, const MediaParameters &media, const Vector<bool> &resolved);
 
+	static void compileNodeStyle(Style &style, const StyleIndex &, const Node &node, const Vector<bool> &resolved);
+
 	Builder(Document *, const MediaParameters &, FontSource *set, const Vector<String> & = Vector<String>());
 	virtual ~Builder();
 
@@ -45,6 +97,25 @@ public:
 	void setHyphens(HyphenMap *);
 	void setMargin(const Margin &);
 
+	// with more than one thread, spine items of paginated layout are laid out concurrently, see renderSpine
+	void setLayoutThreads(uint16_t);
+	uint16_t getLayoutThreads() const;
+
+	// queue with spawned workers, that should be used for concurrent layout instead of builder's own queue,
+	// so, caller can keep workers between renders; builder waits for all tasks of the queue, so, it should not
+	// be shared with unrelated tasks; number of layout threads is taken from queue
+	void setLayoutQueue(thread::TaskQueue *);
+	thread::TaskQueue *getLayoutQueue() const;
+
+	// with cache enabled, result is loaded from caches dir, if document, media, fonts and options was not changed,
+	// or stored into it after layout
+	void setCacheEnabled(bool);
+	bool isCacheEnabled() const;
+
+	// styles from cache are used for unchanged pages, cache is updated with new styles after render
+	void setStyleCache(StyleCache *);
+	StyleCache *getStyleCache() const;
+
 	Result *getResult() const;
 
 	const MediaParameters &getMedia() const;
@@ -96,9 +167,43 @@ public:
 	void processChilds(Layout &l, const Node &);
 
 protected:
+	// state of spine item, laid out by separate builder
+	struct SpineItem {
+		StringView name;
+		const ContentPage *page = nullptr;
+		Builder *builder = nullptr;
+
+		Vec2 start; // position, from which item was laid out
+		Vec2 pos; // position after item
+		float height = 0.0f;
+		float collapsableMarginTop = 0.0f;
+		float nextPage = 0.0f; // page, from which next item should be started
+		NodeId firstNodeId = 0; // first id for generated nodes, reserved for item
+		NodeId nodeIds = 0; // number of generated node ids, used by item
+		bool valid = false;
+
+		Vector<Layout *> layouts;
+		FloatStack floatLeft;
+		FloatStack floatRight;
+	};
+
+	Builder(const Builder *origin);
+
+	uint64_t getCacheKey() const; // 0 if result can not be cached
+
+	void loadStyleCache();
+	void storeStyleCache();
+	const Style *getCachedStyle(const Node &) const;
+
+	void renderSpine(Layout &l, Vec2 &pos, float &height, float &collapsableMarginTop);
+	void renderSpineItem(const Layout &origin, SpineItem &);
+
 	const Vector<bool> * resolvePage(const ContentPage *page);
+	const StyleIndex * getStyleIndex(const ContentPage *page);
 	void setPage(const ContentPage *);
 
+	const Style *getSharedStyle(const Node &);
+
 	void addLayoutObjects(Layout &l);
 	bool processChildNode(Layout &l, const Node &, Vec2 &pos, float &height, float &collapsableMarginTop, bool pageBreak);
 	void doPageBreak(Layout *, Vec2 &);
@@ -133,11 +238,22 @@ protected:
 
 	const ContentPage *_currentPage = nullptr;
 	const Vector<bool> *_currentMedia = nullptr;
+	const StyleIndex *_currentIndex = nullptr;
 	Map<const ContentPage *, Vector<bool>> _resolvedMedia;
+	Map<const ContentPage *, StyleIndex> _styleIndex;
+	Map<const Node *, Vector<const Node *>> _styleShare; // parent -> siblings with distinct computed styles
+	Vector<Pair<NodeId, const ContentPage *>> _stylePages; // page, on which style was compiled
+	Rc<StyleCache> _styleCache;
+	Set<const ContentPage *> _styleCachePages; // pages with valid cached styles
 	NodeId _maxNodeId = 0;
+	uint16_t _layoutThreads = 1;
+	bool _cacheEnabled = false;
+	bool _layoutQueueOwned = false; // queue was spawned by builder and should be cancelled with it
+	Rc<thread::TaskQueue> _layoutQueue;
 
 	MemoryStorage<Layout, 8_KiB> _layoutStorage;
 	Vector<Rc<InlineContext>> _contextStorage;
+	Vector<Builder *> _spineBuilders; // owners of merged spine item layouts
 };
 
 NS_LAYOUT_END
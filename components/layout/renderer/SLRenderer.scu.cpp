@@ -37,6 +37,7 @@ THE SOFTWARE.
 #include "SLTable.cc"
 #include "SLTableBorder.cc"
 #include "SLResult.cc"
+#include "SLResultCache.cc"
 
 #include "SLCssDocument.cc"
 #include "SLDocument.cc"
@@ -31,6 +31,113 @@ THE SOFTWARE.
 
 NS_LAYOUT_BEGIN
 
+void Result::ObjectIndex::build(const Vector<Object *> &objs) {
+	clear();
+
+	_entries.reserve(objs.size() + objs.size() / (NodeSize - 1) + 1);
+	for (size_t i = 0; i < objs.size(); ++ i) {
+		auto &bbox = objs[i]->bbox;
+		Entry e{bbox.getMinX(), bbox.getMinY(), bbox.getMaxX(), bbox.getMaxY(), uint32_t(i)};
+
+		// comparison with NaN is always false, so, Rect::intersectsRect never rejects object by undefined bound;
+		// infinite bounds do the same and can be merged into nodes
+		if (isnan(e.minX)) { e.minX = -std::numeric_limits<float>::infinity(); }
+		if (isnan(e.minY)) { e.minY = -std::numeric_limits<float>::infinity(); }
+		if (isnan(e.maxX)) { e.maxX = std::numeric_limits<float>::infinity(); }
+		if (isnan(e.maxY)) { e.maxY = std::numeric_limits<float>::infinity(); }
+
+		_entries.emplace_back(e);
+	}
+
+	if (_entries.empty()) {
+		return;
+	}
+
+	auto center = [] (const Entry &e) {
+		auto c = e.minY + e.maxY;
+		return isnan(c) ? 0.0f : c;
+	};
+
+	std::sort(_entries.begin(), _entries.end(), [&] (const Entry &l, const Entry &r) {
+		auto lc = center(l), rc = center(r);
+		return (lc == rc) ? (l.minX < r.minX) : (lc < rc);
+	});
+
+	_levels.emplace_back(0);
+
+	size_t begin = 0;
+	while (true) {
+		size_t end = _entries.size();
+		_levels.emplace_back(uint32_t(end));
+		if (end - begin <= NodeSize) {
+			break;
+		}
+
+		for (size_t i = begin; i < end; i += NodeSize) {
+			Entry node = _entries[i];
+			node.value = uint32_t(i);
+			for (size_t j = i + 1; j < std::min(i + NodeSize, end); ++ j) {
+				auto &e = _entries[j];
+				node.minX = std::min(node.minX, e.minX);
+				node.minY = std::min(node.minY, e.minY);
+				node.maxX = std::max(node.maxX, e.maxX);
+				node.maxY = std::max(node.maxY, e.maxY);
+			}
+			_entries.emplace_back(node);
+		}
+		begin = end;
+	}
+}
+
+void Result::ObjectIndex::clear() {
+	_entries.clear();
+	_levels.clear();
+}
+
+void Result::ObjectIndex::query(const Rect &rect, Vector<uint32_t> &ret) const {
+	const float minX = rect.getMinX(), minY = rect.getMinY(), maxX = rect.getMaxX(), maxY = rect.getMaxY();
+	auto intersects = [&] (const Entry &e) {
+		// same as Rect::intersectsRect
+		return !(e.maxX < minX || maxX < e.minX || e.maxY < minY || maxY < e.minY);
+	};
+
+	if (_levels.size() > 1) {
+		struct Item {
+			uint32_t level;
+			uint32_t idx;
+		};
+
+		Vector<Item> stack;
+		stack.reserve(NodeSize * _levels.size());
+
+		const uint32_t top = uint32_t(_levels.size() - 2);
+		for (uint32_t i = _levels[top]; i < _levels[top + 1]; ++ i) {
+			if (intersects(_entries[i])) {
+				stack.emplace_back(Item{top, i});
+			}
+		}
+
+		while (!stack.empty()) {
+			auto item = stack.back();
+			stack.pop_back();
+
+			auto &e = _entries[item.idx];
+			if (item.level == 0) {
+				ret.emplace_back(e.value);
+			} else {
+				const uint32_t end = std::min(uint32_t(e.value + NodeSize), _levels[item.level]);
+				for (uint32_t i = e.value; i < end; ++ i) {
+					if (intersects(_entries[i])) {
+						stack.emplace_back(Item{item.level - 1, i});
+					}
+				}
+			}
+		}
+	}
+
+	std::sort(ret.begin(), ret.end());
+}
+
 bool Result::init(const MediaParameters &media, FontSource *cfg, Document *doc) {
 	_media = media;
 	_fontSet = cfg;
@@ -95,6 +202,35 @@ void Result::finalize() {
 	for (auto &it : toc.childs) {
 		processContents(it, 1);
 	}
+
+	_objectIndex.build(_objects);
+	_refIndex.build(Vector<Object *>(_refs.begin(), _refs.end()));
+}
+
+void Result::append(Result *other) {
+	_objects.reserve(_objects.size() + other->_objects.size());
+	for (auto &it : other->_objects) {
+		it->index = _objects.size();
+		_objects.emplace_back(it);
+	}
+
+	_refs.reserve(_refs.size() + other->_refs.size());
+	for (auto &it : other->_refs) {
+		it->index = _refs.size();
+		_refs.emplace_back(it);
+	}
+
+	for (auto &it : other->_strings) {
+		_strings.emplace(it.first, it.second);
+	}
+
+	for (auto &it : other->_index) {
+		_index.emplace(it.first, it.second);
+	}
+
+	other->_objects.clear();
+	other->_refs.clear();
+	_chunks.emplace_back(other);
 }
 
 void Result::setBackgroundColor(const Color4B &c) {
@@ -162,6 +298,38 @@ Result::BoundIndex Result::getBoundsForPosition(float pos) const {
 	return BoundIndex{maxOf<size_t>(), 0, 0.0f, 0.0f, maxOf<int64_t>()};
 }
 
+Vector<const Object *> Result::query(const Rect &rect) const {
+	Vector<uint32_t> idx;
+	_objectIndex.query(rect, idx);
+
+	Vector<const Object *> ret;
+	ret.reserve(idx.size());
+	for (auto &it : idx) {
+		ret.emplace_back(_objects[it]);
+	}
+	return ret;
+}
+
+Vector<const Object *> Result::hitTest(const Vec2 &pos, float padding) const {
+	return query(Rect(pos.x - padding, pos.y - padding, padding * 2.0f, padding * 2.0f));
+}
+
+Vector<const Link *> Result::queryRefs(const Rect &rect) const {
+	Vector<uint32_t> idx;
+	_refIndex.query(rect, idx);
+
+	Vector<const Link *> ret;
+	ret.reserve(idx.size());
+	for (auto &it : idx) {
+		ret.emplace_back(_refs[it]);
+	}
+	return ret;
+}
+
+Vector<const Link *> Result::hitTestRefs(const Vec2 &pos, float padding) const {
+	return queryRefs(Rect(pos.x - padding, pos.y - padding, padding * 2.0f, padding * 2.0f));
+}
+
 Label *Result::emplaceLabel(const Layout &l, bool isBullet) {
 	auto ret = &_labels.emplace();
 	ret->type = Object::Type::Label;
@@ -48,6 +48,31 @@ public:
 		String href;
 	};
 
+	// Immutable packed R-tree over object bounds, built once in finalize
+	// Leafs are sorted by vertical center, so, every node covers a horizontal band of document
+	class ObjectIndex {
+	public:
+		static constexpr size_t NodeSize = 16;
+
+		void build(const Vector<Object *> &);
+		void clear();
+
+		// indexes of objects, that intersects rect, in document order
+		void query(const Rect &, Vector<uint32_t> &) const;
+
+	protected:
+		struct Entry {
+			float minX;
+			float minY;
+			float maxX;
+			float maxY;
+			uint32_t value; // object index for leafs, first child entry for nodes
+		};
+
+		Vector<Entry> _entries; // levels, packed from leafs to roots
+		Vector<uint32_t> _levels; // first entry of each level, then end of last level
+	};
+
 	bool init(const MediaParameters &, FontSource *cfg, Document *doc);
 
 	FontSource *getFontSet() const;
@@ -58,6 +83,17 @@ public:
 	void pushIndex(const String &, const Vec2 &);
 	void finalize();
 
+	// Binary cache of finalized result: objects, links, strings and index in flat arrays,
+	// font layouts are stored by family, style and size, and resolved with font source on load
+	static String getCachePath(uint64_t key);
+	static Rc<Result> readCache(const StringView &path, uint64_t key, const MediaParameters &, FontSource *, Document *);
+	bool writeCache(const StringView &path, uint64_t key) const;
+	Bytes encodeCache(uint64_t key) const; // data, that is stored by writeCache; equal data means equal results
+
+	// moves objects and links from result of other builder to the end of this result
+	// other result should not be finalized, it's storage is retained by this result
+	void append(Result *);
+
 	void setBackgroundColor(const Color4B &c);
 	const Color4B & getBackgroundColor() const;
 
@@ -76,6 +112,14 @@ public:
 
 	BoundIndex getBoundsForPosition(float) const;
 
+	// objects and links, that intersects rect or contains point, in document order
+	// available after finalize
+	Vector<const Object *> query(const Rect &) const;
+	Vector<const Object *> hitTest(const Vec2 &, float padding = 0.0f) const;
+
+	Vector<const Link *> queryRefs(const Rect &) const;
+	Vector<const Link *> hitTestRefs(const Vec2 &, float padding = 0.0f) const;
+
 	Background *emplaceBackground(const Layout &, const Rect &, const BackgroundStyle &);
 	PathObject *emplaceOutline(const Layout &, const Rect &, const Color4B &, float = 0.0f, style::BorderStyle = style::BorderStyle::None);
 	void emplaceBorder(Layout &, const Rect &, const OutlineStyle &, float width);
@@ -96,6 +140,7 @@ public:
 
 protected:
 	void processContents(const Document::ContentRecord & rec, size_t level);
+	bool readCacheData(const uint8_t *, size_t, uint64_t key);
 
 	MemoryStorage<Label, 16_KiB> _labels;
 	MemoryStorage<Background, 8_KiB> _backgrounds;
@@ -110,6 +155,9 @@ protected:
 	Vector<BoundIndex> _bounds;
 	Map<String, Vec2> _index;
 
+	ObjectIndex _objectIndex;
+	ObjectIndex _refIndex;
+
 	Color4B _background;
 
 	Rc<FontSource> _fontSet;
@@ -118,6 +166,8 @@ protected:
 	size_t _numPages = 1;
 
 	Map<CssStringId, String> _strings;
+
+	Vector<Rc<Result>> _chunks;
 };
 
 NS_LAYOUT_END
@@ -0,0 +1,568 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPLayout.h"
+#include "SLResult.h"
+#include "SLDocument.h"
+#include "SPFilesystem.h"
+
+NS_LAYOUT_BEGIN
+
+static constexpr uint32_t ResultCache_Magic = "SLRC"_tag;
+static constexpr uint32_t ResultCache_Version = 2;
+static constexpr size_t ResultCache_MaxSize = 64 * 1024 * 1024;
+
+struct ResultCache_Header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	float width;
+	float height;
+	Color4B background;
+	uint32_t fonts;
+	uint32_t strings;
+	uint32_t objects;
+	uint32_t refs;
+	uint32_t index;
+};
+
+struct ResultCache_Writer {
+	template <typename T>
+	void write(const T &val) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+		auto ptr = (const uint8_t *)&val;
+		data.insert(data.end(), ptr, ptr + sizeof(T));
+	}
+
+	template <typename T>
+	void write(const Vector<T> &vec) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+		write(uint32_t(vec.size()));
+		align(alignof(T));
+		auto ptr = (const uint8_t *)vec.data();
+		data.insert(data.end(), ptr, ptr + vec.size() * sizeof(T));
+	}
+
+	void write(const StringView &str) {
+		write(uint32_t(str.size()));
+		data.insert(data.end(), (const uint8_t *)str.data(), (const uint8_t *)str.data() + str.size());
+	}
+
+	void write(const String &str) {
+		write(StringView(str));
+	}
+
+	void write(const Vec2 &vec) {
+		write(vec.x);
+		write(vec.y);
+	}
+
+	void write(const Rect &rect) {
+		write(rect.origin.x);
+		write(rect.origin.y);
+		write(rect.size.width);
+		write(rect.size.height);
+	}
+
+	// arrays are aligned from the beginning of file, so, they can be copied from file data as is
+	void align(size_t a) {
+		data.resize((data.size() + a - 1) & ~(a - 1));
+	}
+
+	Bytes data;
+};
+
+// Reads values from file data; arrays are copied into result storage directly
+struct ResultCache_Reader {
+	template <typename T>
+	bool read(T &val) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read");
+		static_assert(!std::is_enum<T>::value, "Enums should be read with readEnum");
+		if (size < sizeof(T)) {
+			return false;
+		}
+		memcpy((void *)&val, ptr, sizeof(T));
+		ptr += sizeof(T); size -= sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	bool read(Vector<T> &vec) {
+		uint32_t count = 0;
+		if (!read(count) || !align(alignof(T)) || size / sizeof(T) < count) {
+			return false;
+		}
+		vec.assign((const T *)ptr, (const T *)ptr + count);
+		ptr += count * sizeof(T); size -= count * sizeof(T);
+		return true;
+	}
+
+	// file can be corrupted, so, enums and flags are checked to be in range of known values
+	template <typename T>
+	bool readEnum(T &val, T max) {
+		typename std::underlying_type<T>::type tmp;
+		if (!read(tmp) || int64_t(tmp) < 0 || int64_t(tmp) > int64_t(max)) {
+			return false;
+		}
+		val = T(tmp);
+		return true;
+	}
+
+	bool read(bool &val) {
+		uint8_t tmp = 0;
+		if (!read(tmp) || tmp > 1) {
+			return false;
+		}
+		val = (tmp != 0);
+		return true;
+	}
+
+	bool read(style::Metric &metric) {
+		return read<style::Metric>(metric) && int64_t(metric.metric) >= 0 && metric.metric <= style::Metric::Units::VMax;
+	}
+
+	bool read(Vec2 &vec) {
+		return read(vec.x) && read(vec.y);
+	}
+
+	bool read(Rect &rect) {
+		return read(rect.origin.x) && read(rect.origin.y) && read(rect.size.width) && read(rect.size.height);
+	}
+
+	bool align(size_t a) {
+		auto offset = size_t(ptr - base);
+		auto n = ((offset + a - 1) & ~(a - 1)) - offset;
+		if (size < n) {
+			return false;
+		}
+		ptr += n; size -= n;
+		return true;
+	}
+
+	bool read(StringView &str) {
+		uint32_t count = 0;
+		if (!read(count) || size < count) {
+			return false;
+		}
+		str = StringView((const char *)ptr, count);
+		ptr += count; size -= count;
+		return true;
+	}
+
+	const uint8_t *base;
+	const uint8_t *ptr;
+	size_t size;
+};
+
+// least recently used files are removed, until cache fits into ResultCache_MaxSize;
+// mtime of cache file is updated on every read, so, it's the time of last use
+static void ResultCache_cleanup(const StringView &dir) {
+	struct CacheFile {
+		String path;
+		size_t size;
+		time_t mtime;
+	};
+
+	Vector<CacheFile> files;
+	size_t total = 0;
+	filesystem::ftw(dir, [&] (StringView path, bool isFile) {
+		if (isFile && path.ends_with(".slr")) {
+			auto size = filesystem::size(path);
+			files.emplace_back(CacheFile{path.str(), size, filesystem::mtime(path)});
+			total += size;
+		}
+	});
+
+	if (total <= ResultCache_MaxSize) {
+		return;
+	}
+
+	std::sort(files.begin(), files.end(), [] (const CacheFile &l, const CacheFile &r) {
+		return l.mtime < r.mtime;
+	});
+
+	for (auto &it : files) {
+		if (total <= ResultCache_MaxSize) {
+			break;
+		}
+		if (filesystem::remove(it.path)) {
+			total -= it.size;
+		}
+	}
+}
+
+String Result::getCachePath(uint64_t key) {
+	return filesystem::cachesPath(toString("layout/", key, ".slr"));
+}
+
+Rc<Result> Result::readCache(const StringView &path, uint64_t key, const MediaParameters &media, FontSource *set, Document *doc) {
+	if (!filesystem::exists(path)) {
+		return nullptr;
+	}
+
+	auto ret = Rc<Result>::create(media, set, doc);
+
+	// every field is copied into result, so, file is read as a whole
+	auto data = filesystem::readIntoMemory(path);
+	if (!ret->readCacheData(data.data(), data.size(), key)) {
+		filesystem::remove(path);
+		return nullptr;
+	}
+
+	filesystem::touch(path);
+	return ret;
+}
+
+bool Result::writeCache(const StringView &path, uint64_t key) const {
+	auto data = encodeCache(key);
+
+	// result, that does not fit into cache, would be removed by cleanup just after it's written
+	if (data.size() > ResultCache_MaxSize) {
+		return false;
+	}
+
+	filesystem::mkdir_recursive(filepath::root(path));
+
+	// write into temporary file, then move it, so, readers never see partially written cache;
+	// temporary name is unique for process and result, so, concurrent writers do not share it
+	auto tmp = toString(path, ".", getpid(), ".", uintptr_t(this), ".tmp");
+	if (!filesystem::write(tmp, data)) {
+		filesystem::remove(tmp);
+		return false;
+	}
+	if (!filesystem::move(tmp, path)) {
+		filesystem::remove(tmp);
+		return false;
+	}
+
+	ResultCache_cleanup(filepath::root(path));
+	return true;
+}
+
+Bytes Result::encodeCache(uint64_t key) const {
+	Map<const FontLayout *, uint32_t> fonts;
+	Vector<const FontLayout *> fontsVec;
+
+	for (auto &it : _objects) {
+		if (it->type == Object::Type::Label) {
+			for (auto &range : it->asLabel()->format.ranges) {
+				if (fonts.emplace(range.layout.get(), uint32_t(fontsVec.size())).second) {
+					fontsVec.emplace_back(range.layout.get());
+				}
+			}
+		}
+	}
+
+	ResultCache_Writer w;
+	w.write(ResultCache_Header{ResultCache_Magic, ResultCache_Version, key, _size.width, _size.height, _background,
+		uint32_t(fontsVec.size()), uint32_t(_strings.size()), uint32_t(_objects.size()), uint32_t(_refs.size()), uint32_t(_index.size())});
+
+	for (auto &it : fontsVec) {
+		auto style = it->getStyle();
+		w.write(it->getFamily());
+		w.write(it->getSize());
+		w.write(style.fontStyle);
+		w.write(style.fontWeight);
+		w.write(style.fontStretch);
+		w.write(style.fontVariant);
+		w.write(style.listStyleType);
+		w.write(style.fontSize);
+	}
+
+	for (auto &it : _strings) {
+		w.write(it.first);
+		w.write(it.second);
+	}
+
+	for (auto &it : _objects) {
+		w.write(it->bbox);
+		w.write(it->type);
+		w.write(it->context);
+		w.write(it->depth);
+		w.write(it->zIndex);
+
+		switch (it->type) {
+		case Object::Type::Label: {
+			auto label = it->asLabel();
+			w.write(uint32_t(label->format.ranges.size()));
+			for (auto &range : label->format.ranges) {
+				w.write(range.colorDirty);
+				w.write(range.opacityDirty);
+				w.write(range.decoration);
+				w.write(range.align);
+				w.write(range.start);
+				w.write(range.count);
+				w.write(range.color);
+				w.write(range.height);
+				w.write(fonts[range.layout.get()]);
+			}
+			w.write(label->format.chars);
+			w.write(label->format.lines);
+			w.write(label->format.width);
+			w.write(label->format.height);
+			w.write(label->format.maxLineX);
+			w.write(label->format.overflow);
+			w.write(label->height);
+			w.write(label->preview);
+			w.write(label->hash);
+			w.write(uint64_t(label->sourceIndex));
+			break;
+		}
+		case Object::Type::Background: {
+			auto &bg = it->asBackground()->background;
+			w.write(bg.display);
+			w.write(bg.backgroundColor);
+			w.write(bg.backgroundRepeat);
+			w.write(bg.backgroundPositionX);
+			w.write(bg.backgroundPositionY);
+			w.write(bg.backgroundSizeWidth);
+			w.write(bg.backgroundSizeHeight);
+			w.write(bg.backgroundImage);
+			break;
+		}
+		case Object::Type::Path: {
+			auto &path = it->asPath()->path;
+			auto params = path.getParams();
+			w.write(params.transform.m);
+			w.write(params.fillColor);
+			w.write(params.strokeColor);
+			w.write(params.style);
+			w.write(params.strokeWidth);
+			w.write(params.winding);
+			w.write(params.lineCup);
+			w.write(params.lineJoin);
+			w.write(params.miterLimit);
+			w.write(params.isAntialiased);
+			w.write(path.getCommands());
+			w.write(path.getPoints());
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	for (auto &it : _refs) {
+		w.write(it->bbox);
+		w.write(it->type);
+		w.write(it->context);
+		w.write(it->depth);
+		w.write(it->zIndex);
+		w.write(it->target);
+		w.write(it->mode);
+	}
+
+	for (auto &it : _index) {
+		w.write(it.first);
+		w.write(it.second);
+	}
+
+	return move(w.data);
+}
+
+bool Result::readCacheData(const uint8_t *data, size_t size, uint64_t key) {
+	ResultCache_Reader r{data, data, size};
+
+	ResultCache_Header header;
+	if (!r.read(header) || header.magic != ResultCache_Magic || header.version != ResultCache_Version || header.key != key) {
+		return false;
+	}
+
+	Vector<Rc<FontLayout>> fonts; fonts.reserve(header.fonts);
+	for (uint32_t i = 0; i < header.fonts; ++ i) {
+		StringView family;
+		uint16_t dsize = 0;
+		FontParameters style;
+		if (!r.read(family) || !r.read(dsize) || !r.readEnum(style.fontStyle, style::FontStyle::Oblique)
+				|| !r.readEnum(style.fontWeight, style::FontWeight::W900)
+				|| !r.readEnum(style.fontStretch, style::FontStretch::UltraExpanded)
+				|| !r.readEnum(style.fontVariant, style::FontVariant::SmallCaps)
+				|| !r.readEnum(style.listStyleType, style::ListStyleType::UpperRoman) || !r.read(style.fontSize)) {
+			return false;
+		}
+		style.fontFamily = family;
+
+		auto layout = _fontSet->getLayout(family, style, dsize);
+		if (!layout) {
+			return false;
+		}
+		fonts.emplace_back(move(layout));
+	}
+
+	for (uint32_t i = 0; i < header.strings; ++ i) {
+		CssStringId id;
+		StringView str;
+		if (!r.read(id) || !r.read(str)) {
+			return false;
+		}
+		_strings.emplace(id, str.str());
+	}
+
+	auto readObject = [&] (Object &obj) {
+		return r.read(obj.bbox) && r.readEnum(obj.type, Object::Type::Ref) && r.readEnum(obj.context, Object::Context::Normal)
+				&& r.read(obj.depth) && r.read(obj.zIndex);
+	};
+
+	_objects.reserve(header.objects);
+	for (uint32_t i = 0; i < header.objects; ++ i) {
+		Object obj;
+		if (!readObject(obj)) {
+			return false;
+		}
+
+		Object *target = nullptr;
+		switch (obj.type) {
+		case Object::Type::Label: {
+			auto label = &_labels.emplace();
+			uint32_t nranges = 0;
+			if (!r.read(nranges)) {
+				return false;
+			}
+			label->format.ranges.resize(nranges);
+			for (auto &range : label->format.ranges) {
+				uint32_t font = 0;
+				if (!r.read(range.colorDirty) || !r.read(range.opacityDirty)
+						|| !r.readEnum(range.decoration, style::TextDecoration::Underline)
+						|| !r.readEnum(range.align, style::VerticalAlign::Bottom)
+						|| !r.read(range.start) || !r.read(range.count) || !r.read(range.color) || !r.read(range.height)
+						|| !r.read(font) || font >= fonts.size()) {
+					return false;
+				}
+				range.layout = fonts[font];
+			}
+
+			StringView hash;
+			uint64_t sourceIndex = 0;
+			if (!r.read(label->format.chars) || !r.read(label->format.lines) || !r.read(label->format.width)
+					|| !r.read(label->format.height) || !r.read(label->format.maxLineX) || !r.read(label->format.overflow)
+					|| !r.read(label->height) || !r.read(label->preview) || !r.read(hash) || !r.read(sourceIndex)) {
+				return false;
+			}
+			if (!hash.empty()) {
+				label->hash = addString(hash);
+			}
+			label->sourceIndex = size_t(sourceIndex);
+			target = label;
+			break;
+		}
+		case Object::Type::Background: {
+			auto bg = &_backgrounds.emplace();
+			auto &style = bg->background;
+			StringView image;
+			if (!r.readEnum(style.display, style::Display::TableCaption) || !r.read(style.backgroundColor)
+					|| !r.readEnum(style.backgroundRepeat, style::BackgroundRepeat::RepeatY)
+					|| !r.read(style.backgroundPositionX) || !r.read(style.backgroundPositionY)
+					|| !r.read(style.backgroundSizeWidth) || !r.read(style.backgroundSizeHeight) || !r.read(image)) {
+				return false;
+			}
+			if (!image.empty()) {
+				style.backgroundImage = addString(image);
+			}
+			target = bg;
+			break;
+		}
+		case Object::Type::Path: {
+			auto path = &_paths.emplace();
+			Path::Params params;
+			Vector<Path::Command> commands;
+			Vector<Path::CommandData> points;
+			if (!r.read(params.transform.m) || !r.read(params.fillColor) || !r.read(params.strokeColor)
+					|| !r.readEnum(params.style, DrawStyle::FillAndStroke) || !r.read(params.strokeWidth)
+					|| !r.readEnum(params.winding, Winding::EvenOdd) || !r.readEnum(params.lineCup, LineCup::Square)
+					|| !r.readEnum(params.lineJoin, LineJoin::Bevel) || !r.read(params.miterLimit) || !r.read(params.isAntialiased)
+					|| !r.read(commands) || !r.read(points)) {
+				return false;
+			}
+
+			// commands are read as raw bytes, so, check them and number of points they use before path is built
+			size_t npoints = 0;
+			for (auto &it : commands) {
+				switch (it) {
+				case Path::Command::MoveTo: case Path::Command::LineTo: npoints += 1; break;
+				case Path::Command::QuadTo: npoints += 2; break;
+				case Path::Command::CubicTo: case Path::Command::ArcTo: npoints += 3; break;
+				case Path::Command::ClosePath: break;
+				default: return false; break;
+				}
+			}
+			if (npoints != points.size()) {
+				return false;
+			}
+			path->path.init(commands.data(), commands.size(), points.data(), points.size());
+			path->path.setParams(params);
+			target = path;
+			break;
+		}
+		default:
+			return false;
+			break;
+		}
+
+		target->bbox = obj.bbox;
+		target->type = obj.type;
+		target->context = obj.context;
+		target->depth = obj.depth;
+		target->zIndex = obj.zIndex;
+		target->index = _objects.size();
+		_objects.emplace_back(target);
+	}
+
+	_refs.reserve(header.refs);
+	for (uint32_t i = 0; i < header.refs; ++ i) {
+		auto link = &_links.emplace();
+		StringView target, mode;
+		if (!readObject(*link) || !r.read(target) || !r.read(mode)) {
+			return false;
+		}
+		// refs are stored as Link objects, so, only reference types can be restored
+		if (link->type != Object::Type::Ref) {
+			return false;
+		}
+		link->target = addString(target);
+		link->mode = addString(mode);
+		link->index = _refs.size();
+		_refs.emplace_back(link);
+	}
+
+	for (uint32_t i = 0; i < header.index; ++ i) {
+		StringView name;
+		Vec2 pos;
+		if (!r.read(name) || !r.read(pos)) {
+			return false;
+		}
+		_index.emplace(name.str(), pos);
+	}
+
+	if (r.size != 0) {
+		return false;
+	}
+
+	setBackgroundColor(header.background);
+	setContentSize(Size(header.width, header.height));
+	finalize();
+	return true;
+}
+
+NS_LAYOUT_END
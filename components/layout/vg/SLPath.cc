@@ -556,6 +556,12 @@ bool Path::init(FilePath &&str) {
 	return true;
 }
 
+bool Path::init(const Command *commands, size_t ncommands, const CommandData *points, size_t npoints) {
+	_commands.assign(commands, commands + ncommands);
+	_points.assign(points, points + npoints);
+	return true;
+}
+
 bool Path::init(const uint8_t *data, size_t len) {
 	float x1, y1, x2, y2, x3, y3;
 	uint8_t tmp;
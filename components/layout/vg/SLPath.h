@@ -82,6 +82,7 @@ public:
 	bool init(const StringView &);
 	bool init(FilePath &&);
 	bool init(const uint8_t *, size_t);
+	bool init(const Command *, size_t, const CommandData *, size_t); // raw data from getCommands/getPoints
 
 	size_t count() const;
 
@@ -28,6 +28,7 @@ THE SOFTWARE.
 
 #include "SPFilesystem.h"
 #include "SPugCache.h"
+#include "SPugOutput.h"
 #include "SPugContext.h"
 #include "SPugVariable.h"
 #include "Root.h"
@@ -656,7 +657,21 @@ void Request::runTemplate(String && path, const Function<void(tpl::Exec &, Reque
 
 int Request::runPug(const StringView & path, const Function<bool(pug::Context &, const pug::Template &)> &cb) {
 	auto cache = server().getPugCache();
-	if (cache->runTemplate(path, [&] (pug::Context &ctx, const pug::Template &tpl) -> bool {
+
+	// template output is passed to filters as transient buckets, without copying into request's buffer;
+	// filters, that can not send data immediately, set buckets aside by themselves
+	auto bb = apr_brigade_create(_request->pool, _request->connection->bucket_alloc);
+	pug::Output output([&] (const StringView &str) -> bool {
+		APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_transient_create(str.data(), str.size(), bb->bucket_alloc));
+		return true;
+	});
+	output.setFlushCallback([&] () -> bool {
+		auto err = ap_pass_brigade(_request->output_filters, bb);
+		apr_brigade_cleanup(bb);
+		return err == APR_SUCCESS;
+	});
+
+	auto ret = cache->runTemplate(path, [&] (pug::Context &ctx, const pug::Template &tpl) -> bool {
 		initScriptContext(ctx);
 
 		if (cb(ctx, tpl)) {
@@ -672,7 +687,10 @@ int Request::runPug(const StringView & path, const Function<bool(pug::Context &,
 			return true;
 		}
 		return false;
-	}, *this)) {
+	}, output);
+
+	output.flush();
+	if (ret) {
 		return DONE;
 	}
 	return HTTP_INTERNAL_SERVER_ERROR;
@@ -60,7 +60,7 @@ protected:
 
 	apr_pool_t *_pool = nullptr;
 	apr::mutex _mutex;
-	Map<String, FileRef *> _templates;
+	UnorderedMap<String, FileRef *> _templates; // only lookups and full updates, so, iteration order is not observable
 };
 
 NS_SA_EXT_END(tpl)
@@ -39,6 +39,7 @@ struct Var;
 class Context;
 class Template;
 class Cache;
+class Output;
 
 using Value = data::ValueTemplate<memory::PoolInterface>;
 
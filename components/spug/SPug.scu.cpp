@@ -28,6 +28,7 @@
 #include "SPugContext.cc"
 #include "SPugExpression.cc"
 #include "SPugLexer.cc"
+#include "SPugOutput.cc"
 #include "SPugTemplate.cc"
 #include "SPugToken.cc"
 #include "SPugVariable.cc"
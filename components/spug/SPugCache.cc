@@ -23,18 +23,20 @@
 #include "SPugCache.h"
 #include "SPugContext.h"
 #include "SPugTemplate.h"
+#include "SPugOutput.h"
 
 #include <sys/inotify.h>
 
 NS_SP_EXT_BEGIN(pug)
 
-Rc<FileRef> FileRef::read(memory::pool_t *p, FilePath path, Template::Options opts, const Callback<void(const StringView &)> &cb, int watch, int wId) {
+Rc<FileRef> FileRef::read(memory::pool_t *p, FilePath path, Template::Options opts, const Callback<void(const StringView &)> &cb,
+		int watch, int wId, const StringView &cacheDir) {
 	auto fpath = path.get();
 	if (filesystem::exists(fpath)) {
 		auto pool = memory::pool::create(p);
 
 		memory::pool::context ctx(pool, memory::pool::Template);
-		return Rc<FileRef>::alloc(pool, path, opts, cb, watch, wId);
+		return Rc<FileRef>::alloc(pool, path, opts, cb, watch, wId, cacheDir);
 	}
 
 	return nullptr;
@@ -47,7 +49,8 @@ Rc<FileRef> FileRef::read(memory::pool_t *p, String && content, bool isTemplate,
 	return Rc<FileRef>::alloc(pool, move(content), isTemplate, opts, cb);
 }
 
-FileRef::FileRef(memory::pool_t *pool, const FilePath &path, Template::Options opts, const Callback<void(const StringView &)> &cb, int watch, int wId)
+FileRef::FileRef(memory::pool_t *pool, const FilePath &path, Template::Options opts, const Callback<void(const StringView &)> &cb,
+		int watch, int wId, const StringView &cacheDir)
 : _pool(pool), _opts(opts) {
 	auto fpath = path.get();
 
@@ -67,10 +70,7 @@ FileRef::FileRef(memory::pool_t *pool, const FilePath &path, Template::Options o
 		_valid = true;
 	}
 	if (_valid && (fpath.ends_with(".pug") || fpath.ends_with(".stl") || fpath.ends_with(".spug"))) {
-		_template = Template::read(_pool, _content, opts, cb);
-		if (!_template) {
-			_valid = false;
-		}
+		readTemplate(cb, cacheDir);
 	}
 }
 
@@ -80,9 +80,37 @@ FileRef::FileRef(memory::pool_t *pool, String &&src, bool isTemplate, Template::
 		_valid = true;
 	}
 	if (isTemplate && _valid) {
-		_template = Template::read(_pool, _content, opts, cb);
-		if (!_template) {
-			_valid = false;
+		readTemplate(cb, StringView());
+	}
+}
+
+void FileRef::readTemplate(const Callback<void(const StringView &)> &cb, const StringView &cacheDir) {
+	String compiledPath;
+	if (!cacheDir.empty()) {
+		// compiled data depends only on content and options
+		compiledPath = string::ToStringTraits<memory::PoolInterface>::toString(cacheDir, "/",
+				string::hash64(_content), "-", _opts.flags.to_ulong(), "-", Template::CompiledVersion, ".stlc");
+		if (filesystem::exists(compiledPath)) {
+			auto data = data::readFile<memory::PoolInterface>(compiledPath);
+			if ((_template = Template::decode(_pool, data, _opts))) {
+				return;
+			}
+		}
+	}
+
+	_template = Template::read(_pool, _content, _opts, cb);
+	if (!_template) {
+		_valid = false;
+	} else if (!compiledPath.empty()) {
+		// other processes can read the same cache dir, so, file is written into unique temporary
+		// file in the same dir, and then atomically renamed into its place
+		auto tmpPath = string::ToStringTraits<memory::PoolInterface>::toString(compiledPath, ".", getpid(), ".", uintptr_t(this), ".tmp");
+		if (data::save(_template->encode(), tmpPath, data::EncodeFormat::Cbor)) {
+			if (!filesystem::move(tmpPath, compiledPath)) {
+				filesystem::remove(tmpPath);
+			}
+		} else {
+			filesystem::remove(tmpPath);
 		}
 	}
 }
@@ -117,8 +145,33 @@ const Template::Options &FileRef::getOpts() const {
 	return _opts;
 }
 
+auto Cache::Snapshot::create(memory::pool_t *p, const Snapshot *prev) -> Snapshot * {
+	auto pool = memory::pool::create(p);
+
+	memory::pool::context ctx(pool);
+	auto ret = new (pool) Snapshot;
+	ret->pool = pool;
+	if (prev) {
+		ret->templates = prev->templates;
+	}
+	return ret;
+}
+
+void Cache::Snapshot::destroy(Snapshot *snapshot) {
+	auto pool = snapshot->pool;
+	do {
+		// references to FileRefs should be released within snapshot pool
+		memory::pool::context ctx(pool);
+		snapshot->~Snapshot();
+	} while (0);
+	memory::pool::destroy(pool);
+}
+
 Cache::Cache(Template::Options opts, const Function<void(const StringView &)> &err)
-: _pool(memory::pool::acquire()), _opts(opts), _errorCallback(err) {
+: _pool(memory::pool::acquire()), _epoch(0), _opts(opts), _errorCallback(err) {
+	_readers[0].store(0);
+	_readers[1].store(0);
+	_snapshot.store(Snapshot::create(_pool));
 	_inotify = inotify_init1(IN_NONBLOCK);
 	if (_inotify != -1) {
 		_inotifyAvailable = true;
@@ -126,8 +179,9 @@ Cache::Cache(Template::Options opts, const Function<void(const StringView &)> &e
 }
 
 Cache::~Cache() {
+	auto snapshot = _snapshot.load();
 	if (_inotify > 0) {
-		for (auto &it : _templates) {
+		for (auto &it : snapshot->templates) {
 			auto fd = it.second->getWatch();
 			if (fd >= 0) {
 				inotify_rm_watch(_inotify, fd);
@@ -136,16 +190,24 @@ Cache::~Cache() {
 
 		close(_inotify);
 	}
+
+	Snapshot::destroy(snapshot);
+	for (auto &it : _retired) {
+		Snapshot::destroy(it);
+	}
 }
 
 void Cache::update(int watch) {
 	std::unique_lock<Mutex> lock(_mutex);
 	auto it = _watches.find(watch);
 	if (it != _watches.end()) {
-		auto tIt = _templates.find(it->second);
-		if (tIt != _templates.end()) {
+		auto snapshot = _snapshot.load();
+		auto tIt = snapshot->templates.find(it->second);
+		if (tIt != snapshot->templates.end()) {
 			if (auto tpl = openTemplate(it->second, tIt->second->getWatch(), tIt->second->getOpts())) {
-				tIt->second = tpl;
+				publish([&] (TemplateMap &map) {
+					map[it->second] = tpl;
+				});
 			}
 		}
 	}
@@ -153,16 +215,29 @@ void Cache::update(int watch) {
 
 void Cache::update(memory::pool_t *pool) {
 	memory::pool::context ctx(pool);
-	for (auto &it : _templates) {
+	std::unique_lock<Mutex> lock(_mutex);
+
+	Vector<Pair<StringView, Rc<FileRef>>> updated;
+	for (auto &it : _snapshot.load()->templates) {
 		if (it.second->getMtime() != 0) {
 			auto mtime = filesystem::mtime(it.first);
 			if (mtime != it.second->getMtime()) {
 				if (auto tpl = openTemplate(it.first, -1, it.second->getOpts())) {
-					it.second = tpl;
+					updated.emplace_back(it.first, tpl);
 				}
 			}
 		}
 	}
+
+	if (!updated.empty()) {
+		publish([&] (TemplateMap &map) {
+			for (auto &it : updated) {
+				map[it.first] = it.second;
+			}
+		});
+	} else {
+		reclaim();
+	}
 }
 
 int Cache::getNotify() const {
@@ -174,6 +249,22 @@ bool Cache::isNotifyAvailable() {
 	return _inotifyAvailable;
 }
 
+bool Cache::setCacheDir(const StringView &dir) {
+	std::unique_lock<Mutex> lock(_mutex);
+	if (dir.empty()) {
+		_cacheDir = StringView();
+		return true;
+	}
+
+	if (!filesystem::exists(dir) && !filesystem::mkdir(dir)) {
+		onError(toString("Fail to create cache dir: ", dir));
+		return false;
+	}
+
+	_cacheDir = dir.pdup(_pool);
+	return true;
+}
+
 bool Cache::runTemplate(const StringView &ipath, const RunCallback &cb, std::ostream &out) {
 	Rc<FileRef> tpl = acquireTemplate(ipath, true, _opts);
 	if (!tpl) {
@@ -192,15 +283,37 @@ bool Cache::runTemplate(const StringView &ipath, const RunCallback &cb, std::ost
 	return runTemplate(tpl, ipath, cb, out);
 }
 
+bool Cache::runTemplate(const StringView &ipath, const RunCallback &cb, Output &out) {
+	Rc<FileRef> tpl = acquireTemplate(ipath, true, _opts);
+	if (!tpl) {
+		tpl = acquireTemplate(filesystem::writablePath(ipath), false, _opts);
+	}
+
+	return runTemplate(tpl, ipath, cb, out);
+}
+
+bool Cache::runTemplate(const StringView &ipath, const RunCallback &cb, Output &out, Template::Options opts) {
+	Rc<FileRef> tpl = acquireTemplate(ipath, true, opts);
+	if (!tpl) {
+		tpl = acquireTemplate(filesystem::writablePath(ipath), false, opts);
+	}
+
+	return runTemplate(tpl, ipath, cb, out);
+}
+
 bool Cache::addFile(StringView path) {
 	std::unique_lock<Mutex> lock(_mutex);
-	auto it = _templates.find(path);
-	if (it == _templates.end()) {
+	auto &templates = _snapshot.load()->templates;
+	auto it = templates.find(path);
+	if (it == templates.end()) {
 		memory::pool::context ctx(_pool);
 		if (auto tpl = openTemplate(path, -1, _opts)) {
-			auto it = _templates.emplace(path.pdup(_templates.get_allocator()), tpl).first;
+			auto key = path.pdup(_pool);
+			publish([&] (TemplateMap &map) {
+				map.emplace(key, tpl);
+			});
 			if (tpl->getWatch() >= 0) {
-				_watches.emplace(tpl->getWatch(), it->first);
+				_watches.emplace(tpl->getWatch(), key);
 			}
 			return true;
 		}
@@ -212,10 +325,13 @@ bool Cache::addFile(StringView path) {
 
 bool Cache::addContent(StringView key, String &&data) {
 	std::unique_lock<Mutex> lock(_mutex);
-	auto it = _templates.find(key);
-	if (it == _templates.end()) {
+	auto &templates = _snapshot.load()->templates;
+	auto it = templates.find(key);
+	if (it == templates.end()) {
 		auto tpl = FileRef::read(_pool, move(data), false, _opts);
-		_templates.emplace(key.pdup(_templates.get_allocator()), tpl);
+		publish([&] (TemplateMap &map) {
+			map.emplace(key.pdup(_pool), tpl);
+		});
 		return true;
 	} else {
 		onError(toString("Already added: '", key, "'"));
@@ -229,13 +345,16 @@ bool Cache::addTemplate(StringView key, String &&data) {
 
 bool Cache::addTemplate(StringView key, String &&data, Template::Options opts) {
 	std::unique_lock<Mutex> lock(_mutex);
-	auto it = _templates.find(key);
-	if (it == _templates.end()) {
+	auto &templates = _snapshot.load()->templates;
+	auto it = templates.find(key);
+	if (it == templates.end()) {
 		auto tpl = FileRef::read(_pool, move(data), true, opts, [&] (const StringView &err) {
 			std::cout << key << ":\n";
 			std::cout << err << "\n";
 		});
-		_templates.emplace(key.pdup(_templates.get_allocator()), tpl);
+		publish([&] (TemplateMap &map) {
+			map.emplace(key.pdup(_pool), tpl);
+		});
 		return true;
 	} else {
 		onError(toString("Already added: '", key, "'"));
@@ -243,16 +362,91 @@ bool Cache::addTemplate(StringView key, String &&data, Template::Options opts) {
 	return false;
 }
 
+Rc<FileRef> Cache::get(const StringView &key) const {
+	return find(key);
+}
+
+Rc<FileRef> Cache::find(const StringView &key) const {
+	Rc<FileRef> ret;
+
+	// register reader in current epoch: snapshots, retired in this epoch, are not released until it leaves;
+	// if epoch was changed before registration, reader should be counted in new one
+	uint64_t epoch = 0;
+	while (true) {
+		epoch = _epoch.load();
+		++ _readers[epoch & 1];
+		if (_epoch.load() == epoch) {
+			break;
+		}
+		-- _readers[epoch & 1];
+	}
+
+	auto snapshot = _snapshot.load();
+	auto it = snapshot->templates.find(key);
+	if (it != snapshot->templates.end()) {
+		ret = it->second;
+	}
+	-- _readers[epoch & 1];
+
+	return ret;
+}
+
+void Cache::publish(const Callback<void(TemplateMap &)> &cb) {
+	auto current = _snapshot.load();
+	auto next = Snapshot::create(_pool, current);
+	do {
+		memory::pool::context ctx(next->pool);
+		cb(next->templates);
+	} while (0);
+
+	_snapshot.store(next);
+	current->retired = _epoch.load();
+	_retired.emplace_back(current);
+	reclaim();
+}
+
+void Cache::reclaim() {
+	auto epoch = _epoch.load();
+	if (_retired.empty() || _readers[(epoch + 1) & 1].load() != 0) {
+		return;
+	}
+
+	// readers of previous epochs are finished, so, snapshots, retired before current epoch, are unreachable
+	auto it = _retired.begin();
+	while (it != _retired.end()) {
+		if ((*it)->retired < epoch) {
+			Snapshot::destroy(*it);
+			it = _retired.erase(it);
+		} else {
+			++ it;
+		}
+	}
+
+	// new readers will use counter, that is empty now, so, snapshots, retired in current epoch, can be
+	// released, when readers of current epoch are finished
+	if (!_retired.empty()) {
+		_epoch.store(epoch + 1);
+	}
+}
+
 Rc<FileRef> Cache::acquireTemplate(StringView path, bool readOnly, const Template::Options &opts) {
-	std::unique_lock<Mutex> lock(_mutex);
-	auto it = _templates.find(path);
-	if (it != _templates.end()) {
-		return it->second;
+	if (auto tpl = find(path)) {
+		return tpl;
 	} else if (!readOnly) {
+		std::unique_lock<Mutex> lock(_mutex);
+		auto &templates = _snapshot.load()->templates;
+		auto it = templates.find(path);
+		if (it != templates.end()) {
+			return it->second;
+		}
+
 		if (auto tpl = openTemplate(path, -1, opts)) {
-			auto it = _templates.emplace(path.pdup(_templates.get_allocator()), tpl).first;
+			auto key = path.pdup(_pool);
+			publish([&] (TemplateMap &map) {
+				map.emplace(key, tpl);
+			});
 			if (tpl->getWatch() >= 0) {
-				_watches.emplace(tpl->getWatch(), it->first);
+				_watches.emplace(tpl->getWatch(), key);
 			}
 			return tpl;
 		}
@@ -264,7 +458,7 @@ Rc<FileRef> Cache::openTemplate(StringView path, int wId, const Template::Option
 	auto ret = FileRef::read(_pool, FilePath(path), opts, [&] (const StringView &err) {
 		std::cout << path << ":\n";
 		std::cout << err << "\n";
-	}, _inotify, wId);
+	}, _inotify, wId, _cacheDir);
 	if (!ret) {
 		onError(toString("File not found: ", path));
 	}  else if (ret->isValid()) {
@@ -274,6 +468,15 @@ Rc<FileRef> Cache::openTemplate(StringView path, int wId, const Template::Option
 }
 
 bool Cache::runTemplate(Rc<FileRef> tpl, StringView ipath, const RunCallback &cb, std::ostream &out) {
+	if (auto output = Output::get(out)) {
+		return runTemplate(tpl, ipath, cb, *output);
+	}
+
+	Output output(out);
+	return runTemplate(tpl, ipath, cb, output);
+}
+
+bool Cache::runTemplate(Rc<FileRef> tpl, StringView ipath, const RunCallback &cb, Output &out) {
 	if (tpl) {
 		if (auto t = tpl->getTemplate()) {
 			auto iopts = tpl->getOpts();
@@ -289,11 +492,21 @@ bool Cache::runTemplate(Rc<FileRef> tpl, StringView ipath, const RunCallback &cb
 					return false;
 				}
 
+				auto output = Output::get(out);
+				if (output) {
+					// included data can be referenced by output after template is released
+					output->retain(tpl.get());
+				}
+
 				bool ret = false;
 				if (const Template *t = tpl->getTemplate()) {
 					ret = t->run(exec, out);
 				} else {
-					out << tpl->getContent();
+					if (output) {
+						output->writeStatic(tpl->getContent());
+					} else {
+						out << tpl->getContent();
+					}
 					ret = true;
 				}
 
@@ -304,6 +517,7 @@ bool Cache::runTemplate(Rc<FileRef> tpl, StringView ipath, const RunCallback &cb
 					return false;
 				}
 			}
+			out.retain(tpl.get());
 			return t->run(exec, out);
 		} else {
 			onError(toString("File '", ipath, "' is not executable"));
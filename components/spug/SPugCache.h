@@ -31,7 +31,7 @@ NS_SP_EXT_BEGIN(pug)
 class FileRef : public RefBase<AtomicCounter, memory::PoolInterface> {
 public:
 	static Rc<FileRef> read(memory::pool_t *, FilePath path, Template::Options opts = Template::Options::getDefault(),
-			const Callback<void(const StringView &)> & = nullptr, int watch = -1, int wId = -1);
+			const Callback<void(const StringView &)> & = nullptr, int watch = -1, int wId = -1, const StringView &cacheDir = StringView());
 
 	static Rc<FileRef> read(memory::pool_t *, String && content, bool isTemplate, Template::Options opts = Template::Options::getDefault(),
 			const Callback<void(const StringView &)> & = nullptr);
@@ -44,12 +44,15 @@ public:
 
 	const Template::Options &getOpts() const;
 
-	FileRef(memory::pool_t *, const FilePath &path, Template::Options opts, const Callback<void(const StringView &)> &cb, int watch, int wId);
+	FileRef(memory::pool_t *, const FilePath &path, Template::Options opts, const Callback<void(const StringView &)> &cb, int watch, int wId,
+			const StringView &cacheDir);
 	FileRef(memory::pool_t *, String && content, bool isTemplate, Template::Options opts, const Callback<void(const StringView &)> &cb);
 
 	virtual ~FileRef();
 
 protected:
+	void readTemplate(const Callback<void(const StringView &)> &cb, const StringView &cacheDir);
+
 	int _watch = -1;
 	memory::pool_t *_pool = nullptr;
 	time_t _mtime = 0;
@@ -70,6 +73,10 @@ public:
 	bool runTemplate(const StringView &, const RunCallback &, std::ostream &);
 	bool runTemplate(const StringView &, const RunCallback &, std::ostream &, Template::Options opts);
 
+	// render directly into sink, provided by caller (e.g. server request), without intermediate stream
+	bool runTemplate(const StringView &, const RunCallback &, Output &);
+	bool runTemplate(const StringView &, const RunCallback &, Output &, Template::Options opts);
+
 	bool addFile(StringView);
 	bool addContent(StringView, String &&);
 	bool addTemplate(StringView, String &&);
@@ -83,11 +90,36 @@ public:
 	int getNotify() const;
 	bool isNotifyAvailable();
 
+	// directory to store compiled templates, so they are not recompiled after restart
+	bool setCacheDir(const StringView &);
+
 protected:
+	using TemplateMap = Map<StringView, Rc<FileRef>>;
+
+	// Immutable view of templates map, readers use it without locking
+	struct Snapshot : memory::AllocPool {
+		// snapshot and its map are allocated from own child pool, that is destroyed with snapshot
+		static Snapshot *create(memory::pool_t *, const Snapshot *prev = nullptr);
+		static void destroy(Snapshot *);
+
+		memory::pool_t *pool = nullptr;
+		TemplateMap templates;
+		uint64_t retired = 0; // epoch, when snapshot was replaced
+	};
+
+	Rc<FileRef> find(const StringView &) const;
+
+	// replace current snapshot with modified copy, should be called with _mutex locked
+	void publish(const Callback<void(TemplateMap &)> &);
+
+	// release snapshots, that can not be reached by readers, should be called with _mutex locked
+	void reclaim();
+
 	Rc<FileRef> acquireTemplate(StringView, bool readOnly, const Template::Options &);
 	Rc<FileRef> openTemplate(StringView, int wId, const Template::Options &);
 
 	bool runTemplate(Rc<FileRef>, StringView ipath, const RunCallback &cb, std::ostream &out);
+	bool runTemplate(Rc<FileRef>, StringView ipath, const RunCallback &cb, Output &out);
 	void onError(const StringView &);
 
 	int _inotify = -1;
@@ -95,8 +127,14 @@ protected:
 
 	memory::pool_t *_pool = nullptr;
 	Mutex _mutex;
-	Map<StringView, Rc<FileRef>> _templates;
+	std::atomic<Snapshot *> _snapshot;
+	// readers are counted by parity of epoch, in which they started: when readers of previous epoch
+	// are finished, snapshots, retired before current epoch, are unreachable
+	std::atomic<uint64_t> _epoch;
+	mutable std::atomic<size_t> _readers[2];
+	Vector<Snapshot *> _retired;
 	Map<int, StringView> _watches;
+	StringView _cacheDir;
 	Template::Options _opts;
 	Function<void(const StringView &)> _errorCallback;
 };
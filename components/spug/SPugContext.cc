@@ -1044,15 +1044,16 @@ static bool Context_processMixinArgs(Context::Mixin &mixin, Expression *expr) {
 	return true;
 }
 
-bool Context::setMixin(const StringView &name, const Template::Chunk *chunk) {
+bool Context::setMixin(const StringView &name, const Template::Op *op) {
 	auto it = currentScope->mixins.find(name);
 	if (it != currentScope->mixins.end()) {
 		return false;
 	}
 
-	Mixin mixin{chunk};
-	if (chunk->expr && chunk->expr->op == Expression::Call) {
-		if (!Context_processMixinArgs(mixin, chunk->expr->right)) {
+	Mixin mixin{op};
+	auto expr = op->chunk->expr;
+	if (expr && expr->op == Expression::Call) {
+		if (!Context_processMixinArgs(mixin, expr->right)) {
 			return false;
 		}
 	}
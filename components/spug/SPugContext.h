@@ -37,7 +37,7 @@ public:
 	using IncludeCallback = Function<bool(const StringView &, Context &, std::ostream &, const Template *)>;
 
 	struct Mixin {
-		const Template::Chunk *chunk;
+		const Template::Op *op;
 		Vector<Pair<StringView, Expression *>> args;
 		size_t required = 0;
 	};
@@ -81,7 +81,7 @@ public:
 
 	void set(const StringView &name, Callback &&);
 
-	bool setMixin(const StringView &name, const Template::Chunk *);
+	bool setMixin(const StringView &name, const Template::Op *);
 	const Mixin *getMixin(const StringView &name) const;
 
 	const VarStorage *getVar(const StringView &name) const;
@@ -0,0 +1,242 @@
+/**
+ Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+#include "SPugOutput.h"
+
+NS_SP_EXT_BEGIN(pug)
+
+Output *Output::get(std::ostream &stream) {
+	return dynamic_cast<Output *>(stream.rdbuf());
+}
+
+Output::Output(std::ostream &target, size_t threshold)
+: _pool(memory::pool::acquire()), _target(&target), _stream(this), _threshold(threshold) {
+	init();
+}
+
+Output::Output(Consumer &&cb, size_t threshold)
+: _pool(memory::pool::acquire()), _consumer(move(cb)), _stream(this), _threshold(threshold) {
+	init();
+}
+
+Output::~Output() {
+	flush();
+}
+
+void Output::write(const StringView &str) {
+	if (_indent > 0) {
+		appendIndented(str.data(), str.size());
+	} else if (str.size() >= BlockSize) {
+		// large data is passed to consumer without copying; it's valid only within this call,
+		// so, buffered slices are flushed first to preserve order
+		flush();
+		consume(str);
+		commit();
+	} else {
+		append(str.data(), str.size());
+	}
+}
+
+void Output::writeStatic(const StringView &str) {
+	if (_indent > 0 || str.size() < MinStaticSlice) {
+		// small slices cost more for consumer then copying
+		write(str);
+	} else {
+		appendSlice(str);
+	}
+}
+
+bool Output::flush() {
+	seal();
+	if (!_slices.empty()) {
+		for (auto &it : _slices) {
+			consume(it);
+		}
+		commit();
+	}
+	reset();
+	return _valid;
+}
+
+void Output::setFlushCallback(FlushCallback &&cb) {
+	_flushCallback = move(cb);
+}
+
+void Output::retain(Retained *ref) {
+	if (ref) {
+		_retained.emplace_back(ref);
+	}
+}
+
+void Output::pushIndent(size_t indent) {
+	write(StringView("\n"));
+	_indent += indent;
+	_lineStart = true;
+	setPut(pptr());
+}
+
+void Output::popIndent(size_t indent) {
+	_indent = (indent < _indent) ? _indent - indent : 0;
+	setPut(pptr());
+}
+
+Output::int_type Output::overflow(int_type c) {
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		char ch = traits_type::to_char_type(c);
+		if (_indent > 0) {
+			appendIndented(&ch, 1);
+		} else {
+			append(&ch, 1);
+		}
+	}
+	return traits_type::not_eof(c);
+}
+
+std::streamsize Output::xsputn(const char_type* s, std::streamsize n) {
+	write(StringView(s, n));
+	return n;
+}
+
+int Output::sync() {
+	return flush() ? 0 : -1;
+}
+
+void Output::consume(const StringView &str) {
+	if (_valid) {
+		if (_target) {
+			_target->write(str.data(), str.size());
+			if (_target->fail()) {
+				_valid = false;
+			}
+		} else if (_consumer) {
+			if (!_consumer(str)) {
+				_valid = false;
+			}
+		}
+	}
+	_flushed += str.size();
+}
+
+void Output::commit() {
+	if (_valid && _flushCallback) {
+		if (!_flushCallback()) {
+			_valid = false;
+		}
+	}
+}
+
+void Output::init() {
+	_blocks.emplace_back((char *)memory::pool::palloc(_pool, BlockSize));
+	reset();
+}
+
+void Output::append(const char *s, size_t n) {
+	while (n > 0) {
+		auto pos = pptr();
+		auto avail = size_t(_blockEnd - pos);
+		if (avail == 0) {
+			nextBlock();
+			continue;
+		}
+
+		auto len = std::min(avail, n);
+		memcpy(pos, s, len);
+		setPut(pos + len);
+		s += len;
+		n -= len;
+	}
+
+	if (_buffered + size_t(pptr() - _sealed) >= _threshold) {
+		flush();
+	}
+}
+
+void Output::appendIndented(const char *s, size_t n) {
+	while (n > 0) {
+		if (_lineStart) {
+			for (size_t i = 0; i < _indent; ++ i) {
+				append("\t", 1);
+			}
+			_lineStart = false;
+		}
+
+		auto nl = (const char *)memchr(s, '\n', n);
+		auto len = nl ? size_t(nl - s + 1) : n;
+		append(s, len);
+		if (nl) {
+			_lineStart = true;
+		}
+		s += len;
+		n -= len;
+	}
+}
+
+void Output::appendSlice(const StringView &str) {
+	seal();
+	_slices.emplace_back(str);
+	_buffered += str.size();
+	if (_buffered >= _threshold) {
+		flush();
+	}
+}
+
+void Output::seal() {
+	auto pos = pptr();
+	if (pos > _sealed) {
+		_slices.emplace_back(StringView(_sealed, pos - _sealed));
+		_buffered += pos - _sealed;
+		_sealed = pos;
+	}
+}
+
+void Output::setPut(char *pos) {
+	// with indentation, every write should pass through filter, so put area is disabled
+	setp(pos, (_indent > 0) ? pos : _blockEnd);
+}
+
+void Output::nextBlock() {
+	seal();
+	if (_buffered >= _threshold) {
+		flush();
+		return;
+	}
+
+	++ _block;
+	if (_block == _blocks.size()) {
+		_blocks.emplace_back((char *)memory::pool::palloc(_pool, BlockSize));
+	}
+	_blockEnd = _blocks[_block] + BlockSize;
+	_sealed = _blocks[_block];
+	setPut(_blocks[_block]);
+}
+
+void Output::reset() {
+	// all slices are consumed, so blocks can be reused
+	_slices.clear();
+	_buffered = 0;
+	_block = 0;
+	_blockEnd = _blocks[0] + BlockSize;
+	_sealed = _blocks[0];
+	setPut(_blocks[0]);
+}
+
+NS_SP_EXT_END(pug)
@@ -0,0 +1,120 @@
+/**
+ Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ **/
+
+#ifndef SPUG_SPUGOUTPUT_H_
+#define SPUG_SPUGOUTPUT_H_
+
+#include "SPug.h"
+#include "SPRef.h"
+
+NS_SP_EXT_BEGIN(pug)
+
+/* Append-only template output sink
+ *
+ * Static template data is stored as slices without copying, dynamic data is written into
+ * pool-allocated blocks directly from std::ostream interface, dynamic data larger than block
+ * is passed to consumer directly. Accumulated slices are passed to consumer when flush threshold
+ * is reached, so large pages can be sent before rendering is finished.
+ */
+class Output : public std::basic_streambuf<char, std::char_traits<char>>, public memory::AllocPool {
+public:
+	// consumer should not keep slice after return, or, if flush callback is set, after flush callback returns
+	using Consumer = Function<bool(const StringView &)>;
+
+	// called after every portion of slices was passed to consumer
+	using FlushCallback = Function<bool()>;
+	using Retained = RefBase<AtomicCounter, memory::PoolInterface>;
+
+	static constexpr size_t BlockSize = 4_KiB;
+	static constexpr size_t FlushThreshold = 16_KiB;
+	static constexpr size_t MinStaticSlice = 128;
+
+	// returns output, used as stream buffer for stream, or nullptr
+	static Output *get(std::ostream &);
+
+	Output(std::ostream &target, size_t threshold = FlushThreshold);
+	Output(Consumer &&, size_t threshold = FlushThreshold);
+	virtual ~Output();
+
+	// copy data into output
+	void write(const StringView &);
+
+	// data should not be modified or released until flush
+	void writeStatic(const StringView &);
+
+	bool flush();
+
+	// consumer can collect slices without copying (e.g. as transient buckets), and send them in flush callback
+	void setFlushCallback(FlushCallback &&);
+
+	// keep object, that owns static data, alive while output exists
+	void retain(Retained *);
+
+	// every line, started after push, will be prefixed with indent tabs
+	void pushIndent(size_t);
+	void popIndent(size_t);
+
+	std::ostream &stream() { return _stream; }
+	std::ostream *getTarget() const { return _target; }
+
+	size_t getFlushed() const { return _flushed; }
+
+protected:
+	virtual int_type overflow(int_type c = traits_type::eof()) override;
+	virtual std::streamsize xsputn(const char_type* s, std::streamsize n) override;
+	virtual int sync() override;
+
+	void init();
+	void consume(const StringView &);
+	void commit();
+	void append(const char *, size_t);
+	void appendIndented(const char *, size_t);
+	void appendSlice(const StringView &);
+	void seal();
+	void setPut(char *);
+	void nextBlock();
+	void reset();
+
+	memory::pool_t *_pool = nullptr;
+	Consumer _consumer;
+	FlushCallback _flushCallback;
+	std::ostream *_target = nullptr;
+	std::ostream _stream;
+
+	Vector<StringView> _slices;
+	Vector<char *> _blocks;
+	Vector<Rc<Retained>> _retained;
+	size_t _block = 0;
+	char *_blockEnd = nullptr;
+	char *_sealed = nullptr; // start of dynamic data, not yet stored as slice
+	size_t _buffered = 0;
+	size_t _threshold = FlushThreshold;
+	size_t _flushed = 0;
+
+	size_t _indent = 0;
+	bool _lineStart = false;
+	bool _valid = true;
+};
+
+NS_SP_EXT_END(pug)
+
+#endif /* SPUG_SPUGOUTPUT_H_ */
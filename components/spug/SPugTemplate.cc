@@ -23,6 +23,7 @@
 #include "SPugTemplate.h"
 #include "SPugContext.h"
 #include "SPugToken.h"
+#include "SPugOutput.h"
 
 NS_SP_EXT_BEGIN(pug)
 
@@ -578,6 +579,116 @@ TemplateRender::Vector<StringView> &TemplateRender::extractIncludes() {
 	return _includes;
 }
 
+struct TemplateCompiler {
+	using String = memory::PoolInterface::StringType;
+	using StringStream = memory::PoolInterface::StringStreamType;
+
+	struct Slice {
+		size_t op;
+		size_t offset;
+		size_t size;
+	};
+
+	TemplateCompiler(Template::Program &prog) : _program(prog) { }
+
+	void compile(const Template::Chunk &);
+
+	void compileBlock(const Template::Chunk &);
+	void compileChunk(const Template::Chunk &);
+
+	void pushText(const StringView &);
+	void pushOp(const Template::Chunk &, bool withBody);
+
+	Template::Program &_program;
+	Vector<Slice> _slices;
+	size_t _lastSlice = maxOf<size_t>();
+};
+
+void TemplateCompiler::compile(const Template::Chunk &root) {
+	compileBlock(root);
+
+	// static data is complete, so slices can now be bound to it
+	for (auto &it : _slices) {
+		_program.ops[it.op].text = StringView(_program.data.data() + it.offset, it.size);
+	}
+}
+
+void TemplateCompiler::compileBlock(const Template::Chunk &chunk) {
+	for (auto &it : chunk.chunks) {
+		compileChunk(*it);
+	}
+}
+
+void TemplateCompiler::compileChunk(const Template::Chunk &c) {
+	StringStream stream;
+	switch (c.type) {
+	case Template::Block:
+		compileBlock(c);
+		break;
+	case Template::Text:
+		pushText(c.value);
+		break;
+	case Template::OutputEscaped:
+	case Template::OutputUnescaped:
+		if (c.expr->isConst() && Context::printConstExpr(*c.expr, stream, c.type == Template::OutputEscaped)) {
+			pushText(stream.weak());
+		} else {
+			pushOp(c, false);
+		}
+		break;
+	case Template::AttributeEscaped:
+	case Template::AttributeUnescaped:
+		if (c.expr->isConst() && Context::printAttrVar(c.value, *c.expr, stream, c.type == Template::AttributeEscaped)) {
+			pushText(stream.weak());
+		} else {
+			pushOp(c, false);
+		}
+		break;
+	case Template::AttributeList:
+		if (c.expr->isConst() && Context::printAttrExpr(*c.expr, stream)) {
+			pushText(stream.weak());
+		} else {
+			pushOp(c, false);
+		}
+		break;
+	case Template::Code:
+	case Template::Include:
+	case Template::MixinCall:
+		pushOp(c, false);
+		break;
+	default:
+		pushOp(c, true);
+		break;
+	}
+}
+
+void TemplateCompiler::pushText(const StringView &str) {
+	if (str.empty()) {
+		return;
+	}
+
+	if (_lastSlice < _slices.size()) {
+		_slices[_lastSlice].size += str.size();
+	} else {
+		_lastSlice = _slices.size();
+		_slices.emplace_back(Slice{_program.ops.size(), _program.data.size(), str.size()});
+		_program.ops.emplace_back(Template::Op{Template::Text});
+	}
+	_program.data.append(str.data(), str.size());
+}
+
+void TemplateCompiler::pushOp(const Template::Chunk &c, bool withBody) {
+	_lastSlice = maxOf<size_t>();
+
+	auto idx = _program.ops.size();
+	_program.ops.emplace_back(Template::Op{c.type, 1, StringView(), &c});
+	if (withBody) {
+		compileBlock(c);
+		_lastSlice = maxOf<size_t>();
+		_program.ops[idx].skip = uint32_t(_program.ops.size() - idx);
+	}
+}
+
 Template::Options Template::Options::getDefault() {
 	return Options();
 }
@@ -619,11 +730,201 @@ Template::Template(memory::pool_t *p, const StringView &str, const Options &opts
 		renderer.renderToken(&_lexer.root);
 		renderer.flushBuffer();
 		_includes = move(renderer.extractIncludes());
+
+		TemplateCompiler compiler(_program);
+		compiler.compile(_root);
+	}
+}
+
+static Value Template_encodeExpression(const Expression *expr) {
+	if (!expr) {
+		return Value();
+	}
+
+	return Value({
+		Value(int64_t(toInt(expr->op))),
+		Value(int64_t(toInt(expr->block))),
+		Value(expr->isToken),
+		expr->value,
+		Template_encodeExpression(expr->left),
+		Template_encodeExpression(expr->right)
+	});
+}
+
+static Expression *Template_decodeExpression(const Value &val) {
+	if (!val.isArray() || val.size() != 6) {
+		return nullptr;
+	}
+
+	auto expr = new Expression(Expression::Op(val.getInteger(0)), Template_decodeExpression(val.getValue(4)),
+			Template_decodeExpression(val.getValue(5)), Value(val.getValue(3)));
+	expr->block = Expression::Block(val.getInteger(1));
+	expr->isToken = val.getBool(2);
+	return expr;
+}
+
+// cached data is read from disk, so, operators and blocks should be in range of known values
+static bool Template_validateExpression(const Value &val) {
+	if (val.isNull()) {
+		return true;
+	}
+
+	if (!val.isArray() || val.size() != 6) {
+		return false;
+	}
+
+	auto op = val.getInteger(0);
+	auto block = val.getInteger(1);
+	if (op < 0 || op > toInt(Expression::Sequence) || block < 0 || block > toInt(Expression::Operator)) {
+		return false;
 	}
+
+	// callable is taken from left operand
+	if (op == toInt(Expression::Call) && !val.isArray(4)) {
+		return false;
+	}
+
+	return Template_validateExpression(val.getValue(4)) && Template_validateExpression(val.getValue(5));
+}
+
+// mixin is declared with name token, or with call of name token
+static bool Template_validateMixin(const Value &expr) {
+	auto op = expr.getInteger(0);
+	if (op == toInt(Expression::Call)) {
+		auto &left = expr.getValue(4);
+		return left.isArray() && left.size() == 6 && left.getBool(2);
+	} else if (op == toInt(Expression::NoOp)) {
+		return expr.getBool(2);
+	}
+	return false;
+}
+
+static bool Template_validateProgram(const Value &ops) {
+	auto count = ops.size();
+	Vector<size_t> ends;
+	ends.emplace_back(count);
+	for (size_t i = 0; i < count; ++ i) {
+		while (ends.back() == i) {
+			ends.pop_back();
+		}
+
+		auto &op = ops.getValue(i);
+		auto type = op.getInteger(0);
+		auto skip = op.getInteger(1);
+		if (type < 0 || type > toInt(Template::MixinCall) || skip < 1 || i + skip > ends.back()) {
+			return false;
+		}
+
+		switch (Template::ChunkType(type)) {
+		case Template::Block:
+			return false;
+			break;
+		case Template::Text:
+			if (skip != 1 || op.size() != 4) {
+				return false;
+			}
+			break;
+		case Template::ControlDefault:
+		case Template::ControlElse:
+		case Template::Include:
+		case Template::MixinCall:
+			break;
+		case Template::ControlMixin:
+			if (!op.isArray(4) || !Template_validateMixin(op.getValue(4))) {
+				return false;
+			}
+			break;
+		default:
+			// instruction can not be executed without an expression
+			if (!op.isArray(4)) {
+				return false;
+			}
+			break;
+		}
+
+		if (type != Template::Text && !Template_validateExpression(op.getValue(4))) {
+			return false;
+		}
+
+		if (skip > 1) {
+			ends.emplace_back(i + skip);
+		}
+	}
+	return true;
+}
+
+Template *Template::decode(memory::pool_t *p, const Value &val, const Options &opts) {
+	if (val.getInteger("version") != CompiledVersion || !val.isString("data") || !val.isArray("ops")
+			|| !Template_validateProgram(val.getValue("ops"))) {
+		return nullptr;
+	}
+
+	memory::pool::push(p);
+	auto ret = new (p) Template(p, val, opts);
+	memory::pool::pop();
+	return ret;
+}
+
+Template::Template(memory::pool_t *p, const Value &val, const Options &opts)
+: _pool(p), _lexer(StringView()), _opts(opts) {
+	_program.data = val.getString("data");
+
+	auto &ops = val.getArray("ops");
+	_program.ops.reserve(ops.size());
+	for (auto &it : ops) {
+		auto type = ChunkType(it.getInteger(0));
+		auto skip = uint32_t(it.getInteger(1));
+		if (type == Text) {
+			auto offset = std::min(size_t(it.getInteger(2)), _program.data.size());
+			auto size = std::min(size_t(it.getInteger(3)), _program.data.size() - offset);
+			_program.ops.emplace_back(Op{type, skip, StringView(_program.data.data() + offset, size)});
+		} else {
+			// chunks are kept only as storage for instruction arguments
+			_root.chunks.emplace_back(new Chunk{type, it.getString(2), Template_decodeExpression(it.getValue(4)), size_t(it.getInteger(3))});
+			_program.ops.emplace_back(Op{type, skip, StringView(), _root.chunks.back()});
+			if (type == Include) {
+				_includes.emplace_back(_root.chunks.back()->value);
+			}
+		}
+	}
+}
+
+Value Template::encode() const {
+	Value ops(Value::Type::ARRAY);
+	ops.getArray().reserve(_program.ops.size());
+	for (auto &it : _program.ops) {
+		if (it.type == Text) {
+			ops.addValue(Value({
+				Value(int64_t(it.type)), Value(int64_t(it.skip)),
+				Value(int64_t(it.text.data() - _program.data.data())), Value(int64_t(it.text.size()))
+			}));
+		} else {
+			ops.addValue(Value({
+				Value(int64_t(it.type)), Value(int64_t(it.skip)),
+				Value(it.chunk->value), Value(int64_t(it.chunk->indent)),
+				Template_encodeExpression(it.chunk->expr)
+			}));
+		}
+	}
+
+	return Value({
+		pair("version", Value(CompiledVersion)),
+		pair("data", Value(_program.data)),
+		pair("ops", move(ops))
+	});
 }
 
 bool Template::run(Context &ctx, std::ostream &out) const {
-	return runChunk(_root, ctx, out);
+	if (auto output = Output::get(out)) {
+		return run(ctx, *output);
+	}
+
+	Output output(out);
+	return run(ctx, output);
+}
+
+bool Template::run(Context &ctx, Output &out) const {
+	return runOps(_program.ops.data(), _program.ops.data() + _program.ops.size(), ctx, out);
 }
 
 static void Template_describeChunk(std::ostream &stream, const Template::Chunk &chunk, size_t depth) {
@@ -673,7 +974,7 @@ void Template::describe(std::ostream &stream, bool tokens) const {
 		stream << "\n";
 	}
 	Template_describeChunk(stream, _root, 0);
-	stream << "\n";
+	stream << "\nProgram: " << _program.ops.size() << " ops, " << _program.data.size() << " bytes of static output\n";
 }
 
 static void Template_readMixinArgs(Vector<Expression *> &vars, Expression *expr) {
@@ -687,70 +988,75 @@ static void Template_readMixinArgs(Vector<Expression *> &vars, Expression *expr)
 	}
 }
 
-bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) const {
+bool Template::runOps(const Op *begin, const Op *end, Context &exec, Output &output) const {
+	auto &out = output.stream();
+
 	auto onError = [&] (const StringView &err) {
-		if (&out != &std::cout) {
+		if (output.getTarget() != &std::cout) {
 			out << "Context error: " << err << "\n";
 		} else {
 			out << "<!-- " << "Context error: " << err << " -->";
 		}
 	};
 
-	auto runIf = [&] (auto &it) -> bool {
+	auto runBody = [&] (const Op *op) -> bool {
+		return runOps(op + 1, op + op->skip, exec, output);
+	};
+
+	auto runIf = [&] (const Op * &it) -> bool {
 		Context::VarScope scope;
 		exec.pushVarScope(scope);
 
 		bool success = false;
 		bool r = true;
-		bool allowElseIf = (*it)->type == ControlIf;
+		bool allowElseIf = it->type == ControlIf;
 
 		auto tryExec = [&] () -> bool {
-			if (auto var = exec.exec(*(*it)->expr, out, true)) {
+			if (auto var = exec.exec(*it->chunk->expr, out, true)) {
 				auto &v = var.readValue();
 				auto val = (v.getType() == Value::Type::DICTIONARY || v.getType() == Value::Type::ARRAY) ? !v.empty() : v.asBool();
 				if ((!allowElseIf && !val) || val) {
-					if (!runChunk(**it, exec, out)) {
+					if (!runBody(it)) {
 						r = false;
 					}
 					return true;
 				} else {
-					++ it;
+					it += it->skip;
 				}
 			} else {
-				++ it;
+				it += it->skip;
 				r = false;
 			}
 			return false;
 		};
 
-
-		if ((*it)->type == ControlIf || (*it)->type == ControlUnless) {
+		if (it->type == ControlIf || it->type == ControlUnless) {
 			if (tryExec()) {
 				success = true;
-				++ it;
+				it += it->skip;
 			}
 		}
 
 		if (!success && allowElseIf) {
-			while (it != chunk.chunks.end() && (*it)->type == ControlElseIf) {
+			while (it != end && it->type == ControlElseIf) {
 				if (tryExec()) {
 					success = true;
-					++ it;
+					it += it->skip;
 					break;
 				}
 			}
 		}
 
-		if (!success && it != chunk.chunks.end() && (*it)->type == ControlElse) {
-			if (!runChunk(**it, exec, out)) {
+		if (!success && it != end && it->type == ControlElse) {
+			if (!runBody(it)) {
 				success = true;
 				r = false;
 			}
-			++ it;
+			it += it->skip;
 		}
 
-		while (it != chunk.chunks.end() && ((*it)->type == ControlElse || (allowElseIf && (*it)->type == ControlElseIf))) {
-			++ it;
+		while (it != end && (it->type == ControlElse || (allowElseIf && it->type == ControlElseIf))) {
+			it += it->skip;
 		}
 
 		exec.popVarScope();
@@ -758,23 +1064,23 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		return r;
 	};
 
-	auto runEachBody = [&] (auto &it, const auto &cb) -> bool {
+	auto runEachBody = [&] (const Op * &it, const auto &cb) -> bool {
 		bool r = true;
 		Context::VarScope scope;
 		exec.pushVarScope(scope);
 
-		auto next = it + 1;
-		bool hasElse = (next != chunk.chunks.end() && (*next)->type == ControlElse);
+		auto next = it + it->skip;
+		bool hasElse = (next != end && next->type == ControlElse);
 		bool runElse = false;
 
-		if (auto var = exec.exec(*(*it)->expr, out)) {
+		if (auto var = exec.exec(*it->chunk->expr, out)) {
 			auto runWithVar = [&] (const Value &val, bool isConst) -> bool {
 				if (val.isArray()) {
 					size_t i = 0;
 					if (val.size() > 0) {
 						for (auto &v_it : val.asArray()) {
 							cb(Value(uint32_t(i)), &v_it, isConst);
-							if (!runChunk(**it, exec, out) && _opts.hasFlag(Options::StopOnError)) {
+							if (!runBody(it) && _opts.hasFlag(Options::StopOnError)) {
 								return false;
 							}
 							scope.namedVars.clear();
@@ -787,7 +1093,7 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 					if (val.size() > 0) {
 						for (auto &v_it : val.asDict()) {
 							cb(Value(v_it.first), &v_it.second, isConst);
-							if (!runChunk(**it, exec, out) && _opts.hasFlag(Options::StopOnError)) {
+							if (!runBody(it) && _opts.hasFlag(Options::StopOnError)) {
 								return false;
 							}
 							scope.namedVars.clear();
@@ -799,7 +1105,7 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 					if (!hasElse) {
 						if (val) {
 							cb(Value(0), &val, isConst);
-							if (!runChunk(**it, exec, out) && _opts.hasFlag(Options::StopOnError)) {
+							if (!runBody(it) && _opts.hasFlag(Options::StopOnError)) {
 								return false;
 							}
 						}
@@ -821,21 +1127,22 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		}
 
 		if (hasElse) {
-			++ it;
+			it = next;
 			if (runElse) {
-				if (!runChunk(**it, exec, out) && _opts.hasFlag(Options::StopOnError)) {
+				if (!runBody(it) && _opts.hasFlag(Options::StopOnError)) {
+					exec.popVarScope();
 					return false;
 				}
 			}
 		}
 
 		exec.popVarScope();
-		++ it;
+		it += it->skip;
 		return r;
 	};
 
-	auto runEach = [&] (auto &it) -> bool {
-		StringView varName((*it)->value);
+	auto runEach = [&] (const Op * &it) -> bool {
+		StringView varName(it->chunk->value);
 		if (varName.empty()) {
 			return false;
 		}
@@ -845,11 +1152,11 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		});
 	};
 
-	auto runEachPair = [&] (auto &it) -> bool {
+	auto runEachPair = [&] (const Op * &it) -> bool {
 		StringView varFirst;
 		StringView varSecond;
 
-		string::split((*it)->value, " ", [&] (const StringView &val) {
+		string::split(it->chunk->value, " ", [&] (const StringView &val) {
 			if (varFirst.empty()) {
 				varFirst = val;
 			} else {
@@ -867,15 +1174,15 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		});
 	};
 
-	auto runWhile = [&] (const Chunk &ch) {
+	auto runWhile = [&] (const Op *op) {
 		Context::VarScope scope;
 		while (true) {
-			if (auto var = exec.exec(*ch.expr, out)) {
+			if (auto var = exec.exec(*op->chunk->expr, out)) {
 				if (var.readValue().asBool()) {
 					scope.namedVars.clear();
 					scope.mixins.clear();
 					exec.pushVarScope(scope);
-					if (!runChunk(ch, exec, out)) {
+					if (!runBody(op)) {
 						exec.popVarScope();
 						return false;
 					}
@@ -890,10 +1197,11 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		return false;
 	};
 
-	auto runMixinChunk = [&] (const Chunk &ch) -> bool {
-		auto mixin = exec.getMixin(ch.value);
+	auto runMixinCall = [&] (const Op *op) -> bool {
+		auto &name = op->chunk->value;
+		auto mixin = exec.getMixin(name);
 		if (!mixin) {
-			onError(toString("Mixin with name ", ch.value, " is not found"));
+			onError(toString("Mixin with name ", name, " is not found"));
 			if (_opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
@@ -901,10 +1209,10 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		}
 
 		Vector<Expression *> vars;
-		Template_readMixinArgs(vars, ch.expr);
+		Template_readMixinArgs(vars, op->chunk->expr);
 
 		if (vars.size() < mixin->required) {
-			onError(toString("Not enough arguments for mixin: ", ch.value));
+			onError(toString("Not enough arguments for mixin: ", name));
 			if (_opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
@@ -929,7 +1237,8 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 
 		exec.pushVarScope(scope);
 
-		if (!runChunk(*mixin->chunk, exec, out) && _opts.hasFlag(Options::StopOnError)) {
+		if (!runOps(mixin->op + 1, mixin->op + mixin->op->skip, exec, output) && _opts.hasFlag(Options::StopOnError)) {
+			exec.popVarScope();
 			return false;
 		}
 
@@ -937,57 +1246,52 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 		return true;
 	};
 
-	auto it = chunk.chunks.begin();
-	while (it != chunk.chunks.end()) {
-		auto &c = **it;
-		switch (c.type) {
+	auto it = begin;
+	while (it != end) {
+		auto c = it->chunk;
+		switch (it->type) {
 		case Text:
-			out << c.value;
+			output.writeStatic(it->text);
 			++ it;
 			break;
 		case OutputEscaped:
 		case OutputUnescaped:
-			if (!exec.print(*c.expr, out, c.type == OutputEscaped) && _opts.hasFlag(Options::StopOnError)) {
+			if (!exec.print(*c->expr, out, it->type == OutputEscaped) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
 			++ it;
 			break;
 		case AttributeEscaped:
 		case AttributeUnescaped:
-			if (!exec.printAttr(c.value, *c.expr, out, c.type == AttributeEscaped) && _opts.hasFlag(Options::StopOnError)) {
+			if (!exec.printAttr(c->value, *c->expr, out, it->type == AttributeEscaped) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
 			++ it;
 			break;
 		case AttributeList:
-			if (!exec.printAttrExprList(*c.expr, out) && _opts.hasFlag(Options::StopOnError)) {
+			if (!exec.printAttrExprList(*c->expr, out) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
 			++ it;
 			break;
-		case Block:
 		case ControlWhen:
 		case ControlDefault:
-			runChunk(c, exec, out);
-			++ it;
+			runBody(it);
+			it += it->skip;
 			break;
 		case Code:
-			if (!exec.exec(*c.expr, out) && _opts.hasFlag(Options::StopOnError)) {
+			if (!exec.exec(*c->expr, out) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
 			++ it;
 			break;
 		case ControlCase:
-			if (!runCase(c, exec, out) && _opts.hasFlag(Options::StopOnError)) {
+			if (!runCase(it, exec, output) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
-			++ it;
+			it += it->skip;
 			break;
 		case ControlIf:
-			if (!runIf(it) && _opts.hasFlag(Options::StopOnError)) {
-				return false;
-			}
-			break;
 		case ControlUnless:
 			if (!runIf(it) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
@@ -1004,39 +1308,40 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 			}
 			break;
 		case ControlWhile:
-			if (!runWhile(**it) && _opts.hasFlag(Options::StopOnError)) {
+			if (!runWhile(it) && _opts.hasFlag(Options::StopOnError)) {
 				return false;
 			}
-			++ it;
+			it += it->skip;
 			break;
 		case Include:
 			if (_opts.hasFlag(Options::Pretty)) {
-				memory::ostringstream stream;
-				if (!exec.runInclude((*it)->value, stream, this) && _opts.hasFlag(Options::StopOnError)) {
+				output.pushIndent(c->indent);
+				auto ret = exec.runInclude(c->value, out, this);
+				output.popIndent(c->indent);
+				if (!ret && _opts.hasFlag(Options::StopOnError)) {
 					return false;
 				}
-				pushWithPrettyFilter(stream, (*it)->indent, out);
 			} else {
-				if (!exec.runInclude((*it)->value, out, this) && _opts.hasFlag(Options::StopOnError)) {
+				if (!exec.runInclude(c->value, out, this) && _opts.hasFlag(Options::StopOnError)) {
 					return false;
 				}
 			}
 			++ it;
 			break;
 		case ControlMixin:
-			++ it;
-			if (c.expr->op == Expression::Call && c.expr->left->isToken) {
-				if (!exec.setMixin(c.expr->left->value.getString(), &c)) {
-					onError(toString("Invalid mixin declaration: ", c.expr->left->value.getString()));
+			if (c->expr->op == Expression::Call && c->expr->left->isToken) {
+				if (!exec.setMixin(c->expr->left->value.getString(), it)) {
+					onError(toString("Invalid mixin declaration: ", c->expr->left->value.getString()));
 				}
-			} else if (c.expr->op == Expression::NoOp && c.expr->isToken) {
-				if (!exec.setMixin(c.expr->value.getString(), &c)) {
-					onError(toString("Invalid mixin declaration: ", c.expr->value.getString()));
+			} else if (c->expr->op == Expression::NoOp && c->expr->isToken) {
+				if (!exec.setMixin(c->expr->value.getString(), it)) {
+					onError(toString("Invalid mixin declaration: ", c->expr->value.getString()));
 				}
 			}
+			it += it->skip;
 			break;
 		case MixinCall:
-			if (!runMixinChunk(c)) {
+			if (!runMixinCall(it)) {
 				return false;
 			}
 			++ it;
@@ -1050,45 +1355,45 @@ bool Template::runChunk(const Chunk &chunk, Context &exec, std::ostream &out) co
 	return true;
 }
 
-bool Template::runCase(const Chunk &chunk, Context &exec, std::ostream &out) const {
-	auto runWhenChunk = [&] (auto it) -> bool {
-		if ((*it)->chunks.size() > 0) {
-			return runChunk(**it, exec, out);
-		} else {
-			++ it;
-			while (it != chunk.chunks.end() && (*it)->type == Template::ControlWhen) {
-				if ((*it)->chunks.size() > 0) {
-					return runChunk(**it, exec, out);
-				}
+bool Template::runCase(const Op *op, Context &exec, Output &output) const {
+	auto &out = output.stream();
+	auto end = op + op->skip;
+
+	auto runWhenBody = [&] (const Op *it) -> bool {
+		// empty 'when' falls through to the next non-empty one
+		while (it != end && it->type == Template::ControlWhen) {
+			if (it->skip > 1) {
+				return runOps(it + 1, it + it->skip, exec, output);
 			}
+			it += it->skip;
 		}
 		return false;
 	};
 
 	auto perform = [&] () -> bool {
-		if (auto var = exec.exec(*chunk.expr, out)) {
+		if (auto var = exec.exec(*op->chunk->expr, out)) {
 			if (auto val = var.readValue()) {
-				const Template::Chunk *def = nullptr;
-				auto it = chunk.chunks.begin();
-				while (it != chunk.chunks.end()) {
-					switch ((*it)->type) {
+				const Op *def = nullptr;
+				auto it = op + 1;
+				while (it != end) {
+					switch (it->type) {
 					case Template::ControlWhen:
-						if (auto v = exec.exec(*(*it)->expr, out)) {
+						if (auto v = exec.exec(*it->chunk->expr, out)) {
 							auto &v2 = v.readValue();
 							if (val == v2) {
-								return runWhenChunk(it);
+								return runWhenBody(it);
 							}
 						} else {
 							return false;
 						}
 						break;
-					case Template::ControlDefault: def = *it; break;
+					case Template::ControlDefault: def = it; break;
 					default: break;
 					}
-					++ it;
+					it += it->skip;
 				}
 				if (def) {
-					return runChunk(*def, exec, out);
+					return runOps(def + 1, def + def->skip, exec, output);
 				} else {
 					return true;
 				}
@@ -1104,20 +1409,4 @@ bool Template::runCase(const Chunk &chunk, Context &exec, std::ostream &out) con
 	return ret;
 }
 
-void Template::pushWithPrettyFilter(memory::ostringstream &str, size_t indent, std::ostream &out) const {
-	StringView r(str.weak());
-	out << '\n';
-	while (!r.empty()) {
-		for (size_t i = 0; i < indent; ++ i) {
-			out << '\t';
-		}
-		out << r.readUntil<StringView::Chars<'\r', '\n'>>();
-		out << r.readChars<StringView::Chars<'\r'>>();
-		if (r.is('\n')) {
-			out << '\n';
-			++ r;
-		}
-	}
-}
-
 NS_SP_EXT_END(pug)
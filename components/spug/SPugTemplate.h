@@ -29,6 +29,8 @@ NS_SP_EXT_BEGIN(pug)
 
 class Template : public memory::AllocPool {
 public:
+	static constexpr int64_t CompiledVersion = 1;
+
 	enum ChunkType {
 		Block,
 		Text,
@@ -68,6 +70,19 @@ public:
 		Vector<Chunk *> chunks;
 	};
 
+	// Flat instruction of compiled program; control instructions own [this + 1, this + skip) as body
+	struct Op {
+		ChunkType type = Block;
+		uint32_t skip = 1;
+		StringView text;
+		const Chunk *chunk = nullptr;
+	};
+
+	struct Program {
+		String data; // merged static output, referenced by Text instructions
+		Vector<Op> ops;
+	};
+
 	struct Options {
 		enum Flags {
 			Pretty,
@@ -91,22 +106,29 @@ public:
 	static Template *read(memory::pool_t *, const StringView &, const Options & = Options::getDefault(),
 			const Callback<void(const StringView &)> &err = nullptr);
 
+	// restore template from data, produced by 'encode', returns nullptr if data is not compatible
+	static Template *decode(memory::pool_t *, const Value &, const Options & = Options::getDefault());
+
 	bool run(Context &, std::ostream &) const;
+	bool run(Context &, Output &) const;
+
+	// serialize compiled program, so it can be restored without parsing
+	Value encode() const;
 
 	void describe(std::ostream &stream, bool tokens = false) const;
 
 protected:
 	Template(memory::pool_t *, const StringView &, const Options &opts, const Callback<void(const StringView &)> &err);
+	Template(memory::pool_t *, const Value &, const Options &opts);
 
-	bool runChunk(const Chunk &chunk, Context &, std::ostream &) const;
-	bool runCase(const Chunk &chunk, Context &, std::ostream &) const;
-
-	void pushWithPrettyFilter(memory::ostringstream &, size_t indent, std::ostream &) const;
+	bool runOps(const Op *begin, const Op *end, Context &, Output &) const;
+	bool runCase(const Op *, Context &, Output &) const;
 
 	memory::pool_t *_pool;
 	Lexer _lexer;
 	Time _mtime;
 	Chunk _root;
+	Program _program;
 	Options _opts;
 
 	Vector<StringView> _includes;
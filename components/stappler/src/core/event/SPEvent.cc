@@ -86,6 +86,11 @@ void Event::send(const EventHeader &header, Ref *object, const char *value) {
 	send(header, object, str);
 }
 void Event::send(const EventHeader &header, Ref *object, const String &value) {
+	if (header.isCoalesced()) {
+		Value val; val.strValue = &value;
+		EventDispatcher::getInstance()->queueEvent(Event(header, object, val, Type::String));
+		return;
+	}
 	Thread::onMainThread([header, object, value] () {
 		Value val; val.strValue = &value;
 		Event event(header, object, val, Type::String);
@@ -96,6 +101,11 @@ void Event::send(const EventHeader &header, Ref *object, const StringView &value
 	send(header, object, value.str());
 }
 void Event::send(const EventHeader &header, Ref *object, const data::Value &value) {
+	if (header.isCoalesced()) {
+		Value val; val.dataValue = &value;
+		EventDispatcher::getInstance()->queueEvent(Event(header, object, val, Type::Data));
+		return;
+	}
 	Thread::onMainThread([header, object, value] () {
 		Value val; val.dataValue = &value;
 		Event event(header, object, val, Type::Data);
@@ -103,12 +113,20 @@ void Event::send(const EventHeader &header, Ref *object, const data::Value &valu
 	});
 }
 void Event::send(const EventHeader &header, Ref *object, Value val, Type type) {
+	if (header.isCoalesced()) {
+		EventDispatcher::getInstance()->queueEvent(Event(header, object, val, type));
+		return;
+	}
 	Thread::onMainThread([header, object, val, type] () {
 		Event event(header, object, val, type);
 		event.dispatch();
 	});
 }
 void Event::send(const EventHeader &header, Ref *object) {
+	if (header.isCoalesced()) {
+		EventDispatcher::getInstance()->queueEvent(Event(header, object));
+		return;
+	}
 	Thread::onMainThread([header, object] () {
 		Event event(header, object);
 		event.dispatch();
@@ -124,6 +124,7 @@ protected:
 	Value _value;
 
 	friend class EventHeader;
+	friend class EventDispatcher;
 
 private:
 	static String ZERO_STRING;
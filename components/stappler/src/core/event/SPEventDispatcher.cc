@@ -28,6 +28,7 @@ THE SOFTWARE.
 #include "SPEvent.h"
 #include "SPEventHandler.h"
 #include "SPThreadManager.h"
+#include "SPThread.h"
 
 //#define SPEVENT_LOG(...) stappler::logTag("Event", __VA_ARGS__)
 #define SPEVENT_LOG(...)
@@ -53,17 +54,27 @@ void EventDispatcher::removeEventHeader(const EventHeader *header) {
 
 void EventDispatcher::addEventListener(const EventHandlerNode *listener) {
 	SPEVENT_LOG("addEventListener");
-	auto it = _listeners.find(listener->getEventID());
-	if (it != _listeners.end()) {
-		it->second.insert(listener);
+	auto &list = _listeners[listener->getEventID()];
+	if (auto obj = listener->getObject()) {
+		list.objects[obj].insert(listener);
 	} else {
-		_listeners.emplace(listener->getEventID(), std::unordered_set<const EventHandlerNode *>{listener});
+		list.common.insert(listener);
 	}
 }
 void EventDispatcher::removeEventListner(const EventHandlerNode *listener) {
 	auto it = _listeners.find(listener->getEventID());
 	if (it != _listeners.end()) {
-		it->second.erase(listener);
+		if (auto obj = listener->getObject()) {
+			auto objIt = it->second.objects.find(obj);
+			if (objIt != it->second.objects.end()) {
+				objIt->second.erase(listener);
+				if (objIt->second.empty()) {
+					it->second.objects.erase(objIt);
+				}
+			}
+		} else {
+			it->second.common.erase(listener);
+		}
 	}
 	SPEVENT_LOG("removeEventListner");
 }
@@ -73,21 +84,106 @@ void EventDispatcher::removeAllListeners() {
 }
 
 void EventDispatcher::dispatchEvent(const Event &ev) {
-	if (_listeners.size() > 0) {
-		auto it = _listeners.find(ev.getHeader().getEventID());
-		if (it != _listeners.end() && it->second.size() != 0) {
-			Vector<const EventHandlerNode *> listenersToExecute;
-			auto &listeners = it->second;
-			for (auto l : listeners) {
-				if (l->shouldRecieveEventWithObject(ev.getEventID(), ev.getObject())) {
-					listenersToExecute.push_back(l);
-				}
-			}
+	if (_listeners.empty()) {
+		return;
+	}
 
-			for (auto l : listenersToExecute) {
-				l->onEventRecieved(ev);
-			}
+	auto it = _listeners.find(ev.getHeader().getEventID());
+	if (it == _listeners.end()) {
+		return;
+	}
+
+	const ListenerSet *objectListeners = nullptr;
+	if (auto obj = ev.getObject()) {
+		auto objIt = it->second.objects.find(obj);
+		if (objIt != it->second.objects.end()) {
+			objectListeners = &objIt->second;
+		}
+	}
+
+	if (it->second.common.empty() && !objectListeners) {
+		return;
+	}
+
+	// listeners can be added or removed from callbacks, so we copy them into list, reused between dispatches;
+	// callbacks can dispatch another events, so each level of recursion use its own list
+	auto depth = _dispatchDepth;
+	if (_dispatchLists.size() <= depth) {
+		_dispatchLists.resize(depth + 1);
+	}
+
+	auto &list = _dispatchLists[depth];
+	list.clear();
+	list.insert(list.end(), it->second.common.begin(), it->second.common.end());
+	if (objectListeners) {
+		list.insert(list.end(), objectListeners->begin(), objectListeners->end());
+	}
+
+	auto count = list.size();
+	++ _dispatchDepth;
+	for (size_t i = 0; i < count; ++ i) {
+		// nested dispatch can reallocate list storage, so list should be acquired by index
+		_dispatchLists[depth][i]->onEventRecieved(ev);
+	}
+	-- _dispatchDepth;
+
+	_dispatchLists[depth].clear();
+}
+
+void EventDispatcher::queueEvent(const Event &ev) {
+	bool schedule = false;
+	{
+		std::unique_lock<std::mutex> lock(_queueMutex);
+		auto &index = _queueIndex[ev.getEventID()];
+		auto it = index.find(ev.getObject());
+		QueuedEvent *q = nullptr;
+		if (it != index.end()) {
+			q = &_queue[it->second];
+		} else {
+			index.emplace(ev.getObject(), _queue.size());
+			_queue.emplace_back(QueuedEvent{&ev.getHeader(), ev.getObject()});
+			q = &_queue.back();
+		}
+
+		q->type = ev._type;
+		q->value = ev._value;
+		switch (ev._type) {
+		case Event::Type::String: q->strValue = *ev._value.strValue; break;
+		case Event::Type::Data: q->dataValue = *ev._value.dataValue; break;
+		default: break;
+		}
+
+		schedule = !_queueScheduled;
+		_queueScheduled = true;
+	}
+
+	if (schedule) {
+		Thread::onMainThread([this] {
+			dispatchQueuedEvents();
+		}, nullptr, true);
+	}
+}
+
+void EventDispatcher::dispatchQueuedEvents() {
+	Vector<QueuedEvent> queue;
+	{
+		std::unique_lock<std::mutex> lock(_queueMutex);
+		queue = std::move(_queue);
+		_queue.clear();
+		_queueIndex.clear();
+		_queueScheduled = false;
+	}
+
+	for (auto &it : queue) {
+		auto val = it.value;
+		switch (it.type) {
+		case Event::Type::String: val.strValue = &it.strValue; break;
+		case Event::Type::Data: val.dataValue = &it.dataValue; break;
+		default: break;
 		}
+
+		Event event(*it.header, it.object, val, it.type);
+		dispatchEvent(event);
 	}
 }
 
@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "SPDefine.h"
 #include "SPEventHeader.h"
+#include "SPEvent.h"
 
 NS_SP_BEGIN
 
@@ -48,11 +49,43 @@ public:
 
 	void dispatchEvent(const Event &ev);
 
+	// stores event to be dispatched on next frame, previously queued event with the same header and object is replaced
+	// can be called from any thread
+	void queueEvent(const Event &ev);
+
 	const Set<const EventHeader *> &getKnownEvents();
 protected:
+	using ListenerSet = std::unordered_set<const EventHandlerNode *>;
+
+	// listeners for single event id, indexed by target object
+	struct ListenerList {
+		ListenerSet common; // listeners without target object
+		std::unordered_map<Ref *, ListenerSet> objects;
+	};
+
+	struct QueuedEvent {
+		const EventHeader *header;
+		Ref *object;
+		Event::Type type;
+		Event::Value value;
+		String strValue;
+		data::Value dataValue;
+	};
+
+	void dispatchQueuedEvents();
+
 	Set<const EventHeader *> _knownEvents;
 
-	std::unordered_map<EventHeader::EventID, std::unordered_set<const EventHandlerNode *>> _listeners;
+	std::unordered_map<EventHeader::EventID, ListenerList> _listeners;
+
+	// reusable lists of listeners to execute, one for each level of recursive dispatch
+	Vector<Vector<const EventHandlerNode *>> _dispatchLists;
+	size_t _dispatchDepth = 0;
+
+	std::mutex _queueMutex;
+	Vector<QueuedEvent> _queue;
+	std::unordered_map<EventHeader::EventID, std::unordered_map<Ref *, size_t>> _queueIndex;
+	bool _queueScheduled = false;
 };
 
 NS_SP_END;
@@ -77,6 +77,7 @@ public:
 	};
 
 	EventHeader::EventID getEventID() const { return _eventID; }
+	Ref *getObject() const { return _obj; }
 
 	void onEventRecieved(const Event &event) const;
 
@@ -44,19 +44,23 @@ EventHeader::EventHeader(Category cat, const String &name)
 EventHeader::EventHeader(const String &catName, const String &eventName)
 : EventHeader(string::hash32(catName), eventName) { }
 
-EventHeader::EventHeader(const EventHeader &other) : _category(other._category), _id(other._id), _name(other._name) { }
-EventHeader::EventHeader(EventHeader &&other) : _category(other._category), _id(other._id), _name(std::move(other._name)) { }
+EventHeader::EventHeader(const EventHeader &other)
+: _category(other._category), _id(other._id), _name(other._name), _coalesced(other._coalesced) { }
+EventHeader::EventHeader(EventHeader &&other)
+: _category(other._category), _id(other._id), _name(std::move(other._name)), _coalesced(other._coalesced) { }
 
 EventHeader &EventHeader::operator=(const EventHeader &other) {
 	_category = other._category;
 	_id = other._id;
 	_name = other._name;
+	_coalesced = other._coalesced;
 	return *this;
 }
 EventHeader &EventHeader::operator=(EventHeader &&other) {
 	_category = other._category;
 	_id = other._id;
 	_name = std::move(other._name);
+	_coalesced = other._coalesced;
 	return *this;
 }
 
@@ -80,6 +84,14 @@ bool EventHeader::isInCategory(EventHeader::Category cat) const {
 	return cat == _category;
 }
 
+void EventHeader::setCoalesced(bool value) {
+	_coalesced = value;
+}
+
+bool EventHeader::isCoalesced() const {
+	return _coalesced;
+}
+
 EventHeader::operator int() {
 	return _id;
 }
@@ -39,6 +39,9 @@ NS_SP_BEGIN
 
  EventHeaders should be declared statically with simple constructor:
 	EventHeader eventHeader(Category);
+
+ Coalesced headers deliver events on next frame: events with the same header and target object,
+ sent within one frame, are merged, and only latest value is delivered to listeners
  */
 
 class EventHeader {
@@ -66,6 +69,9 @@ public:
 
 	bool isInCategory(Category cat) const;
 
+	void setCoalesced(bool);
+	bool isCoalesced() const;
+
 	operator int ();
 
 	bool operator == (const Event &event) const;
@@ -89,6 +95,7 @@ protected:
 	Category _category = 0;
 	EventID _id = 0;
 	String _name;
+	bool _coalesced = false;
 };
 
 NS_SP_END
@@ -39,6 +39,8 @@ THE SOFTWARE.
 
 #define SP_STORAGE_DEBUG 0
 #define SP_STORAGE_BATCH_MAX 50
+#define SP_STORAGE_READERS 2
+#define SP_STORAGE_BUSY_TIMEOUT 1000
 
 #define LIBRARY_CREATE \
 "CREATE TABLE IF NOT EXISTS kvstorage (" \
@@ -56,6 +58,19 @@ using Task = thread::Task;
 
 class Handle {
 public:
+	// sqlite connection with its own prepared statements cache
+	struct Connection {
+		sqlite3 *db = nullptr;
+		sqlite3_stmt *kvSelect = nullptr;
+		Map<String, sqlite3_stmt *> stmts;
+	};
+
+	struct PendingWrite {
+		uint64_t seq = 0;
+		bool removed = false;
+		data::Value value;
+	};
+
 	static Handle *getInstance();
 
 	Handle(const StringView &path);
@@ -63,11 +78,23 @@ public:
 	~Handle();
 
 	Thread &getThread();
+	Thread &getReadThread();
 
 	data::Value getData(const StringView &key);
 	void updateData(const StringView &key, const data::Value &value);
 	void removeData(const StringView &key);
 
+	// returns true if key has uncommitted value, scheduled with group commit
+	bool getPendingData(const StringView &key, data::Value &);
+
+	// schedule write (or removal) for group commit, callback will be called on main thread after commit
+	void scheduleWrite(const StringView &key, data::Value &&, bool removed, Function<void()> &&);
+
+	// commits all scheduled writes in single transaction, should be called only in storage thread
+	void flushWrites();
+
+	Metrics getMetrics() const;
+
 	bool createClass(const StringView &cmd);
 
 	sqlite3_stmt *prepare(const StringView &zSql);
@@ -84,23 +111,44 @@ public:
 	void performWithTransaction(Callback &&, bool unsafe = false);
 
 private:
-	int prepareStmt(sqlite3_stmt **ppStmt, const StringView &zSql);
+	int prepareStmt(Connection &, sqlite3_stmt **ppStmt, const StringView &zSql);
+
+	// returns read-only connection for current read worker or main connection
+	Connection &getConnection();
+
+	void closeConnection(Connection &);
 
 	static Handle* s_sharedInternal;
 	static bool s_configured;
 
+	String _path;
 	bool _kvIsBinary = false;
-	sqlite3 *_db = nullptr;
 	sqlite3_stmt *_kv_update_stmt = nullptr;
-	sqlite3_stmt *_kv_select_stmt = nullptr;
 	sqlite3_stmt *_kv_remove_stmt = nullptr;
 
-	Map<String, sqlite3_stmt *> _stmts;
+	Connection _conn;
+	Vector<Connection> _readers;
 
 	int _version;
 	Thread _thread;
+	Thread _readThread;
 
 	bool _inTransaction = false;
+
+	std::mutex _writeMutex;
+	Map<String, PendingWrite> _pendingWrites;
+	Vector<Function<void()>> _writeCallbacks;
+	uint64_t _writeSeq = 0;
+	bool _flushScheduled = false;
+
+	std::atomic<uint64_t> _transactions;
+	std::atomic<uint64_t> _writes;
+	std::atomic<uint64_t> _coalesced;
+	std::atomic<uint64_t> _maxBatch;
+	std::atomic<uint64_t> _reads;
+	std::atomic<uint64_t> _pendingReads;
+	std::atomic<uint64_t> _commitTime;
+	std::atomic<uint64_t> _lastCommitTime;
 };
 
 class Scheme::Internal : public Ref {
@@ -154,6 +202,8 @@ protected:
 	Map<String, String> _aliases;
 
 	Handle *_storage = nullptr;
+	std::atomic<bool> _initialized;
+	std::atomic<uint32_t> _pendingWrites; // commands, queued on storage thread and not yet performed
 };
 
 Handle* Handle::s_sharedInternal = nullptr;
@@ -191,11 +241,20 @@ void get(const StringView &key, const KeyDataCallback &callback, Handle *storage
 	}
 	auto &thread = storage->getThread();
 	if (thread.isOnThisThread()) {
+		storage->flushWrites();
 		data::Value val(storage->getData(key));
 		callback(key, std::move(val));
 	} else {
 		data::Value *val = new data::Value();
-		thread.perform([key = key.str(), val, storage] (const Task &) -> bool {
+		if (storage->getPendingData(key, *val)) {
+			Thread::onMainThread([key = key.str(), val, callback] {
+				callback(key, std::move(*val));
+				delete val;
+			}, nullptr, true);
+			return;
+		}
+
+		storage->getReadThread().perform([key = key.str(), val, storage] (const Task &) -> bool {
 			*val = storage->getData(key);
 			return true;
 		}, [key = key.str(), val, callback] (const Task &, bool) {
@@ -211,21 +270,17 @@ void set(const StringView &key, const data::Value &value, const KeyDataCallback
 	}
 	auto &thread = storage->getThread();
 	if (thread.isOnThisThread()) {
+		storage->flushWrites();
 		storage->updateData(key, value);
 		if (callback) {
 			callback(key, data::Value(value));
 		}
-	} else {
-		data::Value *val = new data::Value(value);
-		thread.perform([key = key.str(), val, storage] (const Task &) -> bool {
-			storage->updateData(key, *val);
-			return true;
-		}, [key = key.str(), val, callback] (const Task &, bool) {
-			if (callback) {
-				callback(key, std::move(*val));
-			}
-			delete val;
+	} else if (callback) {
+		storage->scheduleWrite(key, data::Value(value), false, [key = key.str(), value, callback] {
+			callback(key, data::Value(value));
 		});
+	} else {
+		storage->scheduleWrite(key, data::Value(value), false, nullptr);
 	}
 }
 
@@ -235,21 +290,17 @@ void set(const StringView &key, data::Value &&value, const KeyDataCallback &call
 	}
 	auto &thread = storage->getThread();
 	if (thread.isOnThisThread()) {
+		storage->flushWrites();
 		storage->updateData(key, value);
 		if (callback) {
 			callback(key, std::move(value));
 		}
-	} else {
-		data::Value *val = new data::Value(std::move(value));
-		thread.perform([key = key.str(), val, storage] (const Task &) -> bool {
-			storage->updateData(key, *val);
-			return true;
-		}, [key = key.str(), val, callback] (const Task &, bool) {
-			if (callback) {
-				callback(key, std::move(*val));
-			}
-			delete val;
+	} else if (callback) {
+		storage->scheduleWrite(key, data::Value(value), false, [key = key.str(), value = std::move(value), callback] {
+			callback(key, data::Value(value));
 		});
+	} else {
+		storage->scheduleWrite(key, std::move(value), false, nullptr);
 	}
 }
 
@@ -259,19 +310,17 @@ void remove(const StringView &key, const KeyCallback &callback, Handle *storage)
 	}
 	auto &thread = storage->getThread();
 	if (thread.isOnThisThread()) {
+		storage->flushWrites();
 		storage->removeData(key);
 		if (callback) {
 			callback(key);
 		}
-	} else {
-		thread.perform([key = key.str(), storage] (const Task &) -> bool {
-			storage->removeData(key);
-			return true;
-		}, [key = key.str(), callback] (const Task &, bool) {
-			if (callback) {
-				callback(key);
-			}
+	} else if (callback) {
+		storage->scheduleWrite(key, data::Value(), true, [key = key.str(), callback] {
+			callback(key);
 		});
+	} else {
+		storage->scheduleWrite(key, data::Value(), true, nullptr);
 	}
 }
 
@@ -289,6 +338,14 @@ bool performWithTransaction(const Function<void()> &cb, Handle *storage, bool un
 	return true;
 }
 
+Metrics getMetrics(Handle *storage) {
+	if (!storage) {
+		storage = Handle::getInstance();
+	}
+
+	return storage->getMetrics();
+}
+
 Scheme::Field::Field(const String &name, Type type, uint8_t flags, uint8_t size)
 : name(name), type(type), size(size), flags(flags) { }
 
@@ -637,7 +694,7 @@ Scheme::Internal *Scheme::Internal::create(const StringView &name, FieldsList &&
 	}
 }
 
-Scheme::Internal::Internal(Handle *internal) : _custom("__data__") {
+Scheme::Internal::Internal(Handle *internal) : _custom("__data__"), _initialized(false), _pendingWrites(0) {
 	if (!internal) {
 		internal = Handle::getInstance();
 	}
@@ -754,10 +811,12 @@ bool Scheme::Internal::initialize() {
 	};
 
 	if (thread.isOnThisThread()) {
-		return cb();
+		_initialized = cb();
+		return _initialized.load();
 	} else {
-		thread.perform([cb] (const Task &) -> bool {
-			return cb();
+		thread.perform([this, cb] (const Task &) -> bool {
+			_initialized = cb();
+			return _initialized.load();
 		}, nullptr, this);
 	}
 
@@ -1011,14 +1070,25 @@ bool Scheme::Internal::perform(Scheme::Command *cmd) {
 			new (&cmd->_data.value) data::Value(std::move(val));
 			cmd->_separateRows = false;
 		}
+		// selects on initialized table can be performed on read-only connections, but only when there
+		// are no queued writes for this scheme, otherwise select can overtake them and read stale data
+		auto isRead = (cmd->_action == Command::Get || cmd->_action == Command::Count) && _initialized.load()
+				&& _pendingWrites.load() == 0;
+		if (!isRead) {
+			++ _pendingWrites;
+		}
+
 		data::Value *val = new data::Value();
-		thread.perform([this, cmd, val] (const Task &) -> bool {
+		(isRead ? storage->getReadThread() : thread).perform([this, cmd, val, isRead] (const Task &) -> bool {
 			*val = performCommand(cmd);
+			if (!isRead) {
+				-- _pendingWrites;
+			}
 			return true;
 		}, [this, cmd, val] (const Task &, bool) {
 			runCommandCallback(cmd, *val);
 			delete val;
-		});
+		}, this);
 	}
 
 	return true;
@@ -1034,9 +1104,11 @@ bool Scheme::Internal::perform(const StringView &sql, const DataCallback &cb) {
 			cb(std::move(val));
 		}
 	} else {
+		++ _pendingWrites;
 		data::Value *val = new data::Value();
 		thread.perform([this, sql = sql.str(), val] (const Task &) -> bool {
 			*val = performCommand(sql);
+			-- _pendingWrites;
 			return true;
 		}, [cb, val] (const Task &, bool) {
 			if (cb) {
@@ -1499,9 +1571,9 @@ static int StorageInternal_explain_result(void *, int n, char **fields, char **v
 }
 #endif
 
-int Handle::prepareStmt(sqlite3_stmt **ppStmt, const StringView &zSql) {
-	auto it = _stmts.find(zSql);
-	if (it != _stmts.end()) {
+int Handle::prepareStmt(Connection &conn, sqlite3_stmt **ppStmt, const StringView &zSql) {
+	auto it = conn.stmts.find(zSql);
+	if (it != conn.stmts.end()) {
 		*ppStmt = it->second;
 		return SQLITE_OK;
 	}
@@ -1510,16 +1582,56 @@ int Handle::prepareStmt(sqlite3_stmt **ppStmt, const StringView &zSql) {
 	if (zSql.substr(0, 6) == "SELECT" || zSql.substr(0, 5) == "COUNT") {
 		String explain = String("EXPLAIN QUERY PLAN ") + zSql;
 		logTag("Storage-Debug", "%s", explain.c_str());
-		sqlite3_exec(_db, explain.c_str(), &StorageInternal_explain_result, this, NULL);
+		sqlite3_exec(conn.db, explain.c_str(), &StorageInternal_explain_result, this, NULL);
 	}
 #endif
 
-	auto err = sqlite3_prepare_v2(_db, zSql.data(), zSql.size(), ppStmt, NULL);
+	auto err = sqlite3_prepare_v2(conn.db, zSql.data(), zSql.size(), ppStmt, NULL);
 	if (err == SQLITE_OK) {
-		_stmts.insert(std::make_pair(zSql.str(), *ppStmt));
+		conn.stmts.insert(std::make_pair(zSql.str(), *ppStmt));
 	}
 	return err;
 }
+
+Handle::Connection &Handle::getConnection() {
+	auto local = thread::ThreadInfo::getThreadLocal();
+	if (!local || local->threadId != _readThread.getId() || local->workerId >= _readers.size()) {
+		return _conn;
+	}
+
+	auto &conn = _readers[local->workerId];
+	if (!conn.db) {
+		// read-only connections are opened lazily on its own worker thread
+		int flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_PRIVATECACHE | SQLITE_OPEN_NOMUTEX;
+		if (sqlite3_open_v2(_path.c_str(), &conn.db, flags, NULL) != SQLITE_OK) {
+			log::format("Storage", "SQLite: fail to open read connection: %s", sqlite3_errmsg(conn.db));
+			sqlite3_close(conn.db);
+			conn.db = nullptr;
+			return _conn;
+		}
+
+		sqlite3_busy_timeout(conn.db, SP_STORAGE_BUSY_TIMEOUT);
+		if (prepareStmt(conn, &conn.kvSelect, LIBRARY_KV_SELECT) != SQLITE_OK) {
+			log::format("Storage", "SQLite: Error in prepared statements: %s", sqlite3_errmsg(conn.db));
+			closeConnection(conn);
+			return _conn;
+		}
+	}
+	return conn;
+}
+
+void Handle::closeConnection(Connection &conn) {
+	for (auto &i : conn.stmts) {
+		sqlite3_finalize(i.second);
+	}
+	conn.stmts.clear();
+	conn.kvSelect = nullptr;
+
+	if (conn.db) {
+		sqlite3_close(conn.db);
+		conn.db = nullptr;
+	}
+}
 Handle *Handle::getInstance() {
 	if (!s_sharedInternal) {
 		const auto &libpath = filesystem::writablePath("library");
@@ -1531,11 +1643,14 @@ Handle *Handle::getInstance() {
 
 Handle::Handle(const StringView &path) : Handle("SqlStorageThread", path) { }
 
-Handle::Handle(const StringView &name, const StringView &ipath) : _db(nullptr), _thread(name) {
-	String path = filesystem_native::posixToNative(ipath);
+Handle::Handle(const StringView &name, const StringView &ipath)
+: _path(filesystem_native::posixToNative(ipath)), _readers(SP_STORAGE_READERS)
+, _thread(name), _readThread(toString(name, "Read"), SP_STORAGE_READERS)
+, _transactions(0), _writes(0), _coalesced(0), _maxBatch(0), _reads(0), _pendingReads(0), _commitTime(0), _lastCommitTime(0) {
 	_version = sqlite3_libversion_number();
 
-	auto cfgflag = (CC_TARGET_PLATFORM == CC_PLATFORM_IOS)?SQLITE_CONFIG_SERIALIZED:SQLITE_CONFIG_SINGLETHREAD;
+	// connections are used from storage thread and read workers, so at least multi-thread mode is required
+	auto cfgflag = (CC_TARGET_PLATFORM == CC_PLATFORM_IOS)?SQLITE_CONFIG_SERIALIZED:SQLITE_CONFIG_MULTITHREAD;
 
 	if (!s_configured) {
 		if (sqlite3_config(cfgflag) != SQLITE_OK) {
@@ -1545,30 +1660,32 @@ Handle::Handle(const StringView &name, const StringView &ipath) : _db(nullptr),
 	}
 
 	int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_PRIVATECACHE | SQLITE_OPEN_NOMUTEX;
-	auto ok = sqlite3_open_v2(path.c_str(), &_db, flags, NULL);
+	auto ok = sqlite3_open_v2(_path.c_str(), &_conn.db, flags, NULL);
 	if (ok != SQLITE_OK ) {
 		log::text("Storage", "SQLite: Error check on open");
 		assert(false);
 	}
 
+	sqlite3_busy_timeout(_conn.db, SP_STORAGE_BUSY_TIMEOUT);
+
 	perform("PRAGMA synchronous = NORMAL;");
-	perform("PRAGMA journal_mode = TRUNCATE;");
+	perform("PRAGMA journal_mode = WAL;");
 
 	char *errorBuffer = NULL;
-	ok = sqlite3_exec(_db, LIBRARY_CREATE, NULL, NULL, &errorBuffer);
+	ok = sqlite3_exec(_conn.db, LIBRARY_CREATE, NULL, NULL, &errorBuffer);
 	if (errorBuffer) {
 		log::format("Storage", "SQLite: CREATE error: %d: %s", ok, errorBuffer);
 		sqlite3_free(errorBuffer);
 	}
 
 	if( ok != SQLITE_OK && ok != SQLITE_DONE) {
-		log::format("Storage", "SQLite: Error in CREATE TABLE: %s", sqlite3_errmsg(_db));
+		log::format("Storage", "SQLite: Error in CREATE TABLE: %s", sqlite3_errmsg(_conn.db));
 		assert(false);
 	}
 
-	ok = (ok == SQLITE_OK)?prepareStmt(&_kv_select_stmt, LIBRARY_KV_SELECT):ok;
-	ok = (ok == SQLITE_OK)?prepareStmt(&_kv_update_stmt, LIBRARY_KV_UPDATE):ok;
-	ok = (ok == SQLITE_OK)?prepareStmt(&_kv_remove_stmt, LIBRARY_KV_REMOVE):ok;
+	ok = (ok == SQLITE_OK)?prepareStmt(_conn, &_conn.kvSelect, LIBRARY_KV_SELECT):ok;
+	ok = (ok == SQLITE_OK)?prepareStmt(_conn, &_kv_update_stmt, LIBRARY_KV_UPDATE):ok;
+	ok = (ok == SQLITE_OK)?prepareStmt(_conn, &_kv_remove_stmt, LIBRARY_KV_REMOVE):ok;
 
 	_kvIsBinary = false;
 
@@ -1586,27 +1703,26 @@ Handle::Handle(const StringView &name, const StringView &ipath) : _db(nullptr),
 	}
 
 	if( ok != SQLITE_OK) {
-		log::format("Storage", "SQLite: Error in prepared statements: %s", sqlite3_errmsg(_db));
+		log::format("Storage", "SQLite: Error in prepared statements: %s", sqlite3_errmsg(_conn.db));
 		assert(false);
 	}
 }
 
 Handle::~Handle() {
-	for (auto &i : _stmts) {
-#if (SP_HASH_COLLISION_SAFE)
-		sqlite3_finalize(i.second.second);
-#else
-		sqlite3_finalize(i.second);
-#endif
+	for (auto &it : _readers) {
+		closeConnection(it);
 	}
-
-	sqlite3_close(_db);
+	closeConnection(_conn);
 }
 
 Thread &Handle::getThread() {
 	return _thread;
 }
 
+Thread &Handle::getReadThread() {
+	return _readThread;
+}
+
 void Handle::updateData(const StringView &key, const data::Value &value) {
 	int ok = SQLITE_OK;
 
@@ -1621,7 +1737,7 @@ void Handle::updateData(const StringView &key, const data::Value &value) {
 	ok = (ok == SQLITE_OK)?sqlite3_step(_kv_update_stmt):ok;
 
 	if( ok != SQLITE_OK && ok != SQLITE_DONE) {
-		log::format("Storage", "SQLite: Error in UPDATE: %s\n", sqlite3_errmsg(_db)); assert(false);
+		log::format("Storage", "SQLite: Error in UPDATE: %s\n", sqlite3_errmsg(_conn.db)); assert(false);
 	}
 
 	sqlite3_reset(_kv_update_stmt);
@@ -1634,37 +1750,151 @@ void Handle::removeData(const StringView &key) {
 	ok = (ok == SQLITE_OK)?sqlite3_step(_kv_remove_stmt):ok;
 
 	if( ok != SQLITE_OK && ok != SQLITE_DONE) {
-		log::format("Storage", "SQLite: Error in DELETE: %s\n", sqlite3_errmsg(_db)); assert(false);
+		log::format("Storage", "SQLite: Error in DELETE: %s\n", sqlite3_errmsg(_conn.db)); assert(false);
 	}
 
 	sqlite3_reset(_kv_remove_stmt);
 }
 
 data::Value Handle::getData(const StringView &key) {
+	auto &conn = getConnection();
+	auto stmt = conn.kvSelect;
+
 	data::Value ret;
 	int ok = SQLITE_OK;
 
-	ok = (ok == SQLITE_OK)?sqlite3_bind_text(_kv_select_stmt, 1, key.data(), key.size(), SQLITE_STATIC):ok;
-	ok = (ok == SQLITE_OK)?sqlite3_step(_kv_select_stmt):ok;
+	ok = (ok == SQLITE_OK)?sqlite3_bind_text(stmt, 1, key.data(), key.size(), SQLITE_STATIC):ok;
+	ok = (ok == SQLITE_OK)?sqlite3_step(stmt):ok;
 
 	if ( ok != SQLITE_OK && ok != SQLITE_DONE && ok != SQLITE_ROW) {
-		log::format("Storage", "SQLite: Error in SELECT: %s\n", sqlite3_errmsg(_db));
+		log::format("Storage", "SQLite: Error in SELECT: %s\n", sqlite3_errmsg(conn.db));
 	}
 
 	if ( ok == SQLITE_ROW ) {
-		const uint8_t *data = (const uint8_t *)sqlite3_column_blob(_kv_select_stmt, 0);
-		size_t bytes(sqlite3_column_bytes(_kv_select_stmt, 0));
+		const uint8_t *data = (const uint8_t *)sqlite3_column_blob(stmt, 0);
+		size_t bytes(sqlite3_column_bytes(stmt, 0));
 		ret = data::read(BytesView(data, bytes));
 	}
 
-	sqlite3_reset(_kv_select_stmt);
+	sqlite3_reset(stmt);
+	++ _reads;
 
 	return ret;
 }
 
+bool Handle::getPendingData(const StringView &key, data::Value &ret) {
+	std::unique_lock<std::mutex> lock(_writeMutex);
+	auto it = _pendingWrites.find(key);
+	if (it == _pendingWrites.end()) {
+		return false;
+	}
+
+	if (!it->second.removed) {
+		ret = it->second.value;
+	}
+	++ _reads;
+	++ _pendingReads;
+	return true;
+}
+
+void Handle::scheduleWrite(const StringView &key, data::Value &&value, bool removed, Function<void()> &&cb) {
+	bool schedule = false;
+	{
+		std::unique_lock<std::mutex> lock(_writeMutex);
+		auto it = _pendingWrites.find(key);
+		if (it == _pendingWrites.end()) {
+			it = _pendingWrites.emplace(key.str(), PendingWrite()).first;
+		} else {
+			++ _coalesced;
+		}
+
+		it->second.seq = ++ _writeSeq;
+		it->second.removed = removed;
+		it->second.value = std::move(value);
+
+		if (cb) {
+			_writeCallbacks.emplace_back(std::move(cb));
+		}
+
+		schedule = !_flushScheduled;
+		_flushScheduled = true;
+	}
+
+	if (schedule) {
+		// all writes, scheduled before this task is performed, will be committed together
+		_thread.perform([this] (const Task &) -> bool {
+			flushWrites();
+			return true;
+		});
+	}
+}
+
+void Handle::flushWrites() {
+	Map<String, PendingWrite> writes;
+	Vector<Function<void()>> callbacks;
+
+	{
+		std::unique_lock<std::mutex> lock(_writeMutex);
+		_flushScheduled = false;
+		if (_pendingWrites.empty()) {
+			return;
+		}
+
+		// pending values stays visible for readers until commit
+		writes = _pendingWrites;
+		callbacks = std::move(_writeCallbacks);
+		_writeCallbacks.clear();
+	}
+
+	performWithTransaction([&] {
+		for (auto &it : writes) {
+			if (it.second.removed) {
+				removeData(it.first);
+			} else {
+				updateData(it.first, it.second.value);
+			}
+		}
+	});
+
+	_writes += writes.size();
+	auto maxBatch = _maxBatch.load();
+	while (writes.size() > maxBatch && !_maxBatch.compare_exchange_weak(maxBatch, writes.size())) { }
+
+	{
+		std::unique_lock<std::mutex> lock(_writeMutex);
+		for (auto &it : writes) {
+			auto p = _pendingWrites.find(it.first);
+			if (p != _pendingWrites.end() && p->second.seq == it.second.seq) {
+				_pendingWrites.erase(p);
+			}
+		}
+	}
+
+	if (!callbacks.empty()) {
+		Thread::onMainThread([callbacks = std::move(callbacks)] {
+			for (auto &it : callbacks) {
+				it();
+			}
+		});
+	}
+}
+
+Metrics Handle::getMetrics() const {
+	Metrics ret;
+	ret.transactions = _transactions.load();
+	ret.writes = _writes.load();
+	ret.coalesced = _coalesced.load();
+	ret.maxBatch = _maxBatch.load();
+	ret.reads = _reads.load();
+	ret.pendingReads = _pendingReads.load();
+	ret.commitTime = _commitTime.load();
+	ret.lastCommitTime = _lastCommitTime.load();
+	return ret;
+}
+
 bool Handle::createClass(const StringView &cmd) {
 	char *errorBuffer = NULL;
-	auto ok = sqlite3_exec(_db, cmd.terminated() ? cmd.data() : cmd.str().data(), NULL, NULL, &errorBuffer);
+	auto ok = sqlite3_exec(_conn.db, cmd.terminated() ? cmd.data() : cmd.str().data(), NULL, NULL, &errorBuffer);
 	if (errorBuffer) {
 		log::text("Storage", cmd);
 		log::format("Storage", "SQLite: CREATE error: %d: %s", ok, errorBuffer);
@@ -1675,21 +1905,23 @@ bool Handle::createClass(const StringView &cmd) {
 }
 
 sqlite3_stmt *Handle::prepare(const StringView &zSql) {
+	auto &conn = getConnection();
 	sqlite3_stmt *stmt = nullptr;
-	auto err = prepareStmt(&stmt, zSql);
+	auto err = prepareStmt(conn, &stmt, zSql);
 	if (err == SQLITE_OK) {
 		return stmt;
 	} else {
-		log::format("Storage", "SQLite: Error in prepared statements: %s", sqlite3_errmsg(_db));
+		log::format("Storage", "SQLite: Error in prepared statements: %s", sqlite3_errmsg(conn.db));
 		return nullptr;
 	}
 }
 
 void Handle::release(const StringView &zSql) {
-	auto it = _stmts.find(zSql);
-	if (it != _stmts.end()) {
+	auto &conn = getConnection();
+	auto it = conn.stmts.find(zSql);
+	if (it != conn.stmts.end()) {
 		sqlite3_finalize(it->second);
-		_stmts.erase(it);
+		conn.stmts.erase(it);
 	}
 }
 
@@ -1717,7 +1949,7 @@ data::Value Handle::perform(const StringView &str, bool reduce) {
 	h.handle = this;
 
 	char *errorBuffer = NULL;
-	auto ok = sqlite3_exec(_db, str.terminated() ? str.data() : str.str().data(), &Handle_performCallback, (void *)&h, &errorBuffer);
+	auto ok = sqlite3_exec(_conn.db, str.terminated() ? str.data() : str.str().data(), &Handle_performCallback, (void *)&h, &errorBuffer);
 	if (errorBuffer) {
 		log::text("Storage", str);
 		log::format("Storage", "SQLite error: %d: %s", ok, errorBuffer);
@@ -1752,7 +1984,7 @@ bool Handle::perform(sqlite3_stmt *stmt, const data::DataCallback &cb) {
 	do {
 		err = sqlite3_step(stmt);
 		if ( err != SQLITE_OK && err != SQLITE_DONE && err != SQLITE_ROW ) {
-			log::format("Storage", "SQLite: Error in query: %s\n", sqlite3_errmsg(_db)); assert(false);
+			log::format("Storage", "SQLite: Error in query: %s\n", sqlite3_errmsg(sqlite3_db_handle(stmt))); assert(false);
 			ret = false;
 		}
 
@@ -1806,17 +2038,24 @@ void Handle::performWithTransaction(Callback &&cb, bool unsafe) {
 	} else {
 		_inTransaction = true;
 		if (unsafe) {
+			// journal mode can not be switched from WAL while read connections are open
 			perform("PRAGMA synchronous = OFF");
-			perform("PRAGMA journal_mode = OFF");
 		}
+
+		auto start = Time::now().toMicros();
 		perform("BEGIN TRANSACTION;");
 
 		cb();
 
 		perform("COMMIT;");
+		auto time = Time::now().toMicros() - start;
+
+		++ _transactions;
+		_commitTime += time;
+		_lastCommitTime = time;
+
 		if (unsafe) {
 			perform("PRAGMA synchronous = NORMAL;");
-			perform("PRAGMA journal_mode = TRUNCATE;");
 		}
 		_inTransaction = false;
 	}
@@ -42,6 +42,13 @@ THE SOFTWARE.
  * This concept allow you to extend Storage functionality, write your own logic,
  * backended by this system, that will work on storage thread without environment
  * overhead.
+ *
+ * Database works in WAL mode. Key-value reads and scheme selects from other threads
+ * are performed on separate read-only connections (storage read thread with its own
+ * workers), so they are not queued behind writes. Key-value writes from other threads
+ * are collected and committed in a single transaction on next storage thread tick
+ * (group commit), repeated writes for the same key are coalesced. Pending values
+ * are visible for `get` before commit.
  */
 
 NS_SP_EXT_BEGIN(storage)
@@ -65,6 +72,19 @@ void remove(const StringView &key, const KeyCallback &callback = nullptr, Handle
 // should be called only in storage thread
 bool performWithTransaction(const Function<void()> &, Handle * = nullptr, bool unsafe = false);
 
+struct Metrics {
+	uint64_t transactions = 0; // committed transactions
+	uint64_t writes = 0; // key-value writes and removals, committed with group commit
+	uint64_t coalesced = 0; // writes, replaced by later write for the same key before commit
+	uint64_t maxBatch = 0; // largest number of keys, committed in single transaction
+	uint64_t reads = 0; // key-value reads
+	uint64_t pendingReads = 0; // key-value reads, served from uncommitted writes
+	uint64_t commitTime = 0; // total time of committed transactions (in microseconds)
+	uint64_t lastCommitTime = 0; // time of last committed transaction (in microseconds)
+};
+
+Metrics getMetrics(Handle * = nullptr);
+
 NS_SP_EXT_END(storage)
 
 #endif
@@ -520,10 +520,16 @@ Rc<cocos2d::Texture2D> TextureCache::uploadTexture(const Bytes &data, const Size
 			});
 		}
 	} else {
-		Bitmap bitmap(data);
+		// with size hint, image is decoded near the display size, so, large images do not need full-size bitmap
+		Bitmap bitmap;
+		const uint32_t targetWidth = (size.width > 0.0f && size.height > 0.0f) ? uint32_t(roundf(size.width * density)) : 0;
+		const uint32_t targetHeight = (size.width > 0.0f && size.height > 0.0f) ? uint32_t(roundf(size.height * density)) : 0;
+		if (!bitmap.loadData(data.data(), data.size(), targetWidth, targetHeight)) {
+			bitmap.clear();
+		}
 		if (bitmap) {
-			if (size.width > 0.0f && size.height > 0.0f && (bitmap.width() > size.width || bitmap.height() > size.height)) {
-				bitmap = bitmap.resample(roundf(size.width * density), roundf(size.height * density));
+			if (targetWidth > 0 && targetHeight > 0 && (bitmap.width() > targetWidth || bitmap.height() > targetHeight)) {
+				bitmap = bitmap.resample(targetWidth, targetHeight);
 			}
 			return getInstance()->performWithGL([&] {
 				auto tex = Rc<cocos2d::Texture2D>::alloc();
@@ -94,7 +94,7 @@ static size_t processExtraVarSize(const FieldExtra *s) {
 	return ret;
 }
 
-static size_t updateFieldLimits(const mem::Map<mem::String, Field> &vec) {
+static size_t updateFieldLimits(const FieldMap &vec) {
 	size_t ret = 256 * vec.size();
 	for (auto &it : vec) {
 		auto t = it.second.getType();
@@ -113,7 +113,7 @@ static size_t updateFieldLimits(const mem::Map<mem::String, Field> &vec) {
 	return ret;
 }
 
-void InputConfig::updateLimits(const mem::Map<mem::String, Field> &fields) {
+void InputConfig::updateLimits(const FieldMap &fields) {
 	maxRequestSize = 256 * fields.size();
 	for (auto &it : fields) {
 		auto t = it.second.getType();
@@ -68,6 +68,10 @@ struct FieldView;
 struct FieldFullTextView;
 struct FieldCustom;
 
+// fields are iterated in name order: column order of generated SQL, input limits and scheme hash depend on it;
+// fields are referenced by pointer from indexes and views, so, map should keep it's nodes stable
+using FieldMap = mem::Map<mem::String, Field>;
+
 namespace internals {
 
 struct RequestData {
@@ -227,7 +231,7 @@ struct InputConfig {
 	InputConfig(InputConfig &&) = default;
 	InputConfig & operator=(InputConfig &&) = default;
 
-	void updateLimits(const mem::Map<mem::String, Field> &vec);
+	void updateLimits(const FieldMap &vec);
 
 	Require required = Require::None;
 	size_t maxRequestSize = config::getMaxRequestSize();
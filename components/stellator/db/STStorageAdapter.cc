@@ -49,6 +49,14 @@ bool Adapter::clear(const stappler::CoderSource &key) const {
 	return _interface->clear(key);
 }
 
+mem::Vector<mem::Value> Adapter::mget(mem::SpanView<mem::BytesView> keys) const {
+	return _interface->mget(keys);
+}
+
+bool Adapter::mset(const mem::Map<mem::Bytes, mem::Value> &data, stappler::TimeInterval maxAge) const {
+	return _interface->mset(data, maxAge);
+}
+
 mem::Vector<int64_t> Adapter::performQueryListForIds(const QueryList &ql, size_t count) const {
 	return _interface->performQueryListForIds(ql, count);
 }
@@ -141,6 +149,37 @@ void Adapter::scheduleAutoField(const Scheme &scheme, const Field &field, uint64
 	}
 }
 
+void Adapter::scheduleViewUpdate(const Scheme &scheme, const Field &field, const Scheme &source, uint64_t id) {
+	struct Adapter_ViewTaskData : AllocPool {
+		const Scheme *source = nullptr;
+		const Field *field = nullptr;
+	};
+
+	if (!id) {
+		return;
+	}
+
+	// object id goes to persistent queue, so update survives failure of async task
+	if (!_interface->scheduleViewUpdate(*field.getSlot<FieldView>(), &scheme, id)) {
+		return;
+	}
+
+	stappler::memory::pool_t * p = stappler::memory::pool::acquire();
+	auto key = mem::toString(scheme.getName(), "_f_", field.getName(), "_view");
+	if (!stappler::memory::pool::get<Adapter_ViewTaskData>(p, key)) {
+		auto d = new (p) Adapter_ViewTaskData;
+		d->source = &source;
+		d->field = &field;
+		stappler::memory::pool::store(p, d, key, [d] {
+			internals::scheduleAyncDbTask([d] (stappler::memory::pool_t *p) -> mem::Function<void(const Transaction &t)> {
+				return [source = d->source, field = d->field] (const Transaction &t) {
+					while (source->processDeferredViews(t, *field) > 0) { }
+				};
+			});
+		});
+	}
+}
+
 mem::Value Adapter::field(Action a, Worker &w, uint64_t oid, const Field &f, mem::Value &&data) const {
 	return _interface->field(a, w, oid, f, std::move(data));
 }
@@ -156,6 +195,20 @@ bool Adapter::removeFromView(const FieldView &v, const Scheme *s, uint64_t oid)
 	return _interface->removeFromView(v, s, oid);
 }
 
+bool Adapter::addToView(const FieldView &v, const Scheme *s, const mem::Vector<mem::Pair<int64_t, int64_t>> &vec) const {
+	return _interface->addToView(v, s, vec);
+}
+bool Adapter::removeFromView(const FieldView &v, const Scheme *s, const mem::Vector<int64_t> &vec) const {
+	return _interface->removeFromView(v, s, vec);
+}
+
+mem::Vector<int64_t> Adapter::popViewUpdates(const FieldView &v, const Scheme *s, size_t count, stappler::Time *oldest) const {
+	return _interface->popViewUpdates(v, s, count, oldest);
+}
+ViewQueueStatus Adapter::getViewQueueStatus(const FieldView &v, const Scheme *s) const {
+	return _interface->getViewQueueStatus(v, s);
+}
+
 mem::Vector<int64_t> Adapter::getReferenceParents(const Scheme &s, uint64_t oid, const Scheme *fs, const Field *f) const {
 	return _interface->getReferenceParents(s, oid, fs, f);
 }
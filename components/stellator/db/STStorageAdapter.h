@@ -45,6 +45,9 @@ public: // key-value storage
 	mem::Value get(const stappler::CoderSource &) const;
 	bool clear(const stappler::CoderSource &) const;
 
+	mem::Vector<mem::Value> mget(mem::SpanView<mem::BytesView>) const;
+	bool mset(const mem::Map<mem::Bytes, mem::Value> &, stappler::TimeInterval = config::getKeyValueStorageTime()) const;
+
 public:
 	bool init(const Interface::Config &cfg, const mem::Map<mem::String, const Scheme *> &);
 
@@ -78,6 +81,7 @@ protected:
 	size_t count(Worker &, const Query &) const;
 
 	void scheduleAutoField(const Scheme &, const Field &, uint64_t id);
+	void scheduleViewUpdate(const Scheme &, const Field &, const Scheme &source, uint64_t id);
 
 protected:
 	mem::Value field(Action, Worker &, uint64_t oid, const Field &, mem::Value && = mem::Value()) const;
@@ -86,6 +90,12 @@ protected:
 	bool addToView(const FieldView &, const Scheme *, uint64_t oid, const mem::Value &) const;
 	bool removeFromView(const FieldView &, const Scheme *, uint64_t oid) const;
 
+	bool addToView(const FieldView &, const Scheme *, const mem::Vector<mem::Pair<int64_t, int64_t>> &) const;
+	bool removeFromView(const FieldView &, const Scheme *, const mem::Vector<int64_t> &) const;
+
+	mem::Vector<int64_t> popViewUpdates(const FieldView &, const Scheme *, size_t count, stappler::Time *oldest) const;
+	ViewQueueStatus getViewQueueStatus(const FieldView &, const Scheme *) const;
+
 	bool beginTransaction() const;
 	bool endTransaction() const;
 
@@ -408,7 +408,7 @@ struct FieldExtra : Field::Slot {
 	virtual bool transformValue(const Scheme &, const mem::Value &, mem::Value &, bool isCreate) const override;
 	virtual void hash(mem::StringStream &stream, ValidationLevel l) const override;
 
-	mem::Map<mem::String, Field> fields;
+	FieldMap fields;
 };
 
 struct FieldFile : Field::Slot {
@@ -487,6 +487,11 @@ struct FieldView : Field::Slot {
 		Delta
 	};
 
+	// view membership is updated by background task from persistent queue, not within object's transaction
+	enum DeferredOptions {
+		Deferred
+	};
+
 	virtual ~FieldView() { }
 
 	template <typename ... Args>
@@ -501,6 +506,7 @@ struct FieldView : Field::Slot {
 	ViewLinkageFn linkage;
 	ViewFn viewFn;
 	bool delta = false;
+	bool deferred = false;
 };
 
 struct FieldFullTextView : Field::Slot {
@@ -794,6 +800,12 @@ template <typename F> struct FieldOption<F, FieldView::DeltaOptions> {
 	}
 };
 
+template <typename F> struct FieldOption<F, FieldView::DeferredOptions> {
+	static inline void assign(F & f, FieldView::DeferredOptions d) {
+		if (d == FieldView::Deferred) { f.deferred = true; } else { f.deferred = false; }
+	}
+};
+
 NS_DB_END
 
 #endif /* STELLATOR_DB_STSTORAGEFIELD_H_ */
@@ -27,6 +27,11 @@ THE SOFTWARE.
 
 NS_DB_BEGIN
 
+struct ViewQueueStatus {
+	size_t pending = 0; // number of objects in queue
+	stappler::TimeInterval lag; // age of the oldest queued object
+};
+
 class Interface : public mem::AllocBase {
 public:
 	enum class StorageType {
@@ -58,6 +63,10 @@ public: // key-value storage
 	virtual mem::Value get(const stappler::CoderSource &) = 0;
 	virtual bool clear(const stappler::CoderSource &) = 0;
 
+	// batch operations, mget returns values in the same order as keys
+	virtual mem::Vector<mem::Value> mget(mem::SpanView<mem::BytesView>) = 0;
+	virtual bool mset(const mem::Map<mem::Bytes, mem::Value> &, stappler::TimeInterval) = 0;
+
 public: // resource requests
 	virtual mem::Vector<int64_t> performQueryListForIds(const QueryList &, size_t count) = 0;
 	virtual mem::Value performQueryList(const QueryList &, size_t count, bool forUpdate) = 0;
@@ -82,6 +91,15 @@ public:
 	virtual bool addToView(const FieldView &, const Scheme *, uint64_t oid, const mem::Value &) = 0;
 	virtual bool removeFromView(const FieldView &, const Scheme *, uint64_t oid) = 0;
 
+	// batch operations for deferred views: pairs is <object id, view tag>
+	virtual bool addToView(const FieldView &, const Scheme *, const mem::Vector<mem::Pair<int64_t, int64_t>> &) = 0;
+	virtual bool removeFromView(const FieldView &, const Scheme *, const mem::Vector<int64_t> &) = 0;
+
+	// persistent queue of objects, which membership in view should be reevaluated
+	virtual bool scheduleViewUpdate(const FieldView &, const Scheme *, uint64_t oid) = 0;
+	virtual mem::Vector<int64_t> popViewUpdates(const FieldView &, const Scheme *, size_t count, stappler::Time *oldest) = 0;
+	virtual ViewQueueStatus getViewQueueStatus(const FieldView &, const Scheme *) = 0;
+
 	virtual mem::Vector<int64_t> getReferenceParents(const Scheme &, uint64_t oid, const Scheme *, const Field *) = 0;
 
 public: // others
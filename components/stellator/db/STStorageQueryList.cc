@@ -26,7 +26,7 @@ THE SOFTWARE.
 
 NS_DB_BEGIN
 
-static const Field *getFieldFormMap(const mem::Map<mem::String, Field> &fields, const mem::StringView &name) {
+static const Field *getFieldFormMap(const FieldMap &fields, const mem::StringView &name) {
 	auto it = fields.find(name);
 	if (it != fields.end()) {
 		return &it->second;
@@ -45,7 +45,7 @@ static const Query::FieldsVec *getFieldsVec(const Query::FieldsVec *vec, const m
 	return nullptr;
 }
 
-static void QueryFieldResolver_resolveByName(mem::Set<const Field *> &ret, const mem::Map<mem::String, Field> &fields, const mem::StringView &name) {
+static void QueryFieldResolver_resolveByName(mem::Set<const Field *> &ret, const FieldMap &fields, const mem::StringView &name) {
 	if (!name.empty() && name.front() == '$') {
 		auto res = Query::decodeResolve(name);
 		switch (res) {
@@ -137,7 +137,7 @@ const Scheme *QueryFieldResolver::getScheme() const {
 	}
 	return nullptr;
 }
-const mem::Map<mem::String, Field> *QueryFieldResolver::getFields() const {
+const FieldMap *QueryFieldResolver::getFields() const {
 	if (root) {
 		return root->fields;
 	}
@@ -237,7 +237,7 @@ void QueryFieldResolver::doResolve(Data *data, const mem::Vector<mem::String> &e
 
 	for (const Field *it : data->resolved) {
 		const Scheme *scheme = nullptr;
-		const mem::Map<mem::String, Field> *fields = nullptr;
+		const FieldMap *fields = nullptr;
 
 		if (auto s = it->getForeignScheme()) {
 			scheme = s;
@@ -56,7 +56,7 @@ public:
 
 	const Field *getField(const mem::String &) const;
 	const Scheme *getScheme() const;
-	const mem::Map<mem::String, Field> *getFields() const;
+	const FieldMap *getFields() const;
 	Meta getMeta() const;
 
 	const mem::Set<const Field *> &getResolves() const;
@@ -72,7 +72,7 @@ public:
 protected:
 	struct Data {
 		const Scheme *scheme = nullptr;
-		const mem::Map<mem::String, Field> *fields = nullptr;
+		const FieldMap *fields = nullptr;
 		const Query::FieldsVec *include = nullptr;
 		const Query::FieldsVec *exclude = nullptr;
 		mem::Set<const Field *> resolved;
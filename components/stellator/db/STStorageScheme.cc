@@ -29,7 +29,7 @@ THE SOFTWARE.
 
 NS_DB_BEGIN
 
-static void Scheme_setOwner(const Scheme *scheme, const mem::Map<mem::String, Field> &map) {
+static void Scheme_setOwner(const Scheme *scheme, const FieldMap &map) {
 	for (auto &it : map) {
 		const_cast<Field::Slot *>(it.second.getSlot())->owner = scheme;
 		if (it.second.getType() == Type::Extra) {
@@ -229,7 +229,7 @@ const mem::Set<const Field *> & Scheme::getForceInclude() const {
 	return forceInclude;
 }
 
-const mem::Map<mem::String, Field> & Scheme::getFields() const {
+const FieldMap & Scheme::getFields() const {
 	return fields;
 }
 
@@ -324,6 +324,106 @@ const mem::Vector<Scheme::ViewScheme *> &Scheme::getViews() const {
 	return views;
 }
 
+size_t Scheme::processDeferredViews(const Transaction &t, const Field &field, size_t batch) const {
+	auto it = std::find_if(views.begin(), views.end(), [&] (const ViewScheme *v) {
+		return v->viewField == &field;
+	});
+	if (it == views.end() || field.getType() != Type::View) {
+		return 0;
+	}
+
+	auto scheme = *it;
+	auto view = field.getSlot<FieldView>();
+	if (!view->viewFn) {
+		return 0;
+	}
+
+	size_t ret = 0;
+	stappler::Time oldest;
+	t.performAsSystem([&] () -> bool {
+		auto ids = t.popViewUpdates(*scheme->scheme, *view, batch, &oldest);
+		if (ids.empty()) {
+			return true;
+		}
+
+		ret = ids.size();
+
+		// drop all previous entries for batch, then rebuild them with single insert
+		if (!t.removeFromView(*scheme->scheme, *view, ids)) {
+			return false;
+		}
+
+		Query q; q.select(std::move(ids));
+		for (auto &f : scheme->fields) {
+			q.include(f->getName());
+		}
+
+		mem::Vector<mem::Pair<int64_t, int64_t>> rows;
+		auto objs = select(t, q);
+		for (auto &obj : objs.asArray()) {
+			if (view->viewFn(*this, obj)) {
+				auto objId = obj.getInteger("__oid");
+				for (auto &id : getLinkageForView(obj, *scheme)) {
+					rows.emplace_back(objId, int64_t(id));
+				}
+			}
+		}
+
+		return t.addToView(*scheme->scheme, *view, rows);
+	});
+
+	if (ret > 0 && oldest) {
+		messages::debug("Storage", "Deferred view updated", mem::Value({
+			stappler::pair("view", mem::Value(mem::toString(scheme->scheme->getName(), ".", field.getName()))),
+			stappler::pair("objects", mem::Value(int64_t(ret))),
+			stappler::pair("lag", mem::Value(int64_t((stappler::Time::now() - oldest).toMicros()))),
+		}));
+	}
+
+	return ret;
+}
+
+bool Scheme::waitForViews(const Transaction &t, stappler::TimeInterval timeout) const {
+	// sleeping within transaction holds it's locks and snapshot, while other workers wait for them,
+	// so, queue is polled only without transaction, when every batch is committed separately
+	const bool canWait = !t.isInTransaction();
+	auto deadline = stappler::Time::now() + timeout;
+	for (auto &it : fields) {
+		if (it.second.getType() != Type::View) {
+			continue;
+		}
+
+		auto slot = it.second.getSlot<FieldView>();
+		if (!slot->deferred) {
+			continue;
+		}
+
+		// process queue in current thread, concurrent workers skip locked entries
+		while (slot->scheme->processDeferredViews(t, it.second) > 0) {
+			if (stappler::Time::now() > deadline) {
+				return false;
+			}
+		}
+
+		// wait for entries, locked by other workers
+		while (getViewQueueStatus(t, it.second).pending > 0) {
+			if (!canWait || stappler::Time::now() > deadline) {
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	return true;
+}
+
+ViewQueueStatus Scheme::getViewQueueStatus(const Transaction &t, const Field &field) const {
+	if (field.getType() != Type::View) {
+		return ViewQueueStatus();
+	}
+
+	return t.getViewQueueStatus(*this, *field.getSlot<FieldView>());
+}
+
 mem::Vector<const Field *> Scheme::getPatchFields(const mem::Value &patch) const {
 	mem::Vector<const Field *> ret; ret.reserve(patch.size());
 	for (auto &it : patch.asDict()) {
@@ -628,6 +728,9 @@ mem::Value Scheme::updateObject(Worker &w, mem::Value && obj, mem::Value &change
 
 	// acquire current views state
 	for (auto &it : viewsToUpdate) {
+		if (it.first->viewField->getType() == Type::View && it.first->viewField->getSlot<FieldView>()->deferred) {
+			continue; // deferred views are rebuilt from current object state
+		}
 		it.second = getLinkageForView(obj, *it.first);
 	}
 
@@ -1437,6 +1540,12 @@ void Scheme::updateView(const Transaction &t, const mem::Value & obj, const View
 
 	auto objId = obj.getInteger("__oid");
 
+	if (view && view->deferred && !scheme->autoField) {
+		// linkage and view function will be evaluated in batch, see processDeferredViews
+		t.scheduleViewUpdate(*scheme->scheme, *scheme->viewField, *this, objId);
+		return;
+	}
+
 	// list of objects, that view fields should contain this object
 	mem::Vector<uint64_t> ids = getLinkageForView(obj, *scheme);
 
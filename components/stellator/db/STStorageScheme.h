@@ -76,6 +76,9 @@ public:
 	// field list to send, when no field is required to return
 	static FieldVec EmptyFieldList() { return FieldVec{nullptr}; }
 
+	// number of queued objects, processed in single deferred view update
+	static constexpr size_t DeferredViewsBatchSize = 256;
+
 	static bool initSchemes(const mem::Map<mem::String, const Scheme *> &);
 
 public:
@@ -116,7 +119,7 @@ public:
 	bool hasAccessControl() const;
 
 	const mem::Set<const Field *> & getForceInclude() const;
-	const mem::Map<mem::String, Field> & getFields() const;
+	const FieldMap & getFields() const;
 	const Field *getField(const mem::StringView &str) const;
 	const mem::Vector<UniqueConstraint> &getUnique() const;
 
@@ -136,6 +139,15 @@ public:
 	uint64_t hash(ValidationLevel l = ValidationLevel::NamesAndTypes) const;
 
 	const mem::Vector<ViewScheme *> &getViews() const;
+
+	// process queued objects of this scheme for deferred view field, returns number of processed objects
+	size_t processDeferredViews(const Transaction &, const Field &view, size_t batch = DeferredViewsBatchSize) const;
+
+	// process and wait for all deferred view fields of this scheme, returns false on timeout;
+	// within transaction queue is only processed: objects, claimed by other workers, are not waited for
+	bool waitForViews(const Transaction &, stappler::TimeInterval timeout) const;
+
+	ViewQueueStatus getViewQueueStatus(const Transaction &, const Field &view) const;
 	mem::Vector<const Field *> getPatchFields(const mem::Value &patch) const;
 
 	const AccessTable &getAccessTable() const;
@@ -245,7 +257,7 @@ protected:
 	void updateView(const Transaction &, const mem::Value &, const ViewScheme *, const mem::Vector<uint64_t> &) const;
 
 protected:
-	mem::Map<mem::String, Field> fields;
+	FieldMap fields;
 	mem::String name;
 
 	Options flags = Options::None;
@@ -409,6 +409,34 @@ bool Transaction::addToView(const Scheme &scheme, const FieldView &field, uint64
 	return _data->adapter.addToView(field, &scheme, oid, viewObj);
 }
 
+bool Transaction::addToView(const Scheme &scheme, const FieldView &field, const mem::Vector<mem::Pair<int64_t, int64_t>> &vec) const {
+	if (!isOpAllowed(scheme, AddToView)) {
+		return false;
+	}
+
+	return _data->adapter.addToView(field, &scheme, vec);
+}
+
+bool Transaction::removeFromView(const Scheme &scheme, const FieldView &field, const mem::Vector<int64_t> &vec) const {
+	if (!isOpAllowed(scheme, RemoveFromView)) {
+		return false;
+	}
+
+	return _data->adapter.removeFromView(field, &scheme, vec);
+}
+
+mem::Vector<int64_t> Transaction::popViewUpdates(const Scheme &scheme, const FieldView &field, size_t count, stappler::Time *oldest) const {
+	if (!isOpAllowed(scheme, RemoveFromView)) {
+		return mem::Vector<int64_t>();
+	}
+
+	return _data->adapter.popViewUpdates(field, &scheme, count, oldest);
+}
+
+ViewQueueStatus Transaction::getViewQueueStatus(const Scheme &scheme, const FieldView &field) const {
+	return _data->adapter.getViewQueueStatus(field, &scheme);
+}
+
 int64_t Transaction::getDeltaValue(const Scheme &scheme) {
 	if (!isOpAllowed(scheme, Delta)) {
 		return false;
@@ -539,6 +567,10 @@ void Transaction::scheduleAutoField(const Scheme &scheme, const Field &field, ui
 	_data->adapter.scheduleAutoField(scheme, field, id);
 }
 
+void Transaction::scheduleViewUpdate(const Scheme &scheme, const Field &field, const Scheme &source, uint64_t id) const {
+	_data->adapter.scheduleViewUpdate(scheme, field, source, id);
+}
+
 bool Transaction::beginTransaction() const {
 	return _data->adapter.beginTransaction();
 }
@@ -559,7 +591,7 @@ void Transaction::clearObjectStorage() const {
 	_data->objects.clear();
 }
 
-static bool Transaction_processFields(const Scheme &scheme, const mem::Value &val, mem::Value &obj, const mem::Map<mem::String, Field> &vec) {
+static bool Transaction_processFields(const Scheme &scheme, const mem::Value &val, mem::Value &obj, const FieldMap &vec) {
 	if (obj.isDictionary()) {
 		auto &dict = obj.asDict();
 		auto it = dict.begin();
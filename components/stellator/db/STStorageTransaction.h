@@ -140,6 +140,13 @@ public: // adapter interface
 	bool removeFromView(const Scheme &, const FieldView &, uint64_t oid, const mem::Value &obj) const;
 	bool addToView(const Scheme &, const FieldView &, uint64_t oid, const mem::Value &obj, const mem::Value &viewObj) const;
 
+	// batch versions: pairs of (source object id, view owner id)
+	bool addToView(const Scheme &, const FieldView &, const mem::Vector<mem::Pair<int64_t, int64_t>> &) const;
+	bool removeFromView(const Scheme &, const FieldView &, const mem::Vector<int64_t> &) const;
+
+	mem::Vector<int64_t> popViewUpdates(const Scheme &, const FieldView &, size_t count, stappler::Time *oldest = nullptr) const;
+	ViewQueueStatus getViewQueueStatus(const Scheme &, const FieldView &) const;
+
 	int64_t getDeltaValue(const Scheme &); // scheme-based delta
 	int64_t getDeltaValue(const Scheme &, const FieldView &, uint64_t); // view-based delta
 
@@ -148,6 +155,7 @@ public: // adapter interface
 	mem::Value performQueryListField(const QueryList &, const Field &);
 
 	void scheduleAutoField(const Scheme &, const Field &, uint64_t id) const;
+	void scheduleViewUpdate(const Scheme &, const Field &, const Scheme &source, uint64_t id) const;
 
 protected:
 	bool beginTransaction() const;
@@ -162,6 +162,13 @@ Driver::Result Driver::exec(Connection conn, const char *command, int nParams, c
 	return Driver::Result(PQexecParams((PGconn *)conn.get(), command, nParams, nullptr, paramValues, paramLengths, paramFormats, resultFormat));
 }
 
+Driver::Result Driver::execPrepared(Connection conn, uint64_t key, const char *command, int nParams, const char *const *paramValues,
+		const int *paramLengths, const int *paramFormats, int resultFormat) {
+	// connections are owned by mod_dbd and can be reopened without notice, so we can not track
+	// statements, prepared on them; use unnamed statement
+	return exec(conn, command, nParams, paramValues, paramLengths, paramFormats, resultFormat);
+}
+
 Driver::~Driver() { }
 
 Driver::Driver(const mem::StringView &) { }
@@ -175,6 +182,7 @@ void Driver::setDbCtrl(mem::Function<void(bool)> &&cb) {
 NS_DB_PQ_END
 #elif STELLATOR
 #include <dlfcn.h>
+#include <cinttypes>
 
 NS_DB_PQ_BEGIN
 
@@ -225,6 +233,9 @@ struct DriverSym : mem::AllocBase {
 	using PQexecType = void *(*) (void *conn, const char *query);
 	using PQexecParamsType = void *(*) (void *conn, const char *command, int nParams, const void *paramTypes,
 			const char *const *paramValues, const int *paramLengths, const int *paramFormats, int resultFormat);
+	using PQprepareType = void *(*) (void *conn, const char *stmtName, const char *query, int nParams, const void *paramTypes);
+	using PQexecPreparedType = void *(*) (void *conn, const char *stmtName, int nParams,
+			const char *const *paramValues, const int *paramLengths, const int *paramFormats, int resultFormat);
 
 	using PQstatusType = ConnStatusType (*) (void *conn);
 	using PQtransactionStatusType = PGTransactionStatusType (*) (void *conn);
@@ -232,8 +243,29 @@ struct DriverSym : mem::AllocBase {
 
 	DriverSym(void *p) : ptr(p) { }
 
+	bool isPrepared(void *conn, uint64_t key) {
+		std::unique_lock<std::mutex> lock(preparedMutex);
+		auto it = prepared.find(conn);
+		return it != prepared.end() && it->second.find(key) != it->second.end();
+	}
+
+	void setPrepared(void *conn, uint64_t key) {
+		std::unique_lock<std::mutex> lock(preparedMutex);
+		prepared[conn].emplace(key);
+	}
+
+	void dropPrepared(void *conn) {
+		std::unique_lock<std::mutex> lock(preparedMutex);
+		prepared.erase(conn);
+	}
+
 	void *ptr;
 
+	// statements, prepared on each connection; connection can be used only by one thread at a time,
+	// but registry is shared between all of them
+	std::mutex preparedMutex;
+	std::unordered_map<void *, std::unordered_set<uint64_t>> prepared;
+
 	PQconnectdbParamsType PQconnectdbParams = nullptr;
 	PQfinishType PQfinish = nullptr;
 	PQresultStatusType PQresultStatus = nullptr;
@@ -251,6 +283,8 @@ struct DriverSym : mem::AllocBase {
 	PQclearType PQclear = nullptr;
 	PQexecType PQexec = nullptr;
 	PQexecParamsType PQexecParams = nullptr;
+	PQprepareType PQprepare = nullptr;
+	PQexecPreparedType PQexecPrepared = nullptr;
 	PQstatusType PQstatus = nullptr;
 	PQtransactionStatusType PQtransactionStatus = nullptr;
 	PQsetNoticeProcessorType PQsetNoticeProcessor = nullptr;
@@ -272,13 +306,19 @@ void Driver_noticeMessage(void *arg, const char *message) {
 Driver::Handle Driver::connect(const char * const *keywords, const char * const *values, int expand_dbname) const{
 	auto ret = (((DriverSym *)_handle)->PQconnectdbParams(keywords, values, expand_dbname));
 	if (ret && ((DriverSym *)_handle)->PQstatus(ret) == CONNECTION_OK) {
+		// new connection can reuse address of closed one, that was not finished with driver, so,
+		// statements, registered for this address, are not prepared on it
+		((DriverSym *)_handle)->dropPrepared(ret);
 		((DriverSym *)_handle)->PQsetNoticeProcessor(ret, Driver_noticeMessage, (void *)this);
 		return Driver::Handle(ret);
+	} else if (ret) {
+		((DriverSym *)_handle)->PQfinish(ret);
 	}
 	return Driver::Handle(nullptr);
 }
 
 void Driver::finish(Handle h) const {
+	((DriverSym *)_handle)->dropPrepared(h.get());
 	((DriverSym *)_handle)->PQfinish(h.get());
 }
 
@@ -389,6 +429,30 @@ Driver::Result Driver::exec(Connection conn, const char *command, int nParams, c
 	return Driver::Result(((DriverSym *)_handle)->PQexecParams(conn.get(), command, nParams, nullptr, paramValues, paramLengths, paramFormats, resultFormat));
 }
 
+Driver::Result Driver::execPrepared(Connection conn, uint64_t key, const char *command, int nParams, const char *const *paramValues,
+		const int *paramLengths, const int *paramFormats, int resultFormat) {
+	auto h = (DriverSym *)_handle;
+	if (!h->PQprepare || !h->PQexecPrepared) {
+		return exec(conn, command, nParams, paramValues, paramLengths, paramFormats, resultFormat);
+	}
+
+	char name[24] = { 0 };
+	snprintf(name, sizeof(name), "sp_%016" PRIx64, key);
+
+	if (!h->isPrepared(conn.get(), key)) {
+		auto res = h->PQprepare(conn.get(), name, command, nParams, nullptr);
+		auto status = h->PQresultStatus(res);
+		h->PQclear(res);
+		if (status != PGRES_COMMAND_OK) {
+			// transaction is already failed, exec with query text to report actual error
+			return exec(conn, command, nParams, paramValues, paramLengths, paramFormats, resultFormat);
+		}
+		h->setPrepared(conn.get(), key);
+	}
+
+	return Driver::Result(h->PQexecPrepared(conn.get(), name, nParams, paramValues, paramLengths, paramFormats, resultFormat));
+}
+
 Driver::~Driver() {
 	release();
 }
@@ -420,6 +484,8 @@ Driver::Driver(const mem::StringView &path) {
 		h->PQclear = DriverSym::PQclearType(dlsym(d, "PQclear"));
 		h->PQexec = DriverSym::PQexecType(dlsym(d, "PQexec"));
 		h->PQexecParams = DriverSym::PQexecParamsType(dlsym(d, "PQexecParams"));
+		h->PQprepare = DriverSym::PQprepareType(dlsym(d, "PQprepare"));
+		h->PQexecPrepared = DriverSym::PQexecPreparedType(dlsym(d, "PQexecPrepared"));
 		h->PQstatus = DriverSym::PQstatusType(dlsym(d, "PQstatus"));
 		h->PQtransactionStatus = DriverSym::PQtransactionStatusType(dlsym(d, "PQtransactionStatus"));
 		h->PQsetNoticeProcessor = DriverSym::PQsetNoticeProcessorType(dlsym(d, "PQsetNoticeProcessor"));
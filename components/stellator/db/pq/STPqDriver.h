@@ -89,6 +89,11 @@ public:
 	Result exec(Connection conn, const char *command, int nParams, const char *const *paramValues,
 			const int *paramLengths, const int *paramFormats, int resultFormat);
 
+	// executes query as prepared statement, named by query shape key; statement is prepared on first use
+	// for each connection, if driver can not prepare statements, query text is executed directly
+	Result execPrepared(Connection conn, uint64_t key, const char *command, int nParams, const char *const *paramValues,
+			const int *paramLengths, const int *paramFormats, int resultFormat);
+
 	void release();
 
 	void setDbCtrl(mem::Function<void(bool)> &&);
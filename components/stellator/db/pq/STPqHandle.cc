@@ -622,20 +622,26 @@ bool Handle::selectQuery(const sql::SqlQuery &query, const stappler::Callback<vo
 
 	auto queryInterface = static_cast<PgQueryInterface *>(query.getInterface());
 
+	auto shape = query.getShape();
+	auto text = shape ? mem::StringView(shape->text) : query.getQuery().weak();
+
 	if (messages::isDebugEnabled()) {
 		if (!query.getTarget().starts_with("__")) {
-			messages::local("Database-Query", query.getQuery().weak());
+			messages::local("Database-Query", text);
 		}
 	}
 
 	ExecParamData data(query);
-	PgResultInterface res(this, driver, driver->exec(conn, query.getQuery().weak().data(), queryInterface->params.size(),
+	PgResultInterface res(this, driver, shape
+		? driver->execPrepared(conn, shape->key, text.data(), queryInterface->params.size(),
+			data.paramValues, data.paramLengths, data.paramFormats, 1)
+		: driver->exec(conn, text.data(), queryInterface->params.size(),
 			data.paramValues, data.paramLengths, data.paramFormats, 1));
 	if (!res.isSuccess()) {
 		auto info = res.getInfo();
-		info.setString(query.getQuery().str(), "query");
+		info.setString(text, "query");
 #if DEBUG
-		std::cout << query.getQuery().weak() << "\n";
+		std::cout << text << "\n";
 		std::cout << mem::EncodeFormat::Pretty << info << "\n";
 #endif
 		messages::debug("Database", "Fail to perform query", std::move(info));
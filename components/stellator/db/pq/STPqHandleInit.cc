@@ -144,6 +144,16 @@ CREATE TABLE IF NOT EXISTS __login (
 CREATE INDEX IF NOT EXISTS __login_user ON __login ("user");
 CREATE INDEX IF NOT EXISTS __login_date ON __login (date);
 
+CREATE TABLE IF NOT EXISTS __views_queue (
+	id bigserial NOT NULL,
+	"view" text NOT NULL,
+	oid bigint NOT NULL,
+	"date" bigint NOT NULL,
+	CONSTRAINT __views_queue_pkey PRIMARY KEY (id),
+	CONSTRAINT __views_queue_unique UNIQUE ("view", oid)
+) WITH ( OIDS=FALSE );
+CREATE INDEX IF NOT EXISTS __views_queue_view ON __views_queue ("view", id);
+
 CREATE EXTENSION IF NOT EXISTS intarray;
 CREATE EXTENSION IF NOT EXISTS pg_trgm;
 )Sql";
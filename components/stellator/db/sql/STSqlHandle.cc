@@ -35,6 +35,11 @@ mem::String SqlHandle::getNameForDelta(const Scheme &scheme) {
 }
 
 mem::Value SqlHandle::get(const stappler::CoderSource &key) {
+	auto it = _kvValues.find(mem::Bytes(key.data(), key.data() + key.size()));
+	if (it != _kvValues.end()) {
+		return it->second;
+	}
+
 	mem::Value ret;
 	makeQuery([&] (SqlQuery &query) {
 		query.select("data").from(getKeyValueSchemeName()).where("name", Comparation::Equal, key).finalize();
@@ -44,27 +49,161 @@ mem::Value SqlHandle::get(const stappler::CoderSource &key) {
 			}
 		});
 	});
+	if (!isInTransaction()) {
+		_kvValues.emplace(mem::Bytes(key.data(), key.data() + key.size()), ret);
+	}
 	return ret;
 }
 
-bool SqlHandle::set(const stappler::CoderSource &key, const mem::Value &data, stappler::TimeInterval maxage) {
-	bool ret = false;
+mem::Vector<mem::Value> SqlHandle::mget(mem::SpanView<mem::BytesView> keys) {
+	mem::Vector<mem::Value> ret; ret.resize(keys.size());
+	mem::Vector<size_t> missed;
+
+	for (size_t i = 0; i < keys.size(); ++ i) {
+		auto it = _kvValues.find(mem::Bytes(keys[i].data(), keys[i].data() + keys[i].size()));
+		if (it != _kvValues.end()) {
+			ret[i] = it->second;
+		} else {
+			missed.emplace_back(i);
+		}
+	}
+
+	if (missed.empty()) {
+		return ret;
+	}
+
 	makeQuery([&] (SqlQuery &query) {
-		query.insert(getKeyValueSchemeName()).fields("name", "mtime", "maxage", "data")
-			.values(key, stappler::Time::now().toSeconds(), maxage.toSeconds(), mem::writeData(data, stappler::data::EncodeFormat::Cbor))
-			.onConflict("name").doUpdate().excluded("mtime").excluded("maxage").excluded("data")
-			.finalize();
-		ret = (performQuery(query) != stappler::maxOf<size_t>());
+		auto w = query.select("name", "data").from(getKeyValueSchemeName())
+			.where("name", Comparation::Equal, mem::Bytes(keys[missed.front()].data(), keys[missed.front()].data() + keys[missed.front()].size()));
+		for (size_t i = 1; i < missed.size(); ++ i) {
+			auto &key = keys[missed[i]];
+			w.where(Operator::Or, "name", Comparation::Equal, mem::Bytes(key.data(), key.data() + key.size()));
+		}
+		query.finalize();
+
+		selectQuery(query, [&] (Result &res) {
+			for (auto row : res) {
+				auto name = row.toBytes(0);
+				for (auto &idx : missed) {
+					if (keys[idx] == name) {
+						ret[idx] = stappler::data::read<mem::BytesView, mem::Interface>(row.toBytes(1));
+					}
+				}
+			}
+		});
 	});
+
+	if (!isInTransaction()) {
+		for (auto &idx : missed) {
+			_kvValues.emplace(mem::Bytes(keys[idx].data(), keys[idx].data() + keys[idx].size()), ret[idx]);
+		}
+	}
 	return ret;
 }
 
+bool SqlHandle::set(const stappler::CoderSource &key, const mem::Value &data, stappler::TimeInterval maxage) {
+	mem::Map<mem::Bytes, KeyValueWrite> writes;
+	writes.emplace(mem::Bytes(key.data(), key.data() + key.size()), KeyValueWrite{data, maxage});
+	return performKeyValueWrite(std::move(writes));
+}
+
+bool SqlHandle::mset(const mem::Map<mem::Bytes, mem::Value> &data, stappler::TimeInterval maxage) {
+	if (data.empty()) {
+		return true;
+	}
+
+	mem::Map<mem::Bytes, KeyValueWrite> writes;
+	for (auto &it : data) {
+		writes.emplace(it.first, KeyValueWrite{it.second, maxage});
+	}
+	return performKeyValueWrite(std::move(writes));
+}
+
 bool SqlHandle::clear(const stappler::CoderSource &key) {
-	bool ret = false;
-	makeQuery([&] (SqlQuery &query) {
-		query.remove("__sessions").where("name", Comparation::Equal, key).finalize();
-		ret = (performQuery(query) == 1); // one row should be affected
-	});
+	mem::Map<mem::Bytes, KeyValueWrite> writes;
+	writes.emplace(mem::Bytes(key.data(), key.data() + key.size()), KeyValueWrite{mem::Value(), stappler::TimeInterval(), true});
+	return performKeyValueWrite(std::move(writes));
+}
+
+void SqlHandle::setKeyValueWriteBehind(bool value) {
+	if (_kvWriteBehind && !value) {
+		finalizeKeyValues();
+	}
+	_kvWriteBehind = value;
+}
+
+bool SqlHandle::isKeyValueWriteBehind() const {
+	return _kvWriteBehind;
+}
+
+bool SqlHandle::finalizeKeyValues() {
+	if (_kvWrites.empty()) {
+		return true;
+	}
+
+	auto writes = std::move(_kvWrites);
+	_kvWrites.clear();
+	return performKeyValueQuery(writes);
+}
+
+bool SqlHandle::performKeyValueWrite(mem::Map<mem::Bytes, KeyValueWrite> &&writes) {
+	if (!_kvWriteBehind) {
+		return performKeyValueQuery(writes);
+	}
+
+	// value, that will be written, is visible for next reads from this handle
+	for (auto &it : writes) {
+		_kvValues[it.first] = it.second.removed ? mem::Value() : it.second.data;
+		_kvWrites[it.first] = std::move(it.second);
+	}
+	return true;
+}
+
+bool SqlHandle::performKeyValueQuery(const mem::Map<mem::Bytes, KeyValueWrite> &writes) {
+	bool hasUpdates = false;
+	mem::Vector<const mem::Bytes *> removed;
+	for (auto &it : writes) {
+		// value, written within transaction, can be rolled back, so it should be read from database again
+		if (isInTransaction()) {
+			_kvValues.erase(it.first);
+		} else {
+			_kvValues[it.first] = it.second.removed ? mem::Value() : it.second.data;
+		}
+		if (it.second.removed) {
+			removed.emplace_back(&it.first);
+		} else {
+			hasUpdates = true;
+		}
+	}
+
+	bool ret = true;
+	if (hasUpdates) {
+		auto now = stappler::Time::now().toSeconds();
+		makeQuery([&] (SqlQuery &query) {
+			auto vals = query.insert(getKeyValueSchemeName()).fields("name", "mtime", "maxage", "data").values();
+			for (auto &it : writes) {
+				if (!it.second.removed) {
+					vals.values(mem::Bytes(it.first), now, it.second.maxage.toSeconds(), mem::writeData(it.second.data, stappler::data::EncodeFormat::Cbor));
+				}
+			}
+			vals.onConflict("name").doUpdate().excluded("mtime").excluded("maxage").excluded("data");
+			query.finalize();
+			ret = (performQuery(query) != stappler::maxOf<size_t>());
+		});
+	}
+
+	if (!removed.empty()) {
+		makeQuery([&] (SqlQuery &query) {
+			auto w = query.remove(getKeyValueSchemeName()).where("name", Comparation::Equal, mem::Bytes(*removed.front()));
+			for (auto it = std::next(removed.begin()); it != removed.end(); ++ it) {
+				w.where(Operator::Or, "name", Comparation::Equal, mem::Bytes(**it));
+			}
+			query.finalize();
+			auto count = performQuery(query);
+			ret = ret && count != stappler::maxOf<size_t>() && count >= 1; // at least one row should be affected
+		});
+	}
+
 	return ret;
 }
 
@@ -48,10 +48,23 @@ public:
 	static mem::String getNameForDelta(const Scheme &scheme);
 
 public:
+	// key-value data, read or written with handle, is cached in it and is not requested from database again;
+	// cache is not shared between handles (or processes), so, it can not be outdated by other writers
+	// for more then handle's lifetime (single request)
 	virtual bool set(const stappler::CoderSource &, const mem::Value &, stappler::TimeInterval) override;
 	virtual mem::Value get(const stappler::CoderSource &) override;
 	virtual bool clear(const stappler::CoderSource &) override;
 
+	virtual mem::Vector<mem::Value> mget(mem::SpanView<mem::BytesView>) override;
+	virtual bool mset(const mem::Map<mem::Bytes, mem::Value> &, stappler::TimeInterval) override;
+
+	// in write-behind mode key-value writes are stored in handle, and performed with finalizeKeyValues
+	// repeated writes for the same key are coalesced into single write
+	void setKeyValueWriteBehind(bool);
+	bool isKeyValueWriteBehind() const;
+
+	bool finalizeKeyValues();
+
 	virtual db::User * authorizeUser(const db::Auth &auth, const mem::StringView &iname, const mem::StringView &password) override;
 
 	void makeSessionsCleanup();
@@ -98,9 +111,25 @@ protected: // prop interface
 	virtual bool removeFromView(const db::FieldView &, const Scheme *, uint64_t oid) override;
 	virtual bool addToView(const db::FieldView &, const Scheme *, uint64_t oid, const mem::Value &) override;
 
+	virtual bool addToView(const db::FieldView &, const Scheme *, const mem::Vector<mem::Pair<int64_t, int64_t>> &) override;
+	virtual bool removeFromView(const db::FieldView &, const Scheme *, const mem::Vector<int64_t> &) override;
+
+	virtual bool scheduleViewUpdate(const db::FieldView &, const Scheme *, uint64_t oid) override;
+	virtual mem::Vector<int64_t> popViewUpdates(const db::FieldView &, const Scheme *, size_t count, stappler::Time *oldest) override;
+	virtual db::ViewQueueStatus getViewQueueStatus(const db::FieldView &, const Scheme *) override;
+
 	virtual mem::Vector<int64_t> getReferenceParents(const Scheme &, uint64_t oid, const Scheme *, const Field *) override;
 
 protected:
+	struct KeyValueWrite {
+		mem::Value data;
+		stappler::TimeInterval maxage;
+		bool removed = false;
+	};
+
+	bool performKeyValueWrite(mem::Map<mem::Bytes, KeyValueWrite> &&);
+	bool performKeyValueQuery(const mem::Map<mem::Bytes, KeyValueWrite> &);
+
 	int64_t selectQueryId(const SqlQuery &);
 	size_t performQuery(const SqlQuery &);
 
@@ -135,6 +164,10 @@ protected:
 	void performPostUpdate(const db::Transaction &, SqlQuery &query, const Scheme &s, mem::Value &data, int64_t id, const mem::Value &upd, bool clear);
 
 	mem::Vector<stappler::Pair<stappler::Time, mem::Bytes>> _bcasts;
+
+	bool _kvWriteBehind = false;
+	mem::Map<mem::Bytes, KeyValueWrite> _kvWrites;
+	mem::Map<mem::Bytes, mem::Value> _kvValues;
 };
 
 NS_DB_SQL_END
@@ -25,7 +25,7 @@ THE SOFTWARE.
 
 NS_DB_SQL_BEGIN
 
-static mem::Value Handle_preparePostUpdate(mem::Value &data, const mem::Map<mem::String, db::Field> &fields) {
+static mem::Value Handle_preparePostUpdate(mem::Value &data, const db::FieldMap &fields) {
 	mem::Value postUpdate(mem::Value::Type::DICTIONARY);
 	auto &data_dict = data.asDict();
 	auto data_it = data_dict.begin();
@@ -55,7 +55,9 @@ mem::Value SqlHandle::select(Worker &worker, const db::Query &q) {
 	makeQuery([&] (SqlQuery &query) {
 		auto ordField = q.getQueryField();
 		if (ordField.empty()) {
-			query.writeQuery(worker, scheme, q);
+			if (!query.writeShapedQuery(worker, scheme, q)) {
+				query.writeQuery(worker, scheme, q);
+			}
 			ret = selectValueQuery(scheme, query);
 		} else if (auto f = scheme.getField(ordField)) {
 			switch (f->getType()) {
@@ -434,7 +436,7 @@ void SqlHandle::performPostUpdate(const db::Transaction &t, SqlQuery &query, con
 		}
 	};
 
-	const mem::Map<mem::String, Field> &fields = s.getFields();
+	const FieldMap &fields = s.getFields();
 	for (auto &it : upd.asDict()) {
 		auto f_it = fields.find(it.first);
 		if (f_it != fields.end()) {
@@ -522,6 +524,117 @@ bool SqlHandle::addToView(const db::FieldView &view, const Scheme *scheme, uint6
 	return ret;
 }
 
+bool SqlHandle::addToView(const db::FieldView &view, const Scheme *scheme, const mem::Vector<mem::Pair<int64_t, int64_t>> &rows) {
+	if (rows.empty()) {
+		return true;
+	}
+
+	bool ret = false;
+	if (scheme) {
+		mem::String name = mem::toString(scheme->getName(), "_f_", view.name, "_view");
+
+		makeQuery([&] (SqlQuery &query) {
+			auto val = query.insert(name)
+					.fields(mem::toString(view.scheme->getName(), "_id"), mem::toString(scheme->getName(), "_id"))
+					.values();
+			for (auto &it : rows) {
+				val.values(it.first, it.second);
+			}
+			query.finalize();
+			ret = performQuery(query) != stappler::maxOf<size_t>();
+		});
+	}
+	return ret;
+}
+
+bool SqlHandle::removeFromView(const db::FieldView &view, const Scheme *scheme, const mem::Vector<int64_t> &oids) {
+	if (oids.empty()) {
+		return true;
+	}
+
+	bool ret = false;
+	if (scheme) {
+		mem::String name = mem::toString(scheme->getName(), "_f_", view.name, "_view");
+
+		makeQuery([&] (SqlQuery &query) {
+			query << "DELETE FROM " << name << " WHERE \"" << view.scheme->getName() << "_id\" IN (";
+			bool first = true;
+			for (auto &it : oids) {
+				if (first) { first = false; } else { query << ","; }
+				query << it;
+			}
+			query << ");";
+			ret = performQuery(query) != stappler::maxOf<size_t>();
+		});
+	}
+	return ret;
+}
+
+bool SqlHandle::scheduleViewUpdate(const db::FieldView &view, const Scheme *scheme, uint64_t oid) {
+	bool ret = false;
+	if (scheme) {
+		mem::String name = mem::toString(scheme->getName(), "_f_", view.name, "_view");
+
+		makeQuery([&] (SqlQuery &query) {
+			query.insert("__views_queue").fields("view", "oid", "date")
+					.values(name, oid, stappler::Time::now().toMicroseconds())
+					.onConflictDoNothing().finalize();
+			ret = performQuery(query) != stappler::maxOf<size_t>();
+		});
+	}
+	return ret;
+}
+
+mem::Vector<int64_t> SqlHandle::popViewUpdates(const db::FieldView &view, const Scheme *scheme, size_t count, stappler::Time *oldest) {
+	mem::Vector<int64_t> ret;
+	if (scheme) {
+		mem::String name = mem::toString(scheme->getName(), "_f_", view.name, "_view");
+
+		// claim batch with single statement; locked entries are processed by other workers
+		makeQuery([&] (SqlQuery &query) {
+			query << "DELETE FROM __views_queue WHERE id IN (SELECT id FROM __views_queue WHERE \"view\"='" << name
+					<< "' ORDER BY id LIMIT " << count << " FOR UPDATE SKIP LOCKED) RETURNING oid, \"date\";";
+			selectQuery(query, [&] (Result &res) {
+				int64_t minDate = 0;
+				ret.reserve(res.nrows());
+				for (auto it : res) {
+					ret.emplace_back(it.toInteger(0));
+					auto date = it.toInteger(1);
+					if (minDate == 0 || date < minDate) {
+						minDate = date;
+					}
+				}
+				if (oldest) {
+					*oldest = stappler::Time::microseconds(minDate);
+				}
+			});
+		});
+	}
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}
+
+db::ViewQueueStatus SqlHandle::getViewQueueStatus(const db::FieldView &view, const Scheme *scheme) {
+	db::ViewQueueStatus ret;
+	if (scheme) {
+		mem::String name = mem::toString(scheme->getName(), "_f_", view.name, "_view");
+
+		makeQuery([&] (SqlQuery &query) {
+			query.select().count().aggregate("min", "date").from("__views_queue")
+					.where("view", Comparation::Equal, name).finalize();
+			selectQuery(query, [&] (Result &res) {
+				if (res) {
+					ret.pending = size_t(res.at(0).toInteger(0));
+					if (ret.pending > 0) {
+						ret.lag = stappler::Time::now() - stappler::Time::microseconds(res.at(0).toInteger(1));
+					}
+				}
+			});
+		});
+	}
+	return ret;
+}
+
 mem::Vector<int64_t> SqlHandle::getReferenceParents(const Scheme &objectScheme, uint64_t oid, const Scheme *parentScheme, const Field *parentField) {
 	mem::Vector<int64_t> vec;
 	if (parentField->isReference() && parentField->getType() == db::Type::Set) {
@@ -33,6 +33,29 @@ SqlQuery::SqlQuery(db::QueryInterface *iface) {
 void SqlQuery::clear() {
 	stream.clear();
 	binder.clear();
+	shape = nullptr;
+}
+
+static stappler::sql::QueryShapeCache s_queryShapes;
+
+static uint64_t SqlQuery_getSelectShapeKey(Worker &worker, const db::Scheme &scheme, const db::Query &q) {
+	// only plain select by id has a stable shape; everything else embeds values into query text
+	if (!q.getSingleSelectId() || !q.getQueryField().empty() || q.hasSelectList() || !q.getSelectAlias().empty()
+			|| q.hasOrder() || q.hasLimit() || q.hasOffset() || q.hasDelta() || q.isSoftLimit()) {
+		return 0;
+	}
+
+	// 'SELECT *' result type depends on current table definition, so it should not be cached
+	if (worker.shouldIncludeAll()) {
+		return 0;
+	}
+
+	stappler::sql::QueryShapeKey key;
+	key.add("select-by-id").add(scheme.getName()).add(uint64_t(q.isForUpdate()));
+	worker.readFields(scheme, q, [&] (const mem::StringView &name, const db::Field *) {
+		key.add(name);
+	});
+	return key.get();
 }
 
 static inline bool SqlQuery_comparationIsValid(const Field &f, Comparation comp) {
@@ -181,6 +204,30 @@ bool SqlQuery::writeQuery(Worker &worker, const db::Scheme &scheme, const db::Qu
 	return true;
 }
 
+bool SqlQuery::writeShapedQuery(Worker &worker, const db::Scheme &scheme, const db::Query &q) {
+	auto key = SqlQuery_getSelectShapeKey(worker, scheme, q);
+	if (!key) {
+		return false;
+	}
+
+	auto id = mem::toString(q.getSingleSelectId());
+	if (auto s = s_queryShapes.get(key)) {
+		writeBind(db::Binder::TypeString(id, "bigint"));
+		setShape(s);
+		return true;
+	}
+
+	auto sel = select();
+	auto s = writeSelectFrom(sel, worker, q);
+	auto w = s.where("__oid", db::Comparation::Equal, db::Binder::TypeString(id, "bigint"));
+	if (q.isForUpdate()) { w.forUpdate(); }
+	w.finalize();
+
+	// if cache is full, query is still valid, but without shape
+	setShape(s_queryShapes.emplace(key, stream.weak(), 1));
+	return true;
+}
+
 bool SqlQuery::writeQuery(Worker &w, const db::Scheme &scheme, uint64_t oid, const db::Field &f, const db::Query &q) {
 	auto type = f.getType();
 	auto fs = f.getForeignScheme();
@@ -50,6 +50,9 @@ public:
 	void clear();
 
 	bool writeQuery(Worker &, const db::Scheme &scheme, const db::Query &q);
+
+	// writes select-by-id query from process-wide shape cache; returns false if query can not be shaped
+	bool writeShapedQuery(Worker &, const db::Scheme &scheme, const db::Query &q);
 	bool writeQuery(Worker &worker, const db::Scheme &scheme, uint64_t, const db::Field &f, const db::Query &q);
 
 	void writeWhere(SqlQuery::SelectWhere &, db::Operator op, const db::Scheme &, const db::Query &);
@@ -38,7 +38,7 @@ ResultRow & ResultRow::operator=(const ResultRow &other) noexcept {
 size_t ResultRow::size() const {
 	return result->_nfields;
 }
-mem::Value ResultRow::toData(const db::Scheme &scheme, const mem::Map<mem::String, db::Field> &viewFields) {
+mem::Value ResultRow::toData(const db::Scheme &scheme, const db::FieldMap &viewFields) {
 	mem::Value row(mem::Value::Type::DICTIONARY);
 	row.asDict().reserve(result->_nfields);
 	mem::Value *deltaPtr = nullptr;
@@ -265,7 +265,7 @@ mem::Value Result::decode(const db::Field &field) const {
 		} else if (field.getType() == db::Type::View) {
 			auto v = static_cast<const db::FieldView *>(field.getSlot());
 			for (auto it : *this) {
-				ret.addValue(it.toData(*v->scheme, mem::Map<mem::String, db::Field>()));
+				ret.addValue(it.toData(*v->scheme, db::FieldMap()));
 			}
 		} else {
 			for (auto it : *this) {
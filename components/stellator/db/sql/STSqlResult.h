@@ -35,7 +35,7 @@ struct ResultRow {
 	ResultRow & operator=(const ResultRow &other) noexcept;
 
 	size_t size() const;
-	mem::Value toData(const db::Scheme &, const mem::Map<mem::String, db::Field> & = mem::Map<mem::String, db::Field>());
+	mem::Value toData(const db::Scheme &, const db::FieldMap & = db::FieldMap());
 
 	mem::StringView front() const;
 	mem::StringView back() const;
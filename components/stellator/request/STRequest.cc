@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 #include "SPFilesystem.h"
 #include "SPugCache.h"
+#include "SPugOutput.h"
 #include "SPugContext.h"
 #include "SPugVariable.h"
 #include "STRoot.h"
@@ -554,7 +555,13 @@ bool Request::checkCacheHeaders(mem::Time t, uint32_t idHash) {
 
 int Request::runPug(const mem::StringView & path, const mem::Function<bool(pug::Context &, const pug::Template &)> &cb) {
 	auto cache = server().getPugCache();
-	if (cache->runTemplate(path, [&] (pug::Context &ctx, const pug::Template &tpl) -> bool {
+
+	// template output goes to request's buffer directly, without intermediate stream
+	pug::Output output([&] (const mem::StringView &str) -> bool {
+		return _buffer.sputn(str.data(), str.size()) == std::streamsize(str.size());
+	});
+
+	auto ret = cache->runTemplate(path, [&] (pug::Context &ctx, const pug::Template &tpl) -> bool {
 		initScriptContext(ctx);
 
 		if (cb(ctx, tpl)) {
@@ -570,7 +577,10 @@ int Request::runPug(const mem::StringView & path, const mem::Function<bool(pug::
 			return true;
 		}
 		return false;
-	}, *this)) {
+	}, output);
+
+	output.flush();
+	if (ret) {
 		return DONE;
 	}
 	return HTTP_INTERNAL_SERVER_ERROR;
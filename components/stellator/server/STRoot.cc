@@ -147,6 +147,7 @@ void Root::performStorage(mem::pool_t *pool, const Server &serv, const mem::Call
 			mem::pool::userdata_set((void *)iface, config::getStorageInterfaceKey(), nullptr, pool);
 
 			cb(storage);
+			h.finalizeKeyValues();
 
 			mem::pool::userdata_set((void *)nullptr, config::getStorageInterfaceKey(), nullptr, pool);
 			dbdClose(pool, serv, dbd);
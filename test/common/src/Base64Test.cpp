@@ -0,0 +1,217 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2018 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPString.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+static const char * s_base64Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char * s_base64UrlAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// bitwise reference implementations
+static std::string Base64Test_encode(BytesView data, const char *alphabet, bool padding) {
+	std::string ret;
+	uint32_t acc = 0;
+	size_t bits = 0;
+	for (size_t i = 0; i < data.size(); ++ i) {
+		acc = (acc << 8) | data[i];
+		bits += 8;
+		while (bits >= 6) {
+			bits -= 6;
+			ret.push_back(alphabet[(acc >> bits) & 0x3F]);
+		}
+	}
+	if (bits > 0) {
+		ret.push_back(alphabet[(acc << (6 - bits)) & 0x3F]);
+	}
+	while (padding && ret.size() % 4 != 0) {
+		ret.push_back('=');
+	}
+	return ret;
+}
+
+static std::vector<uint8_t> Base64Test_decode(StringView str) {
+	std::vector<uint8_t> ret;
+	uint32_t acc = 0;
+	size_t bits = 0;
+	for (auto &c : str) {
+		auto s1 = strchr(s_base64Alphabet, c);
+		auto s2 = strchr(s_base64UrlAlphabet, c);
+		if (c == 0 || (!s1 && !s2)) {
+			continue;
+		}
+		acc = (acc << 6) | uint32_t(s1 ? s1 - s_base64Alphabet : s2 - s_base64UrlAlphabet);
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			ret.push_back(uint8_t(acc >> bits));
+		}
+	}
+	return ret;
+}
+
+struct Base64Test : MemPoolTest {
+	Base64Test() : MemPoolTest("Base64Test") { }
+
+	virtual bool run(pool_t *pool) {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		std::vector<uint8_t> data; data.resize(1024 * 1024 + 7);
+		uint32_t seed = 1;
+		for (auto &it : data) {
+			seed = seed * 1103515245 + 12345;
+			it = uint8_t(seed >> 16);
+		}
+
+		runTest(stream, "Base64 encode", count, passed, [&] {
+			for (size_t len = 0; len < 200; ++ len) {
+				for (size_t offset = 0; offset < 4; ++ offset) {
+					BytesView v(data.data() + offset, len);
+					if (base64::encode<memory::StandartInterface>(v) != Base64Test_encode(v, s_base64Alphabet, true)
+							|| base64url::encode<memory::StandartInterface>(v) != Base64Test_encode(v, s_base64UrlAlphabet, false)) {
+						stream << "length: " << len;
+						return false;
+					}
+
+					std::ostringstream out;
+					base64url::encode(out, v);
+					if (out.str() != Base64Test_encode(v, s_base64UrlAlphabet, false)) {
+						return false;
+					}
+				}
+			}
+
+			std::ostringstream out;
+			base64::encode(out, BytesView(data));
+			char buf[10];
+			return out.str() == Base64Test_encode(BytesView(data), s_base64Alphabet, true)
+					&& base64::encode(buf, 10, BytesView(data)) == 8 && StringView(buf, 8) == StringView(out.str()).sub(0, 8);
+		});
+
+		runTest(stream, "Base64 decode", count, passed, [&] {
+			for (size_t len = 0; len < 200; ++ len) {
+				auto str = Base64Test_encode(BytesView(data.data(), len), s_base64Alphabet, true);
+				auto url = Base64Test_encode(BytesView(data.data(), len), s_base64UrlAlphabet, false);
+				if (base64::decode<memory::StandartInterface>(CoderSource(str)) != Base64Test_decode(str)
+						|| base64url::decode<memory::StandartInterface>(CoderSource(url)) != Base64Test_decode(url)) {
+					stream << "length: " << len;
+					return false;
+				}
+
+				// chars outside of alphabet should be ignored
+				std::string broken;
+				for (size_t i = 0; i < str.size(); ++ i) {
+					broken.push_back(str[i]);
+					if (i % 7 == 3) { broken.append("\r\n"); }
+				}
+				if (base64::decode<memory::StandartInterface>(CoderSource(broken)) != Base64Test_decode(broken)) {
+					stream << "broken length: " << len;
+					return false;
+				}
+			}
+
+			auto str = Base64Test_encode(BytesView(data), s_base64Alphabet, true);
+			std::string lines;
+			for (size_t i = 0; i < str.size(); i += 76) {
+				lines.append(str.data() + i, std::min(size_t(76), str.size() - i));
+				lines.append("\r\n");
+			}
+
+			std::ostringstream out;
+			base64::decode(out, CoderSource(lines));
+			auto s = out.str();
+
+			uint8_t buf[5];
+			return std::vector<uint8_t>(s.begin(), s.end()) == data
+					&& base64::decode(buf, 5, CoderSource(str)) == 5 && memcmp(buf, data.data(), 5) == 0;
+		});
+
+		runTest(stream, "Base16", count, passed, [&] {
+			for (size_t len = 0; len < 100; ++ len) {
+				BytesView v(data.data() + 1, len);
+				std::string ref;
+				for (size_t i = 0; i < v.size(); ++ i) {
+					ref.append(base16::charToHex(char(v[i])), 2);
+				}
+
+				auto enc = base16::encode<memory::StandartInterface>(v);
+				std::string upper(enc); string::toupper_buf(upper.data(), upper.size());
+				auto dec = base16::decode<memory::StandartInterface>(CoderSource(upper));
+				if (enc != ref || dec != std::vector<uint8_t>(v.data(), v.data() + v.size())) {
+					stream << "length: " << len;
+					return false;
+				}
+			}
+
+			std::ostringstream out;
+			base16::encode(out, BytesView(data));
+			std::ostringstream dec;
+			base16::decode(dec, CoderSource(out.str()));
+			auto s = dec.str();
+			return std::vector<uint8_t>(s.begin(), s.end()) == data;
+		});
+
+		runTest(stream, "Codecs throughput", count, passed, [&] {
+			BytesView v(data);
+			auto reference = Time::now();
+			auto refStr = Base64Test_encode(v, s_base64Alphabet, true);
+			auto refDec = Base64Test_decode(refStr);
+			auto refTime = Time::now() - reference;
+
+			auto t = Time::now();
+			auto str = base64::encode<memory::StandartInterface>(v);
+			auto base64Enc = Time::now() - t;
+
+			t = Time::now();
+			auto dec = base64::decode<memory::StandartInterface>(CoderSource(str));
+			auto base64Dec = Time::now() - t;
+
+			t = Time::now();
+			auto hex = base16::encode<memory::StandartInterface>(v);
+			auto base16Enc = Time::now() - t;
+
+			t = Time::now();
+			auto hexDec = base16::decode<memory::StandartInterface>(CoderSource(hex));
+			auto base16Dec = Time::now() - t;
+
+			stream << v.size() << " bytes; reference: " << refTime.toMicroseconds()
+					<< "; base64: " << base64Enc.toMicroseconds() << " / " << base64Dec.toMicroseconds()
+					<< "; base16: " << base16Enc.toMicroseconds() << " / " << base16Dec.toMicroseconds();
+			return str == refStr && dec == data && hexDec == data && refDec == data;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _Base64Test;
+
+NS_SP_END
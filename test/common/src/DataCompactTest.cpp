@@ -0,0 +1,166 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPData.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct DataCompactTest : MemPoolTest {
+	DataCompactTest() : MemPoolTest("DataCompactTest") { }
+
+	data::Value makePayload(size_t count) {
+		data::Value ret;
+		auto &items = ret.emplace("items");
+		for (size_t i = 0; i < count; ++ i) {
+			auto &item = items.emplace();
+			item.setInteger(int64_t(i), "id");
+			item.setDouble(i * 0.5, "score");
+			item.setBool(i % 2 == 0, "active");
+			item.setString(toString("user", i), "name");
+			item.setString(toString("https://example.org/users/", i, "/profile"), "url");
+			auto &tags = item.emplace("tags");
+			tags.addString("one");
+			tags.addString("two");
+		}
+		ret.setInteger(int64_t(count), "total");
+		ret.setBytes(Bytes{1, 2, 3, 4}, "meta");
+		return ret;
+	}
+
+	virtual bool run(pool_t *pool) {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		auto source = makePayload(10);
+
+		runTest(stream, "Convert", count, passed, [&] {
+			data::CompactValue compact(source);
+			return compact.toValue() == source && compact.getValue("items").size() == 10
+					&& compact.getValue("items").getValue(size_t(3)).getValue("name").getString() == "user3"
+					&& compact.getValue("items").getValue(size_t(3)).getValue("url").getString() == "https://example.org/users/3/profile"
+					&& compact.getValue("meta").getBytes() == BytesView(source.getBytes("meta"))
+					&& !compact.hasValue("unknown");
+		});
+
+		runTest(stream, "Builder", count, passed, [&] {
+			data::CompactValue::Builder builder;
+			builder.beginDict();
+			builder.key("b");
+			builder.beginArray();
+			builder.value(int64_t(1));
+			builder.value(StringView("long string value"));
+			builder.end();
+			builder.key("a");
+			builder.value(true);
+			builder.end();
+
+			auto compact = builder.finalize();
+			return compact.getKeysCount() == 2 && compact.getValue("a").getBool()
+					&& data::json::write(compact) == "{\"a\":true,\"b\":[1,\"long string value\"]}";
+		});
+
+		runTest(stream, "Encode", count, passed, [&] {
+			data::CompactValue compact(source);
+			return data::json::write(compact) == data::json::write(source)
+					&& data::cbor::write(compact) == data::cbor::write(source)
+					&& data::serenity::write(compact) == data::serenity::write(source);
+		});
+
+		runTest(stream, "Decode", count, passed, [&] {
+			// serenity format can not represent array of dictionaries within dictionary, so, it's tested with
+			// value, that survives round trip
+			data::Value flat;
+			flat.setString("user", "name");
+			flat.setString("https://example.org/users/1/profile", "url");
+			auto &tags = flat.emplace("tags");
+			tags.addString("one");
+			tags.addString("two");
+			auto &nested = flat.emplace("nested");
+			nested.setInteger(1, "id");
+			nested.setBool(true, "active");
+			flat.setInteger(2, "total");
+
+			auto json = data::readCompact(data::json::write(source));
+			auto cbor = data::readCompact(data::cbor::write(source));
+			auto serenity = data::readCompact(data::serenity::write(flat));
+			return json.toValue() == data::json::read<memory::DefaultInterface>(data::json::write(source))
+					&& cbor.toValue() == source
+					&& serenity.toValue() == flat;
+		});
+
+		runTest(stream, "Benchmark", count, passed, [&] {
+			auto payload = makePayload(100000);
+			auto cbor = data::cbor::write(payload);
+
+			memory::pool::clear(pool);
+			auto poolValue = payload.convert<memory::PoolInterface>();
+			auto treeBytes = memory::pool::get_allocated_bytes(pool);
+
+			auto t = Time::now();
+			data::CompactValue compact(payload);
+			auto convertTime = Time::now() - t;
+
+			t = Time::now();
+			int64_t treeSum = 0;
+			for (auto &it : payload.getArray("items")) {
+				treeSum += it.getInteger("id") + it.getString("name").size() + it.getArray("tags").size();
+			}
+			auto treeTime = Time::now() - t;
+
+			t = Time::now();
+			int64_t compactSum = 0;
+			for (auto it : compact.getValue("items")) {
+				compactSum += it.getValue("id").getInteger() + it.getValue("name").getString().size() + it.getValue("tags").size();
+			}
+			auto compactTime = Time::now() - t;
+
+			t = Time::now();
+			auto treeRead = data::read(cbor);
+			auto treeReadTime = Time::now() - t;
+
+			t = Time::now();
+			auto compactRead = data::readCompact(cbor);
+			auto compactReadTime = Time::now() - t;
+
+			stream << "memory: " << treeBytes << " (tree) " << compact.getMemoryUsage() << " (compact);"
+					<< " convert: " << convertTime.toMicroseconds() << ";"
+					<< " traverse: " << treeTime.toMicroseconds() << " (tree) " << compactTime.toMicroseconds() << " (compact);"
+					<< " read: " << treeReadTime.toMicroseconds() << " (tree) " << compactReadTime.toMicroseconds() << " (compact)";
+
+			return treeSum == compactSum && poolValue.size() == compact.size() && compactRead.getNodesCount() == compact.getNodesCount();
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _DataCompactTest;
+
+NS_SP_END
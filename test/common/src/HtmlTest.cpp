@@ -0,0 +1,127 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPHtmlParser.h"
+#include "SPTime.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct HtmlTest : Test {
+	HtmlTest() : Test("HtmlTest") { }
+
+	template <typename StringReader>
+	struct CountReader {
+		using Parser = html::Parser<CountReader, StringReader>;
+		using Tag = typename Parser::Tag;
+
+		inline void onBeginTag(Parser &p, Tag &tag) { ++ tags; }
+		inline void onTagAttribute(Parser &p, Tag &tag, StringReader &name, StringReader &value) { ++ attrs; }
+		inline void onTagContent(Parser &p, Tag &tag, StringReader &s) { text += s.size(); }
+
+		size_t tags = 0;
+		size_t attrs = 0;
+		size_t text = 0;
+	};
+
+	struct CountTokenReader {
+		using Tokenizer = html::Tokenizer<CountTokenReader>;
+		using StringReader = Tokenizer::StringReader;
+		using TagReader = Tokenizer::TagReader;
+
+		inline void onText(Tokenizer &, StringReader &s) { text += s.size(); }
+		inline void onTag(Tokenizer &, StringReader &name, TagReader &tag) {
+			StringReader attrName, attrValue;
+			while (tag.readAttribute(attrName, attrValue)) {
+				++ attrs;
+			}
+			++ tags;
+		}
+
+		size_t tags = 0;
+		size_t attrs = 0;
+		size_t text = 0;
+	};
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		String page(
+			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<html xmlns=\"http://www.w3.org/1999/xhtml\"><head><title>Глава 1</title>"
+			"<style type=\"text/css\">p > a { color: red }</style></head>\n"
+			"<body class=\"chapter\"><!-- comment <p> --><h1 id=\"ch1\">Глава первая</h1>\n"
+			"<p class=\"text\">Съешь же ещё этих мягких французских булок, да выпей чаю. "
+			"The quick brown fox jumps over the lazy dog.<br/><img src=\"img.png\" alt='image'/></p>\n"
+			"<p>Text with <b>bold</b>, <i>italic</i> and <a href=\"#ch1\">link</a>.</p>"
+			"<![CDATA[ raw <data> ]]></body></html>\n");
+
+		String corpus;
+		while (corpus.size() < 16 * 1024 * 1024) {
+			corpus.append(page);
+		}
+
+		size_t pages = corpus.size() / page.size();
+
+		runTest(stream, "ParserUtf8", count, passed, [&] {
+			String data(corpus);
+			CountReader<StringViewUtf8> r;
+			auto t = Time::now();
+			html::parse(r, StringViewUtf8(data.data(), data.size()), false);
+			stream << (Time::now() - t).toMicroseconds() << " " << r.tags << " " << r.attrs << " " << r.text;
+			return r.tags == pages * 13 && r.attrs == pages * 8;
+		});
+
+		runTest(stream, "ParserChar", count, passed, [&] {
+			String data(corpus);
+			CountReader<StringView> r;
+			auto t = Time::now();
+			html::parse(r, StringView(data), false);
+			stream << (Time::now() - t).toMicroseconds() << " " << r.tags << " " << r.attrs << " " << r.text;
+			return r.tags == pages * 13 && r.attrs == pages * 8;
+		});
+
+		runTest(stream, "Tokenizer", count, passed, [&] {
+			String data(corpus);
+			CountTokenReader r;
+			CountTokenReader::Tokenizer tokenizer(r);
+			auto t = Time::now();
+			tokenizer.tokenize(StringViewUtf8(data.data(), data.size()));
+			stream << (Time::now() - t).toMicroseconds() << " " << r.tags << " " << r.attrs << " " << r.text;
+			return r.tags == pages * 13 && r.attrs == pages * 8;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+
+} _HtmlTest;
+
+NS_SP_END
@@ -0,0 +1,174 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPFilesystem.h"
+#include "SPLog.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct AsyncLogTest : Test {
+	AsyncLogTest() : Test("AsyncLogTest") { }
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		auto path = filesystem::currentDir("async.log");
+		filesystem::remove(path);
+
+		runTest(stream, "Deferred", count, passed, [&] {
+			log::AsyncLog::Config cfg;
+			cfg.path = path;
+			cfg.deferFormat = true;
+			cfg.policy = log::AsyncLog::Policy::Block;
+
+			log::AsyncLog asyncLog(cfg);
+			if (!asyncLog.isActive() || log::AsyncLog::getInstance() != &asyncLog) {
+				return false;
+			}
+
+			std::vector<std::thread> threads;
+			for (size_t i = 0; i < 4; ++ i) {
+				threads.emplace_back([i] {
+					for (size_t j = 0; j < 1000; ++ j) {
+						log::format("Test", "%zu:%04zu %s %.2f %-3d|%*s|%.*s", i, j, "text", 0.5, -1, 3, "x", 2, "abcd");
+					}
+				});
+			}
+			for (auto &it : threads) {
+				it.join();
+			}
+
+			asyncLog.flush();
+
+			auto stats = asyncLog.getStats();
+			auto data = filesystem::readTextFile(path);
+			stream << stats.written << " " << stats.dropped << " " << stats.blocked;
+
+			return stats.written == 4000 && stats.dropped == 0
+					&& data.find("[Test] 2:0999 text 0.50 -1 |  x|ab\n") != String::npos;
+		});
+
+		runTest(stream, "Drop", count, passed, [&] {
+			log::AsyncLog::Config cfg;
+			cfg.path = path;
+			cfg.bufferSize = 4_KiB;
+			cfg.flushInterval = TimeInterval::seconds(10);
+
+			log::AsyncLog asyncLog(cfg);
+			for (size_t j = 0; j < 1000; ++ j) {
+				log::vtext("Test", "message ", j);
+			}
+			asyncLog.flush();
+
+			auto stats = asyncLog.getStats();
+			stream << stats.written << " " << stats.dropped;
+			return stats.written + stats.dropped == 1000;
+		});
+
+		runTest(stream, "Rotate", count, passed, [&] {
+			log::AsyncLog::Config cfg;
+			cfg.path = path;
+			cfg.maxFileSize = 1_KiB;
+			cfg.maxFiles = 2;
+			cfg.policy = log::AsyncLog::Policy::Block;
+
+			log::AsyncLog asyncLog(cfg);
+			for (size_t j = 0; j < 100; ++ j) {
+				log::vtext("Test", "message ", j);
+				if (j % 10 == 0) {
+					asyncLog.flush();
+				}
+			}
+			asyncLog.flush();
+
+			return filesystem::exists(toString(path, ".1")) && filesystem::exists(toString(path, ".2"))
+					&& !filesystem::exists(toString(path, ".3"));
+		});
+
+		runTest(stream, "Restart", count, passed, [&] {
+			static std::atomic<size_t> s_calls;
+
+			// keeps default log quiet, while async log is not active
+			log::CustomLog quiet([] (const StringView &, log::CustomLog::Type, log::CustomLog::VA &) { });
+
+			std::atomic<bool> done(false);
+			std::vector<std::thread> threads;
+			for (size_t i = 0; i < 4; ++ i) {
+				threads.emplace_back([&done] {
+					while (!done.load()) {
+						log::format("Test", "%s %d", "message", 1);
+					}
+				});
+			}
+
+			// hook should not be called after it was removed, async log data is released while threads are logging
+			bool success = true;
+			for (size_t i = 0; i < 20; ++ i) {
+				{
+					log::AsyncLog::Config cfg;
+					cfg.path = path;
+					log::AsyncLog asyncLog(cfg);
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				s_calls.store(0);
+				{
+					log::CustomLog counter([] (const StringView &, log::CustomLog::Type, log::CustomLog::VA &) {
+						++ s_calls;
+					});
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				auto calls = s_calls.load();
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				if (calls == 0 || s_calls.load() != calls) {
+					success = false;
+				}
+			}
+
+			done.store(true);
+			for (auto &it : threads) {
+				it.join();
+			}
+
+			return success;
+		});
+
+		filesystem::remove(path);
+		filesystem::remove(toString(path, ".1"));
+		filesystem::remove(toString(path, ".2"));
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _AsyncLogTest;
+
+NS_SP_END
@@ -89,6 +89,122 @@ struct MemMapTest : MemPoolTest {
 			return data.find(&vec) != data.end() && data.find(&vec2) != data.end();
 		});
 
+		runTest(stream, "slab churn test", count, passed, [&] {
+			// erase and reinsert half of keys, without slab cache every reinsert takes new node from pool
+			auto churn = [&] (bool slab, size_t &bytes, TimeInterval &time) {
+				auto p = memory::pool::create(pool);
+				memory::pool::context<pool_t *> ctx(p);
+
+				auto initial = memory::pool::get_allocated_bytes(p);
+				auto t = Time::now();
+
+				memory::map<size_t, size_t> data;
+				data.set_slab_allocation(slab);
+				for (size_t i = 0; i < 1024; ++ i) {
+					data.emplace(i, i);
+				}
+
+				for (size_t round = 0; round < 64; ++ round) {
+					for (size_t i = round % 2; i < 1024; i += 2) {
+						data.erase(i);
+					}
+					for (size_t i = round % 2; i < 1024; i += 2) {
+						data.emplace(i, i + round);
+					}
+				}
+
+				time = Time::now() - t;
+				bytes = memory::pool::get_allocated_bytes(p) - initial;
+
+				bool success = data.size() == 1024 && data.is_slab_allocation() == slab;
+				for (auto &it : data) {
+					if (it.second != it.first + (it.first % 2 ? 63 : 62)) {
+						success = false;
+					}
+				}
+
+				ctx.pop();
+				memory::pool::destroy(p);
+				return success;
+			};
+
+			size_t slabBytes = 0, poolBytes = 0;
+			TimeInterval slabTime, poolTime;
+			auto slabSuccess = churn(true, slabBytes, slabTime);
+			auto poolSuccess = churn(false, poolBytes, poolTime);
+
+			stream << "slab: " << slabBytes << " bytes " << slabTime.toMicroseconds() << " us; pool: "
+					<< poolBytes << " bytes " << poolTime.toMicroseconds() << " us";
+
+			return slabSuccess && poolSuccess && slabBytes * 8 < poolBytes;
+		});
+
+		runTest(stream, "slab move test", count, passed, [&] {
+			// moved tree should keep slab mode, otherwise erased nodes of moved tree are not reused
+			auto p = memory::pool::create(pool);
+			memory::pool::context<pool_t *> ctx(p);
+
+			memory::map<size_t, size_t> source;
+			source.set_slab_allocation(true);
+			for (size_t i = 0; i < 1024; ++ i) {
+				source.emplace(i, i);
+			}
+
+			memory::map<size_t, size_t> moved(std::move(source));
+			memory::map<size_t, size_t> assigned;
+			assigned = std::move(moved);
+
+			auto initial = memory::pool::get_allocated_bytes(p);
+			for (size_t round = 0; round < 64; ++ round) {
+				for (size_t i = 0; i < 1024; i += 2) {
+					assigned.erase(i);
+				}
+				for (size_t i = 0; i < 1024; i += 2) {
+					assigned.emplace(i, i + round);
+				}
+			}
+			auto bytes = memory::pool::get_allocated_bytes(p) - initial;
+
+			// without node reuse every round allocates 512 new nodes
+			bool success = assigned.is_slab_allocation() && assigned.size() == 1024 && assigned.at(0) == 63
+					&& bytes * 8 < 64 * 512 * sizeof(Pair<size_t, size_t>);
+
+			stream << " move: " << bytes << " bytes";
+
+			ctx.pop();
+			memory::pool::destroy(p);
+			return success;
+		});
+
+		runTest(stream, "slab value test", count, passed, [&] {
+			auto p = memory::pool::create(pool);
+			memory::pool::context<pool_t *> ctx(p);
+
+			Value val;
+			for (size_t i = 0; i < 256; ++ i) {
+				val.setInteger(int64_t(i), StringView(std::to_string(i)));
+			}
+
+			auto initial = memory::pool::get_allocated_bytes(p);
+			for (size_t round = 0; round < 16; ++ round) {
+				for (size_t i = 0; i < 256; i += 2) {
+					val.erase(StringView(std::to_string(i)));
+				}
+				for (size_t i = 0; i < 256; i += 2) {
+					val.setInteger(int64_t(i + round), StringView(std::to_string(i)));
+				}
+			}
+			auto bytes = memory::pool::get_allocated_bytes(p) - initial;
+
+			bool success = val.asDict().is_slab_allocation() && val.size() == 256
+					&& val.getInteger("0") == 15 && val.getInteger("1") == 1;
+
+			stream << " value: " << bytes << " bytes";
+
+			ctx.pop();
+			memory::pool::destroy(p);
+			return success;
+		});
 
 		_desc = stream.str();
 
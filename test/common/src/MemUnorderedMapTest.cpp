@@ -0,0 +1,215 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+#include "SPCommon.h"
+#include "SPString.h"
+#include "SPData.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+template <typename Map>
+static bool MemUnorderedMapTest_churn(size_t seed) {
+	// random inserts and erases, checked against memory::map
+	memory::map<size_t, size_t> reference;
+	Map data;
+
+	uint64_t state = seed;
+	auto next = [&] {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return size_t(state >> 33);
+	};
+
+	for (size_t i = 0; i < 20000; ++ i) {
+		auto key = next() % 2048;
+		if (next() % 3 == 0) {
+			if (reference.erase(key) != data.erase(key)) {
+				return false;
+			}
+		} else {
+			reference.emplace(key, i);
+			data.emplace(key, i);
+		}
+	}
+
+	if (reference.size() != data.size()) {
+		return false;
+	}
+
+	for (auto &it : reference) {
+		auto v = data.find(it.first);
+		if (v == data.end() || v->second != it.second) {
+			return false;
+		}
+	}
+
+	for (auto &it : data) {
+		if (reference.find(it.first) == reference.end()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct MemUnorderedMapTest : MemPoolTest {
+	MemUnorderedMapTest() : MemPoolTest("MemUnorderedMapTest") { }
+
+	virtual bool run(pool_t *pool) {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		runTest(stream, "churn test", count, passed, [&] {
+			return MemUnorderedMapTest_churn<memory::unordered_map<size_t, size_t>>(1)
+					&& MemUnorderedMapTest_churn<memory::unordered_map<size_t, size_t, std::hash<size_t>, std::equal_to<>, memory::HashTableFlags::Ordered>>(2)
+					&& MemUnorderedMapTest_churn<memory::unordered_map<size_t, size_t, std::hash<size_t>, std::equal_to<>, memory::HashTableFlags::Stable>>(3)
+					&& MemUnorderedMapTest_churn<memory::unordered_map<size_t, size_t, std::hash<size_t>, std::equal_to<>,
+						memory::HashTableFlags::Stable | memory::HashTableFlags::Ordered>>(4);
+		});
+
+		runTest(stream, "stable references", count, passed, [&] {
+			memory::unordered_map<size_t, String, std::hash<size_t>, std::equal_to<>, memory::HashTableFlags::Stable> data;
+			auto first = &data.emplace(0, "zero").first->second;
+			for (size_t i = 1; i < 1000; ++ i) {
+				data.emplace(i, String(std::to_string(i).data()));
+			}
+			for (size_t i = 1; i < 1000; i += 2) {
+				data.erase(i);
+			}
+			return first == &data.find(0)->second && *first == "zero" && data.size() == 500;
+		});
+
+		runTest(stream, "heterogeneous lookup", count, passed, [&] {
+			memory::unordered_map<String, size_t> data{
+				pair(String("One"), 1), pair(String("Two"), 2), pair(String("Three"), 3)
+			};
+
+			auto it = data.find(StringView("Two"));
+			return it != data.end() && it->second == 2 && data.count("Three") == 1
+					&& data.contains("One") && !data.contains(StringView("Four"))
+					&& data.erase(StringView("One")) == 1 && data.size() == 2;
+		});
+
+		runTest(stream, "insertion order", count, passed, [&] {
+			memory::unordered_map<String, size_t, memory::string_hash, std::equal_to<>, memory::HashTableFlags::Ordered> data;
+			for (size_t i = 0; i < 100; ++ i) {
+				data.emplace(String(std::to_string(i).data()), i);
+			}
+			for (size_t i = 0; i < 100; i += 3) {
+				data.erase(String(std::to_string(i).data()));
+			}
+			data["100"] = 100;
+
+			size_t prev = 0;
+			bool success = true;
+			for (auto &it : data) {
+				if (it.second % 3 == 0 && it.second != 99 && it.second != 100) {
+					success = false;
+				}
+				if (it.second < prev) {
+					success = false;
+				}
+				prev = it.second;
+			}
+			return success && data.size() == 67 && data.at("100") == 100;
+		});
+
+		runTest(stream, "copy and move", count, passed, [&] {
+			memory::unordered_map<size_t, String> data;
+			for (size_t i = 0; i < 64; ++ i) {
+				data.emplace(i, String(std::to_string(i).data()));
+			}
+
+			memory::unordered_map<size_t, String> copy(data);
+			memory::unordered_map<size_t, String> moved(std::move(copy));
+
+			return moved == data && copy.empty() && moved.find(42)->second == "42";
+		});
+
+		runTest(stream, "set test", count, passed, [&] {
+			memory::unordered_set<String> data{ "One", "Two", "Three" };
+			data.emplace("Two");
+			data.emplace("Four");
+			data.erase(StringView("One"));
+
+			return data.size() == 3 && data.contains(StringView("Four")) && !data.contains("One")
+					&& *data.find(StringView("Three")) == "Three";
+		});
+
+		runTest(stream, "lookup benchmark", count, passed, [&] {
+			Vector<String> keys;
+			for (size_t i = 0; i < 4096; ++ i) {
+				keys.emplace_back(String(toString("field_", i * 7919).data()));
+			}
+
+			memory::map<String, size_t> tree;
+			memory::unordered_map<String, size_t> table;
+			std::unordered_map<std::string, size_t> stdTable;
+			for (size_t i = 0; i < keys.size(); ++ i) {
+				tree.emplace(keys[i], i);
+				table.emplace(keys[i], i);
+				stdTable.emplace(std::string(keys[i].data(), keys[i].size()), i);
+			}
+
+			size_t treeSum = 0, tableSum = 0, stdSum = 0;
+
+			auto t = Time::now();
+			for (size_t r = 0; r < 32; ++ r) {
+				for (auto &it : keys) {
+					treeSum += tree.find(StringView(it))->second;
+				}
+			}
+			auto treeTime = Time::now() - t;
+
+			t = Time::now();
+			for (size_t r = 0; r < 32; ++ r) {
+				for (auto &it : keys) {
+					tableSum += table.find(StringView(it))->second;
+				}
+			}
+			auto tableTime = Time::now() - t;
+
+			t = Time::now();
+			for (size_t r = 0; r < 32; ++ r) {
+				for (auto &it : keys) {
+					// std::unordered_map has no heterogeneous lookup in C++17
+					stdSum += stdTable.find(std::string(it.data(), it.size()))->second;
+				}
+			}
+			auto stdTime = Time::now() - t;
+
+			stream << keys.size() << " keys; map: " << treeTime.toMicroseconds() << " us; unordered_map: "
+					<< tableTime.toMicroseconds() << " us; std::unordered_map: " << stdTime.toMicroseconds() << " us";
+
+			return treeSum == tableSum && tableSum == stdSum;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _MemUnorderedMapTest;
+
+NS_SP_END
@@ -29,6 +29,7 @@ THE SOFTWARE.
 #include "Test.h"
 
 #include "SPSearchConfiguration.h"
+#include "SPSearchInvertedIndex.h"
 #include "SPUrl.h"
 
 NS_SP_BEGIN
@@ -159,6 +160,160 @@ struct SearchTest : MemPoolTest {
 			return false;
 		});
 
+		runTest(stream, "Search inverted index", count, passed, [&] {
+			search::Configuration cfg(search::Language::English);
+			search::InvertedIndex index(cfg);
+			index.setMergeFactor(2);
+
+			Vector<Pair<StringView, search::SearchData::Rank>> docs{
+				pair("The quick brown fox jumps over the lazy dog", search::SearchData::A),
+				pair("Lazy dogs are sleeping in the sun", search::SearchData::Unknown),
+				pair("A brown dog and a quick fox", search::SearchData::B),
+				pair("Foxes are quick, foxes are brown, foxes are everywhere", search::SearchData::Unknown),
+			};
+
+			int64_t id = 0;
+			for (auto &it : docs) {
+				index.add(++ id, it.first, it.second);
+				if (id != 2) {
+					index.commit();
+				}
+			}
+
+			if (index.getSegmentsCount() != 1 || index.getDocumentsCount() != 4) {
+				stream << "segments: " << index.getSegmentsCount() << " docs: " << index.getDocumentsCount();
+				return false;
+			}
+
+			auto check = [&] (search::InvertedIndex &idx, StringView query, std::initializer_list<int64_t> expected) {
+				auto ret = idx.performSearch(query);
+				std::set<int64_t> ids;
+				for (auto &it : ret) { ids.emplace(it.id); }
+				std::set<int64_t> matched;
+				auto q = cfg.parseQuery(query);
+				for (size_t i = 0; i < docs.size(); ++ i) {
+					search::Configuration::SearchVector vec;
+					cfg.makeSearchVector(vec, docs[i].first, docs[i].second);
+					if (cfg.isMatch(vec, q)) { matched.emplace(int64_t(i + 1)); }
+				}
+				if (ids != std::set<int64_t>(expected) || ids != matched) {
+					stream << "'" << query << "':";
+					for (auto &it : ret) { stream << " " << it.id; }
+					stream << ";";
+					return false;
+				}
+				return true;
+			};
+
+			auto test = [&] (search::InvertedIndex &idx) {
+				return check(idx, "quick fox", {1, 3, 4})
+					&& check(idx, "\"quick brown fox\"", {1})
+					&& check(idx, "\"quick fox\"", {3, 4})
+					&& check(idx, "dog !fox", {2})
+					&& check(idx, "!dog", {4})
+					&& check(idx, "sun | everywhere", {2, 4})
+					&& check(idx, "cat", {});
+			};
+
+			if (!test(index)) {
+				return false;
+			}
+
+			// document with most frequent term in high rank should be the first
+			auto ret = index.performSearch("fox");
+			if (ret.empty() || ret.front().id != 1) {
+				stream << "rank order;";
+				return false;
+			}
+
+			auto data = index.encode();
+			search::InvertedIndex loaded(cfg);
+			if (!loaded.load(data, false) || !test(loaded)) {
+				return false;
+			}
+
+			// segment with postings, that reference documents out of segment, should not be loaded
+			Bytes broken(data.data(), data.data() + data.size());
+			search::InvertedIndex::SegmentHeader header;
+			memcpy(&header, broken.data(), sizeof(header));
+			header.docs = 2;
+			memcpy(broken.data(), &header, sizeof(header));
+
+			search::InvertedIndex brokenIndex(cfg);
+			if (brokenIndex.load(broken, false)) {
+				stream << "broken segment is loaded;";
+				return false;
+			}
+
+			auto headline = loaded.makeHeadline(search::Configuration::HeadlineConfig(),
+					"The quick brown fox jumps over the lazy dog", cfg.parseQuery("fox !dog"));
+			if (headline.find("<b>fox</b>") == String::npos || headline.find("<b>dog</b>") != String::npos) {
+				stream << headline;
+				return false;
+			}
+
+			return true;
+		});
+
+		// Compares makeSearchVector over the same corpus with stem cache disabled and enabled; timings are
+		// meaningful only for optimized build:
+		//   make -C test/common host-release LOCAL_OPTIMIZATION=-O2
+		//   sptest SearchTest
+		runTest(stream, "Search stem cache", count, passed, [&] {
+			static StringView s_words[] = {
+				"the", "search", "engines", "indexing", "of", "articles", "and", "documents", "is", "running",
+				"quickly", "with", "stemmed", "words", "for", "every", "language", "in", "cached", "results",
+				"building", "inverted", "indexes", "requires", "parsing", "html", "bodies", "into", "tokens", "which",
+				"are", "normalized", "before", "stemming", "they", "produce", "positions", "ranks", "queries", "matching",
+			};
+
+			// pseudo-random article bodies with natural-like word repetition
+			Vector<String> corpus;
+			uint32_t seed = 1;
+			for (size_t i = 0; i < 100; ++ i) {
+				StringStream article;
+				for (size_t j = 0; j < 1000; ++ j) {
+					seed = seed * 1103515245 + 12345;
+					if (j % 100 == 0) { article << (j ? "</p><p>" : "<p>"); }
+					article << s_words[(seed >> 16) % (sizeof(s_words) / sizeof(StringView))] << " ";
+				}
+				article << "</p>";
+				auto str = article.str();
+				corpus.emplace_back(str.data(), str.size());
+			}
+
+			search::Configuration cfg(search::Language::English);
+			auto run = [&] (size_t cacheSize, Vector<search::Configuration::String> &results) {
+				search::setStemCacheSize(cacheSize);
+				auto t = Time::now();
+				for (auto &it : corpus) {
+					search::Configuration::SearchVector vec;
+					size_t counter = 0;
+					search::parseHtml(it, [&] (StringView str) {
+						counter = cfg.makeSearchVector(vec, str, search::SearchData::Rank::Unknown, counter);
+					});
+					results.emplace_back(cfg.encodeSearchVector(vec));
+				}
+				return Time::now() - t;
+			};
+
+			Vector<search::Configuration::String> uncached;
+			Vector<search::Configuration::String> cached;
+			auto uncachedTime = run(0, uncached);
+			auto cachedTime = run(search::StemCacheDefaultSize, cached);
+
+			size_t stemmed = 0;
+			Vector<StringView> batch{ "running", "indexes", "running", "the", "indexes", "runs" };
+			cfg.stemWords(batch, search::ParserToken::AsciiWord, [&] (StringView word, StringView stem, search::ParserToken) {
+				++ stemmed;
+			});
+
+			stream << "corpus: " << uncachedTime.toMicroseconds() << " (uncached) " << cachedTime.toMicroseconds() << " (cached)";
+
+			return uncached == cached && stemmed == 3 && search::isStopword("the", search::Language::English)
+					&& !search::isStopword("search", search::Language::English);
+		});
+
 		/*runTest(stream, "Search parser offset", count, passed, [&] {
 			auto str = StringView("-1.234e56 -1.234 -1234 1234 8.3.0 &amp; a_nichkov@mail.ru");
 
@@ -114,4 +114,88 @@ struct SqlTest : Test {
 
 } _SqlTest;
 
+struct SqlShapeTest : Test {
+	SqlShapeTest() : Test("SqlShapeTest") { }
+
+	virtual bool run() override {
+		using namespace sql;
+		using Query = sql::Query<SimpleBinder>;
+
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+		size_t ntests = 10000;
+
+		Vector<StringView> fields{"__oid", "name", "mtime", "ctime", "data", "owner", "alias"};
+
+		auto buildQuery = [&] (Query &q, const Query::RawStringView &id) {
+			auto sel = q.select();
+			for (auto &it : fields) {
+				sel.field(it);
+			}
+			sel.from("objects").where("__oid", Comparation::Equal, id).finalize();
+		};
+
+		auto makeKey = [&] {
+			QueryShapeKey key;
+			key.add("select-by-id").add("objects");
+			for (auto &it : fields) {
+				key.add(it);
+			}
+			return key.get();
+		};
+
+		runTest(stream, "BuildQuery", count, passed, [&] {
+			size_t len = 0;
+			auto t = Time::now();
+			for (size_t i = 0; i < ntests; ++i) {
+				Query q;
+				auto id = toString(i);
+				buildQuery(q, Query::RawStringView{id});
+				len += q.getStream().str().size();
+			}
+			stream << (Time::now() - t).toMicroseconds() << " " << len;
+			return len > 0;
+		});
+
+		runTest(stream, "ShapedQuery", count, passed, [&] {
+			QueryShapeCache cache;
+			size_t len = 0;
+			auto t = Time::now();
+			for (size_t i = 0; i < ntests; ++i) {
+				Query q;
+				Vector<String> params;
+				auto key = makeKey();
+				if (auto shape = cache.get(key)) {
+					q.setShape(shape);
+				} else {
+					buildQuery(q, Query::RawStringView{"$1"});
+					q.setShape(cache.emplace(key, q.getStream().str(), 1));
+				}
+				params.emplace_back(toString(i));
+				len += q.getShape()->text.size();
+			}
+			stream << (Time::now() - t).toMicroseconds() << " " << len;
+			return cache.size() == 1;
+		});
+
+		runTest(stream, "ShapeText", count, passed, [&] {
+			QueryShapeCache cache;
+			Query q;
+			buildQuery(q, Query::RawStringView{"$1"});
+			auto shape = cache.emplace(makeKey(), q.getStream().str(), 1);
+			stream << shape->text;
+			return shape == cache.get(makeKey())
+				&& shape->text == "SELECT \"__oid\", \"name\", \"mtime\", \"ctime\", \"data\", \"owner\", \"alias\" FROM objects WHERE(\"__oid\"=$1);"
+				&& QueryShapeKey().add("ab").add("c").get() != QueryShapeKey().add("a").add("bc").get();
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+
+} _SqlShapeTest;
+
 NS_SP_END
@@ -0,0 +1,86 @@
+/**
+Copyright (c) 2019 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPThreadTaskQueue.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+struct TaskQueueTest : Test {
+	TaskQueueTest() : Test("TaskQueueTest") { }
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		// every task is queued when workers are likely going to sleep; lost notification leaves task in queue
+		runTest(stream, "Wakeup", count, passed, [&] {
+			auto queue = Rc<thread::TaskQueue>::alloc(2);
+			queue->spawnWorkers();
+
+			bool ret = true;
+			std::atomic<size_t> executed = 0;
+			for (size_t i = 0; i < 2000 && ret; ++ i) {
+				queue->perform(Rc<thread::Task>::create([&] (const thread::Task &) -> bool {
+					++ executed;
+					return true;
+				}));
+
+				auto deadline = Time::now() + TimeInterval::seconds(2);
+				while (executed.load() != i + 1) {
+					if (Time::now() > deadline) {
+						stream << "task " << i << " was not executed;";
+						queue->finalize(); // workers should not sleep any more, so queue can be drained
+						ret = false;
+						break;
+					}
+					std::this_thread::yield();
+				}
+			}
+
+			queue->waitForAll();
+			queue->cancelWorkers();
+			return ret;
+		});
+
+		// workers are released right after start, before or while they are going to sleep;
+		// lost notification makes cancelWorkers wait for worker forever
+		runTest(stream, "Early release", count, passed, [&] {
+			for (size_t i = 0; i < 200; ++ i) {
+				auto queue = Rc<thread::TaskQueue>::alloc(4);
+				queue->spawnWorkers();
+				queue->cancelWorkers();
+			}
+			return true;
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _TaskQueueTest;
+
+NS_SP_END
@@ -0,0 +1,300 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+/**
+Copyright (c) 2018 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "SPCommon.h"
+#include "SPTime.h"
+#include "SPString.h"
+#include "Test.h"
+
+NS_SP_BEGIN
+
+// per-codepoint reference implementation, zero chars are decoded as is
+static memory::u16string UnicodeTest_toUtf16(StringView str) {
+	memory::u16string ret;
+	auto ptr = str.data();
+	auto end = ptr + str.size();
+	while (ptr < end) {
+		uint8_t offset = 0;
+		ret.push_back(unicode::utf8Decode(ptr, offset));
+		ptr += offset ? offset : 1;
+	}
+	return ret;
+}
+
+// case mapping is defined only for ascii and Russian alphabet
+static const char16_t * const s_uppercaseSet = u"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
+static const char16_t * const s_lowercaseSet = u"абвгдеёжзийклмнопрстуфхцчшщъыьэюя";
+
+static char16_t UnicodeTest_mapCase(char16_t c, const char16_t *from, const char16_t *to) {
+	if (c < 0x80) {
+		return (from == s_uppercaseSet) ? char16_t(::tolower(c)) : char16_t(::toupper(c));
+	}
+	for (size_t i = 0; from[i]; ++ i) {
+		if (from[i] == c) {
+			return to[i];
+		}
+	}
+	return c;
+}
+
+static memory::string UnicodeTest_toUtf8(WideStringView str) {
+	memory::string ret;
+	for (auto &it : str) {
+		unicode::utf8Encode(ret, it);
+	}
+	return ret;
+}
+
+struct UnicodeSimdTest : MemPoolTest {
+	UnicodeSimdTest() : MemPoolTest("UnicodeSimdTest") { }
+
+	virtual bool run(pool_t *pool) {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		static StringView s_words[] = {
+			"search", "Index", "DOCUMENT", "layout", "Font",
+			"поиск", "Индекс", "ДОКУМЕНТ", "шрифт", "Ёлка", "Ѓ", "ѐж",
+			"Ĺatin", "ÀÉÎÕÜ", "àéîõü", "Straße", "×÷",
+			"日本語", "中文", "한국어", "Ελληνικά",
+			"       ", "1234567890", ",.;!?",
+		};
+
+		// pseudo-random mixed-script corpus: mostly Latin and Cyrillic with some three-byte chars
+		Vector<memory::string> corpus;
+		uint32_t seed = 1;
+		for (size_t i = 0; i < 200; ++ i) {
+			memory::string text;
+			for (size_t j = 0; j < 500; ++ j) {
+				seed = seed * 1103515245 + 12345;
+				auto &word = s_words[(seed >> 16) % (sizeof(s_words) / sizeof(StringView))];
+				text.append(word.data(), word.size());
+				text.push_back(' ');
+			}
+			corpus.emplace_back(std::move(text));
+		}
+
+		runTest(stream, "Utf8 to utf16", count, passed, [&] {
+			for (auto &it : corpus) {
+				auto ref = UnicodeTest_toUtf16(it);
+				if (string::getUtf16Length(it) != ref.size() || string::toUtf16<memory::PoolInterface>(it) != ref) {
+					return false;
+				}
+
+				// all offsets to cover block boundaries
+				for (size_t i = 1; i < 64; ++ i) {
+					StringView r(it.data() + i, it.size() - i);
+					if (string::toUtf16<memory::PoolInterface>(r) != UnicodeTest_toUtf16(r)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Embedded zero chars", count, passed, [&] {
+			auto str = string::toUtf16<memory::PoolInterface>(StringView("ab\0cd", 5));
+			if (str.size() != 5 || str != WideStringView(u"ab\0cd", 5)) {
+				stream << "short string: " << str.size() << " chars;";
+				return false;
+			}
+
+			// zero chars in ascii, two-byte and mixed blocks
+			for (size_t i = 0; i < 16; ++ i) {
+				auto text = corpus[i];
+				for (size_t j = i; j < text.size(); j += 37) {
+					if (!unicode::isUtf8Surrogate(text[j])) {
+						text[j] = 0;
+					}
+				}
+				auto ref = UnicodeTest_toUtf16(text);
+				if (string::getUtf16Length(text) != ref.size() || string::toUtf16<memory::PoolInterface>(text) != ref) {
+					stream << "corpus string " << i << ";";
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Utf16 to utf8", count, passed, [&] {
+			for (auto &it : corpus) {
+				auto str = string::toUtf16<memory::PoolInterface>(it);
+				if (string::getUtf8Length(str) != it.size() || string::toUtf8<memory::PoolInterface>(str) != it) {
+					return false;
+				}
+
+				for (size_t i = 1; i < 32; ++ i) {
+					WideStringView r(str.data() + i, str.size() - i);
+					if (string::getUtf8Length(r) != UnicodeTest_toUtf8(r).size() || string::toUtf8<memory::PoolInterface>(r) != UnicodeTest_toUtf8(r)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Utf8 validation", count, passed, [&] {
+			for (auto &it : corpus) {
+				if (!string::isValidUtf8(it)) {
+					return false;
+				}
+			}
+
+			memory::string str("Проверка строки с испорченным символом в середине блока");
+			if (!string::isValidUtf8(str)) {
+				return false;
+			}
+			str[20] = 'x';
+			return !string::isValidUtf8(str);
+		});
+
+		runTest(stream, "Case folding", count, passed, [&] {
+			memory::string str("Latin ÀÉÎÕÜ ×, КИРИЛЛИЦА Ё Ѓ и ASCII: ABCxyz");
+			string::tolower_buf(str.data(), str.size());
+			if (str != "latin ÀÉÎÕÜ ×, кириллица ё Ѓ и ascii: abcxyz") {
+				stream << str;
+				return false;
+			}
+
+			string::toupper_buf(str.data(), str.size());
+			if (str != "LATIN ÀÉÎÕÜ ×, КИРИЛЛИЦА Ё Ѓ И ASCII: ABCXYZ") {
+				stream << str;
+				return false;
+			}
+
+			// every char of basic multilingual plane, as single chars and in vectorized blocks
+			memory::u16string all; all.reserve(0xD800);
+			for (char16_t c = 1; c < 0xD800; ++ c) {
+				all.push_back(c);
+				if (string::tolower(c) != UnicodeTest_mapCase(c, s_uppercaseSet, s_lowercaseSet)
+						|| string::toupper(c) != UnicodeTest_mapCase(c, s_lowercaseSet, s_uppercaseSet)) {
+					stream << "char " << uint32_t(c) << ";";
+					return false;
+				}
+			}
+
+			auto lowerAll = all;
+			string::tolower_buf(lowerAll.data(), lowerAll.size());
+			auto upperAll = all;
+			string::toupper_buf(upperAll.data(), upperAll.size());
+			for (size_t i = 0; i < all.size(); ++ i) {
+				if (lowerAll[i] != string::tolower(all[i]) || upperAll[i] != string::toupper(all[i])) {
+					stream << "buffer char " << uint32_t(all[i]) << ";";
+					return false;
+				}
+			}
+
+			auto allUtf8 = UnicodeTest_toUtf8(all);
+			auto lowerUtf8 = allUtf8;
+			string::tolower_buf(lowerUtf8.data(), lowerUtf8.size());
+			auto upperUtf8 = allUtf8;
+			string::toupper_buf(upperUtf8.data(), upperUtf8.size());
+			if (lowerUtf8 != UnicodeTest_toUtf8(lowerAll) || upperUtf8 != UnicodeTest_toUtf8(upperAll)) {
+				stream << "utf8 buffer;";
+				return false;
+			}
+
+			for (auto &it : corpus) {
+				auto w = string::toUtf16<memory::PoolInterface>(it);
+				auto lw = w;
+				for (auto &c : lw) { c = string::tolower(c); }
+				string::tolower_buf(w.data(), w.size());
+				if (w != lw) {
+					return false;
+				}
+
+				auto l = it;
+				string::tolower_buf(l.data(), l.size());
+				if (l != string::toUtf8<memory::PoolInterface>(lw)) {
+					return false;
+				}
+
+				for (auto &c : lw) { c = string::toupper(c); }
+				string::toupper_buf(w.data(), w.size());
+				if (w != lw) {
+					return false;
+				}
+
+				string::toupper_buf(l.data(), l.size());
+				if (l != string::toUtf8<memory::PoolInterface>(lw)) {
+					return false;
+				}
+			}
+			return true;
+		});
+
+		runTest(stream, "Transcoding benchmark", count, passed, [&] {
+			size_t bytes = 0;
+			Vector<memory::u16string> wide; wide.reserve(corpus.size());
+			Vector<memory::string> narrow; narrow.reserve(corpus.size());
+
+			auto t = Time::now();
+			for (auto &it : corpus) {
+				wide.emplace_back(UnicodeTest_toUtf16(it));
+				bytes += it.size();
+			}
+			auto refDecode = Time::now() - t;
+
+			t = Time::now();
+			for (auto &it : wide) {
+				narrow.emplace_back(UnicodeTest_toUtf8(it));
+			}
+			auto refEncode = Time::now() - t;
+
+			wide.clear(); narrow.clear();
+
+			t = Time::now();
+			for (auto &it : corpus) {
+				wide.emplace_back(string::toUtf16<memory::PoolInterface>(it));
+			}
+			auto decode = Time::now() - t;
+
+			t = Time::now();
+			for (auto &it : wide) {
+				narrow.emplace_back(string::toUtf8<memory::PoolInterface>(it));
+			}
+			auto encode = Time::now() - t;
+
+			t = Time::now();
+			for (auto &it : narrow) {
+				string::tolower_buf(it.data(), it.size());
+			}
+			auto lower = Time::now() - t;
+
+			stream << bytes << " bytes; decode: " << refDecode.toMicroseconds() << " -> " << decode.toMicroseconds()
+					<< "; encode: " << refEncode.toMicroseconds() << " -> " << encode.toMicroseconds()
+					<< "; tolower: " << lower.toMicroseconds();
+			return narrow.size() == corpus.size();
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _UnicodeSimdTest;
+
+NS_SP_END
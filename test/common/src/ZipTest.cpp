@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include "SPCommon.h"
 #include "SPZip.h"
 #include "SPFilesystem.h"
+#include "SPThreadTaskQueue.h"
 #include "Test.h"
 
 namespace stappler {
@@ -49,4 +50,163 @@ struct ZipTest : Test {
 	}
 } _ZipTest;
 
+// minimal reader: walks central directory and inflates every entry from local headers
+static bool ZipWriterTest_read(const std::string &zip, std::map<std::string, std::string> &files) {
+	auto u16 = [&] (size_t off) { return uint16_t(uint8_t(zip[off]) | (uint8_t(zip[off + 1]) << 8)); };
+	auto u32 = [&] (size_t off) { return uint32_t(u16(off) | (uint32_t(u16(off + 2)) << 16)); };
+
+	if (zip.size() < 22 || u32(zip.size() - 22) != 0x06054b50) {
+		return false;
+	}
+
+	size_t count = u16(zip.size() - 12);
+	size_t cd = u32(zip.size() - 6);
+	for (size_t i = 0; i < count; ++ i) {
+		if (u32(cd) != 0x02014b50) {
+			return false;
+		}
+
+		auto method = u16(cd + 10);
+		auto crc = u32(cd + 16);
+		auto csize = u32(cd + 20);
+		auto usize = u32(cd + 24);
+		auto nameLen = u16(cd + 28);
+		auto extraLen = u16(cd + 30);
+		auto offset = u32(cd + 42);
+		std::string name(zip.data() + cd + 46, nameLen);
+		cd += 46 + nameLen + extraLen;
+
+		if (u32(offset) != 0x04034b50) {
+			return false;
+		}
+
+		auto data = (const uint8_t *)zip.data() + offset + 30 + u16(offset + 26) + u16(offset + 28);
+		std::string out; out.resize(usize);
+		if (method == 8) {
+			z_stream stream;
+			memset(&stream, 0, sizeof(z_stream));
+			inflateInit2(&stream, -MAX_WBITS);
+			stream.next_in = (Bytef *)data;
+			stream.avail_in = csize;
+			stream.next_out = (Bytef *)out.data();
+			stream.avail_out = uInt(out.size());
+			auto err = inflate(&stream, Z_FINISH);
+			inflateEnd(&stream);
+			if (err != Z_STREAM_END || stream.total_out != usize) {
+				return false;
+			}
+		} else {
+			memcpy(out.data(), data, usize);
+		}
+
+		if (crc32(0, (const Bytef *)out.data(), uInt(out.size())) != crc) {
+			return false;
+		}
+
+		files.emplace(move(name), move(out));
+	}
+	return true;
+}
+
+struct ZipWriterTest : Test {
+	ZipWriterTest() : Test("ZipWriterTest") { }
+
+	virtual bool run() override {
+		StringStream stream;
+		size_t count = 0;
+		size_t passed = 0;
+		stream << "\n";
+
+		std::map<std::string, std::string> source;
+		source.emplace("mimetype", "application/vnd.oasis.opendocument.text");
+		for (size_t i = 0; i < 64; ++ i) {
+			std::string data;
+			uint32_t seed = uint32_t(i + 1);
+			for (size_t j = 0; j < i * 4096 + 17; ++ j) {
+				seed = seed * 1103515245 + 12345;
+				// limited alphabet, so data is compressible
+				data.push_back(char('a' + (seed >> 16) % 8));
+			}
+			source.emplace("content/file" + std::to_string(i) + ".txt", move(data));
+		}
+
+		auto write = [&] (ZipWriter &writer) {
+			writer.addFile("mimetype", StringView(source["mimetype"]), true);
+			writer.addDir("content");
+			for (auto &it : source) {
+				if (it.first != "mimetype" && it.first != "content/file7.txt") {
+					if (!writer.addFile(it.first, StringView(it.second))) {
+						return false;
+					}
+				}
+			}
+
+			// streamed entry, written in small chunks
+			auto &big = source["content/file7.txt"];
+			writer.beginFile("content/file7.txt");
+			for (size_t i = 0; i < big.size(); i += 1000) {
+				writer.write(StringView(big).sub(i, 1000));
+			}
+			writer.endFile();
+			return writer.finalize();
+		};
+
+		auto check = [&] (const std::string &zip) {
+			std::map<std::string, std::string> files;
+			if (!ZipWriterTest_read(zip, files)) {
+				return false;
+			}
+			if (zip.compare(30, 8, "mimetype") != 0 || files["content/"] != std::string()) {
+				return false;
+			}
+			files.erase("content/");
+			return files == source;
+		};
+
+		runTest(stream, "Sequential", count, passed, [&] {
+			std::ostringstream out;
+			ZipWriter writer(out);
+			return write(writer) && check(out.str());
+		});
+
+		runTest(stream, "Parallel", count, passed, [&] {
+			auto queue = Rc<thread::TaskQueue>::alloc(4);
+			queue->spawnWorkers();
+
+			std::ostringstream out;
+			bool ret = false;
+			do {
+				ZipWriter writer(out, queue, 4);
+				ret = write(writer) && check(out.str());
+			} while (0);
+
+			queue->waitForAll();
+			queue->cancelWorkers();
+			return ret;
+		});
+
+		runTest(stream, "Long names", count, passed, [&] {
+			std::ostringstream out;
+			ZipWriter writer(out);
+			std::string name(size_t(maxOf<uint16_t>()) + 1, 'a');
+			if (writer.addFile(name, StringView("data")) || writer.addDir(name) || writer.beginFile(name)) {
+				return false;
+			}
+
+			// rejected entry does not break the archive
+			name.pop_back();
+			if (!writer.addFile(name, StringView("data")) || !writer.finalize()) {
+				return false;
+			}
+
+			std::map<std::string, std::string> files;
+			return ZipWriterTest_read(out.str(), files) && files.size() == 1 && files[name] == "data";
+		});
+
+		_desc = stream.str();
+
+		return count == passed;
+	}
+} _ZipWriterTest;
+
 }
@@ -31,6 +31,7 @@ THE SOFTWARE.
 
 #include "PugTest.cc"
 #include "UploadTest.cc"
+#include "ViewsTest.cc"
 
 NS_SA_EXT_BEGIN(test)
 
@@ -75,11 +76,13 @@ protected:
 	Scheme _refs = Scheme("refs", Scheme::Options::WithDelta);
 	Scheme _subobjects = Scheme("subobjects");
 	Scheme _images = Scheme("images");
+	Scheme _viewOwners = Scheme("view_owners");
+	Scheme _viewItems = Scheme("view_items");
 };
 
 TestHandler::TestHandler(Server &serv, const String &name, const data::Value &dict)
 : ServerComponent(serv, name, dict) {
-	exportValues(_objects, _refs, _subobjects, _images);
+	exportValues(_objects, _refs, _subobjects, _images, _viewOwners, _viewItems);
 
 	using namespace storage;
 
@@ -142,6 +145,18 @@ TestHandler::TestHandler(Server &serv, const String &name, const data::Value &di
 	},
 			AccessRole::Admin(AccessRoleId::Authorized)
 	);
+
+	_viewOwners.define({
+		Field::Text("name"),
+		Field::View("items", _viewItems, storage::ViewFn([this] (const Scheme &objScheme, const data::Value &obj) -> bool {
+			return obj.getInteger("value") > 0;
+		}), Vector<String>{"value", "owner"}, storage::FieldView::Deferred),
+	});
+
+	_viewItems.define({
+		Field::Integer("value"),
+		Field::Object("owner", _viewOwners),
+	});
 }
 
 void TestHandler::onChildInit(Server &serv) {
@@ -157,6 +172,7 @@ void TestHandler::onChildInit(Server &serv) {
 	serv.addHandler("/handler", SA_HANDLER(TestSelectHandler));
 	serv.addHandler("/pug/", SA_HANDLER(TestPugHandler));
 	serv.addHandler("/upload/", SA_HANDLER(TestUploadHandler));
+	serv.addHandler("/views/", SA_HANDLER(TestViewsHandler));
 }
 
 void TestHandler::onStorageTransaction(storage::Transaction &t) {
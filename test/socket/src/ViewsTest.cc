@@ -0,0 +1,146 @@
+/**
+Copyright (c) 2020 Roman Katuntsev <sbkarr@stappler.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+**/
+
+#include "Define.h"
+
+NS_SA_EXT_BEGIN(test)
+
+// Deferred view "view_owners.items" lists positive items of owner; items are queued on update and added
+// to view in batches by processDeferredViews or waitForViews. Async view task is scheduled with request pool,
+// so, it can not process queue before test is finished
+class TestViewsHandler : public RequestHandler {
+public:
+	virtual bool isRequestPermitted(Request & rctx) override {
+		return true;
+	}
+
+	virtual int onTranslateName(Request &rctx) override {
+		if (_subPath != "/deferred") {
+			return HTTP_NOT_FOUND;
+		}
+
+		auto owners = rctx.server().getScheme("view_owners");
+		auto items = rctx.server().getScheme("view_items");
+		auto field = owners ? owners->getField("items") : nullptr;
+		if (!owners || !items || !field) {
+			return HTTP_NOT_FOUND;
+		}
+
+		auto view = field->getSlot<storage::FieldView>();
+		auto t = storage::Transaction::acquire(rctx.storage());
+
+		data::Value result;
+		bool success = true;
+		auto check = [&] (bool value, const StringView &name) {
+			result.setBool(value, name);
+			success = success && value;
+		};
+
+		auto getView = [&] (int64_t ownerId) {
+			Vector<int64_t> ret;
+			for (auto &it : owners->getProperty(t, ownerId, "items").asArray()) {
+				ret.emplace_back(it.getInteger("__oid"));
+			}
+			std::sort(ret.begin(), ret.end());
+			return ret;
+		};
+
+		auto getPending = [&] () {
+			return owners->getViewQueueStatus(t, *field).pending;
+		};
+
+		// queue can be left by interrupted run
+		check(owners->waitForViews(t, TimeInterval::seconds(10)), "cleanup");
+
+		auto start = Time::now();
+		auto owner = owners->create(t, data::Value({ pair("name", data::Value("deferred")) }));
+		auto ownerId = owner.getInteger("__oid");
+
+		Vector<int64_t> ids;
+		Vector<int64_t> visible;
+		for (int64_t value : { 1, -2, 3, -4, 5 }) {
+			auto item = items->create(t, data::Value({ pair("value", data::Value(value)), pair("owner", data::Value(ownerId)) }));
+			ids.emplace_back(item.getInteger("__oid"));
+			if (value > 0) {
+				visible.emplace_back(ids.back());
+			}
+		}
+		std::sort(ids.begin(), ids.end());
+		std::sort(visible.begin(), visible.end());
+
+		// updated objects are queued, view is not changed until queue is processed
+		check(getPending() == ids.size(), "queued");
+		check(getView(ownerId).empty(), "notApplied");
+
+		// entries are claimed in batches of requested size in id order, with time of oldest entry;
+		// transaction is cancelled, so, claimed entries are returned into queue
+		t.performAsSystem([&] () -> bool {
+			Time oldest;
+			auto first = t.popViewUpdates(*owners, *view, 2, &oldest);
+			auto rest = t.popViewUpdates(*owners, *view, ids.size());
+			auto none = t.popViewUpdates(*owners, *view, ids.size());
+
+			check(first.size() == 2 && std::is_sorted(first.begin(), first.end()), "popBatch");
+			check(rest.size() == ids.size() - 2 && std::is_sorted(rest.begin(), rest.end()), "popRest");
+			check(none.empty(), "popEmpty");
+			check(oldest >= start - TimeInterval::seconds(1) && oldest <= Time::now(), "popOldest");
+
+			Vector<int64_t> all(first); all.insert(all.end(), rest.begin(), rest.end());
+			std::sort(all.begin(), all.end());
+			check(all == ids, "popIds");
+			return false;
+		});
+		check(getPending() == ids.size(), "popRollback");
+
+		// batch is processed with single view update, only objects, accepted by view function, are added
+		check(items->processDeferredViews(t, *field, 2) == 2, "processBatch");
+		check(getPending() == ids.size() - 2, "processPending");
+		while (items->processDeferredViews(t, *field, 2) > 0) { }
+		check(getPending() == 0, "processAll");
+		check(getView(ownerId) == visible, "processView");
+
+		// update is queued again and applied by waitForViews; without transaction every batch is committed
+		items->update(t, uint64_t(visible.front()), data::Value({ pair("value", data::Value(-1)) }));
+		check(getPending() == 1, "updateQueued");
+		check(owners->waitForViews(t, TimeInterval::seconds(10)), "wait");
+		check(getPending() == 0, "waitPending");
+		visible.erase(visible.begin());
+		check(getView(ownerId) == visible, "waitView");
+
+		// within transaction, entries of current transaction are processed without waiting
+		t.perform([&] () -> bool {
+			items->update(t, uint64_t(visible.front()), data::Value({ pair("value", data::Value(-1)) }));
+			auto waitStart = Time::now();
+			check(owners->waitForViews(t, TimeInterval::seconds(10)), "transactionWait");
+			check(Time::now() - waitStart < TimeInterval::seconds(1), "transactionNoSleep");
+			return true;
+		});
+		visible.erase(visible.begin());
+		check(getView(ownerId) == visible, "transactionView");
+
+		result.setBool(success, "success");
+		rctx.writeData(result);
+		return DONE;
+	}
+};
+
+NS_SA_EXT_END(test)
@@ -31,6 +31,9 @@
 #include "SPugLexer.h"
 #include "SPugTemplate.h"
 #include "SPugContext.h"
+#include "SPugCache.h"
+#include "SPugOutput.h"
+#include "SPugExpression.h"
 
 using namespace stappler;
 
@@ -401,6 +404,405 @@ else
 	p Failure
 )";
 
+struct Sample {
+	StringView name;
+	StringView text;
+};
+
+static Sample s_samples[] = {
+	Sample{"attr", s_attrText},
+	Sample{"attr2", s_attrText2},
+	Sample{"attr3", s_attrText3},
+	Sample{"output", s_outputText},
+	Sample{"code", s_codeText},
+	Sample{"var", s_varText},
+	Sample{"call", s_callText},
+	Sample{"tag", s_tagText},
+	Sample{"case", s_caseText},
+	Sample{"if", s_ifText},
+	Sample{"each", s_eachText},
+	Sample{"condOp", s_condOpText},
+	Sample{"while", s_whileText},
+	Sample{"interp", s_InterpText},
+	Sample{"tagInterp", s_tagInterpText},
+	Sample{"tagMixin", s_tagMixinText},
+	Sample{"tagMixinList", s_tagMixinListText},
+	Sample{"tagIf", s_tagIfTest},
+	Sample{"not", s_notTest},
+	Sample{"recursion", s_recursionTest},
+	Sample{"undefined", s_undefinedTest},
+};
+
+static std::ostringstream s_errors;
+
+static void initContext(pug::Context &ctx) {
+	using Value = pug::Value;
+
+	ctx.loadDefaults();
+	ctx.set("test", Value{
+		pair("value", Value("value1")),
+		pair("next", Value{
+			pair("value", Value("value2")),
+			pair("next", Value{
+				pair("value", Value("value3")),
+			}),
+		}),
+	});
+	ctx.set("world", Value("World"));
+	ctx.set("func", [] (pug::VarStorage &self, pug::Var *args, size_t count) -> pug::Var {
+		if (count == 0) {
+			return pug::Var(Value("No arguments"));
+		} else {
+			memory::PoolInterface::StringStreamType stream;
+			for (size_t i = 0; i < count; ++ i) {
+				stream << " " << args[i].readValue();
+			}
+			return pug::Var(Value(stream.str()));
+		}
+		return pug::Var();
+	});
+}
+
+static String renderSample(const pug::Template *tpl) {
+	std::ostringstream stream;
+	pug::Context ctx;
+	initContext(ctx);
+	tpl->run(ctx, stream);
+	return stream.str();
+}
+
+static String samplePath(const Sample &sample, bool pretty) {
+	return filesystem::currentDir(toString("html/", sample.name, pretty ? ".pretty.html" : ".html"));
+}
+
+static bool printSamples() {
+	for (auto pretty : { false, true }) {
+		auto opts = pretty ? pug::Template::Options::getPretty() : pug::Template::Options::getDefault();
+		for (auto &it : s_samples) {
+			if (auto tpl = pug::Template::read(it.text, opts)) {
+				filesystem::write(samplePath(it, pretty), renderSample(tpl));
+			}
+		}
+	}
+	return true;
+}
+
+// Expected output was produced with tree-walking renderer, that was used before templates were compiled
+// into flat program, so compiled program should produce exactly the same text
+static bool testProgram() {
+	bool success = true;
+	for (auto pretty : { false, true }) {
+		auto opts = pretty ? pug::Template::Options::getPretty() : pug::Template::Options::getDefault();
+		for (auto &it : s_samples) {
+			auto tpl = pug::Template::read(it.text, opts);
+			if (!tpl) {
+				std::cout << "  " << it.name << ": fail to compile\n";
+				success = false;
+				continue;
+			}
+
+			auto expected = filesystem::readTextFile(samplePath(it, pretty));
+			auto result = renderSample(tpl);
+			if (result != expected) {
+				std::cout << "  " << it.name << (pretty ? " (pretty)" : "") << ": output differs:\n" << result << "\n";
+				success = false;
+			} else if (renderSample(tpl) != result) {
+				std::cout << "  " << it.name << (pretty ? " (pretty)" : "") << ": second run differs\n";
+				success = false;
+			}
+		}
+	}
+	return success;
+}
+
+// removes callable from first call in encoded expression
+static bool dropCallee(pug::Value &expr) {
+	if (!expr.isArray() || expr.size() != 6) {
+		return false;
+	}
+	if (expr.getInteger(0) == toInt(pug::Expression::Call)) {
+		expr.setValue(pug::Value(), 4);
+		return true;
+	}
+	return dropCallee(expr.getValue(4)) || dropCallee(expr.getValue(5));
+}
+
+static bool testEncode() {
+	bool success = true;
+	for (auto &it : s_samples) {
+		auto pool = memory::pool::create(memory::pool::acquire());
+		auto tpl = pug::Template::read(it.text);
+		auto data = data::write(tpl->encode(), data::EncodeFormat::Cbor);
+		auto decoded = pug::Template::decode(pool, data::read<BytesView, memory::PoolInterface>(data));
+		if (!decoded) {
+			std::cout << "  " << it.name << ": fail to decode\n";
+			success = false;
+		} else if (renderSample(decoded) != renderSample(tpl)) {
+			std::cout << "  " << it.name << ": decoded template output differs\n";
+			success = false;
+		}
+
+		// programs with broken structure should be rejected
+		auto val = tpl->encode();
+		auto &ops = val.getValue("ops");
+		for (size_t i = 0; i < ops.size(); ++ i) {
+			auto broken = val;
+			broken.getValue("ops").getValue(i).setInteger(ops.size() + 1, 1);
+			if (pug::Template::decode(pool, broken)) {
+				std::cout << "  " << it.name << ": out of range op " << i << " was accepted\n";
+				success = false;
+			}
+
+			broken = val;
+			broken.getValue("ops").getValue(i).setInteger(toInt(pug::Template::MixinCall) + 1, 0);
+			if (pug::Template::decode(pool, broken)) {
+				std::cout << "  " << it.name << ": invalid op type " << i << " was accepted\n";
+				success = false;
+			}
+
+			broken = val;
+			if (dropCallee(broken.getValue("ops").getValue(i).getValue(4)) && pug::Template::decode(pool, broken)) {
+				std::cout << "  " << it.name << ": call without callable in op " << i << " was accepted\n";
+				success = false;
+			}
+
+			broken = val;
+			auto &op = broken.getValue("ops").getValue(i);
+			if (op.getInteger(0) == toInt(pug::Template::ControlMixin)) {
+				auto &expr = op.getValue(4);
+				if (expr.getInteger(0) == toInt(pug::Expression::Call)) {
+					expr.getValue(4).setBool(false, 2);
+				} else {
+					expr.setBool(false, 2);
+				}
+				if (pug::Template::decode(pool, broken)) {
+					std::cout << "  " << it.name << ": mixin without name in op " << i << " was accepted\n";
+					success = false;
+				}
+			}
+		}
+		memory::pool::destroy(pool);
+	}
+	return success;
+}
+
+static bool testCache() {
+	bool success = true;
+
+	pug::Cache cache(pug::Template::Options::getDefault(), [&] (const StringView &err) {
+		s_errors << err;
+	});
+
+	Map<String, String> expected;
+	for (auto &it : s_samples) {
+		auto path = toString("virtual://", it.name, ".pug");
+		cache.addTemplate(path, it.text.str<memory::PoolInterface>());
+		expected.emplace(path, renderSample(pug::Template::read(it.text)));
+	}
+
+	auto run = [&] (const StringView &path) -> String {
+		std::ostringstream stream;
+		cache.runTemplate(path, [&] (pug::Context &ctx, const pug::Template &) -> bool {
+			initContext(ctx);
+			return true;
+		}, stream);
+		return stream.str();
+	};
+
+	// readers use snapshots without lock, while new templates are published
+	std::atomic<size_t> failed(0);
+	std::atomic<bool> finished(false);
+	Vector<std::thread> threads;
+	for (size_t i = 0; i < 4; ++ i) {
+		threads.emplace_back([&] {
+			auto pool = memory::pool::create();
+			memory::pool::push(pool);
+			while (!finished.load()) {
+				for (auto &it : expected) {
+					if (run(it.first) != it.second) {
+						++ failed;
+					}
+				}
+			}
+			memory::pool::pop();
+			memory::pool::destroy(pool);
+		});
+	}
+
+	for (size_t i = 0; i < 200; ++ i) {
+		cache.addContent(toString("virtual://content-", i), string::ToStringTraits<memory::PoolInterface>::toString("content ", i));
+	}
+
+	// every retired snapshot holds reference to template; they should be released while readers are active,
+	// when readers from previous epochs are finished
+	auto ref = cache.get(expected.begin()->first);
+	for (size_t i = 0; i < 1000 && ref->getReferenceCount() > 2; ++ i) {
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+		cache.update(memory::pool::acquire());
+	}
+	if (ref->getReferenceCount() > 2) {
+		std::cout << "  retired snapshots were not released under read load: " << ref->getReferenceCount() - 2 << "\n";
+		success = false;
+	}
+	ref = nullptr;
+
+	finished.store(true);
+	for (auto &it : threads) {
+		it.join();
+	}
+
+	if (failed.load() > 0) {
+		std::cout << "  " << failed.load() << " concurrent runs produced wrong output\n";
+		success = false;
+	}
+
+	// compiled templates are restored from cache dir
+	auto dir = filesystem::currentDir("cache");
+	filesystem::remove(dir, true, true);
+	for (size_t i = 0; i < 2; ++ i) {
+		pug::Cache fileCache;
+		fileCache.setCacheDir(dir);
+		fileCache.addFile(filesystem::currentDir("test/test.stl"));
+
+		std::ostringstream stream;
+		fileCache.runTemplate(filesystem::currentDir("test/test.stl"), nullptr, stream);
+		auto result = stream.str();
+		auto tpl = pug::Template::read(filesystem::readTextFile(filesystem::currentDir("test/test.stl")));
+		std::ostringstream reference;
+		pug::Context ctx;
+		ctx.loadDefaults();
+		tpl->run(ctx, reference);
+		if (result.empty() || result != reference.str()) {
+			std::cout << "  cached template output differs (pass " << i << ")\n";
+			success = false;
+		}
+	}
+
+	size_t files = 0;
+	filesystem::ftw(dir, [&] (const StringView &path, bool isFile) {
+		if (isFile && path.ends_with(".stlc")) {
+			++ files;
+		}
+	});
+	if (files != 1) {
+		std::cout << "  expected one compiled template in cache dir, found " << files << "\n";
+		success = false;
+	}
+	filesystem::remove(dir, true, true);
+
+	return success;
+}
+
+static bool testOutput() {
+	bool success = true;
+
+	for (auto &it : s_samples) {
+		auto tpl = pug::Template::read(it.text, pug::Template::Options::getPretty());
+		auto expected = renderSample(tpl);
+
+		// small threshold: output is passed to consumer in many portions
+		String result;
+		size_t calls = 0;
+		pug::Output output([&] (const StringView &str) -> bool {
+			result.append(str.data(), str.size());
+			++ calls;
+			return true;
+		}, 64);
+
+		pug::Context ctx;
+		initContext(ctx);
+		tpl->run(ctx, output);
+		output.flush();
+
+		if (result != expected || output.getFlushed() != expected.size()) {
+			std::cout << "  " << it.name << ": sink output differs\n";
+			success = false;
+		} else if (expected.size() > 256 && calls < 2) {
+			std::cout << "  " << it.name << ": output was not flushed before rendering was finished\n";
+			success = false;
+		}
+	}
+
+	// slices stay valid until flush callback returns, so consumer can keep them without copying
+	String big(pug::Output::BlockSize * 3, 'x');
+	auto tpl = pug::Template::read(StringView(R"(
+mixin item(value)
+	li= value
+ul
+	- for (var x = 0; x < 100; x++)
+		+item(x)
+p= big
+p= "after"
+)"));
+
+	String result;
+	Vector<StringView> pending;
+	size_t maxSlice = 0;
+	pug::Output output([&] (const StringView &str) -> bool {
+		pending.emplace_back(str);
+		maxSlice = std::max(maxSlice, str.size());
+		return true;
+	}, 256);
+	output.setFlushCallback([&] () -> bool {
+		for (auto &it : pending) {
+			result.append(it.data(), it.size());
+		}
+		pending.clear();
+		return true;
+	});
+
+	pug::Context ctx;
+	ctx.loadDefaults();
+	ctx.set("big", pug::Value(big));
+	tpl->run(ctx, output);
+	output.flush();
+
+	std::ostringstream reference;
+	pug::Context refCtx;
+	refCtx.loadDefaults();
+	refCtx.set("big", pug::Value(big));
+	tpl->run(refCtx, reference);
+
+	if (result != reference.str() || !pending.empty()) {
+		std::cout << "  collected slices differ from stream output\n";
+		success = false;
+	}
+
+	// large dynamic value should be passed to consumer as a whole, without copying into blocks
+	if (maxSlice < big.size()) {
+		std::cout << "  large value was split into blocks\n";
+		success = false;
+	}
+
+	// rejected data stops output
+	size_t received = 0;
+	pug::Output failed([&] (const StringView &str) -> bool {
+		received += str.size();
+		return false;
+	}, 64);
+	pug::Context failedCtx;
+	failedCtx.loadDefaults();
+	failedCtx.set("big", pug::Value(big));
+	tpl->run(failedCtx, failed);
+	if (failed.flush() || received == 0 || received > 64 + pug::Output::BlockSize) {
+		std::cout << "  output was not stopped by consumer\n";
+		success = false;
+	}
+
+	return success;
+}
+
+static bool runTest(const StringView &name, const Callback<bool()> &cb) {
+	auto pool = memory::pool::create(memory::pool::acquire());
+	memory::pool::push(pool);
+	auto ret = cb();
+	memory::pool::pop();
+	memory::pool::destroy(pool);
+
+	std::cout << "==== " << name << ": " << (ret ? "passed" : "failed") << "\n";
+	return ret;
+}
+
 int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 	if (c == 'v') {
 		ret.setBool(true, "verbose");
@@ -411,6 +813,8 @@ int parseOptionSwitch(data::Value &ret, char c, const char *str) {
 int parseOptionString(data::Value &ret, const StringView &str, int argc, const char * argv[]) {
 	if (str == "v") {
 		ret.setBool(true, "verbose");
+	} else if (str == "print") {
+		ret.setBool(true, "print");
 	}
 	return 1;
 }
@@ -426,48 +830,23 @@ int _spMain(argc, argv) {
 		std::cout << " Options: " << stappler::data::EncodeFormat::Pretty << opts << "\n";
 	};
 
-	auto pool = memory::pool::create(nullptr);
+	memory::pool::initialize();
+	auto pool = memory::pool::create();
 	memory::pool::push(pool);
 
-	//auto &args = opts.getValue("args");
-
-	pug::Template * tpl = pug::Template::read(s_undefinedTest, pug::Template::Options::getPretty());
-
-	using Value = pug::Value;
-
-	pug::Context ctx;
-
-	tpl->describe(std::cout, true);
-
-	/*ctx.set("test", Value{
-		pair("value", Value("value1")),
-		pair("next", Value{
-			pair("value", Value("value2")),
-			pair("next", Value{
-				pair("value", Value("value3")),
-			}),
-		}),
-	});
-	ctx.set("world", Value("World"));
-	ctx.set("func", [] (pug::VarStorage &self, pug::Var *args, size_t count) -> pug::Var {
-		if (count == 0) {
-			return pug::Var(Value("No arguments"));
-		} else {
-			memory::PoolInterface::StringStreamType stream;
-			for (size_t i = 0; i < count; ++ i) {
-				stream << " " << args[i].readValue();
-			}
-			return pug::Var(Value(stream.str()));
-		}
-		return pug::Var();
-	});*/
-	/*ctx.set("unit", Value{
-		pair("role", Value(10)),
-	});*/
-
-	tpl->run(ctx, std::cout);
+	size_t failed = 0;
+	if (opts.getBool("print")) {
+		// rewrite expected output for samples
+		printSamples();
+	} else {
+		if (!runTest("Program", &testProgram)) { ++ failed; }
+		if (!runTest("Encode", &testEncode)) { ++ failed; }
+		if (!runTest("Cache", &testCache)) { ++ failed; }
+		if (!runTest("Output", &testOutput)) { ++ failed; }
+		std::cout << "==== Failed: " << failed << "\n";
+	}
 
 	memory::pool::pop();
 
-	return 0;
+	return failed > 0 ? 1 : 0;
 }